@@ -27,8 +27,13 @@ extern "C" void slog_to_debug(const char *tag,
 // Core systems
 #include "src/Audio/AudioEngine.h"
 #include "src/Game/ECS.h"
+#include "src/Game/EcsBenchmark.h"
+#include "src/Game/FixedTimestep.h"
 #include "src/Game/GameState.h"
+#include "src/Game/PhysicsBenchmark.h"
 #include "src/Game/Player.h"
+#include "src/Game/SimulationRecording.h"
+#include "src/Game/SystemScheduler.h"
 #include "src/Geometry/Quad.h"
 #include "src/Model/ModelLoader.h"
 #include "src/Model/ModelMetadata.h"
@@ -40,9 +45,14 @@ extern "C" void slog_to_debug(const char *tag,
 #include "src/Editor/EntityPlacement.h"
 #include "src/Editor/WireframeManager.h"
 #include "src/Editor/TransformGizmo.h"  // ADDED
+#include "src/Utilities/JobSystem.h"
 #include "src/Utilities/RaycastHelper.h"
 
+#include <algorithm>
+#include <random>
 #include <stdlib.h>
+#include <string.h>
+#include <thread>
 #include <time.h>
 #include <vector>
 
@@ -60,6 +70,17 @@ static UIManager ui;
 static GameStateManager gameState;
 static ECS ecs;
 static PlayerController *player = nullptr;
+static JobSystem jobs;
+static SystemScheduler scheduler;
+static SystemScheduler physicsScheduler;  // Run once per fixed step
+static FixedTimestep physicsStep;
+static PhysicsBenchmark physicsBenchmark;
+static SimulationRecorder recorder;
+
+// Per-frame inputs read by the scheduled systems
+static float frameDt = 0.0f;
+static float frameWidth = 0.0f;
+static float frameHeight = 0.0f;
 
 // Editor systems
 static EditorUI editorUI;
@@ -127,6 +148,43 @@ void OnGuiVisibilityChanged(bool visible) {
     printf("GUI %s\n", visible ? "opened" : "closed");
 }
 
+// Systems declare what they read and write so the scheduler can run
+// non-conflicting ones side by side
+void RegisterSystems() {
+    scheduler.AddSystem("AI",
+        ComponentMaskOf<AIController, Transform, CharacterController>(),
+        ComponentMaskOf<AIController, Transform, CharacterController>(),
+        []() { if (gameState.IsPlaying()) ecs.UpdateAI(frameDt); });
+    scheduler.AddSystem("Animation",
+        ComponentMaskOf<Animator>(),
+        ComponentMaskOf<Animator>(),
+        []() { if (gameState.IsPlaying()) ecs.UpdateAnimation(frameDt); });
+    scheduler.AddSystem("Billboards",
+        ComponentMaskOf<Billboard, Transform>(),
+        ComponentMaskOf<Transform>(),
+        []() { if (player) ecs.UpdateBillboards(player->CameraPosition()); });
+    scheduler.AddSystem("ScreenSpace",
+        ComponentMaskOf<ScreenSpace>(),
+        ComponentMaskOf<Transform>(),
+        []() { ecs.UpdateScreenSpace(frameWidth, frameHeight); });
+
+    // Physics advances in fixed steps, independent of the frame rate.
+    // Characters move first so the solver pushes bodies out of them.
+    // All three query or rebuild the collider index and hash grid.
+    physicsScheduler.AddSystem("Characters",
+        ComponentMaskOf<CharacterController, Collider, Rigidbody, Transform>() | kColliderIndexBit,
+        ComponentMaskOf<CharacterController, Rigidbody, Transform>() | kColliderIndexBit,
+        []() { ecs.UpdateCharacters(physicsStep.StepSize()); });
+    physicsScheduler.AddSystem("Physics",
+        ComponentMaskOf<Collider, Rigidbody, Transform>() | kColliderIndexBit,
+        ComponentMaskOf<Rigidbody, Transform>() | kColliderIndexBit,
+        []() { ecs.UpdatePhysics(physicsStep.StepSize()); });
+    physicsScheduler.AddSystem("Collisions",
+        ComponentMaskOf<Collider, Rigidbody, Transform>() | kColliderIndexBit,
+        ComponentMaskOf<Rigidbody, Transform>() | kColliderIndexBit,
+        []() { ecs.UpdateCollisions(physicsStep.StepSize()); });
+}
+
 void init(void) {
 #ifdef _WIN32
     AllocConsole();
@@ -148,11 +206,20 @@ void init(void) {
     desc.logger.func = slog_to_debug;
     sg_setup(&desc);
 
+    jobs.Init();
+    ecs.SetJobSystem(&jobs);
+    ecs.SetHashGridLayers(kEnemyCollisionLayer);  // Enemy waves are thousands of same-sized spheres
+    RegisterSystems();
+
     ui.Setup();
     ui.SetGuiVisibilityCallback(OnGuiVisibilityChanged);
 
     // Initialize editor systems
     editorUI.Init(&ecs, &audio, &gameState);
+    editorUI.SetScheduler(&jobs, &scheduler);
+    editorUI.SetPhysicsStep(&physicsStep, &physicsScheduler);
+    editorUI.SetBenchmark(&physicsBenchmark, HMM_Vec3(20.0f, -4.0f, 20.0f));  // On the ground, off to the side
+    editorUI.SetRecorder(&recorder);
     wireframeManager.Init(&ecs, &renderer);
     entityPlacement.Init(&ecs, &renderer, &treeEntities, &enemyEntities, &lightEntities);
     transformGizmo.Init(&ecs, &renderer);  // ADDED
@@ -166,6 +233,13 @@ void init(void) {
         ImGui::Separator();
         editorUI.RenderPerformanceStats((float)sapp_frame_duration());
         
+        if (ImGui::CollapsingHeader("Physics Benchmark")) {
+            editorUI.RenderBenchmarkControls();
+        }
+        if (ImGui::CollapsingHeader("Simulation Recording")) {
+            editorUI.RenderRecordingControls();
+        }
+        
         if (gameState.IsEdit()) {
             ImGui::Separator();
             
@@ -180,6 +254,10 @@ void init(void) {
             }
 
             editorUI.RenderPlacementControls(placementMode, placementMeshId, meshTreeId, meshEnemyId);
+
+            if (ImGui::CollapsingHeader("Scene Snapshot")) {
+                editorUI.RenderSnapshotControls(renderer);
+            }
         }
 
         if (player) {
@@ -235,6 +313,10 @@ void init(void) {
     // Option 2: Mesh collider (for complex terrain)
     // ecs.CreateMeshCollider(groundEntity, models3D[3]);
 
+    // Option 3: Heightfield collider (large terrain; also from a heightmap with
+    // CreateHeightfieldColliderFromImage())
+    // ecs.CreateHeightfieldCollider(groundEntity, models3D[3], 1.0f);
+
     Selectable groundSel;
     groundSel.name = "Ground";
     groundSel.volumeType = SelectionVolumeType::Box;
@@ -247,6 +329,7 @@ void init(void) {
     printf("\n=== SPAWNING TREES ===\n");
     treeEntities.clear();
     srand((unsigned int)time(nullptr));
+    ecs.SeedRandom((uint32_t)time(nullptr));  // Recordings reseed it
     for (int i = 0; i < 2; ++i) {
         EntityId treeId = ecs.CreateEntity();
         Transform t;
@@ -312,23 +395,29 @@ void init(void) {
 
         ecs.AddRenderable(eid, meshEnemyId, renderer);
 
-        // ADDED: Sphere collider for enemies (dynamic, affected by physics)
+        // Sphere collider for enemies, swept by their character controller
         Collider enemyCollider;
         enemyCollider.type = ColliderType::Sphere;
         enemyCollider.radius = 0.5f; // Enemy body radius
         enemyCollider.isStatic = false;
         enemyCollider.isTrigger = false;
+        enemyCollider.collisionLayer = kEnemyCollisionLayer;
         ecs.AddCollider(eid, enemyCollider);
 
-        // ADDED: Rigidbody for enemies (so they can be pushed, affected by physics)
+        // Kinematic rigidbody: enemies walk with a character controller
+        // and push other bodies, but the solver never pushes them
         Rigidbody enemyRb;
-        enemyRb.mass = 50.0f; // Heavy enough to not be easily pushed
-        enemyRb.affectedByGravity = true;
-        enemyRb.drag = 0.5f; // Some air resistance
+        enemyRb.mass = 50.0f;
+        enemyRb.affectedByGravity = false; // The character controller applies gravity
+        enemyRb.drag = 0.0f;
         enemyRb.bounciness = 0.0f; // Don't bounce
-        enemyRb.isKinematic = false; // Affected by physics
+        enemyRb.isKinematic = true;
+        enemyRb.canSleep = false;
         ecs.AddRigidbody(eid, enemyRb);
 
+        CharacterController enemyController;
+        ecs.AddCharacter(eid, enemyController);
+
         // CHANGED: Use sphere selection volume
         Selectable enemySel;
         enemySel.name = "Enemy";
@@ -453,8 +542,12 @@ void frame(void) {
             placementMode ? " | PLACEMENT ACTIVE" : "");
     ui.DebugText(debugText);
 
+    // Drop the selection if the selected entity was destroyed (stale handle)
+    if (selectedEntity != -1 && !ecs.IsAlive(selectedEntity)) {
+        selectedEntity = -1;
+    }
+
     // Wireframe management
-    static EntityId previousSelection = -1;
     static bool wasInEditMode = false;
     bool isEditMode = gameState.IsEdit();
     bool modeChanged = (isEditMode != wasInEditMode);
@@ -463,34 +556,54 @@ void frame(void) {
         wireframeManager.DestroyAllWireframes();
         transformGizmo.DestroyGizmo();  // ADDED
         entityPlacement.DestroyGhostPreview();  // ADDED
-        previousSelection = -1;
         placementMode = false;
     }
 
+    // A recording covers play mode only
+    if (recorder.IsRecording() && !gameState.IsPlaying()) recorder.End();
+
+    // Deterministic mode (recording): every frame is exactly one physics
+    // step, whatever time it took
+    const bool fixedFrames = ecs.IsDeterministic() && gameState.IsPlaying();
+    const float simDt = fixedFrames ? physicsStep.StepSize() : dt;
+
     // Update player
-    if (player) player->Update(dt);
+    if (player) player->Update(simDt);
+    recorder.CaptureInput();
 
-    // Run ECS systems
+    // Run per-frame ECS systems (AI, animation, billboards, screen space)
+    frameDt = simDt;
+    frameWidth = (float)width;
+    frameHeight = (float)height;
+    scheduler.Run(jobs);
+
+    // Fixed physics steps owed for this frame; rendering is drawn the
+    // remaining fraction of a step between the last two states
     if (gameState.IsPlaying()) {
-        ecs.UpdateAI(dt);
-        ecs.UpdatePhysics(dt);
-        ecs.UpdateCollisions(dt); // ADDED: Enable collision detection
-        ecs.UpdateAnimation(dt);
+        int steps = fixedFrames ? 1 : physicsStep.Advance(sapp_frame_duration());
+        for (int i = 0; i < steps; ++i) {
+            ecs.BeginPhysicsStep();
+            physicsScheduler.Run(jobs);
+            ecs.EndPhysicsStep();
+            physicsBenchmark.AfterStep(ecs, physicsStep.StepSize());
+        }
+        recorder.EndFrame();
+        ecs.SetInterpolationAlpha(fixedFrames ? 1.0f : physicsStep.Alpha());
+    } else {
+        physicsStep.Reset();
+        ecs.SetInterpolationAlpha(1.0f);
     }
 
-    if (player) {
-        ecs.UpdateBillboards(player->CameraPosition());
-    }
-    ecs.UpdateScreenSpace((float)width, (float)height);
+    // Sync point: apply structural changes recorded by systems and the editor
+    ecs.PlaybackCommands(renderer);
 
     // Update wireframes and gizmo in edit mode
     if (isEditMode) {
-        bool selectionChanged = (selectedEntity != previousSelection);
-        bool forceUpdate = selectionChanged || modeChanged;
-        wireframeManager.UpdateWireframes(selectedEntity, forceUpdate);
+        // Only entities whose components changed are touched (selection included)
+        wireframeManager.UpdateWireframes(selectedEntity, modeChanged);
         
         // ADDED: Update collision visualization
-        wireframeManager.UpdateCollisionVisuals(showCollisionShapes);
+        wireframeManager.UpdateCollisionVisuals(showCollisionShapes, selectedEntity);
         
         // CHANGED: Update transform gizmo (only if enabled)
         if (gizmoEnabled && selectedEntity != -1 && !placementMode) {
@@ -500,8 +613,6 @@ void frame(void) {
             transformGizmo.DestroyGizmo();
         }
         
-        previousSelection = selectedEntity;
-        
         // Update ghost preview in placement mode
         if (placementMode && player) {
             hmm_mat4 proj = HMM_Perspective(60.0f, (float)sapp_width() / (float)sapp_height(), 0.01f, 1000.0f);
@@ -540,9 +651,9 @@ void frame(void) {
 
     for (const auto &[entityId, light] : lights) {
         if (!light.enabled) continue;
-        auto transIt = transforms.find(entityId);
-        if (transIt != transforms.end()) {
-            lightPositions.push_back(transIt->second.GetWorldPosition());  // CHANGED: Use GetWorldPosition()
+        const Transform *lightTransform = transforms.Get(entityId);
+        if (lightTransform) {
+            lightPositions.push_back(ecs.GetWorldPosition(entityId));  // Follows parent transforms
             lightColors.push_back(light.color);
             lightIntensities.push_back(light.intensity);
             lightRadii.push_back(light.radius);
@@ -567,9 +678,12 @@ void frame(void) {
     ui.Render();  // UI renders LAST
     renderer.EndPass();
     sg_commit();
+
+    ecs.EndFrame();
 }
 
 void cleanup(void) {
+    jobs.Shutdown();
     ui.Shutdown();
     audio.Shutdown();
     renderer.Cleanup();
@@ -733,26 +847,20 @@ static void input(const sapp_event *ev) {
                     // FIXED: Use RaycastPlacement instead of GetPlacementPosition
                     RaycastHit hit = ecs.RaycastPlacement(rayOrigin, rayDir, 1000.0f);
                     
+                    EntityId newEntity = -1;
                     if (hit.hit) {
                         printf("Placing entity at raycast hit: (%.2f, %.2f, %.2f)\n", 
                                hit.point.X, hit.point.Y, hit.point.Z);
-                        entityPlacement.PlaceEntity(hit.point, placementMeshId, meshTreeId, meshEnemyId);
+                        newEntity = entityPlacement.PlaceEntity(hit.point, placementMeshId, meshTreeId, meshEnemyId);
                     } else {
                         // Fallback: place at fixed distance if no hit
                         hmm_vec3 fallbackPos = HMM_AddVec3(rayOrigin, HMM_MultiplyVec3f(rayDir, 10.0f));
                         printf("No raycast hit, placing at fallback: (%.2f, %.2f, %.2f)\n", 
                                fallbackPos.X, fallbackPos.Y, fallbackPos.Z);
-                        entityPlacement.PlaceEntity(fallbackPos, placementMeshId, meshTreeId, meshEnemyId);
+                        newEntity = entityPlacement.PlaceEntity(fallbackPos, placementMeshId, meshTreeId, meshEnemyId);
                     }
 
                     // Create wireframe for newly placed entity
-                    EntityId newEntity = -1;
-                    const auto &selectables = ecs.GetSelectables();
-                    for (const auto &[entityId, selectable] : selectables) {
-                        if (newEntity == -1 || entityId > newEntity) {
-                            newEntity = entityId;
-                        }
-                    }
                     if (newEntity != -1) {
                         wireframeManager.CreateOrUpdateWireframe(newEntity, false);
                     }
@@ -808,9 +916,126 @@ if (ev->type == SAPP_EVENTTYPE_KEY_DOWN && ev->key_code == SAPP_KEYCODE_P && gam
     }
 }
 
+// --replay <file>: re-simulates a recording without opening a window and
+// exits with 0 if every frame matched (see SimulationRecording.h)
+static int RunReplay(const char* path) {
+#ifdef _WIN32
+    AllocConsole();
+    FILE *dummy;
+    freopen_s(&dummy, "CONOUT$", "w", stdout);
+#endif
+    jobs.Init();
+    SimulationReplay::Result result = SimulationReplay::Run(path, &jobs);
+    jobs.Shutdown();
+    return result.loaded && result.firstDivergence < 0 ? 0 : 1;
+}
+
+// Fixed scene for the ray and sweep benchmarks: ground, trees, crates, barrels and an enemy crowd in the hash grid
+static constexpr float kQuerySceneRadius = 30.0f;
+
+static void BuildQueryScene(ECS& scene, const Model3D& tree) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto spot = [&](float y) { return HMM_Vec3(unit(rng) * kQuerySceneRadius, y, unit(rng) * kQuerySceneRadius); };
+    
+    EntityId ground = scene.CreateEntity();
+    scene.AddTransform(ground, Transform());
+    scene.CreatePlaneCollider(ground, HMM_Vec3(0.0f, 1.0f, 0.0f), 0.0f);
+    scene.SetHashGridLayers(kEnemyCollisionLayer);
+    
+    for (int i = 0; i < 400; ++i) {
+        EntityId id = scene.CreateEntity();
+        Transform t;
+        t.yaw = unit(rng) * 180.0f;
+        Collider collider;
+        collider.isStatic = true;
+        if (i < 20) {
+            t.position = spot(0.0f);
+            scene.AddTransform(id, t);
+            scene.CreateMeshCollider(id, tree);
+            continue;
+        } else if (i < 120) {
+            collider.type = ColliderType::Box;
+            collider.boxHalfExtents = HMM_Vec3(0.5f, 0.5f, 0.5f);
+            t.position = spot(0.5f);
+        } else if (i < 200) {
+            collider.type = ColliderType::Capsule;
+            collider.capsuleRadius = 0.4f;
+            collider.capsuleHeight = 1.0f;
+            t.position = spot(0.9f);
+        } else {
+            collider.type = ColliderType::Sphere;
+            collider.radius = 0.5f;
+            collider.collisionLayer = kEnemyCollisionLayer;
+            collider.isStatic = false;
+            t.position = spot(0.5f);
+        }
+        scene.AddTransform(id, t);
+        scene.AddCollider(id, collider);
+    }
+    scene.EndFrame();
+}
+
+// --benchmark: runs the ECS and physics benchmarks without opening a window
+// and exits with 0 if none of their results disagreed with the reference
+// they are checked against (see EcsBenchmark.h, PhysicsBenchmark.h)
+static int RunBenchmarks() {
+#ifdef _WIN32
+    AllocConsole();
+    FILE *dummy;
+    freopen_s(&dummy, "CONOUT$", "w", stdout);
+#endif
+    jobs.Init();
+    int failures = 0;
+    for (int count : { 10000, 100000, 1000000 }) {
+        failures += EcsBenchmark::MeasureStorage(count).mismatches;
+    }
+    for (int count : { 10000, 100000 }) {
+        failures += EcsBenchmark::MeasureViews(count).mismatches;
+    }
+    failures += EcsBenchmark::MeasureThreadScaling(20000, std::max(1u, std::thread::hardware_concurrency())).mismatches;
+    failures += EcsBenchmark::CheckTransformBatch(100000).mismatches;
+    failures += EcsBenchmark::MeasureHierarchy(256, 10000, 1000).mismatches;
+    failures += EcsBenchmark::MeasureSnapshot(100000, "benchmark.snapshot").mismatches;
+    failures += EcsBenchmark::CheckSlotReuse(10000, 100).mismatches;
+    if (!physicsBenchmark.RunBoxPyramid().settled) ++failures;
+    for (int count : { 1000, 4000 }) {
+        failures += physicsBenchmark.MeasureBroadphase(count).mismatches;
+    }
+    for (int count : { 10000, 100000 }) {
+        // Testing every pair of 100k spheres takes seconds, so one frame there
+        failures += physicsBenchmark.MeasureHashGrid(count, count > 10000 ? 1 : PhysicsBenchmark::kBenchmarkFrames).mismatches;
+    }
+    for (int count : { 1000, 10000, 100000 }) {
+        failures += physicsBenchmark.MeasureQueries(count).mismatches;
+    }
+    failures += physicsBenchmark.MeasureNarrowphase().mismatches;
+    failures += physicsBenchmark.CheckTunneling().tunneled;
+    failures += physicsBenchmark.MeasureHeightfieldRaycasts().mismatches;
+    failures += physicsBenchmark.CheckRayKernels().mismatches;
+    Model3D tree = loader.LoadModel("assets/models/cartoon_lowpoly_trees_blend.glb");
+    failures += physicsBenchmark.MeasureMeshRaycasts(tree).mismatches;
+    failures += physicsBenchmark.MeasureMeshInstances(tree).mismatches;
+    {
+        ECS scene;
+        scene.SetJobSystem(&jobs);
+        BuildQueryScene(scene, tree);
+        failures += physicsBenchmark.MeasureRaycasts(scene, HMM_Vec3(0.0f, 0.0f, 0.0f), kQuerySceneRadius).mismatches;
+        failures += physicsBenchmark.MeasureCapsuleSweeps(scene, HMM_Vec3(0.0f, 0.0f, 0.0f), kQuerySceneRadius).mismatches;
+    }
+    failures += physicsBenchmark.CheckCharacterMoves().failures;
+    free(tree.vertices);
+    free(tree.indices);
+    jobs.Shutdown();
+    printf("Benchmarks finished, %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
 sapp_desc sokol_main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) exit(RunReplay(argv[i + 1]));
+        if (strcmp(argv[i], "--benchmark") == 0) exit(RunBenchmarks());
+    }
     sapp_desc desc = {};
     desc.init_cb = init;
     desc.frame_cb = frame;
@@ -848,6 +1073,10 @@ sapp_desc sokol_main(int argc, char *argv[]) {
             }
 
             editorUI.RenderPlacementControls(placementMode, placementMeshId, meshTreeId, meshEnemyId);
+
+            if (ImGui::CollapsingHeader("Scene Snapshot")) {
+                editorUI.RenderSnapshotControls(renderer);
+            }
         }
 
         if (player) {
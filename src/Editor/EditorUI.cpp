@@ -1,5 +1,12 @@
 #include "EditorUI.h"
+#include "../Game/FixedTimestep.h"
+#include "../Game/PhysicsBenchmark.h"
 #include "../Game/Player.h"
+#include "../Game/RayKernels.h"
+#include "../Game/SceneSnapshot.h"
+#include "../Game/SimulationRecording.h"
+#include "../Game/SystemScheduler.h"
+#include "../Utilities/JobSystem.h"
 #include "../../External/Imgui/imgui.h"
 
 EditorUI::EditorUI()
@@ -125,6 +132,122 @@ void EditorUI::RenderPerformanceStats(float deltaTime) {
         ImGui::Text("Colliders: %zu", colliders.size());
         ImGui::Text("Rigidbodies: %zu", rigidbodies.size());
         
+        // Broadphase: which pair finder runs and the candidate pairs it produced
+        int broadphaseMode = (int)m_ecs->GetBroadphaseMode();
+        const char* broadphaseNames[] = { "AABB Tree", "Sweep and Prune" };
+        if (ImGui::Combo("Broadphase", &broadphaseMode, broadphaseNames, 2)) {
+            m_ecs->SetBroadphaseMode((ECS::BroadphaseMode)broadphaseMode);
+        }
+        SpatialIndex::Stats indexStats = m_ecs->GetColliderIndexStats();
+        if (m_ecs->GetBroadphaseMode() == ECS::BroadphaseMode::AABBTree) {
+            ImGui::Text("Broadphase: %d pairs, %d reinserts", indexStats.pairs, indexStats.reinserts);
+        } else {
+            const SweepAndPrune::Stats& broadphaseStats = m_ecs->GetBroadphaseStats();
+            ImGui::Text("Broadphase: %d proxies, %d pairs (axis %c, %d swaps)", broadphaseStats.proxies,
+                        broadphaseStats.pairs, "XYZ"[broadphaseStats.axis], broadphaseStats.swaps);
+        }
+        ImGui::Text("Collider Trees: %d moving (height %d), %d static (height %d)",
+                    indexStats.dynamicProxies, indexStats.dynamicHeight,
+                    indexStats.staticProxies, indexStats.staticHeight);
+        
+        // Hash grid for the enemy crowd layer
+        bool enemyGrid = (m_ecs->GetHashGridLayers() & kEnemyCollisionLayer) != 0;
+        if (ImGui::Checkbox("Enemies in Hash Grid", &enemyGrid)) {
+            m_ecs->SetHashGridLayers(enemyGrid ? m_ecs->GetHashGridLayers() | kEnemyCollisionLayer
+                                               : m_ecs->GetHashGridLayers() & ~kEnemyCollisionLayer);
+        }
+        float gridCellSize = m_ecs->GetHashGridCellSize();
+        if (ImGui::SliderFloat("Grid Cell Size", &gridCellSize, 0.25f, 4.0f)) {
+            m_ecs->SetHashGridCellSize(gridCellSize);
+        }
+        const SpatialHashGrid::Stats& gridStats = m_ecs->GetHashGridStats();
+        ImGui::Text("Hash Grid: %d proxies, %d pairs (%d buckets, largest %d)", gridStats.proxies,
+                    gridStats.pairs, gridStats.buckets, gridStats.largestBucket);
+        const CollisionMeshRegistry& collisionMeshes = m_ecs->GetCollisionMeshes();
+        ImGui::Text("Collision Meshes: %d shared (%.2f MB)", collisionMeshes.Count(),
+                    collisionMeshes.MemoryBytes() / (1024.0f * 1024.0f));
+        const HeightfieldRegistry& heightfields = m_ecs->GetHeightfields();
+        ImGui::Text("Heightfields: %d shared (%.2f MB)", heightfields.Count(),
+                    heightfields.MemoryBytes() / (1024.0f * 1024.0f));
+        
+        // Transform cache: matrices rebuilt last frame vs renderables visited
+        const ECS::TransformSyncStats& syncStats = m_ecs->GetTransformSyncStats();
+        ImGui::Text("Matrices Recomputed: %d / %d", syncStats.recomputed, syncStats.total);
+        ImGui::Text("Transform Kernel: %s", TransformBatchKernelName());
+        ImGui::Text("Ray Kernel: %s", RayKernelName());
+        
+        // Job system / scheduled systems
+        if (m_jobs && m_scheduler) {
+            ImGui::Separator();
+            bool singleThreaded = m_jobs->IsSingleThreaded();
+            if (ImGui::Checkbox("Single-threaded (deterministic)", &singleThreaded)) {
+                m_jobs->SetSingleThreaded(singleThreaded);
+            }
+            ImGui::Text("Job Threads: %u", m_jobs->ThreadCount());
+            ImGui::Text("System Phases: %d", m_scheduler->PhaseCount());
+            
+            ImGui::Indent();
+            for (const SystemScheduler::SystemStats& stats : m_scheduler->GetStats()) {
+                ImGui::Text("[%d] %s: %.3f ms", stats.phase, stats.name, stats.lastMs);
+            }
+            ImGui::Unindent();
+        }
+        
+        // Fixed-step physics: rate is adjustable while running
+        if (m_physicsStep && m_physicsScheduler) {
+            ImGui::Separator();
+            float stepRate = m_physicsStep->StepRate();
+            if (ImGui::SliderFloat("Physics Rate (Hz)", &stepRate, FixedTimestep::kMinStepRate, 240.0f, "%.0f")) {
+                m_physicsStep->SetStepRate(stepRate);
+            }
+            int maxSubsteps = m_physicsStep->MaxSubsteps();
+            if (ImGui::SliderInt("Max Substeps", &maxSubsteps, 1, 16)) {
+                m_physicsStep->SetMaxSubsteps(maxSubsteps);
+            }
+            ImGui::Text("Physics Steps: %d this frame, %d dropped", m_physicsStep->LastSteps(), m_physicsStep->DroppedSteps());
+            ImGui::Text("Interpolated: %d bodies (alpha %.2f)", syncStats.interpolated, m_ecs->GetInterpolationAlpha());
+            
+            bool sleeping = m_ecs->IsSleepingEnabled();
+            if (ImGui::Checkbox("Sleeping", &sleeping)) {
+                m_ecs->SetSleepingEnabled(sleeping);
+            }
+            const ECS::SleepStats& sleepStats = m_ecs->GetSleepStats();
+            ImGui::Text("Bodies: %d awake in %d islands, %d sleeping in %d islands", sleepStats.awake,
+                        sleepStats.islands, sleepStats.sleeping, sleepStats.sleepingIslands);
+            
+            // Contact solver: iterations are an upper bound, converged steps stop early
+            int solverIterations = m_ecs->GetSolverIterations();
+            if (ImGui::SliderInt("Solver Iterations", &solverIterations, 1, 32)) {
+                m_ecs->SetSolverIterations(solverIterations);
+            }
+            bool warmStarting = m_ecs->IsWarmStarting();
+            if (ImGui::Checkbox("Warm Starting", &warmStarting)) {
+                m_ecs->SetWarmStarting(warmStarting);
+            }
+            const ECS::ContactSolverStats& solverStats = m_ecs->GetContactSolverStats();
+            ImGui::Text("Contacts: %d (%d warm started), %d iterations, %.3f ms", solverStats.contacts,
+                        solverStats.warmStarted, solverStats.iterations, solverStats.solveMs);
+            const ECS::ContinuousStats& continuousStats = m_ecs->GetContinuousStats();
+            ImGui::Text("Swept: %d bodies, %d stopped at impact (%d substeps)", continuousStats.swept,
+                        continuousStats.hits, continuousStats.substeps);
+            
+            // Narrowphase tests per collider pair type that ran last step
+            const ECS::NarrowphaseStats& narrowStats = m_ecs->GetNarrowphaseStats();
+            for (int a = 0; a < kColliderTypeCount; ++a) {
+                for (int b = 0; b < kColliderTypeCount; ++b) {
+                    if (narrowStats.tests[a][b] == 0) continue;
+                    ImGui::Text("  %s-%s: %d tested, %d touching", ColliderTypeName((ColliderType)a),
+                                ColliderTypeName((ColliderType)b), narrowStats.tests[a][b], narrowStats.contacts[a][b]);
+                }
+            }
+            
+            ImGui::Indent();
+            for (const SystemScheduler::SystemStats& stats : m_physicsScheduler->GetStats()) {
+                ImGui::Text("[%d] %s: %.3f ms", stats.phase, stats.name, stats.lastMs);
+            }
+            ImGui::Unindent();
+        }
+        
         // Camera info (if player exists)
         if (m_player) {
             ImGui::Separator();
@@ -206,12 +329,14 @@ void EditorUI::RenderPlayerInspector(EntityId playerId) {
             const char* colliderTypeNames[] = { "Sphere", "Box", "Capsule", "Mesh", "Plane" };
             ImGui::Text("Type: %s", colliderTypeNames[(int)collider->type]);
             
+            bool changed = false;
             if (collider->type == ColliderType::Sphere) {
-                ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 5.0f, "%.2f m");
+                changed |= ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 5.0f, "%.2f m");
             }
             
-            ImGui::Checkbox("Is Trigger", &collider->isTrigger);
+            changed |= ImGui::Checkbox("Is Trigger", &collider->isTrigger);
             ImGui::Text("Is Static: %s", collider->isStatic ? "YES" : "NO");
+            if (changed) m_ecs->MarkChanged<Collider>(playerId);
         }
     }
     
@@ -302,15 +427,17 @@ void EditorUI::RenderEnemyInspector(EntityId enemyId) {
             
             ImGui::Text("Type: %s", colliderTypeNames[currentType]);
             
+            bool changed = false;
             if (collider->type == ColliderType::Sphere) {
-                ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f, "%.2f m");
+                changed |= ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f, "%.2f m");
             } else if (collider->type == ColliderType::Box) {
-                ImGui::DragFloat3("Half Extents", &collider->boxHalfExtents.X, 0.1f);
+                changed |= ImGui::DragFloat3("Half Extents", &collider->boxHalfExtents.X, 0.1f);
             }
             
             ImGui::Separator();
-            ImGui::Checkbox("Is Trigger", &collider->isTrigger);
-            ImGui::Checkbox("Is Static", &collider->isStatic);
+            changed |= ImGui::Checkbox("Is Trigger", &collider->isTrigger);
+            changed |= ImGui::Checkbox("Is Static", &collider->isStatic);
+            if (changed) m_ecs->MarkChanged<Collider>(enemyId);
         }
     }
     
@@ -347,8 +474,9 @@ void EditorUI::RenderTreeInspector(EntityId treeId) {
             const char* colliderTypeNames[] = { "Sphere", "Box", "Capsule", "Mesh", "Plane" };
             ImGui::Text("Type: %s", colliderTypeNames[(int)collider->type]);
             
-            if (collider->type == ColliderType::Sphere) {
-                ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f, "%.2f m");
+            if (collider->type == ColliderType::Sphere &&
+                ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f, "%.2f m")) {
+                m_ecs->MarkChanged<Collider>(treeId);
             }
             
             ImGui::Separator();
@@ -362,12 +490,14 @@ void EditorUI::RenderTreeInspector(EntityId treeId) {
         const char* volumeTypeNames[] = { "Sphere", "Box", "Mesh", "Icon" };
         ImGui::Text("Type: %s", volumeTypeNames[(int)sel->volumeType]);
         
+        bool changed = false;
         if (sel->volumeType == SelectionVolumeType::Sphere) {
-            ImGui::DragFloat("Selection Radius", &sel->boundingSphereRadius, 0.1f, 0.5f, 20.0f, "%.1f m");
+            changed |= ImGui::DragFloat("Selection Radius", &sel->boundingSphereRadius, 0.1f, 0.5f, 20.0f, "%.1f m");
         }
         
-        ImGui::Checkbox("Show Wireframe", &sel->showWireframe);
-        ImGui::Checkbox("Can Be Selected", &sel->canBeSelected);
+        changed |= ImGui::Checkbox("Show Wireframe", &sel->showWireframe);
+        changed |= ImGui::Checkbox("Can Be Selected", &sel->canBeSelected);
+        if (changed) m_ecs->MarkChanged<Selectable>(treeId);
     }
     
     // === TRANSFORM ===
@@ -454,11 +584,17 @@ void EditorUI::RenderEntityInspector(EntityId selectedEntity) {
     Rigidbody* rb = m_ecs->GetRigidbody(selectedEntity);
     if (rb) {
         if (ImGui::CollapsingHeader("Rigidbody")) {
-            ImGui::DragFloat3("Velocity", &rb->velocity.X, 0.1f);
-            ImGui::DragFloat("Mass", &rb->mass, 0.1f, 0.1f, 1000.0f);
-            ImGui::Checkbox("Affected By Gravity", &rb->affectedByGravity);
-            ImGui::DragFloat("Drag", &rb->drag, 0.01f, 0.0f, 2.0f);
-            ImGui::DragFloat("Bounciness", &rb->bounciness, 0.01f, 0.0f, 1.0f);
+            bool changed = false;
+            changed |= ImGui::DragFloat3("Velocity", &rb->velocity.X, 0.1f);
+            changed |= ImGui::DragFloat("Mass", &rb->mass, 0.1f, 0.1f, 1000.0f);
+            changed |= ImGui::Checkbox("Affected By Gravity", &rb->affectedByGravity);
+            changed |= ImGui::DragFloat("Drag", &rb->drag, 0.01f, 0.0f, 2.0f);
+            changed |= ImGui::DragFloat("Bounciness", &rb->bounciness, 0.01f, 0.0f, 1.0f);
+            changed |= ImGui::DragFloat("Friction", &rb->friction, 0.01f, 0.0f, 2.0f);
+            changed |= ImGui::Checkbox("Can Sleep", &rb->canSleep);
+            changed |= ImGui::Checkbox("Continuous Collision", &rb->continuousCollision);
+            ImGui::Text("State: %s", rb->sleeping ? "Sleeping" : "Awake");
+            if (changed) m_ecs->WakeBody(selectedEntity);
         }
     }
     
@@ -468,18 +604,21 @@ void EditorUI::RenderEntityInspector(EntityId selectedEntity) {
         if (ImGui::CollapsingHeader("Collider")) {
             const char* colliderTypeNames[] = { "Sphere", "Box", "Capsule", "Mesh", "Plane" };
             int currentType = (int)collider->type;
+            bool changed = false;
             if (ImGui::Combo("Type", &currentType, colliderTypeNames, 5)) {
                 collider->type = (ColliderType)currentType;
+                changed = true;
             }
             
             if (collider->type == ColliderType::Sphere) {
-                ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f);
+                changed |= ImGui::DragFloat("Radius", &collider->radius, 0.01f, 0.1f, 10.0f);
             } else if (collider->type == ColliderType::Box) {
-                ImGui::DragFloat3("Half Extents", &collider->boxHalfExtents.X, 0.1f);
+                changed |= ImGui::DragFloat3("Half Extents", &collider->boxHalfExtents.X, 0.1f);
             }
             
-            ImGui::Checkbox("Is Trigger", &collider->isTrigger);
-            ImGui::Checkbox("Is Static", &collider->isStatic);
+            changed |= ImGui::Checkbox("Is Trigger", &collider->isTrigger);
+            changed |= ImGui::Checkbox("Is Static", &collider->isStatic);
+            if (changed) m_ecs->MarkChanged<Collider>(selectedEntity);
         }
     }
     
@@ -544,6 +683,129 @@ void EditorUI::RenderPlacementControls(bool& placementMode, int& placementMeshId
     }
 }
 
+void EditorUI::RenderSnapshotControls(Renderer& renderer) {
+    static const char* kSnapshotPath = "scene.snapshot";
+    
+    // Every selectable entity except the player, which init() always creates
+    if (ImGui::Button("Save Snapshot")) {
+        std::vector<EntityId> entities;
+        for (const auto& [entityId, selectable] : m_ecs->GetSelectables()) {
+            if (m_player && entityId == m_player->Entity()) continue;
+            entities.push_back(entityId);
+        }
+        SceneSnapshot::Save(*m_ecs, kSnapshotPath, entities);
+    }
+    ImGui::SameLine();
+    
+    // Loads in addition to the current scene
+    if (ImGui::Button("Load Snapshot")) {
+        m_lastSnapshotCount = SceneSnapshot::Load(*m_ecs, renderer, kSnapshotPath);
+    }
+    
+    if (m_lastSnapshotCount >= 0) {
+        ImGui::Text("Loaded %d entities in %.2f ms", m_lastSnapshotCount, SceneSnapshot::LastLoadMs());
+    }
+}
+
+void EditorUI::RenderBenchmarkControls() {
+    if (!m_benchmark) return;
+    
+    // Sight lines around the benchmark spot, through whatever is in the scene
+    static constexpr float kRaycastBenchmarkRadius = 30.0f;
+    char rayLabel[64];
+    snprintf(rayLabel, sizeof(rayLabel), "Measure Raycasts (%d rays)", PhysicsBenchmark::kBenchmarkRays);
+    if (ImGui::Button(rayLabel)) {
+        m_benchmark->MeasureRaycasts(*m_ecs, m_benchmarkPosition, kRaycastBenchmarkRadius);
+    }
+    const PhysicsBenchmark::RaycastStats& rayStats = m_benchmark->GetRaycastStats();
+    if (rayStats.rays > 0) {
+        ImGui::Text("Rays: %.2f M/s single, %.2f M/s batched", rayStats.singleRaysPerSec * 1e-6, rayStats.batchRaysPerSec * 1e-6);
+        if (rayStats.parallelRaysPerSec > 0.0) {
+            ImGui::Text("Batched on %u threads: %.2f M/s", rayStats.threads, rayStats.parallelRaysPerSec * 1e-6);
+        }
+        ImGui::Text("%d hits, %d mismatches", rayStats.hits, rayStats.mismatches);
+    }
+    
+    // Character-sized capsules moved one step from random spots in the same area
+    char sweepLabel[64];
+    snprintf(sweepLabel, sizeof(sweepLabel), "Measure Capsule Sweeps (%d sweeps)", PhysicsBenchmark::kBenchmarkSweeps);
+    if (ImGui::Button(sweepLabel)) {
+        m_benchmark->MeasureCapsuleSweeps(*m_ecs, m_benchmarkPosition, kRaycastBenchmarkRadius);
+    }
+    const PhysicsBenchmark::SweepStats& sweepStats = m_benchmark->GetSweepStats();
+    if (sweepStats.sweeps > 0) {
+        ImGui::Text("Sweeps: %.2f M/s single, %.2f M/s batched", sweepStats.singleSweepsPerSec * 1e-6, sweepStats.batchSweepsPerSec * 1e-6);
+        if (sweepStats.parallelSweepsPerSec > 0.0) {
+            ImGui::Text("Batched on %u threads: %.2f M/s", sweepStats.threads, sweepStats.parallelSweepsPerSec * 1e-6);
+        }
+        ImGui::Text("%d hits, %d mismatches", sweepStats.hits, sweepStats.mismatches);
+    }
+    const ECS::CharacterStats& characterStats = m_ecs->GetCharacterStats();
+    if (characterStats.characters > 0) {
+        ImGui::Text("Characters: %d (%d grounded), %d sweeps, %.3f ms/step",
+                    characterStats.characters, characterStats.grounded, characterStats.sweeps, characterStats.moveMs);
+    }
+    
+    // Runs while playing; settle time is simulated seconds
+    char label[64];
+    snprintf(label, sizeof(label), "Spawn Box Pyramid (%d layers)", PhysicsBenchmark::kPyramidLayers);
+    if (ImGui::Button(label)) {
+        m_benchmark->SpawnBoxPyramid(*m_ecs, m_benchmarkPosition);
+    }
+    if (!m_benchmark->IsRunning()) return;
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        m_benchmark->Clear(*m_ecs);
+        return;
+    }
+    
+    const PhysicsBenchmark::Stats& stats = m_benchmark->GetStats();
+    if (stats.settled) {
+        ImGui::Text("%d boxes settled after %.2f s (%d steps)", stats.bodies, stats.settleTime, stats.steps);
+    } else {
+        ImGui::Text("%d boxes settling... (%d steps)", stats.bodies, stats.steps);
+    }
+    if (stats.steps > 0) {
+        ImGui::Text("Solver: %.3f ms/step avg, %.3f ms max, %.1f iterations avg",
+                    stats.solveMsTotal / stats.steps, stats.solveMsMax, (float)stats.iterationsTotal / stats.steps);
+    }
+}
+
+void EditorUI::RenderRecordingControls() {
+    if (!m_recorder) return;
+    static const char* kRecordingPath = "simulation.recording";
+    static constexpr uint32_t kRecordingSeed = 1;
+    
+    // Frames are recorded while playing; going back to edit mode stops
+    if (m_recorder->IsRecording()) {
+        ImGui::Text("Recording: %d frames", m_recorder->FrameCount());
+        if (ImGui::Button("Stop Recording")) {
+            m_recorder->End();
+        }
+        return;
+    }
+    if (m_gameState->IsPlaying() && m_physicsStep) {
+        if (ImGui::Button("Record")) {
+            m_recorder->Begin(*m_ecs, kRecordingPath, m_player ? m_player->Entity() : -1, m_physicsStep->StepRate(), kRecordingSeed);
+        }
+        ImGui::SameLine();
+    }
+    
+    // Re-simulates in a separate, headless ECS; the scene is untouched
+    if (ImGui::Button("Replay")) {
+        m_replayResult = SimulationReplay::Run(kRecordingPath, m_jobs);
+    }
+    
+    const SimulationReplay::Result& result = m_replayResult;
+    if (result.simulated == 0) return;
+    if (result.firstDivergence >= 0) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Diverged at frame %d of %d", result.firstDivergence, result.frames);
+    } else {
+        ImGui::Text("%d frames match", result.frames);
+    }
+    ImGui::Text("%.3f ms/frame avg, %.3f ms max", result.totalMs / result.simulated, result.maxFrameMs);
+}
+
 void EditorUI::RenderCollisionVisualization(bool& showCollisions) {
     if (ImGui::Checkbox("Show Collision Shapes", &showCollisions)) {
         printf("Collision visualization: %s\n", showCollisions ? "ON" : "OFF");
@@ -2,9 +2,14 @@
 #include "../Game/ECS.h"
 #include "../Audio/AudioEngine.h"
 #include "../Game/GameState.h"
+#include "../Game/SimulationRecording.h"
 
 // Forward declare PlayerController
 class PlayerController;
+class JobSystem;
+class SystemScheduler;
+class FixedTimestep;
+class PhysicsBenchmark;
 
 class EditorUI {
 public:
@@ -13,6 +18,10 @@ public:
     
     void Init(ECS* ecs, AudioEngine* audio, GameStateManager* gameState);
     void SetPlayer(PlayerController* player) { m_player = player; }
+    void SetScheduler(JobSystem* jobs, SystemScheduler* scheduler) { m_jobs = jobs; m_scheduler = scheduler; }
+    void SetPhysicsStep(FixedTimestep* step, SystemScheduler* scheduler) { m_physicsStep = step; m_physicsScheduler = scheduler; }
+    void SetBenchmark(PhysicsBenchmark* benchmark, const hmm_vec3& position) { m_benchmark = benchmark; m_benchmarkPosition = position; }
+    void SetRecorder(SimulationRecorder* recorder) { m_recorder = recorder; }
     void RenderAudioControls();
     void RenderGameStateControls();
     void RenderEntityInspector(EntityId selectedEntity);
@@ -23,6 +32,15 @@ public:
     
     // ADDED: Global performance stats
     void RenderPerformanceStats(float deltaTime);
+    
+    // Save/load the scene as a binary snapshot (see SceneSnapshot.h)
+    void RenderSnapshotControls(Renderer& renderer);
+    
+    // Physics stress scenes (see PhysicsBenchmark.h)
+    void RenderBenchmarkControls();
+    
+    // Record the simulation and replay it headless (see SimulationRecording.h)
+    void RenderRecordingControls();
 
     int GetSelectedPlacementType() const { return m_selectedPlacementType; }
 
@@ -36,7 +54,16 @@ private:
     AudioEngine* m_audio = nullptr;
     GameStateManager* m_gameState = nullptr;
     PlayerController* m_player = nullptr;
+    JobSystem* m_jobs = nullptr;
+    SystemScheduler* m_scheduler = nullptr;
+    FixedTimestep* m_physicsStep = nullptr;
+    SystemScheduler* m_physicsScheduler = nullptr;
+    PhysicsBenchmark* m_benchmark = nullptr;
+    hmm_vec3 m_benchmarkPosition{0.0f, 0.0f, 0.0f};
+    SimulationRecorder* m_recorder = nullptr;
+    SimulationReplay::Result m_replayResult;
     int m_selectedPlacementType = 0;
+    int m_lastSnapshotCount = -1;
     
     // ADDED: FPS tracking
     float m_fpsAccumulator = 0.0f;
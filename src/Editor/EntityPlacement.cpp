@@ -113,7 +113,7 @@ void EntityPlacement::DestroyGhostPreview() {
 }
 
 // FIXED: Changed signature to match header (pass by value, not reference)
-void EntityPlacement::PlaceEntity(hmm_vec3 position, int placementMeshId, int meshTreeId, int meshEnemyId) {
+EntityId EntityPlacement::PlaceEntity(hmm_vec3 position, int placementMeshId, int meshTreeId, int meshEnemyId) {
     if (placementMeshId == meshTreeId) {
         // Spawn tree
         EntityId treeId = m_ecs->CreateEntity();
@@ -151,6 +151,7 @@ void EntityPlacement::PlaceEntity(hmm_vec3 position, int placementMeshId, int me
         // FIXED: Corrected printf format string (removed extra %d)
         printf("Placed TREE at (%.2f, %.2f, %.2f) with entity ID %d\n", 
                position.X, position.Y, position.Z, treeId);
+        return treeId;
     }
     else if (placementMeshId == meshEnemyId) {
         // Spawn enemy
@@ -179,17 +180,22 @@ void EntityPlacement::PlaceEntity(hmm_vec3 position, int placementMeshId, int me
         enemyCollider.radius = 0.5f;
         enemyCollider.isStatic = false;
         enemyCollider.isTrigger = false;
+        enemyCollider.collisionLayer = kEnemyCollisionLayer;
         m_ecs->AddCollider(enemyId, enemyCollider);
 
-        // ADDED: Enemy rigidbody
+        // Enemy rigidbody: kinematic, walked by its character controller
         Rigidbody enemyRb;
         enemyRb.mass = 50.0f;
-        enemyRb.affectedByGravity = true;
-        enemyRb.drag = 0.5f;
+        enemyRb.affectedByGravity = false;
+        enemyRb.drag = 0.0f;
         enemyRb.bounciness = 0.0f;
-        enemyRb.isKinematic = false;
+        enemyRb.isKinematic = true;
+        enemyRb.canSleep = false;
         m_ecs->AddRigidbody(enemyId, enemyRb);
 
+        CharacterController enemyController;
+        m_ecs->AddCharacter(enemyId, enemyController);
+
         Selectable enemySel;
         enemySel.name = "Enemy";
         enemySel.volumeType = SelectionVolumeType::Sphere;
@@ -202,14 +208,17 @@ void EntityPlacement::PlaceEntity(hmm_vec3 position, int placementMeshId, int me
         m_enemyEntities->push_back(enemyId);
         printf("Placed ENEMY at (%.2f, %.2f, %.2f) with entity ID %d\n", 
                position.X, position.Y, position.Z, enemyId);
+        return enemyId;
     }
+    
+    return -1;
 }
 
 void EntityPlacement::DeleteEntity(EntityId entityId) {
     printf("Deleting entity %d\n", entityId);
     
-    m_ecs->RemoveRenderable(entityId, *m_renderer);
-    m_ecs->DestroyEntity(entityId);
+    // Deferred to the next sync point in frame() (also removes the renderer instance)
+    m_ecs->Commands().DestroyEntity(entityId);
     
     auto treeIt = std::find(m_treeEntities->begin(), m_treeEntities->end(), entityId);
     if (treeIt != m_treeEntities->end()) {
@@ -21,8 +21,8 @@ public:
     void DestroyGhostPreview();
     EntityId GetGhostEntity() const { return m_ghostEntity; }
     
-    // Entity placement
-    void PlaceEntity(hmm_vec3 position, int placementMeshId, int meshTreeId, int meshEnemyId);
+    // Entity placement (returns the placed entity, or -1 if nothing was placed)
+    EntityId PlaceEntity(hmm_vec3 position, int placementMeshId, int meshTreeId, int meshEnemyId);
     void DeleteEntity(EntityId entityId);
     
 private:
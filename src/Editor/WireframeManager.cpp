@@ -286,12 +286,35 @@ void WireframeManager::CreateCollisionPlaneMesh() {
     renderer->MarkMeshAsWireframe(collisionPlaneMeshId);
 }
 
-void WireframeManager::UpdateCollisionVisuals(bool showCollisions) {
+void WireframeManager::UpdateCollisionVisuals(bool showCollisions, EntityId selectedEntity) {
     if (!showCollisions) {
         DestroyAllCollisionVisuals();
         return;
     }
     
+    // Full rebuild on first use or when change history was lost; otherwise
+    // only entities whose Collider or Transform changed are refreshed
+    bool rebuild = !m_colliderObserver.IsAttached();
+    if (!rebuild) {
+        rebuild = !m_colliderObserver.Poll(*ecs, [&](EntityId id, ChangeKind) {
+            RefreshCollisionVisual(id);
+        });
+    }
+    if (!rebuild) {
+        rebuild = !m_collisionTransformObserver.Poll(*ecs, [&](EntityId id, ChangeKind) {
+            if (activeCollisionVisuals.count(id) || ecs->HasCollider(id)) RefreshCollisionVisual(id);
+        });
+    }
+    if (rebuild) {
+        RebuildAllCollisionVisuals();
+        return;
+    }
+    
+    // The inspector edits the selected collider in place
+    if (selectedEntity != -1) RefreshCollisionVisual(selectedEntity);
+}
+
+void WireframeManager::RebuildAllCollisionVisuals() {
     // Create or update collision visuals for all entities with colliders
     const auto& colliders = ecs->GetColliders();
     for (const auto& [entityId, collider] : colliders) {
@@ -301,18 +324,29 @@ void WireframeManager::UpdateCollisionVisuals(bool showCollisions) {
     // Remove visuals for entities that no longer have colliders
     std::vector<EntityId> toRemove;
     for (const auto& [entityId, instanceId] : activeCollisionVisuals) {
-        if (colliders.find(entityId) == colliders.end()) {
+        if (!colliders.Has(entityId)) {
             toRemove.push_back(entityId);
         }
     }
     for (EntityId id : toRemove) {
         DestroyCollisionVisual(id);
     }
+    
+    m_colliderObserver.Reset(*ecs);
+    m_collisionTransformObserver.Reset(*ecs);
+}
+
+void WireframeManager::RefreshCollisionVisual(EntityId entity) {
+    if (ecs->HasCollider(entity) && ecs->HasTransform(entity)) {
+        CreateOrUpdateCollisionVisual(entity);
+    } else {
+        DestroyCollisionVisual(entity);
+    }
 }
 
 void WireframeManager::CreateOrUpdateCollisionVisual(EntityId entity) {
     Collider* collider = ecs->GetCollider(entity);
-    Transform* transform = ecs->GetTransform(entity);
+    const Transform* transform = ecs->PeekTransform(entity);
     if (!collider || !transform) return;
     
     // Destroy existing visual
@@ -343,7 +377,16 @@ void WireframeManager::CreateOrUpdateCollisionVisual(EntityId entity) {
                 );
                 hmm_mat4 scale = HMM_Scale(fullSize);
                 hmm_mat4 translation = HMM_Translate(transform->position);
-                visualMatrix = HMM_MultiplyMat4(translation, scale);
+                // Boxes turn with the transform (see Narrowphase.h)
+                hmm_vec3 axes[3];
+                TransformAxes(*transform, axes);
+                hmm_mat4 rotation = HMM_Mat4d(1.0f);
+                for (int col = 0; col < 3; ++col) {
+                    rotation.Elements[col][0] = axes[col].X;
+                    rotation.Elements[col][1] = axes[col].Y;
+                    rotation.Elements[col][2] = axes[col].Z;
+                }
+                visualMatrix = HMM_MultiplyMat4(translation, HMM_MultiplyMat4(rotation, scale));
             }
             break;
             
@@ -381,11 +424,13 @@ void WireframeManager::DestroyAllCollisionVisuals() {
         renderer->RemoveInstance(instanceId);
     }
     activeCollisionVisuals.clear();
+    m_colliderObserver.Detach();
+    m_collisionTransformObserver.Detach();
 }
 
 void WireframeManager::CreateOrUpdateWireframe(EntityId entityId, bool isSelected) {
     Selectable* sel = m_ecs->GetSelectable(entityId);
-    Transform* t = m_ecs->GetTransform(entityId);
+    const Transform* t = m_ecs->PeekTransform(entityId);  // Read only: don't mark the source changed
     if (!sel || !t) {
         printf("WARNING: Entity %d missing Selectable or Transform component\n", entityId);
         return;
@@ -408,6 +453,9 @@ void WireframeManager::CreateOrUpdateWireframe(EntityId entityId, bool isSelecte
         
         printf("Created wireframe entity %d for entity %d (mesh: %d, selected: %d)\n", 
                wireframeEntity, entityId, meshId, isSelected);
+        
+        // AddTransform may grow the transform pool, so re-fetch the source transform
+        t = m_ecs->PeekTransform(entityId);
     } else {
         wireframeEntity = it->second;
     }
@@ -450,6 +498,8 @@ void WireframeManager::DestroyAllWireframes() {
         m_ecs->DestroyEntity(wireframeEntity);
     }
     m_entityWireframes.clear();
+    m_selectableObserver.Detach();
+    m_wireframeTransformObserver.Detach();
 }
 
 void WireframeManager::DestroyWireframe(EntityId entityId) {
@@ -464,12 +514,40 @@ void WireframeManager::DestroyWireframe(EntityId entityId) {
 }
 
 void WireframeManager::UpdateWireframes(EntityId selectedEntity, bool forceUpdate) {
+    // Full rebuild when forced, on first use, or when change history was lost
+    bool rebuild = forceUpdate || !m_selectableObserver.IsAttached();
+    if (!rebuild) {
+        rebuild = !m_selectableObserver.Poll(*m_ecs, [&](EntityId id, ChangeKind) {
+            RefreshWireframe(id, selectedEntity);
+        });
+    }
+    if (!rebuild) {
+        rebuild = !m_wireframeTransformObserver.Poll(*m_ecs, [&](EntityId id, ChangeKind) {
+            if (m_entityWireframes.count(id) || m_ecs->HasSelectable(id)) RefreshWireframe(id, selectedEntity);
+        });
+    }
+    if (rebuild) {
+        RebuildAllWireframes(selectedEntity, forceUpdate);
+        return;
+    }
+    
+    // A selection change only swaps the meshes of the old and new selection
+    if (selectedEntity != m_wireframeSelection) {
+        RefreshWireframe(m_wireframeSelection, selectedEntity);
+        m_wireframeSelection = selectedEntity;
+    }
+    
+    // The inspector edits the selected entity in place
+    RefreshWireframe(selectedEntity, selectedEntity);
+}
+
+void WireframeManager::RebuildAllWireframes(EntityId selectedEntity, bool recreate) {
     const auto& selectables = m_ecs->GetSelectables();
     
     for (const auto& [entityId, selectable] : selectables) {
         bool isSelected = (entityId == selectedEntity);
         
-        if (forceUpdate) {
+        if (recreate) {
             auto it = m_entityWireframes.find(entityId);
             if (it != m_entityWireframes.end()) {
                 EntityId oldWireframe = it->second;
@@ -482,4 +560,28 @@ void WireframeManager::UpdateWireframes(EntityId selectedEntity, bool forceUpdat
         
         CreateOrUpdateWireframe(entityId, isSelected);
     }
+    
+    // Remove wireframes of entities that are no longer selectable
+    std::vector<EntityId> toRemove;
+    for (const auto& [entityId, wireframeEntity] : m_entityWireframes) {
+        if (!selectables.Has(entityId)) {
+            toRemove.push_back(entityId);
+        }
+    }
+    for (EntityId id : toRemove) {
+        DestroyWireframe(id);
+    }
+    
+    m_selectableObserver.Reset(*m_ecs);
+    m_wireframeTransformObserver.Reset(*m_ecs);
+    m_wireframeSelection = selectedEntity;
+}
+
+void WireframeManager::RefreshWireframe(EntityId entity, EntityId selectedEntity) {
+    if (entity == -1) return;
+    if (m_ecs->HasSelectable(entity) && m_ecs->HasTransform(entity)) {
+        CreateOrUpdateWireframe(entity, entity == selectedEntity);
+    } else {
+        DestroyWireframe(entity);
+    }
 }
\ No newline at end of file
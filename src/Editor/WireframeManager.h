@@ -11,13 +11,15 @@ public:
     
     void Init(ECS* ecs, Renderer* renderer);
     void CreateWireframeMeshes();
+    // Incremental: only entities whose Selectable/Transform changed since the
+    // last call are updated. forceUpdate rebuilds every wireframe.
     void UpdateWireframes(EntityId selectedEntity, bool forceUpdate);
     void CreateOrUpdateWireframe(EntityId entity, bool isSelected);
     void DestroyWireframe(EntityId entity);
     void DestroyAllWireframes();
     
     // ADDED: Collision visualization
-    void UpdateCollisionVisuals(bool showCollisions);
+    void UpdateCollisionVisuals(bool showCollisions, EntityId selectedEntity = -1);
     void CreateOrUpdateCollisionVisual(EntityId entity);
     void DestroyCollisionVisual(EntityId entity);
     void DestroyAllCollisionVisuals();
@@ -47,6 +49,18 @@ private:
     // ADDED: Track wireframes for entities
     std::unordered_map<EntityId, EntityId> m_entityWireframes;
     
+    // ADDED: Change tracking, so per-frame updates scale with what changed
+    ComponentObserver<Selectable> m_selectableObserver;
+    ComponentObserver<Transform> m_wireframeTransformObserver;
+    ComponentObserver<Collider> m_colliderObserver;
+    ComponentObserver<Transform> m_collisionTransformObserver;
+    EntityId m_wireframeSelection = -1;
+    
+    void RebuildAllWireframes(EntityId selectedEntity, bool recreate);
+    void RefreshWireframe(EntityId entity, EntityId selectedEntity);
+    void RebuildAllCollisionVisuals();
+    void RefreshCollisionVisual(EntityId entity);
+    
     void CreateWireframeCube(float size, hmm_vec3 color, int& outMeshId);
     
     // ADDED: Create collision shape meshes
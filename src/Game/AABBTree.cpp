@@ -0,0 +1,287 @@
+#include "AABBTree.h"
+#include <algorithm>
+
+// A fat box this much looser than needed (after a shrink) is refitted
+static constexpr float kMaxLooseness = 4.0f;
+
+static hmm_vec3 MinVec3(const hmm_vec3& a, const hmm_vec3& b) {
+    return HMM_Vec3(fminf(a.X, b.X), fminf(a.Y, b.Y), fminf(a.Z, b.Z));
+}
+
+static hmm_vec3 MaxVec3(const hmm_vec3& a, const hmm_vec3& b) {
+    return HMM_Vec3(fmaxf(a.X, b.X), fmaxf(a.Y, b.Y), fmaxf(a.Z, b.Z));
+}
+
+// Half the surface area; only ever compared against itself
+static float Area(const hmm_vec3& min, const hmm_vec3& max) {
+    hmm_vec3 d = HMM_SubtractVec3(max, min);
+    return d.X * d.Y + d.Y * d.Z + d.Z * d.X;
+}
+
+int DynamicAABBTree::AllocateNode() {
+    if (freeList_ == kNullNode) {
+        nodes_.emplace_back();
+        freeList_ = (int)nodes_.size() - 1;
+    }
+    int index = freeList_;
+    freeList_ = nodes_[index].parent;
+    nodes_[index] = Node();
+    nodes_[index].height = 0;
+    return index;
+}
+
+void DynamicAABBTree::FreeNode(int index) {
+    nodes_[index].parent = freeList_;
+    nodes_[index].height = -1;
+    nodes_[index].child1 = kNullNode;
+    nodes_[index].child2 = kNullNode;
+    freeList_ = index;
+}
+
+int DynamicAABBTree::CreateProxy(EntityId entity, const hmm_vec3& min, const hmm_vec3& max) {
+    int proxy = AllocateNode();
+    hmm_vec3 margin = HMM_Vec3(margin_, margin_, margin_);
+    nodes_[proxy].min = HMM_SubtractVec3(min, margin);
+    nodes_[proxy].max = HMM_AddVec3(max, margin);
+    nodes_[proxy].entity = entity;
+    InsertLeaf(proxy);
+    ++proxyCount_;
+    return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(int proxy) {
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --proxyCount_;
+}
+
+bool DynamicAABBTree::MoveProxy(int proxy, const hmm_vec3& min, const hmm_vec3& max) {
+    Node& node = nodes_[proxy];
+    bool inside = true;
+    bool tooLoose = false;
+    for (int axis = 0; axis < 3; ++axis) {
+        float below = min.Elements[axis] - node.min.Elements[axis];
+        float above = node.max.Elements[axis] - max.Elements[axis];
+        inside = inside && below >= 0.0f && above >= 0.0f;
+        tooLoose = tooLoose || below > kMaxLooseness * margin_ || above > kMaxLooseness * margin_;
+    }
+    if (inside && !tooLoose) return false;
+
+    RemoveLeaf(proxy);
+    hmm_vec3 margin = HMM_Vec3(margin_, margin_, margin_);
+    node.min = HMM_SubtractVec3(min, margin);
+    node.max = HMM_AddVec3(max, margin);
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::Clear() {
+    nodes_.clear();
+    root_ = kNullNode;
+    freeList_ = kNullNode;
+    proxyCount_ = 0;
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf) {
+    if (root_ == kNullNode) {
+        root_ = leaf;
+        nodes_[leaf].parent = kNullNode;
+        return;
+    }
+
+    // Walk down to the sibling that makes the tree grow least: descending
+    // costs the growth of the current node ("inheritance") plus whatever
+    // the child itself would grow
+    const hmm_vec3 leafMin = nodes_[leaf].min;
+    const hmm_vec3 leafMax = nodes_[leaf].max;
+    int index = root_;
+    while (!nodes_[index].IsLeaf()) {
+        const Node& node = nodes_[index];
+        float area = Area(node.min, node.max);
+        float combinedArea = Area(MinVec3(node.min, leafMin), MaxVec3(node.max, leafMax));
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        int children[2] = { node.child1, node.child2 };
+        for (int i = 0; i < 2; ++i) {
+            const Node& child = nodes_[children[i]];
+            float grown = Area(MinVec3(child.min, leafMin), MaxVec3(child.max, leafMax));
+            childCost[i] = (child.IsLeaf() ? grown : grown - Area(child.min, child.max)) + inheritance;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    // New parent takes the sibling's place and adopts both
+    int sibling = index;
+    int oldParent = nodes_[sibling].parent;
+    int newParent = AllocateNode();
+    nodes_[newParent].parent = oldParent;
+    nodes_[newParent].min = MinVec3(leafMin, nodes_[sibling].min);
+    nodes_[newParent].max = MaxVec3(leafMax, nodes_[sibling].max);
+    nodes_[newParent].height = nodes_[sibling].height + 1;
+    nodes_[newParent].child1 = sibling;
+    nodes_[newParent].child2 = leaf;
+    nodes_[sibling].parent = newParent;
+    nodes_[leaf].parent = newParent;
+
+    if (oldParent == kNullNode) {
+        root_ = newParent;
+    } else if (nodes_[oldParent].child1 == sibling) {
+        nodes_[oldParent].child1 = newParent;
+    } else {
+        nodes_[oldParent].child2 = newParent;
+    }
+
+    Refit(nodes_[leaf].parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf) {
+    if (leaf == root_) {
+        root_ = kNullNode;
+        return;
+    }
+
+    int parent = nodes_[leaf].parent;
+    int grandParent = nodes_[parent].parent;
+    int sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+    // The sibling takes the parent's place
+    if (grandParent == kNullNode) {
+        root_ = sibling;
+        nodes_[sibling].parent = kNullNode;
+        FreeNode(parent);
+        return;
+    }
+    if (nodes_[grandParent].child1 == parent) {
+        nodes_[grandParent].child1 = sibling;
+    } else {
+        nodes_[grandParent].child2 = sibling;
+    }
+    nodes_[sibling].parent = grandParent;
+    FreeNode(parent);
+
+    Refit(grandParent);
+}
+
+// Rebalances and refits every node from `index` up to the root
+void DynamicAABBTree::Refit(int index) {
+    while (index != kNullNode) {
+        index = Balance(index);
+        Node& node = nodes_[index];
+        const Node& child1 = nodes_[node.child1];
+        const Node& child2 = nodes_[node.child2];
+        node.height = 1 + std::max(child1.height, child2.height);
+        node.min = MinVec3(child1.min, child2.min);
+        node.max = MaxVec3(child1.max, child2.max);
+        index = node.parent;
+    }
+}
+
+// If one subtree of A is two or more levels taller, its root is rotated up
+// into A's place and A adopts the shorter of that root's children. Returns
+// the node now at A's position.
+//
+//        A                C
+//       / \              / \      C keeps its taller child F
+//      B   C     ->     A   F     and A adopts G; the mirror
+//         / \          / \        case rotates B up
+//        F   G        B   G
+int DynamicAABBTree::Balance(int iA) {
+    Node& A = nodes_[iA];
+    if (A.IsLeaf() || A.height < 2) return iA;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    Node& B = nodes_[iB];
+    Node& C = nodes_[iC];
+    int balance = C.height - B.height;
+
+    // Rotate C up
+    if (balance > 1) {
+        int iF = C.child1;
+        int iG = C.child2;
+        Node& F = nodes_[iF];
+        Node& G = nodes_[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if (C.parent == kNullNode) {
+            root_ = iC;
+        } else if (nodes_[C.parent].child1 == iA) {
+            nodes_[C.parent].child1 = iC;
+        } else {
+            nodes_[C.parent].child2 = iC;
+        }
+
+        if (F.height > G.height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.min = MinVec3(B.min, G.min);
+            A.max = MaxVec3(B.max, G.max);
+            C.min = MinVec3(A.min, F.min);
+            C.max = MaxVec3(A.max, F.max);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.min = MinVec3(B.min, F.min);
+            A.max = MaxVec3(B.max, F.max);
+            C.min = MinVec3(A.min, G.min);
+            C.max = MaxVec3(A.max, G.max);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1) {
+        int iD = B.child1;
+        int iE = B.child2;
+        Node& D = nodes_[iD];
+        Node& E = nodes_[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if (B.parent == kNullNode) {
+            root_ = iB;
+        } else if (nodes_[B.parent].child1 == iA) {
+            nodes_[B.parent].child1 = iB;
+        } else {
+            nodes_[B.parent].child2 = iB;
+        }
+
+        if (D.height > E.height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.min = MinVec3(C.min, E.min);
+            A.max = MaxVec3(C.max, E.max);
+            B.min = MinVec3(A.min, D.min);
+            B.max = MaxVec3(A.max, D.max);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.min = MinVec3(C.min, D.min);
+            A.max = MaxVec3(C.max, D.max);
+            B.min = MinVec3(A.min, E.min);
+            B.max = MaxVec3(A.max, E.max);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
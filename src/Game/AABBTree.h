@@ -0,0 +1,256 @@
+#pragma once
+
+#include "EntityId.h"
+#include "RayKernels.h"
+#include "../../External/HandmadeMath.h"
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// DYNAMIC AABB TREE - Incrementally maintained bounding volume hierarchy
+// ============================================================================
+// Each leaf holds one entity's box enlarged by a margin (its "fat" box), so
+// small moves leave the tree alone: MoveProxy() only reinserts a leaf once
+// the new box pokes out of the fat one. Insertion walks down towards the
+// sibling that grows the surface area least, then refits the ancestors and
+// rotates those whose subtrees have become lopsided, which keeps the tree
+// shallow (queries O(log n)) without ever rebuilding it.
+//
+// Node indices are stable for the life of a proxy and double as handles.
+// Queries are const and keep their traversal stack on the caller's side, so
+// several threads may query at once as long as nobody modifies the tree.
+
+class DynamicAABBTree {
+public:
+    static constexpr int kNullNode = -1;
+
+    explicit DynamicAABBTree(float margin = 0.0f) : margin_(margin) {}
+
+    // Returns the proxy handle
+    int CreateProxy(EntityId entity, const hmm_vec3& min, const hmm_vec3& max);
+    void DestroyProxy(int proxy);
+
+    // Returns true if the leaf had to be reinserted
+    bool MoveProxy(int proxy, const hmm_vec3& min, const hmm_vec3& max);
+
+    void Clear();
+
+    EntityId GetEntity(int proxy) const { return nodes_[proxy].entity; }
+    const hmm_vec3& FatMin(int proxy) const { return nodes_[proxy].min; }
+    const hmm_vec3& FatMax(int proxy) const { return nodes_[proxy].max; }
+
+    int ProxyCount() const { return proxyCount_; }
+    int Height() const { return root_ == kNullNode ? 0 : nodes_[root_].height; }
+
+    // Calls func(int proxyA, int proxyB) once for every two leaves whose fat
+    // boxes overlap. Both subtrees are descended together, which is much
+    // cheaper than a query from every leaf.
+    template <typename Func>
+    void QueryPairs(Func&& func) const {
+        CollectPairs(*this, func);
+    }
+
+    // Same for leaves of this tree (proxyA) against leaves of `other` (proxyB)
+    template <typename Func>
+    void QueryPairs(const DynamicAABBTree& other, Func&& func) const {
+        CollectPairs(other, func);
+    }
+
+    // Calls func(int proxy) for every leaf whose fat box overlaps the query;
+    // func returns false to stop early
+    template <typename Func>
+    void QueryAABB(const hmm_vec3& min, const hmm_vec3& max, Func&& func) const {
+        Traverse([&](const Node& node) { return BoxesOverlap(node.min, node.max, min, max); }, func);
+    }
+
+    template <typename Func>
+    void QuerySphere(const hmm_vec3& center, float radius, Func&& func) const {
+        Traverse([&](const Node& node) { return SphereOverlapsBox(center, radius, node.min, node.max); }, func);
+    }
+
+    // Calls func(int proxy, float maxDistance) for every leaf the ray
+    // origin + t * direction, 0 <= t <= maxDistance, passes through. func
+    // returns the new maxDistance (the closest hit so far), which clips the
+    // rest of the traversal.
+    template <typename Func>
+    void RayCast(const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, Func&& func) const {
+        hmm_vec3 inverse = HMM_Vec3(1.0f / direction.X, 1.0f / direction.Y, 1.0f / direction.Z);
+        Traverse([&](const Node& node) { return RayOverlapsBox(origin, inverse, maxDistance, node.min, node.max); },
+                 [&](int proxy) {
+                     maxDistance = func(proxy, maxDistance);
+                     return true;
+                 });
+    }
+
+    // RayCast() for a packet of rays in one traversal: each node is fetched
+    // once and tested against all lanes still inside its parent with one
+    // RayPacketBox() (see RayKernels.h). Calls
+    // func(int proxy, uint32_t lanes) for every leaf with the lanes that pass
+    // through it; func may shorten those lanes' packet.maxDistance, which
+    // clips them for the rest of the walk. Each lane sees its leaves in the
+    // order, and with the distances, RayCast() would give it.
+    template <typename Func>
+    void RayCastPacket(RayPacket& packet, Func&& func) const {
+        if (root_ == kNullNode || packet.laneMask == 0) return;
+        NodeStack stack;
+        stack.Push(root_, packet.laneMask);
+        while (!stack.Empty()) {
+            uint32_t lanes;
+            int index = stack.Pop(&lanes);
+            const Node& node = nodes_[index];
+            lanes = RayPacketBox(packet, node.min, node.max, lanes);
+            if (lanes == 0) continue;
+            if (node.IsLeaf()) {
+                func(index, lanes);
+            } else {
+                stack.Push(node.child1, lanes);
+                stack.Push(node.child2, lanes);
+            }
+        }
+    }
+
+    static bool BoxesOverlap(const hmm_vec3& minA, const hmm_vec3& maxA, const hmm_vec3& minB, const hmm_vec3& maxB) {
+        return minA.X <= maxB.X && minB.X <= maxA.X &&
+               minA.Y <= maxB.Y && minB.Y <= maxA.Y &&
+               minA.Z <= maxB.Z && minB.Z <= maxA.Z;
+    }
+
+    static bool SphereOverlapsBox(const hmm_vec3& center, float radius, const hmm_vec3& min, const hmm_vec3& max) {
+        float distSq = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float c = center.Elements[axis];
+            float d = c < min.Elements[axis] ? min.Elements[axis] - c : (c > max.Elements[axis] ? c - max.Elements[axis] : 0.0f);
+            distSq += d * d;
+        }
+        return distSq <= radius * radius;
+    }
+
+    // Slab test against [0, maxDistance]
+    static bool RayOverlapsBox(const hmm_vec3& origin, const hmm_vec3& inverseDirection, float maxDistance,
+                               const hmm_vec3& min, const hmm_vec3& max) {
+        float tmin = 0.0f;
+        float tmax = maxDistance;
+        for (int axis = 0; axis < 3; ++axis) {
+            float t1 = (min.Elements[axis] - origin.Elements[axis]) * inverseDirection.Elements[axis];
+            float t2 = (max.Elements[axis] - origin.Elements[axis]) * inverseDirection.Elements[axis];
+            // fminf/fmaxf drop the NaN of 0 * inf (ray parallel to a slab face)
+            tmin = fmaxf(tmin, fminf(t1, t2));
+            tmax = fminf(tmax, fmaxf(t1, t2));
+        }
+        return tmin <= tmax;
+    }
+
+private:
+    struct Node {
+        hmm_vec3 min;
+        hmm_vec3 max;
+        int parent = kNullNode;   // Next free node while on the free list
+        int child1 = kNullNode;
+        int child2 = kNullNode;
+        int height = -1;          // 0 = leaf, -1 = free
+        EntityId entity = -1;
+
+        bool IsLeaf() const { return child1 == kNullNode; }
+    };
+
+    // Depth-first stack; spills to the heap only past kInlineDepth (a tree
+    // of a million leaves is about 30 levels deep)
+    class NodeStack {
+    public:
+        // lanes rides along for RayCastPacket()
+        void Push(int node, uint32_t lanes = 0) {
+            if (count_ < kInlineDepth) inline_[count_++] = Entry{node, lanes};
+            else overflow_.push_back(Entry{node, lanes});
+        }
+        int Pop(uint32_t* outLanes = nullptr) {
+            Entry entry;
+            if (!overflow_.empty()) {
+                entry = overflow_.back();
+                overflow_.pop_back();
+            } else {
+                entry = inline_[--count_];
+            }
+            if (outLanes) *outLanes = entry.lanes;
+            return entry.node;
+        }
+        bool Empty() const { return count_ == 0 && overflow_.empty(); }
+
+    private:
+        struct Entry {
+            int node;
+            uint32_t lanes;
+        };
+        static constexpr int kInlineDepth = 64;
+        Entry inline_[kInlineDepth];
+        int count_ = 0;
+        std::vector<Entry> overflow_;
+    };
+
+    template <typename Overlaps, typename Func>
+    void Traverse(Overlaps&& overlaps, Func&& func) const {
+        if (root_ == kNullNode) return;
+        NodeStack stack;
+        stack.Push(root_);
+        while (!stack.Empty()) {
+            int index = stack.Pop();
+            const Node& node = nodes_[index];
+            if (!overlaps(node)) continue;
+            if (node.IsLeaf()) {
+                if (!func(index)) return;
+            } else {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+    }
+
+    template <typename Func>
+    void CollectPairs(const DynamicAABBTree& other, Func& func) const {
+        if (root_ == kNullNode || other.root_ == kNullNode) return;
+        const bool self = &other == this;
+        std::vector<std::pair<int, int>> stack;
+        stack.emplace_back(root_, other.root_);
+        while (!stack.empty()) {
+            auto [a, b] = stack.back();
+            stack.pop_back();
+            const Node& nodeA = nodes_[a];
+            const Node& nodeB = other.nodes_[b];
+
+            // A subtree against itself: its two halves against themselves
+            // and each other, so no pair is seen twice
+            if (self && a == b) {
+                if (nodeA.IsLeaf()) continue;
+                stack.emplace_back(nodeA.child1, nodeA.child1);
+                stack.emplace_back(nodeA.child2, nodeA.child2);
+                stack.emplace_back(nodeA.child1, nodeA.child2);
+                continue;
+            }
+
+            if (!BoxesOverlap(nodeA.min, nodeA.max, nodeB.min, nodeB.max)) continue;
+            if (nodeA.IsLeaf() && nodeB.IsLeaf()) {
+                func(a, b);
+            } else if (nodeB.IsLeaf() || (!nodeA.IsLeaf() && nodeA.height >= nodeB.height)) {
+                stack.emplace_back(nodeA.child1, b);
+                stack.emplace_back(nodeA.child2, b);
+            } else {
+                stack.emplace_back(a, nodeB.child1);
+                stack.emplace_back(a, nodeB.child2);
+            }
+        }
+    }
+
+    int AllocateNode();
+    void FreeNode(int index);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    int Balance(int index);
+    void Refit(int index);
+
+    std::vector<Node> nodes_;
+    int root_ = kNullNode;
+    int freeList_ = kNullNode;
+    int proxyCount_ = 0;
+    float margin_;
+};
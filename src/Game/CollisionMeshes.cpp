@@ -0,0 +1,121 @@
+#include "CollisionMeshes.h"
+#include "MeshBVH.h"
+#include "RayKernels.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// FNV-1a over the raw triangle data
+static uint64_t HashTriangles(const CollisionTriangle* triangles, size_t count) {
+    const unsigned char* bytes = (const unsigned char*)triangles;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < count * sizeof(CollisionTriangle); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+int CollisionMeshRegistry::Register(const Model3D& model) {
+    auto known = byModel_.find(model.indices);
+    if (known != byModel_.end()) return known->second;
+    if (model.index_count < 3) return kInvalidHandle;
+
+    CollisionMesh mesh;
+    mesh.triangles.reserve(model.index_count / 3);
+
+    hmm_vec3 boundsMin = HMM_Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    hmm_vec3 boundsMax = HMM_Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (int i = 0; i + 2 < model.index_count; i += 3) {
+        CollisionTriangle tri;
+
+        const Vertex& v0 = model.vertices[model.indices[i + 0]];
+        const Vertex& v1 = model.vertices[model.indices[i + 1]];
+        const Vertex& v2 = model.vertices[model.indices[i + 2]];
+
+        tri.v0 = HMM_Vec3(v0.pos[0], v0.pos[1], v0.pos[2]);
+        tri.v1 = HMM_Vec3(v1.pos[0], v1.pos[1], v1.pos[2]);
+        tri.v2 = HMM_Vec3(v2.pos[0], v2.pos[1], v2.pos[2]);
+
+        hmm_vec3 edge1 = HMM_SubtractVec3(tri.v1, tri.v0);
+        hmm_vec3 edge2 = HMM_SubtractVec3(tri.v2, tri.v0);
+        tri.normal = HMM_NormalizeVec3(HMM_Cross(edge1, edge2));
+
+        mesh.triangles.push_back(tri);
+
+        boundsMin = HMM_Vec3(
+            fminf(boundsMin.X, fminf(tri.v0.X, fminf(tri.v1.X, tri.v2.X))),
+            fminf(boundsMin.Y, fminf(tri.v0.Y, fminf(tri.v1.Y, tri.v2.Y))),
+            fminf(boundsMin.Z, fminf(tri.v0.Z, fminf(tri.v1.Z, tri.v2.Z)))
+        );
+        boundsMax = HMM_Vec3(
+            fmaxf(boundsMax.X, fmaxf(tri.v0.X, fmaxf(tri.v1.X, tri.v2.X))),
+            fmaxf(boundsMax.Y, fmaxf(tri.v0.Y, fmaxf(tri.v1.Y, tri.v2.Y))),
+            fmaxf(boundsMax.Z, fmaxf(tri.v0.Z, fmaxf(tri.v1.Z, tri.v2.Z)))
+        );
+    }
+
+    mesh.boundsMin = boundsMin;
+    mesh.boundsMax = boundsMax;
+
+    // Triangles end up in BVH leaf order
+    BuildMeshBVH(mesh.triangles, mesh.bvhNodes);
+
+    int handle = Add(std::move(mesh));
+    byModel_[model.indices] = handle;
+
+    const CollisionMesh& added = meshes_[handle];
+    printf("Registered collision mesh %d: %zu triangles, %zu BVH nodes, bounds: [%.1f, %.1f, %.1f] to [%.1f, %.1f, %.1f]\n",
+           handle, added.triangles.size(), added.bvhNodes.size(),
+           boundsMin.X, boundsMin.Y, boundsMin.Z,
+           boundsMax.X, boundsMax.Y, boundsMax.Z);
+    return handle;
+}
+
+int CollisionMeshRegistry::Adopt(const CollisionTriangle* triangles, size_t triangleCount,
+                                 const MeshBVHNode* bvhNodes, size_t bvhNodeCount) {
+    if (triangleCount == 0) return kInvalidHandle;
+
+    uint64_t hash = HashTriangles(triangles, triangleCount);
+    auto range = byContent_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const CollisionMesh& mesh = meshes_[it->second];
+        if (mesh.triangles.size() == triangleCount &&
+            memcmp(mesh.triangles.data(), triangles, triangleCount * sizeof(CollisionTriangle)) == 0) {
+            return it->second;
+        }
+    }
+
+    CollisionMesh mesh;
+    mesh.triangles.assign(triangles, triangles + triangleCount);
+    if (bvhNodeCount > 0) {
+        mesh.bvhNodes.assign(bvhNodes, bvhNodes + bvhNodeCount);
+    } else {
+        BuildMeshBVH(mesh.triangles, mesh.bvhNodes);
+    }
+
+    // The root box is the mesh's box
+    mesh.boundsMin = mesh.bvhNodes[0].min;
+    mesh.boundsMax = mesh.bvhNodes[0].max;
+    return Add(std::move(mesh));
+}
+
+int CollisionMeshRegistry::Add(CollisionMesh&& mesh) {
+    PackTriangles(mesh.triangles.data(), mesh.triangles.size(), mesh.trianglePackets);
+    mesh.contentHash = HashTriangles(mesh.triangles.data(), mesh.triangles.size());
+    int handle = (int)meshes_.size();
+    byContent_.emplace(mesh.contentHash, handle);
+    meshes_.push_back(std::move(mesh));
+    return handle;
+}
+
+size_t CollisionMeshRegistry::MemoryBytes() const {
+    size_t bytes = meshes_.capacity() * sizeof(CollisionMesh);
+    for (const CollisionMesh& mesh : meshes_) {
+        bytes += mesh.triangles.capacity() * sizeof(CollisionTriangle);
+        bytes += mesh.bvhNodes.capacity() * sizeof(MeshBVHNode);
+        bytes += mesh.trianglePackets.capacity() * sizeof(TrianglePacket);
+    }
+    return bytes;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Components.h"
+#include "../../include/Model.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// COLLISION MESHES - Shared triangle data for mesh colliders
+// ============================================================================
+// A mesh collider refers to its triangles by handle (Collider::meshHandle)
+// instead of owning a copy, so every tree placed from one model shares one
+// triangle array, BVH and packet set. The data stays in mesh space; queries
+// are moved into it through the entity's inverse transform (see
+// ECS::RayMeshIntersect()).
+//
+// Meshes are never removed, like renderer meshes. Registering a model again
+// returns its first handle (models are keyed by their index buffer, which
+// the loader keeps for the life of the program), and adopting
+// triangles identical to a registered mesh returns that mesh, so reloading a
+// scene snapshot does not pile up copies.
+
+struct CollisionMesh {
+    std::vector<CollisionTriangle> triangles;     // In BVH leaf order
+    std::vector<MeshBVHNode> bvhNodes;
+    std::vector<TrianglePacket> trianglePackets;  // Same triangles, packed for SIMD ray tests
+    hmm_vec3 boundsMin{0.0f, 0.0f, 0.0f};
+    hmm_vec3 boundsMax{0.0f, 0.0f, 0.0f};
+    uint64_t contentHash = 0;                     // Of the triangles, for Adopt()
+};
+
+class CollisionMeshRegistry {
+public:
+    static constexpr int kInvalidHandle = -1;
+
+    // Triangulates the model and builds its BVH, or returns the handle the
+    // model got the first time. -1 for a model without triangles.
+    int Register(const Model3D& model);
+
+    // Takes triangles already in BVH leaf order with their tree (as a scene
+    // snapshot stores them). An identical mesh already registered is reused.
+    int Adopt(const CollisionTriangle* triangles, size_t triangleCount,
+              const MeshBVHNode* bvhNodes, size_t bvhNodeCount);
+
+    const CollisionMesh* Get(int handle) const {
+        return handle >= 0 && handle < (int)meshes_.size() ? &meshes_[handle] : nullptr;
+    }
+
+    int Count() const { return (int)meshes_.size(); }
+
+    // Heap bytes held by all meshes
+    size_t MemoryBytes() const;
+
+private:
+    int Add(CollisionMesh&& mesh);
+
+    std::vector<CollisionMesh> meshes_;
+    std::unordered_map<const uint16_t*, int> byModel_;   // Model3D::indices -> handle
+    std::unordered_multimap<uint64_t, int> byContent_;  // contentHash -> handle
+};
@@ -0,0 +1,33 @@
+#include "CommandBuffer.h"
+
+EntityId CommandBuffer::CreateEntity() {
+    return kFirstPendingId - createCount_++;
+}
+
+void CommandBuffer::DestroyEntity(EntityId id) {
+    if (id == -1) return;
+    destroys_.push_back(id);
+    ++commandCount_;
+}
+
+void CommandBuffer::AddRenderable(EntityId id, int meshId) {
+    renderables_.emplace_back(id, meshId);
+    ++commandCount_;
+}
+
+void CommandBuffer::SetParent(EntityId child, EntityId parent) {
+    parents_.emplace_back(child, parent);
+    ++commandCount_;
+}
+
+void CommandBuffer::Clear() {
+    std::apply([](auto&... commands) {
+        ((commands.adds.clear(), commands.removes.clear()), ...);
+    }, components_);
+    renderables_.clear();
+    parents_.clear();
+    destroys_.clear();
+    resolved_.clear();
+    createCount_ = 0;
+    commandCount_ = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Components.h"
+#include "../../include/Model.h"
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// COMMAND BUFFER - Deferred structural changes
+// ============================================================================
+// Systems record entity creation/destruction and component adds/removes
+// here instead of touching the pools while they iterate them. Each thread
+// gets its own buffer (ECS::Commands()), so recording needs no locking.
+// ECS::PlaybackCommands() applies every buffer at the frame's sync point.
+//
+// Playback is batched by kind: all creates, then all component adds (each
+// pool grows once for the whole batch), then renderables and parents, then
+// removes, then destroys.
+//
+// CreateEntity() returns a pending handle that is only meaningful to later
+// commands in the SAME buffer; it is resolved to a real entity at playback.
+
+class CommandBuffer {
+public:
+    EntityId CreateEntity();
+    void DestroyEntity(EntityId id);
+
+    template <typename T>
+    void AddComponent(EntityId id, const T& component) {
+        For<T>().adds.emplace_back(id, component);
+    }
+
+    template <typename T>
+    void RemoveComponent(EntityId id) {
+        For<T>().removes.push_back(id);
+    }
+
+    void AddRenderable(EntityId id, int meshId);
+    void SetParent(EntityId child, EntityId parent);
+
+    bool empty() const { return commandCount_ == 0 && createCount_ == 0; }
+    void Clear();
+
+    // Pending handles: -2, -3, ... (-1 stays the invalid entity)
+    static bool IsPending(EntityId id) { return id <= kFirstPendingId; }
+
+private:
+    friend class ECS;
+
+    static constexpr EntityId kFirstPendingId = -2;
+
+    template <typename T>
+    struct ComponentCommands {
+        using Type = T;
+        std::vector<std::pair<EntityId, T>> adds;
+        std::vector<EntityId> removes;
+    };
+
+    template <typename T>
+    ComponentCommands<T>& For() {
+        ++commandCount_;
+        return std::get<ComponentCommands<T>>(components_);
+    }
+
+    // Maps a pending handle to the entity created at playback
+    EntityId Resolve(EntityId id) const {
+        if (!IsPending(id)) return id;
+        size_t index = (size_t)(kFirstPendingId - id);
+        return index < resolved_.size() ? resolved_[index] : -1;
+    }
+
+    // Components that can be added/removed through a command buffer.
+    // Renderable (needs the Renderer) and Parent have dedicated commands.
+    std::tuple<ComponentCommands<Transform>,
+               ComponentCommands<Rigidbody>,
+               ComponentCommands<Collider>,
+               ComponentCommands<AIController>,
+               ComponentCommands<Animator>,
+               ComponentCommands<CharacterController>,
+               ComponentCommands<Billboard>,
+               ComponentCommands<ScreenSpace>,
+               ComponentCommands<Light>,
+               ComponentCommands<Selectable>> components_;
+    std::vector<std::pair<EntityId, int>> renderables_;
+    std::vector<std::pair<EntityId, EntityId>> parents_;
+    std::vector<EntityId> destroys_;
+
+    int createCount_ = 0;
+    size_t commandCount_ = 0;
+    std::vector<EntityId> resolved_;
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "EntityId.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// COMPONENT POOL - Sparse set storage for a single component type
+// ============================================================================
+// Components live in one densely packed array so systems can walk them
+// linearly. A paged sparse array maps an entity's slot index to its dense
+// slot, which keeps lookups O(1) without hashing. The dense side stores the
+// full handle, so lookups with a stale generation miss. Removal swaps the
+// last element into the hole, so the dense order is NOT stable and pointers
+// returned by Get() are only valid until the next Insert/Remove on the same
+// pool.
+//
+// Each pool also keeps a change log of added/changed/removed entities.
+// Insert/Remove log automatically; in-place edits are logged with
+// MarkChanged(). Readers keep a cursor and call ForEachChange() to see only
+// what happened since their last read, so their work scales with the number
+// of changes rather than the pool size. A component is logged as changed at
+// most once per frame, unless a reader has read its entry since, so edits
+// after a read are never lost. The log is trimmed by frame (TrimChanges(),
+// which also starts the next frame); a reader whose cursor fell off the end
+// is told to rescan the whole pool.
+// Logging is not thread-safe: structural changes and MarkChanged() belong
+// on the main thread.
+enum class ChangeKind : uint8_t { Added, Changed, Removed };
+
+struct ComponentChange {
+    EntityId entity;
+    ChangeKind kind;
+    uint32_t frame;
+};
+
+template <typename T>
+class ComponentPool {
+public:
+    static constexpr uint32_t kInvalidSlot = 0xFFFFFFFFu;
+
+    // Iterates (entity, component) pairs in dense order
+    template <typename Pool, typename Ref>
+    class BasicIterator {
+    public:
+        BasicIterator(Pool* pool, size_t index) : pool_(pool), index_(index) {}
+
+        std::pair<EntityId, Ref> operator*() const {
+            return { pool_->entities_[index_], pool_->components_[index_] };
+        }
+        BasicIterator& operator++() { ++index_; return *this; }
+        bool operator==(const BasicIterator& other) const { return index_ == other.index_; }
+        bool operator!=(const BasicIterator& other) const { return index_ != other.index_; }
+
+    private:
+        Pool* pool_;
+        size_t index_;
+    };
+
+    using value_type = T;
+    using iterator = BasicIterator<ComponentPool, T&>;
+    using const_iterator = BasicIterator<const ComponentPool, const T&>;
+
+    // Insert or overwrite the component for an entity (same semantics as map[id] = value)
+    T& Insert(EntityId id, const T& value) {
+        uint32_t& slot = SlotFor(id);
+        if (slot != kInvalidSlot) {
+            // Overwriting a stale generation counts as a new component
+            LogChange(entities_[slot] == id ? ChangeKind::Changed : ChangeKind::Added, id, slot);
+            entities_[slot] = id;
+            components_[slot] = value;
+            return components_[slot];
+        }
+        slot = (uint32_t)components_.size();
+        components_.push_back(value);
+        entities_.push_back(id);
+        loggedEpoch_.push_back(0);
+        LogChange(ChangeKind::Added, id, slot);
+        return components_.back();
+    }
+
+    // Remove the component for an entity. Returns false if it had none.
+    bool Remove(EntityId id) {
+        uint32_t* slot = FindSlot(id);
+        if (!slot) return false;
+
+        uint32_t removed = *slot;
+        uint32_t last = (uint32_t)components_.size() - 1;
+        if (removed != last) {
+            components_[removed] = std::move(components_[last]);
+            entities_[removed] = entities_[last];
+            loggedEpoch_[removed] = loggedEpoch_[last];
+            SlotFor(entities_[removed]) = removed;
+        }
+        components_.pop_back();
+        entities_.pop_back();
+        loggedEpoch_.pop_back();
+        *slot = kInvalidSlot;
+        changes_.push_back({ id, ChangeKind::Removed, frame_ });
+        return true;
+    }
+
+    bool Has(EntityId id) const {
+        return FindSlot(id) != nullptr;
+    }
+
+    T* Get(EntityId id) {
+        uint32_t* slot = FindSlot(id);
+        return slot ? &components_[*slot] : nullptr;
+    }
+
+    const T* Get(EntityId id) const {
+        const uint32_t* slot = FindSlot(id);
+        return slot ? &components_[*slot] : nullptr;
+    }
+
+    void Reserve(size_t count) {
+        components_.reserve(count);
+        entities_.reserve(count);
+        loggedEpoch_.reserve(count);
+    }
+
+    // Room for `extra` more components, growing geometrically so repeated
+    // small batches do not reallocate every time
+    void ReserveAdditional(size_t extra) {
+        size_t needed = components_.size() + extra;
+        if (needed <= components_.capacity()) return;
+        size_t grown = components_.capacity() * 2;
+        Reserve(needed > grown ? needed : grown);
+    }
+
+    // Appends components for entities that are not in the pool yet (e.g.
+    // freshly created ones) with one bulk copy. Returns the first of the
+    // `count` new elements, which are contiguous.
+    T* InsertBatch(const EntityId* ids, const T* values, size_t count) {
+        size_t first = components_.size();
+        components_.insert(components_.end(), values, values + count);
+        entities_.insert(entities_.end(), ids, ids + count);
+        loggedEpoch_.resize(first + count, epoch_);
+        changes_.reserve(changes_.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            SlotFor(ids[i]) = (uint32_t)(first + i);
+            changes_.push_back({ ids[i], ChangeKind::Added, frame_ });
+        }
+        return components_.data() + first;
+    }
+
+    void Clear() {
+        for (EntityId id : entities_) {
+            SlotFor(id) = kInvalidSlot;
+            changes_.push_back({ id, ChangeKind::Removed, frame_ });
+        }
+        components_.clear();
+        entities_.clear();
+        loggedEpoch_.clear();
+    }
+
+    // -- Change tracking ----------------------------------------------------
+
+    // Records an in-place edit of an existing component
+    void MarkChanged(EntityId id) {
+        uint32_t* slot = FindSlot(id);
+        if (slot) LogChange(ChangeKind::Changed, id, *slot);
+    }
+
+    // Cursor positioned after everything logged so far. Edits from here on
+    // are logged again, even for components already logged this frame.
+    uint64_t ChangeCursor() {
+        size_t first = changes_.size();
+        while (first > 0 && changes_[first - 1].frame == frame_) --first;
+        ForgetLogged(first, changes_.size());
+        return changeBase_ + changes_.size();
+    }
+
+    // Calls func(const ComponentChange&) for each change after `cursor` and
+    // advances it. Returns false (and skips to the end) if some of those
+    // changes were already trimmed; the caller should rescan the pool.
+    template <typename Func>
+    bool ForEachChange(uint64_t& cursor, Func&& func) {
+        bool complete = cursor >= changeBase_;
+        size_t first = complete ? (size_t)(cursor - changeBase_) : changes_.size();
+        for (size_t i = first; i < changes_.size(); ++i) {
+            func(changes_[i]);
+        }
+        ForgetLogged(first, changes_.size());  // Later edits must be logged again for this reader
+        cursor = changeBase_ + changes_.size();
+        return complete;
+    }
+
+    // Starts a new frame: stamps new log entries with `frame`, logs every
+    // component's next edit again and drops entries older than
+    // `oldestFrameToKeep`
+    void TrimChanges(uint32_t frame, uint32_t oldestFrameToKeep) {
+        ++epoch_;
+        size_t drop = 0;
+        while (drop < changes_.size() && changes_[drop].frame < oldestFrameToKeep) ++drop;
+        if (drop > 0) {
+            changes_.erase(changes_.begin(), changes_.begin() + drop);
+            changeBase_ += drop;
+        }
+        frame_ = frame;
+    }
+
+    size_t size() const { return components_.size(); }
+    bool empty() const { return components_.empty(); }
+
+    // Raw dense arrays for systems that want to walk the pool directly
+    T* Data() { return components_.data(); }
+    const T* Data() const { return components_.data(); }
+    const EntityId* Entities() const { return entities_.data(); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, components_.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, components_.size()); }
+
+private:
+    void LogChange(ChangeKind kind, EntityId id, uint32_t slot) {
+        if (kind == ChangeKind::Changed && loggedEpoch_[slot] == epoch_) return;
+        loggedEpoch_[slot] = epoch_;
+        changes_.push_back({ id, kind, frame_ });
+    }
+
+    // Lets the components behind log entries [first, last) be logged again
+    // this frame (epoch_ starts at 1, so 0 never matches)
+    void ForgetLogged(size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            if (uint32_t* slot = FindSlot(changes_[i].entity)) loggedEpoch_[*slot] = 0;
+        }
+    }
+
+    static constexpr uint32_t kPageShift = 10;
+    static constexpr uint32_t kPageSize = 1u << kPageShift;
+    static constexpr uint32_t kPageMask = kPageSize - 1;
+
+    // Returns the sparse entry only if it points at this exact handle
+    uint32_t* FindSlot(EntityId id) {
+        uint32_t index = EntityIndex(id);
+        uint32_t page = index >> kPageShift;
+        if (id < 0 || page >= pages_.size() || !pages_[page]) return nullptr;
+        uint32_t* slot = &pages_[page][index & kPageMask];
+        return (*slot != kInvalidSlot && entities_[*slot] == id) ? slot : nullptr;
+    }
+
+    const uint32_t* FindSlot(EntityId id) const {
+        uint32_t index = EntityIndex(id);
+        uint32_t page = index >> kPageShift;
+        if (id < 0 || page >= pages_.size() || !pages_[page]) return nullptr;
+        const uint32_t* slot = &pages_[page][index & kPageMask];
+        return (*slot != kInvalidSlot && entities_[*slot] == id) ? slot : nullptr;
+    }
+
+    // Allocates the sparse page on demand (ignores the generation)
+    uint32_t& SlotFor(EntityId id) {
+        uint32_t index = EntityIndex(id);
+        uint32_t page = index >> kPageShift;
+        if (page >= pages_.size()) pages_.resize(page + 1);
+        if (!pages_[page]) {
+            pages_[page] = std::make_unique<uint32_t[]>(kPageSize);
+            for (uint32_t i = 0; i < kPageSize; ++i) pages_[page][i] = kInvalidSlot;
+        }
+        return pages_[page][index & kPageMask];
+    }
+
+    std::vector<T> components_;
+    std::vector<EntityId> entities_;
+    std::vector<std::unique_ptr<uint32_t[]>> pages_;
+
+    // Change log (see top of file). loggedEpoch_ is parallel to the dense
+    // arrays and holds the epoch (frame) a component was last logged in.
+    std::vector<uint32_t> loggedEpoch_;
+    std::vector<ComponentChange> changes_;
+    uint64_t changeBase_ = 0;
+    uint32_t epoch_ = 1;
+    uint32_t frame_ = 0;
+};
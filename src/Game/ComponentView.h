@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ComponentPool.h"
+#include <cstddef>
+#include <tuple>
+
+// ============================================================================
+// COMPONENT VIEW - Iterates entities that have ALL of the given components
+// ============================================================================
+// The view drives iteration from the smallest pool and resolves the other
+// components through their sparse arrays, so there are no hash lookups and
+// no temporary allocations. The callback receives (EntityId, Ts&...).
+//
+// Do not add or remove components of the viewed types from inside Each():
+// pools are swap-and-pop arrays and structural changes move elements.
+template <typename... Ts>
+class ComponentView {
+public:
+    explicit ComponentView(ComponentPool<Ts>&... pools) : pools_(&pools...) {}
+
+    template <typename Func>
+    void Each(Func&& func) {
+        EachInRange(0, SizeHint(), func);
+    }
+
+    // Visits driver slots [begin, end) only. Used to split a view into
+    // chunks for the job system; disjoint ranges touch disjoint entities.
+    template <typename Func>
+    void EachInRange(size_t begin, size_t end, Func&& func) {
+        const EntityId* entities = nullptr;
+        size_t count = 0;
+        PickDriver(entities, count);
+        if (end > count) end = count;
+
+        for (size_t i = begin; i < end; ++i) {
+            EntityId id = entities[i];
+            std::tuple<Ts*...> components(std::get<ComponentPool<Ts>*>(pools_)->Get(id)...);
+            if ((std::get<Ts*>(components) && ...)) {
+                func(id, *std::get<Ts*>(components)...);
+            }
+        }
+    }
+
+    // Upper bound on the number of entities Each() will visit
+    size_t SizeHint() const {
+        const EntityId* entities = nullptr;
+        size_t count = 0;
+        PickDriver(entities, count);
+        return count;
+    }
+
+private:
+    void PickDriver(const EntityId*& entities, size_t& count) const {
+        count = (size_t)-1;
+        ((std::get<ComponentPool<Ts>*>(pools_)->size() < count
+              ? (void)(count = std::get<ComponentPool<Ts>*>(pools_)->size(),
+                       entities = std::get<ComponentPool<Ts>*>(pools_)->Entities())
+              : (void)0), ...);
+    }
+
+    std::tuple<ComponentPool<Ts>*...> pools_;
+};
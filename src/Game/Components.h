@@ -1,12 +1,10 @@
 #pragma once
 
 #include "../../External/HandmadeMath.h"
+#include "EntityId.h"
 #include <cstdint>
 #include <vector>
 
-// Forward declare EntityId (defined in ECS.h)
-using EntityId = int;
-
 // ============================================================================
 // TRANSFORM COMPONENT
 // ============================================================================
@@ -21,6 +19,19 @@ struct Transform {
     bool useCustomMatrix = false;
     hmm_mat4 customMatrix = HMM_Mat4d(1.0f);
     
+    // Cached world matrix (ModelMatrix() times the parent's world matrix, see
+    // Parent). Writes must go through ECS::GetTransform() or
+    // ECS::MarkTransformDirty(), which set the flag and queue the entity;
+    // ECS::SyncToRenderer() recomputes queued matrices, and their subtrees,
+    // and clears the flag.
+    bool dirty = false;
+    hmm_mat4 worldMatrix = HMM_Mat4d(1.0f);
+    
+    // Cached matrix when it is current, otherwise a fresh local one
+    hmm_mat4 CurrentMatrix() const {
+        return dirty ? ModelMatrix() : worldMatrix;
+    }
+    
     hmm_mat4 ModelMatrix() const {
         if (useCustomMatrix) {
             return customMatrix;
@@ -41,13 +52,17 @@ struct Transform {
         return HMM_MultiplyMat4(t, temp);
     }
     
+    // Same point as ModelMatrix()'s translation. For a parented entity this
+    // is relative to the parent; ECS::GetWorldPosition() includes parents.
     hmm_vec3 GetWorldPosition() const {
         hmm_mat4 rx = HMM_Rotate(pitch, HMM_Vec3(1.0f, 0.0f, 0.0f));
         hmm_mat4 ry = HMM_Rotate(yaw, HMM_Vec3(0.0f, 1.0f, 0.0f));
         hmm_mat4 rz = HMM_Rotate(roll, HMM_Vec3(0.0f, 0.0f, 1.0f));
         hmm_mat4 rot = HMM_MultiplyMat4(HMM_MultiplyMat4(rx, ry), rz);
         
-        hmm_vec4 offset4 = HMM_Vec4(originOffset.X, originOffset.Y, originOffset.Z, 0.0f);
+        // Where ModelMatrix() puts the model's origin: the origin offset is
+        // scaled before it is rotated
+        hmm_vec4 offset4 = HMM_Vec4(originOffset.X * scale.X, originOffset.Y * scale.Y, originOffset.Z * scale.Z, 0.0f);
         hmm_vec4 rotatedOffset4 = HMM_MultiplyMat4ByVec4(rot, offset4);
         hmm_vec3 rotatedOffset = HMM_Vec3(rotatedOffset4.X, rotatedOffset4.Y, rotatedOffset4.Z);
         
@@ -64,7 +79,8 @@ enum class ColliderType : uint8_t {
     Box,
     Capsule,
     Mesh,        // Complex geometry (terrain, buildings)
-    Plane        // Infinite plane (simple ground)
+    Plane,       // Infinite plane (simple ground)
+    Heightfield  // Grid of heights (large outdoor terrain)
 };
 
 // Triangle for mesh collider
@@ -73,6 +89,32 @@ struct CollisionTriangle {
     hmm_vec3 normal;       // Pre-calculated normal
 };
 
+// Ray-triangle tests accept barycentric coordinates this far outside the
+// triangle, so a ray through an edge two triangles share can't slip between
+// them on rounding
+constexpr float kRayEdgeTolerance = 1e-4f;
+
+// Node of a mesh collider's triangle BVH (see MeshBVH.h). An inner node's
+// first child is the node right after it and `offset` is the second; a leaf
+// covers triangles [offset, offset + count).
+struct MeshBVHNode {
+    hmm_vec3 min;
+    uint32_t offset;
+    hmm_vec3 max;
+    uint32_t count;        // 0 = inner node
+};
+
+// Triangles 8p..8p+7 of a mesh collider packed for RayTrianglePacket() (see
+// RayKernels.h): first vertex and the edges v1 - v0, v2 - v0. Lanes past the
+// end of the mesh have zero edges, which never hit.
+constexpr int kRayPacketWidth = 8;
+
+struct TrianglePacket {
+    float v0x[kRayPacketWidth], v0y[kRayPacketWidth], v0z[kRayPacketWidth];
+    float e1x[kRayPacketWidth], e1y[kRayPacketWidth], e1z[kRayPacketWidth];
+    float e2x[kRayPacketWidth], e2y[kRayPacketWidth], e2z[kRayPacketWidth];
+};
+
 struct Collider {
     ColliderType type = ColliderType::Sphere;
     
@@ -83,10 +125,13 @@ struct Collider {
     float capsuleRadius = 0.5f;
     
     // === Mesh collider ===
-    std::vector<CollisionTriangle> triangles;
-    hmm_vec3 meshBoundsMin{0.0f, 0.0f, 0.0f};
+    int meshHandle = -1;                   // CollisionMeshRegistry handle; triangles are shared
+    hmm_vec3 meshBoundsMin{0.0f, 0.0f, 0.0f};  // Copy of the shared mesh's (or heightfield's) bounds
     hmm_vec3 meshBoundsMax{0.0f, 0.0f, 0.0f};
     
+    // === Heightfield collider ===
+    int heightfieldHandle = -1;            // HeightfieldRegistry handle; heights are shared
+    
     // === Plane collider ===
     hmm_vec3 planeNormal{0.0f, 1.0f, 0.0f};
     float planeDistance = 0.0f;
@@ -99,6 +144,10 @@ struct Collider {
     bool useBroadPhase = true;
 };
 
+// Collision layers used by the game (Collider::collisionLayer bits)
+constexpr uint32_t kDefaultCollisionLayer = 0x00000001;
+constexpr uint32_t kEnemyCollisionLayer = 0x00000002;  // Enemy crowds; kept in the hash grid
+
 struct Rigidbody {
     hmm_vec3 velocity{0.0f, 0.0f, 0.0f};
     float mass = 1.0f;
@@ -106,6 +155,38 @@ struct Rigidbody {
     bool isKinematic = false;
     float drag = 0.1f;
     float bounciness = 0.0f;
+    float friction = 0.5f;  // Combined with the other body's as sqrt(a * b)
+    
+    // Sleeping (see ECS::WakeBody()): a body that has stayed slow for a
+    // while is no longer integrated, tested or synced until something
+    // wakes it. Velocity edits should go through ECS::ApplyImpulse() or
+    // MarkChanged<Rigidbody>() so a sleeping body notices them.
+    bool canSleep = true;
+    bool sleeping = false;
+    float sleepTimer = 0.0f;  // Seconds below the sleep speed
+    
+    // Fast bodies and bullets: swept against other colliders when a step
+    // would move them further than their collider's radius (see
+    // ECS::UpdatePhysics()), so they can't pass through thin ones
+    bool continuousCollision = false;
+};
+
+// Walking actor (player, AI) moved by ECS::UpdateCharacters() with swept
+// shapes instead of through the solver. Needs a capsule (or sphere)
+// Collider and should carry a kinematic Rigidbody, so the solver pushes
+// other bodies out of it but never pushes it.
+struct CharacterController {
+    hmm_vec3 moveVelocity{0.0f, 0.0f, 0.0f};  // Wanted horizontal velocity (Y is ignored)
+    float verticalVelocity = 0.0f;            // Set to jump; gravity pulls it while airborne
+    float stepHeight = 0.35f;                 // Ledges up to this high are walked onto
+    float maxSlopeCos = 0.64f;                // cos of the steepest walkable slope (about 50 degrees)
+    float snapDistance = 0.3f;                // Walkable ground this far below is followed down
+    float skinWidth = 0.01f;                  // Gap kept to what the character stops against
+
+    // From the last UpdateCharacters()
+    bool grounded = false;
+    hmm_vec3 groundNormal{0.0f, 1.0f, 0.0f};
+    EntityId groundEntity = -1;
 };
 
 // ============================================================================
@@ -179,6 +260,26 @@ struct ScreenSpace {
     float depth = 0.0f;
 };
 
+// ============================================================================
+// RENDERING LINKAGE
+// ============================================================================
+
+struct Renderable {
+    int meshId = -1;      // mesh lookup in Renderer
+    int instanceId = -1;  // renderer instance id
+};
+
+// ============================================================================
+// HIERARCHY
+// ============================================================================
+
+// The entity's Transform is relative to the parent's world matrix.
+// Set through ECS::SetParent(), which rejects cycles and entities with a
+// Collider or Selectable.
+struct Parent {
+    EntityId parent = -1;
+};
+
 // ============================================================================
 // GHOST PREVIEW
 // ============================================================================
@@ -1,111 +1,191 @@
 #include "ECS.h"
+#include "MeshBVH.h"
+#include "RayKernels.h"
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <type_traits>
 #include "../External/HandmadeMath.h"
 
-ECS::ECS() = default;
+ECS::ECS() : commandBuffers_(1), dirtyTransforms_(1), sweptBodies_(1), sweepScratch_(1) {}
 ECS::~ECS() = default;
 
 EntityId ECS::CreateEntity() {
-    EntityId id = nextId_++;
+    // Recycle a destroyed slot (its generation was bumped on destroy)
+    uint32_t index;
+    if (deterministic_ && !deterministicFreeSlots_.empty()) {
+        index = deterministicFreeSlots_.front();
+        deterministicFreeSlots_.pop_front();
+    } else if (!deterministic_ && !freeSlots_.empty()) {
+        index = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        index = (uint32_t)generations_.size();
+        if (index > kEntityIndexMask) {
+            printf("ERROR: Entity limit reached (%u)\n", kEntityIndexMask + 1);
+            return -1;
+        }
+        generations_.push_back(1);
+        aliveSlot_.push_back(kDeadSlot);
+    }
+    
+    EntityId id = MakeEntityId(index, generations_[index]);
+    aliveSlot_[index] = (uint32_t)alive_.size();
     alive_.push_back(id);
     return id;
 }
 
+bool ECS::IsAlive(EntityId id) const {
+    if (id < 0) return false;
+    uint32_t index = EntityIndex(id);
+    return index < generations_.size() &&
+           aliveSlot_[index] != kDeadSlot &&
+           generations_[index] == EntityGeneration(id);
+}
+
 void ECS::DestroyEntity(EntityId id) {
-    transforms_.erase(id);
-    rigidbodies_.erase(id);
-    colliders_.erase(id);
-    ai_controllers_.erase(id);
-    animators_.erase(id);
-    mesh_for_entity_.erase(id);
-    instance_for_entity_.erase(id);
-    billboards_.erase(id);
-    screen_spaces_.erase(id);
-    lights_.erase(id);
-    selectables_.erase(id);
-    alive_.erase(std::remove(alive_.begin(), alive_.end(), id), alive_.end());
-}
-
-void ECS::AddTransform(EntityId id, const Transform& t) { transforms_[id] = t; }
-bool ECS::HasTransform(EntityId id) const { return transforms_.find(id) != transforms_.end(); }
+    if (!IsAlive(id)) return;
+    
+    transforms_.Remove(id);
+    rigidbodies_.Remove(id);
+    colliders_.Remove(id);
+    ai_controllers_.Remove(id);
+    animators_.Remove(id);
+    characters_.Remove(id);
+    renderables_.Remove(id);
+    billboards_.Remove(id);
+    screen_spaces_.Remove(id);
+    lights_.Remove(id);
+    selectables_.Remove(id);
+    
+    // Leave the hierarchy. Children are detached on the next rebuild
+    // (their parent handle is stale by then), which keeps destroy O(1).
+    RemoveParent(id);
+    if (EntityIndex(id) < childCount_.size() && childCount_[EntityIndex(id)] > 0) {
+        childCount_[EntityIndex(id)] = 0;
+        hierarchyDirty_ = true;
+    }
+    
+    // Swap-remove from the alive list
+    uint32_t index = EntityIndex(id);
+    uint32_t slot = aliveSlot_[index];
+    EntityId last = alive_.back();
+    alive_[slot] = last;
+    aliveSlot_[EntityIndex(last)] = slot;
+    alive_.pop_back();
+    aliveSlot_[index] = kDeadSlot;
+    
+    // Bump the generation so outstanding handles to this slot go stale.
+    // Generation 0 is skipped so a handle is never 0.
+    uint32_t generation = (generations_[index] + 1) & kEntityGenerationMask;
+    generations_[index] = generation ? generation : 1;
+    if (deterministic_) {
+        deterministicFreeSlots_.push_back(index);
+    } else {
+        freeSlots_.push_back(index);
+    }
+}
+
+void ECS::AddTransform(EntityId id, const Transform& t) {
+    if (!IsAlive(id)) return;
+    Transform& inserted = transforms_.Insert(id, t);
+    inserted.dirty = false;
+    TouchTransform(id, inserted);
+}
+bool ECS::HasTransform(EntityId id) const { return transforms_.Has(id); }
+
+// Callers may write through the returned pointer, so assume they do
 Transform* ECS::GetTransform(EntityId id) {
-    auto it = transforms_.find(id);
-    return (it != transforms_.end()) ? &it->second : nullptr;
+    Transform* t = transforms_.Get(id);
+    if (t) TouchTransform(id, *t);
+    return t;
 }
 
-void ECS::AddRigidbody(EntityId id, const Rigidbody& rb) { rigidbodies_[id] = rb; }
-Rigidbody* ECS::GetRigidbody(EntityId id) {
-    auto it = rigidbodies_.find(id);
-    return (it != rigidbodies_.end()) ? &it->second : nullptr;
+const Transform* ECS::PeekTransform(EntityId id) const { return transforms_.Get(id); }
+
+void ECS::AddRigidbody(EntityId id, const Rigidbody& rb) {
+    if (!IsAlive(id)) return;
+    rigidbodies_.Insert(id, rb);
 }
+Rigidbody* ECS::GetRigidbody(EntityId id) { return rigidbodies_.Get(id); }
 
-void ECS::AddCollider(EntityId id, const Collider& col) { colliders_[id] = col; }
-Collider* ECS::GetCollider(EntityId id) {
-    auto it = colliders_.find(id);
-    return (it != colliders_.end()) ? &it->second : nullptr;
+void ECS::AddCollider(EntityId id, const Collider& col) {
+    if (!IsAlive(id)) return;
+    if (parents_.Has(id)) {
+        printf("ERROR: AddCollider(%d): parented entities can't have colliders\n", id);
+        return;
+    }
+    colliders_.Insert(id, col);
 }
-bool ECS::HasCollider(EntityId id) const { return colliders_.find(id) != colliders_.end(); }
+Collider* ECS::GetCollider(EntityId id) { return colliders_.Get(id); }
+bool ECS::HasCollider(EntityId id) const { return colliders_.Has(id); }
 
-void ECS::AddAI(EntityId id, const AIController& ai) { ai_controllers_[id] = ai; }
-AIController* ECS::GetAI(EntityId id) {
-    auto it = ai_controllers_.find(id);
-    return (it != ai_controllers_.end()) ? &it->second : nullptr;
+void ECS::AddAI(EntityId id, const AIController& ai) {
+    if (!IsAlive(id)) return;
+    ai_controllers_.Insert(id, ai);
 }
+AIController* ECS::GetAI(EntityId id) { return ai_controllers_.Get(id); }
 
-void ECS::AddAnimator(EntityId id, const Animator& a) { animators_[id] = a; }
-Animator* ECS::GetAnimator(EntityId id) {
-    auto it = animators_.find(id);
-    return (it != animators_.end()) ? &it->second : nullptr;
+void ECS::AddAnimator(EntityId id, const Animator& a) {
+    if (!IsAlive(id)) return;
+    animators_.Insert(id, a);
 }
+Animator* ECS::GetAnimator(EntityId id) { return animators_.Get(id); }
+
+void ECS::AddCharacter(EntityId id, const CharacterController& character) {
+    if (!IsAlive(id)) return;
+    characters_.Insert(id, character);
+}
+CharacterController* ECS::GetCharacter(EntityId id) { return characters_.Get(id); }
 
 int ECS::AddRenderable(EntityId id, int meshId, Renderer& renderer) {
-    if (meshId < 0) return -1;
-    mesh_for_entity_[id] = meshId;
-    int instId = renderer.AddInstance(meshId, transforms_.count(id) ? transforms_[id].ModelMatrix() : HMM_Mat4d(1.0f));
-    instance_for_entity_[id] = instId;
-    return instId;
+    if (meshId < 0 || !IsAlive(id)) return -1;
+    const Transform* t = transforms_.Get(id);
+    Renderable r;
+    r.meshId = meshId;
+    r.instanceId = renderer.AddInstance(meshId, t ? t->ModelMatrix() : HMM_Mat4d(1.0f));
+    renderables_.Insert(id, r);
+    return r.instanceId;
 }
 
 bool ECS::HasRenderable(EntityId id) const {
-    return instance_for_entity_.find(id) != instance_for_entity_.end();
+    return renderables_.Has(id);
 }
 
 int ECS::GetInstanceId(EntityId id) const {
-    auto it = instance_for_entity_.find(id);
-    return (it != instance_for_entity_.end()) ? it->second : -1;
+    const Renderable* r = renderables_.Get(id);
+    return r ? r->instanceId : -1;
 }
 
 int ECS::GetMeshId(EntityId id) const {
-    auto it = mesh_for_entity_.find(id);
-    return (it != mesh_for_entity_.end()) ? it->second : -1;
+    const Renderable* r = renderables_.Get(id);
+    return r ? r->meshId : -1;
 }
 
 void ECS::RemoveRenderable(EntityId id, Renderer& renderer) {
-    auto it = instance_for_entity_.find(id);
-    if (it != instance_for_entity_.end()) {
-        int instanceId = it->second;
-        renderer.RemoveInstance(instanceId);
-        instance_for_entity_.erase(it);
+    Renderable* r = renderables_.Get(id);
+    if (r) {
+        renderer.RemoveInstance(r->instanceId);
+        renderables_.Remove(id);
     }
-    mesh_for_entity_.erase(id);
 }
 
 // Billboard Methods
-void ECS::AddBillboard(EntityId id, const Billboard& b) { billboards_[id] = b; }
-Billboard* ECS::GetBillboard(EntityId id) {
-    auto it = billboards_.find(id);
-    return (it != billboards_.end()) ? &it->second : nullptr;
+void ECS::AddBillboard(EntityId id, const Billboard& b) {
+    if (!IsAlive(id)) return;
+    billboards_.Insert(id, b);
 }
-bool ECS::HasBillboard(EntityId id) const { return billboards_.find(id) != billboards_.end(); }
+Billboard* ECS::GetBillboard(EntityId id) { return billboards_.Get(id); }
+bool ECS::HasBillboard(EntityId id) const { return billboards_.Has(id); }
 
 void ECS::UpdateBillboards(const hmm_vec3& cameraPosition) {
-    for (auto& [id, billboard] : billboards_) {
-        Transform* t = GetTransform(id);
-        if (!t) continue;
+    View<Billboard, Transform>().Each([&](EntityId id, Billboard& billboard, Transform& transform) {
+        Transform* t = &transform;
         
         if (billboard.followTarget != -1) {
-            Transform* targetTransform = GetTransform(billboard.followTarget);
+            const Transform* targetTransform = PeekTransform(billboard.followTarget);
             if (targetTransform) {
                 t->position = HMM_AddVec3(targetTransform->position, billboard.offset);
             }
@@ -114,7 +194,7 @@ void ECS::UpdateBillboards(const hmm_vec3& cameraPosition) {
         hmm_vec3 toCamera = HMM_SubtractVec3(cameraPosition, t->position);
         float length = sqrtf(toCamera.X * toCamera.X + toCamera.Y * toCamera.Y + toCamera.Z * toCamera.Z);
         
-        if (length < 0.001f) continue;
+        if (length < 0.001f) return;
         
         hmm_vec3 forward = HMM_Vec3(toCamera.X / length, toCamera.Y / length, toCamera.Z / length);
         
@@ -167,21 +247,21 @@ void ECS::UpdateBillboards(const hmm_vec3& cameraPosition) {
         
         t->customMatrix = rotationMatrix;
         t->useCustomMatrix = true;
-    }
+        TouchTransform(id, *t);
+    });
 }
 
 // Screen Space Methods
-void ECS::AddScreenSpace(EntityId id, const ScreenSpace& ss) { screen_spaces_[id] = ss; }
-ScreenSpace* ECS::GetScreenSpace(EntityId id) {
-    auto it = screen_spaces_.find(id);
-    return (it != screen_spaces_.end()) ? &it->second : nullptr;
+void ECS::AddScreenSpace(EntityId id, const ScreenSpace& ss) {
+    if (!IsAlive(id)) return;
+    screen_spaces_.Insert(id, ss);
 }
-bool ECS::HasScreenSpace(EntityId id) const { return screen_spaces_.find(id) != screen_spaces_.end(); }
+ScreenSpace* ECS::GetScreenSpace(EntityId id) { return screen_spaces_.Get(id); }
+bool ECS::HasScreenSpace(EntityId id) const { return screen_spaces_.Has(id); }
 
 void ECS::UpdateScreenSpace(float screenWidth, float screenHeight) {
-    for (auto& [id, screenSpace] : screen_spaces_) {
-        Transform* t = GetTransform(id);
-        if (!t) continue;
+    ParallelEach<ScreenSpace, Transform>([&](EntityId id, ScreenSpace& screenSpace, Transform& transform) {
+        Transform* t = &transform;
         
         float x = (screenSpace.screenPosition.X - 0.5f) * 2.0f;
         float y = (0.5f - screenSpace.screenPosition.Y) * 2.0f;
@@ -214,24 +294,189 @@ void ECS::UpdateScreenSpace(float screenWidth, float screenHeight) {
         screenMatrix.Elements[2][3] = 0.0f;
         screenMatrix.Elements[3][3] = 1.0f;
         
+        // Only changes when the window is resized
+        if (t->useCustomMatrix && memcmp(&t->customMatrix, &screenMatrix, sizeof(hmm_mat4)) == 0) return;
+        
         t->customMatrix = screenMatrix;
         t->useCustomMatrix = true;
-    }
+        TouchTransform(id, *t);
+    });
 }
 
 std::vector<EntityId> ECS::GetScreenSpaceEntities() const {
     std::vector<EntityId> result;
-    for (const auto& [id, _] : screen_spaces_) {
-        result.push_back(id);
-    }
+    result.assign(screen_spaces_.Entities(), screen_spaces_.Entities() + screen_spaces_.size());
     return result;
 }
 
 std::vector<EntityId> ECS::AllEntities() const { return alive_; }
 
-// -- Systems ---------------------------------------------------------------
+void ECS::SetJobSystem(JobSystem* jobs) {
+    jobs_ = jobs;
+    EnsureThreadSlots();
+}
+
+// Per-thread buffers need one slot per job thread (index 0 = main thread)
+void ECS::EnsureThreadSlots() {
+    size_t slots = jobs_ ? jobs_->WorkerCount() + 1 : 1;
+    if (commandBuffers_.size() < slots) commandBuffers_.resize(slots);
+    if (dirtyTransforms_.size() < slots) dirtyTransforms_.resize(slots);
+    if (sweptBodies_.size() < slots) sweptBodies_.resize(slots);
+    if (sweepScratch_.size() < slots) sweepScratch_.resize(slots);
+}
 
-static inline float randf() { return (float)std::rand() / (float)RAND_MAX; }
+// -- Change tracking -------------------------------------------------------
+
+void ECS::MarkTransformDirty(EntityId id) {
+    if (Transform* t = transforms_.Get(id)) TouchTransform(id, *t);
+}
+
+// Moves the per-thread dirty lists into the transform change log and the
+// SyncToRenderer queue. Main thread only, outside parallel systems.
+void ECS::FlushTransformChanges() {
+    if (deterministic_) {
+        // One list in entity order: which thread touched what is up to the
+        // scheduler, and the log order decides the index's tree shape
+        std::vector<EntityId>& merged = dirtyTransforms_[0];
+        for (size_t i = 1; i < dirtyTransforms_.size(); ++i) {
+            merged.insert(merged.end(), dirtyTransforms_[i].begin(), dirtyTransforms_[i].end());
+            dirtyTransforms_[i].clear();
+        }
+        std::sort(merged.begin(), merged.end(), [](EntityId a, EntityId b) { return EntityIndex(a) < EntityIndex(b); });
+    }
+    for (std::vector<EntityId>& dirty : dirtyTransforms_) {
+        for (EntityId id : dirty) {
+            transforms_.MarkChanged(id);
+        }
+        syncQueue_.insert(syncQueue_.end(), dirty.begin(), dirty.end());
+        dirty.clear();
+    }
+}
+
+void ECS::EndFrame() {
+    FlushTransformChanges();
+    
+    // Consume this frame's changes while they are still logged, so the
+    // indexes stay incremental even in frames without collisions or picking
+    RefreshColliderIndex();
+    RefreshSelectableIndex();
+    
+    ++frame_;
+    uint32_t oldestFrameToKeep = frame_ > kChangeHistoryFrames ? frame_ - kChangeHistoryFrames : 0;
+    ForEachPool([&](auto& pool) {
+        pool.TrimChanges(frame_, oldestFrameToKeep);
+    });
+}
+
+// -- Command buffers -------------------------------------------------------
+
+CommandBuffer& ECS::Commands() {
+    unsigned index = jobs_ ? jobs_->CurrentThreadIndex() : 0;
+    return commandBuffers_[index < commandBuffers_.size() ? index : 0];
+}
+
+void ECS::ReserveEntities(size_t count) {
+    alive_.reserve(alive_.size() + count);
+    size_t reusable = deterministic_ ? deterministicFreeSlots_.size() : freeSlots_.size();
+    if (count > reusable) {
+        size_t fresh = count - reusable;
+        generations_.reserve(generations_.size() + fresh);
+        aliveSlot_.reserve(aliveSlot_.size() + fresh);
+    }
+}
+
+template <typename T>
+void ECS::PlaybackComponentAdds() {
+    using Commands = CommandBuffer::ComponentCommands<T>;
+    ComponentPool<T>& pool = Storage<T>();
+    
+    size_t addCount = 0;
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        addCount += std::get<Commands>(buffer.components_).adds.size();
+    }
+    if (addCount == 0) return;
+    pool.ReserveAdditional(addCount);
+    
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        for (const auto& [id, component] : std::get<Commands>(buffer.components_).adds) {
+            EntityId entity = buffer.Resolve(id);
+            if (!IsAlive(entity)) continue;
+            T& inserted = pool.Insert(entity, component);
+            if constexpr (std::is_same_v<T, Transform>) {
+                inserted.dirty = false;
+                TouchTransform(entity, inserted);
+            }
+        }
+    }
+}
+
+template <typename T>
+void ECS::PlaybackComponentRemoves() {
+    using Commands = CommandBuffer::ComponentCommands<T>;
+    ComponentPool<T>& pool = Storage<T>();
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        for (EntityId id : std::get<Commands>(buffer.components_).removes) {
+            pool.Remove(buffer.Resolve(id));
+        }
+    }
+}
+
+void ECS::PlaybackCommands(Renderer& renderer) {
+    EnsureThreadSlots();
+    
+    size_t createCount = 0;
+    size_t renderableCount = 0;
+    bool anyCommands = false;
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        createCount += (size_t)buffer.createCount_;
+        renderableCount += buffer.renderables_.size();
+        anyCommands = anyCommands || !buffer.empty();
+    }
+    if (!anyCommands) return;
+    
+    // Creates: entity bookkeeping grows once for the whole batch
+    ReserveEntities(createCount);
+    for (CommandBuffer& buffer : commandBuffers_) {
+        buffer.resolved_.resize((size_t)buffer.createCount_);
+        for (EntityId& entity : buffer.resolved_) {
+            entity = CreateEntity();
+        }
+    }
+    
+    // Component adds, one batch per pool
+    std::apply([this](const auto&... commands) {
+        (PlaybackComponentAdds<typename std::decay_t<decltype(commands)>::Type>(), ...);
+    }, commandBuffers_[0].components_);
+    
+    renderables_.ReserveAdditional(renderableCount);
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        for (const auto& [id, meshId] : buffer.renderables_) {
+            AddRenderable(buffer.Resolve(id), meshId, renderer);
+        }
+        for (const auto& [child, parent] : buffer.parents_) {
+            SetParent(buffer.Resolve(child), buffer.Resolve(parent));
+        }
+    }
+    
+    // Removes, then destroys
+    std::apply([this](const auto&... commands) {
+        (PlaybackComponentRemoves<typename std::decay_t<decltype(commands)>::Type>(), ...);
+    }, commandBuffers_[0].components_);
+    
+    for (const CommandBuffer& buffer : commandBuffers_) {
+        for (EntityId id : buffer.destroys_) {
+            EntityId entity = buffer.Resolve(id);
+            RemoveRenderable(entity, renderer);
+            DestroyEntity(entity);
+        }
+    }
+    
+    for (CommandBuffer& buffer : commandBuffers_) {
+        buffer.Clear();
+    }
+}
+
+// -- Systems ---------------------------------------------------------------
 
 static inline float LerpAngle(float from, float to, float t) {
     const float PI = 3.14159265359f;
@@ -242,41 +487,60 @@ static inline float LerpAngle(float from, float to, float t) {
 }
 
 void ECS::UpdateAI(float dt) {
-    for (auto &kv : ai_controllers_) {
-        EntityId id = kv.first;
-        AIController &ai = kv.second;
-        Transform* t = GetTransform(id);
-        if (!t) continue;
+    View<AIController, Transform>().Each([&](EntityId id, AIController& ai, Transform& transform) {
+        Transform* t = &transform;
+        CharacterController* character = characters_.Get(id);  // Walked by UpdateCharacters() if set
 
         ai.stateTimer -= dt;
         switch (ai.state) {
             case AIState::Idle:
                 if (ai.stateTimer <= 0.0f) {
                     ai.state = AIState::Wander;
-                    ai.stateTimer = 3.0f + randf() * 4.0f;
-                    ai.wanderTarget = HMM_AddVec3(t->position, HMM_Vec3((randf()-0.5f)*10.0f,0.0f,(randf()-0.5f)*10.0f));
+                    ai.stateTimer = 3.0f + RandomFloat() * 4.0f;
+                    ai.wanderTarget = HMM_AddVec3(t->position, HMM_Vec3((RandomFloat()-0.5f)*10.0f,0.0f,(RandomFloat()-0.5f)*10.0f));
                 }
                 break;
             case AIState::Wander: {
                 hmm_vec3 dir = HMM_SubtractVec3(ai.wanderTarget, t->position);
                 float dx = dir.X; float dz = dir.Z;
                 float dist = sqrtf(dx*dx + dz*dz);
-                if (dist > 0.1f) {
+                // Characters can be blocked, so they give up when time runs out
+                if (dist > 0.1f && !(character && ai.stateTimer <= 0.0f)) {
                     float speed = 1.0f;
-                    t->position = HMM_AddVec3(t->position, HMM_Vec3(dx/dist*speed*dt, 0.0f, dz/dist*speed*dt));
+                    if (character) {
+                        character->moveVelocity = HMM_Vec3(dx/dist*speed, 0.0f, dz/dist*speed);
+                    } else {
+                        t->position = HMM_AddVec3(t->position, HMM_Vec3(dx/dist*speed*dt, 0.0f, dz/dist*speed*dt));
+                    }
                     
                     float targetYaw = atan2f(dx, dz);
                     float rotationSpeed = 5.0f;
                     t->yaw = LerpAngle(t->yaw, targetYaw, rotationSpeed * dt);
+                    TouchTransform(id, *t);
                 } else {
+                    if (character) character->moveVelocity = HMM_Vec3(0.0f, 0.0f, 0.0f);
                     ai.state = AIState::Idle;
-                    ai.stateTimer = 1.0f + randf()*2.0f;
+                    ai.stateTimer = 1.0f + RandomFloat()*2.0f;
                 }
                 break;
             }
             case AIState::Chase:
                 break;
         }
+    });
+}
+
+// Longest move that can't skip past anything: the collider's inner radius
+static float SweepRadius(const Collider& collider) {
+    switch (collider.type) {
+        case ColliderType::Sphere: return collider.radius;
+        case ColliderType::Capsule: return collider.capsuleRadius;
+        case ColliderType::Box: {
+            const hmm_vec3& half = collider.boxHalfExtents;
+            float smallest = half.X < half.Y ? half.X : half.Y;
+            return smallest < half.Z ? smallest : half.Z;
+        }
+        default: return 0.0f;  // Meshes and planes are never swept
     }
 }
 
@@ -284,11 +548,8 @@ void ECS::UpdatePhysics(float dt) {
     const hmm_vec3 gravity = HMM_Vec3(0.0f, -9.81f, 0.0f);
     
     // Apply gravity and integrate velocity
-    for (auto &kv : rigidbodies_) {
-        EntityId id = kv.first;
-        Rigidbody &rb = kv.second;
-        Transform* t = GetTransform(id);
-        if (!t || rb.isKinematic) continue;
+    ParallelEach<Rigidbody, Transform>([&](EntityId id, Rigidbody& rb, Transform& t) {
+        if (rb.isKinematic || rb.sleeping) return;
         
         // Apply gravity
         if (rb.affectedByGravity) {
@@ -303,290 +564,1888 @@ void ECS::UpdatePhysics(float dt) {
         }
         
         // Integrate position
-        t->position = HMM_AddVec3(t->position, HMM_MultiplyVec3f(rb.velocity, dt));
+        if (rb.velocity.X != 0.0f || rb.velocity.Y != 0.0f || rb.velocity.Z != 0.0f) {
+            // Too fast to jump in one go: moved by SweepBody() below
+            if (rb.continuousCollision) {
+                const Collider* collider = colliders_.Get(id);
+                float reach = collider ? SweepRadius(*collider) : 0.0f;
+                if (reach > 0.0f && HMM_DotVec3(rb.velocity, rb.velocity) * dt * dt > reach * reach) {
+                    unsigned index = jobs_ ? jobs_->CurrentThreadIndex() : 0;
+                    sweptBodies_[index < sweptBodies_.size() ? index : 0].push_back(id);
+                    return;
+                }
+            }
+            t.position = HMM_AddVec3(t.position, HMM_MultiplyVec3f(rb.velocity, dt));
+            TouchTransform(id, t);
+        }
         
         // REMOVED: Old hardcoded ground collision at Y=0
         // This is now handled by UpdateCollisions() checking against the plane collider
+    });
+    
+    // Swept bodies in slot order, whichever thread found them
+    continuousStats_ = ContinuousStats();
+    sweepOrder_.clear();
+    for (std::vector<EntityId>& swept : sweptBodies_) {
+        sweepOrder_.insert(sweepOrder_.end(), swept.begin(), swept.end());
+        swept.clear();
+    }
+    if (sweepOrder_.empty()) return;
+    std::sort(sweepOrder_.begin(), sweepOrder_.end(), [](EntityId a, EntityId b) { return EntityIndex(a) < EntityIndex(b); });
+    RefreshColliderIndex();
+    for (EntityId id : sweepOrder_) {
+        SweepBody(id, dt);
+    }
+}
+
+// Planes are unbounded, so they never go through the sweep
+static bool UsesBroadphase(const Collider& collider) {
+    return collider.useBroadPhase && collider.type != ColliderType::Plane;
+}
+
+// World-space AABB around what CheckCollision() tests for this collider
+static void ColliderBounds(const Collider& collider, const Transform& transform, hmm_vec3& outMin, hmm_vec3& outMax) {
+    hmm_vec3 center = transform.position;
+    hmm_vec3 extents;
+    switch (collider.type) {
+        case ColliderType::Sphere: {
+            // Collisions test the sphere at position, raycasts at
+            // GetWorldPosition() (scaled, rotated origin offset): cover both
+            float radius = collider.radius + HMM_LengthVec3(HMM_MultiplyVec3(transform.originOffset, transform.scale));
+            extents = HMM_Vec3(radius, radius, radius);
+            break;
+        }
+        case ColliderType::Box: {
+            // |R| * half extents covers the turned box
+            hmm_vec3 axes[3];
+            TransformAxes(transform, axes);
+            const hmm_vec3& half = collider.boxHalfExtents;
+            for (int row = 0; row < 3; ++row) {
+                extents.Elements[row] = fabsf(axes[0].Elements[row]) * half.X +
+                                        fabsf(axes[1].Elements[row]) * half.Y +
+                                        fabsf(axes[2].Elements[row]) * half.Z;
+            }
+            break;
+        }
+        case ColliderType::Capsule: {
+            // Segment along the local Y axis, rounded by the radius
+            hmm_vec3 axes[3];
+            TransformAxes(transform, axes);
+            float halfHeight = collider.capsuleHeight * 0.5f;
+            for (int row = 0; row < 3; ++row) {
+                extents.Elements[row] = fabsf(axes[1].Elements[row]) * halfHeight + collider.capsuleRadius;
+            }
+            break;
+        }
+        case ColliderType::Mesh:
+        case ColliderType::Heightfield: {
+            // Local bounds through the model matrix (|M| * extents covers any rotation)
+            hmm_mat4 m = transform.CurrentMatrix();
+            hmm_vec3 localCenter = HMM_MultiplyVec3f(HMM_AddVec3(collider.meshBoundsMin, collider.meshBoundsMax), 0.5f);
+            hmm_vec3 localExtents = HMM_MultiplyVec3f(HMM_SubtractVec3(collider.meshBoundsMax, collider.meshBoundsMin), 0.5f);
+            for (int row = 0; row < 3; ++row) {
+                center.Elements[row] = m.Elements[3][row];
+                extents.Elements[row] = 0.0f;
+                for (int col = 0; col < 3; ++col) {
+                    center.Elements[row] += m.Elements[col][row] * localCenter.Elements[col];
+                    extents.Elements[row] += fabsf(m.Elements[col][row]) * localExtents.Elements[col];
+                }
+            }
+            break;
+        }
+        default:
+            extents = HMM_Vec3(0.0f, 0.0f, 0.0f);
+            break;
+    }
+    outMin = HMM_SubtractVec3(center, extents);
+    outMax = HMM_AddVec3(center, extents);
+}
+
+// Candidate pairs for this frame into broadphasePairs_. Runs inside the
+// Collisions system, which owns Transform and Collider for its phase, so
+// reading their change logs here does not race with other systems.
+void ECS::FindCollisionPairs() {
+    const EntityId* entities = colliders_.Entities();
+    const Collider* colliderData = colliders_.Data();
+    const size_t colliderCount = colliders_.size();
+    
+    broadphasePairs_.clear();
+    RebuildHashGrid();
+    if (broadphaseMode_ == BroadphaseMode::AABBTree) {
+        // Only colliders that changed since the last refresh are touched
+        RefreshColliderIndex();
+        colliderIndex_.FindPairs(broadphasePairs_);
+    } else {
+        // New colliders get a proxy (no-op for existing ones)
+        for (size_t i = 0; i < colliderCount; ++i) {
+            if (UsesBroadphase(colliderData[i]) && !InHashGrid(entities[i])) broadphase_.Add(entities[i]);
+        }
+        
+        // Refresh bounds and filter data; drop proxies whose collider is gone
+        for (BroadphaseProxy& proxy : broadphase_.Proxies()) {
+            const Collider* collider = colliders_.Get(proxy.entity);
+            const Transform* transform = transforms_.Get(proxy.entity);
+            if (!collider || !transform || !UsesBroadphase(*collider) || InHashGrid(proxy.entity)) {
+                broadphase_.Remove(proxy.entity);
+                continue;
+            }
+            ColliderBounds(*collider, *transform, proxy.min, proxy.max);
+            proxy.collisionLayer = collider->collisionLayer;
+            proxy.collisionMask = collider->collisionMask;
+            proxy.isStatic = IsStaticForPairs(proxy.entity, *collider);
+        }
+        
+        broadphase_.FindPairs(broadphasePairs_);
+    }
+    
+    if (hashGrid_.Size() > 0) {
+        hashGrid_.FindPairs(broadphasePairs_);
+        
+        // Grid colliders against the bounded ones outside it: each of
+        // those (usually a few - the player, trees, ground meshes) looks
+        // up the grid cells its box reaches
+        for (size_t i = 0; i < colliderCount; ++i) {
+            const Collider& a = colliderData[i];
+            if (!UsesBroadphase(a) || InHashGrid(entities[i])) continue;
+            const Transform* transform = transforms_.Get(entities[i]);
+            if (!transform) continue;
+            hmm_vec3 min, max;
+            ColliderBounds(a, *transform, min, max);
+            bool aStatic = IsStaticForPairs(entities[i], a);
+            hashGrid_.QueryAABB(min, max, [&](EntityId other) {
+                const Collider* b = colliders_.Get(other);
+                if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, aStatic,
+                                      b->collisionLayer, b->collisionMask, IsStaticForPairs(other, *b))) {
+                    return;
+                }
+                broadphasePairs_.emplace_back(entities[i], other);
+            });
+        }
+    }
+    
+    // Colliders outside the sweep are paired with everything (each pair once)
+    for (size_t i = 0; i < colliderCount; ++i) {
+        const Collider& a = colliderData[i];
+        if (UsesBroadphase(a)) continue;
+        bool aStatic = IsStaticForPairs(entities[i], a);
+        
+        // A static one (the ground plane) can only pair with moving
+        // colliders, which the tree already lists: sleeping bodies cost
+        // nothing. Pairs with other colliders outside the sweep are left
+        // to the moving one's loop.
+        if (aStatic && broadphaseMode_ == BroadphaseMode::AABBTree) {
+            auto pairWith = [&](EntityId other) {
+                const Collider* b = colliders_.Get(other);
+                if (!b || !UsesBroadphase(*b)) return;
+                if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, true,
+                                      b->collisionLayer, b->collisionMask, false)) {
+                    return;
+                }
+                broadphasePairs_.emplace_back(entities[i], other);
+            };
+            colliderIndex_.ForEachMoving(pairWith);
+            hashGrid_.ForEachMoving(pairWith);
+            continue;
+        }
+        
+        for (size_t j = 0; j < colliderCount; ++j) {
+            const Collider& b = colliderData[j];
+            if (j == i) continue;
+            bool bStatic = IsStaticForPairs(entities[j], b);
+            // A static one outside the sweep skipped us in tree mode, so
+            // the pair is made here whatever the order
+            bool pairedByB = !aStatic && bStatic && broadphaseMode_ == BroadphaseMode::AABBTree;
+            if (!UsesBroadphase(b) && j < i && !pairedByB) continue;
+            if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, aStatic,
+                                  b.collisionLayer, b.collisionMask, bStatic)) {
+                continue;
+            }
+            broadphasePairs_.emplace_back(entities[i], entities[j]);
+        }
+    }
+}
+
+void ECS::SetBroadphaseMode(BroadphaseMode mode) {
+    if (mode == broadphaseMode_) return;
+    broadphaseMode_ = mode;
+    broadphase_.Clear();  // Repopulated on the next frame if needed
+}
+
+// -- Hash grid ---------------------------------------------------------------
+
+void ECS::SetHashGridLayers(uint32_t layers) {
+    if (layers == hashGridLayers_) return;
+    hashGridLayers_ = layers;
+    colliderIndexCursors_.valid = false;  // Colliders move between the index and the grid
+    RebuildHashGrid();
+}
+
+void ECS::SetHashGridCellSize(float cellSize) {
+    hashGrid_.SetCellSize(cellSize);
+    colliderIndexCursors_.valid = false;  // Which colliders fit may change
+    RebuildHashGrid();
+}
+
+// By the collider's reach from its position, which moving never changes,
+// so a collider is in the grid or in the index but never both or neither
+bool ECS::FitsHashGrid(const Collider& collider, const Transform& transform) const {
+    if ((collider.collisionLayer & hashGridLayers_) == 0 || !UsesBroadphase(collider)) return false;
+    float radius;
+    switch (collider.type) {
+        case ColliderType::Sphere:
+            radius = collider.radius + HMM_LengthVec3(HMM_MultiplyVec3(transform.originOffset, transform.scale));
+            break;
+        case ColliderType::Box: radius = HMM_LengthVec3(collider.boxHalfExtents); break;
+        case ColliderType::Capsule: radius = collider.capsuleHeight * 0.5f + collider.capsuleRadius; break;
+        default: return false;  // Meshes can be any size
+    }
+    return hashGrid_.Fits(radius);
+}
+
+// Gathers the grid's colliders from scratch; no state carries over
+void ECS::RebuildHashGrid() {
+    for (const BroadphaseProxy& proxy : hashGridProxies_) {
+        hashGridMembers_[EntityIndex(proxy.entity)] = -1;
+    }
+    hashGridProxies_.clear();
+    if (hashGridLayers_ == 0) {
+        hashGrid_.Clear();
+        return;
+    }
+    
+    const EntityId* entities = colliders_.Entities();
+    const Collider* colliderData = colliders_.Data();
+    for (size_t i = 0; i < colliders_.size(); ++i) {
+        const Collider& collider = colliderData[i];
+        const Transform* transform = transforms_.Get(entities[i]);
+        if (!transform || !FitsHashGrid(collider, *transform)) continue;
+        
+        BroadphaseProxy proxy;
+        proxy.entity = entities[i];
+        ColliderBounds(collider, *transform, proxy.min, proxy.max);
+        proxy.collisionLayer = collider.collisionLayer;
+        proxy.collisionMask = collider.collisionMask;
+        proxy.isStatic = IsStaticForPairs(entities[i], collider);
+        hashGridProxies_.push_back(proxy);
+        
+        uint32_t slot = EntityIndex(entities[i]);
+        if (slot >= hashGridMembers_.size()) hashGridMembers_.resize(slot + 1, -1);
+        hashGridMembers_[slot] = entities[i];
+    }
+    hashGrid_.Build(hashGridProxies_);
+}
+
+// -- Spatial indexes -------------------------------------------------------
+
+void ECS::UpdateColliderProxy(EntityId id) {
+    const Collider* collider = colliders_.Get(id);
+    const Transform* transform = transforms_.Get(id);
+    if (!collider || !transform) {
+        colliderIndex_.Remove(id);
+        return;
+    }
+    if (collider->type == ColliderType::Plane) {
+        colliderIndex_.UpdateUnbounded(id);
+        return;
+    }
+    
+    if (FitsHashGrid(*collider, *transform)) {
+        colliderIndex_.Remove(id);  // Found through the hash grid instead
+        return;
+    }
+    
+    BroadphaseProxy proxy;
+    proxy.entity = id;
+    ColliderBounds(*collider, *transform, proxy.min, proxy.max);
+    proxy.collisionLayer = collider->collisionLayer;
+    proxy.collisionMask = collider->collisionMask;
+    proxy.isStatic = IsStaticForPairs(id, *collider);  // Sleeping bodies only pair with awake ones
+    // Colliders outside the broadphase are paired by FindCollisionPairs()
+    colliderIndex_.Update(proxy, collider->useBroadPhase);
+}
+
+// Same volumes RaycastSelectionNew() tests; icons are never hit by a ray
+void ECS::UpdateSelectableProxy(EntityId id) {
+    const Selectable* selectable = selectables_.Get(id);
+    const Transform* transform = transforms_.Get(id);
+    const Collider* collider = colliders_.Get(id);
+    if (!selectable || !transform) {
+        selectableIndex_.Remove(id);
+        return;
+    }
+    
+    BroadphaseProxy proxy;
+    proxy.entity = id;
+    proxy.isStatic = collider && collider->isStatic;
+    switch (selectable->volumeType) {
+        case SelectionVolumeType::Sphere: {
+            hmm_vec3 center = transform->GetWorldPosition();
+            float r = selectable->boundingSphereRadius;
+            proxy.min = HMM_SubtractVec3(center, HMM_Vec3(r, r, r));
+            proxy.max = HMM_AddVec3(center, HMM_Vec3(r, r, r));
+            break;
+        }
+        case SelectionVolumeType::Box:
+            proxy.min = HMM_AddVec3(transform->position, selectable->boundingBoxMin);
+            proxy.max = HMM_AddVec3(transform->position, selectable->boundingBoxMax);
+            break;
+        case SelectionVolumeType::Mesh:
+            if (!selectable->useMeshColliderForPicking || !collider ||
+                (collider->type != ColliderType::Mesh && collider->type != ColliderType::Heightfield)) {
+                selectableIndex_.Remove(id);
+                return;
+            }
+            ColliderBounds(*collider, *transform, proxy.min, proxy.max);
+            break;
+        default:
+            selectableIndex_.Remove(id);
+            return;
+    }
+    selectableIndex_.Update(proxy, false);
+}
+
+// Applies the collider and transform changes logged since the last refresh
+void ECS::RefreshColliderIndex() {
+    IndexCursors& cursors = colliderIndexCursors_;
+    auto collect = [&](const ComponentChange& change) { indexChanges_.push_back(change.entity); };
+    
+    indexChanges_.clear();
+    bool complete = cursors.valid &&
+                    ForEachChange<Collider>(cursors.colliders, collect) &&
+                    ForEachChange<Transform>(cursors.transforms, collect);
+    if (!complete) {
+        colliderIndex_.Clear();
+        indexChanges_.assign(colliders_.Entities(), colliders_.Entities() + colliders_.size());
+        cursors.colliders = ChangeCursor<Collider>();
+        cursors.transforms = ChangeCursor<Transform>();
+        cursors.valid = true;
+    }
+    
+    for (EntityId id : indexChanges_) {
+        UpdateColliderProxy(id);
+    }
+}
+
+// Selection volumes also depend on the collider (mesh bounds, static flag)
+void ECS::RefreshSelectableIndex() {
+    IndexCursors& cursors = selectableIndexCursors_;
+    auto collect = [&](const ComponentChange& change) { indexChanges_.push_back(change.entity); };
+    
+    indexChanges_.clear();
+    bool complete = cursors.valid &&
+                    ForEachChange<Selectable>(cursors.selectables, collect) &&
+                    ForEachChange<Collider>(cursors.colliders, collect) &&
+                    ForEachChange<Transform>(cursors.transforms, collect);
+    if (!complete) {
+        selectableIndex_.Clear();
+        indexChanges_.assign(selectables_.Entities(), selectables_.Entities() + selectables_.size());
+        cursors.selectables = ChangeCursor<Selectable>();
+        cursors.colliders = ChangeCursor<Collider>();
+        cursors.transforms = ChangeCursor<Transform>();
+        cursors.valid = true;
+    }
+    
+    for (EntityId id : indexChanges_) {
+        UpdateSelectableProxy(id);
+    }
+}
+
+void ECS::QueryColliders(const hmm_vec3& min, const hmm_vec3& max, std::vector<EntityId>& outEntities,
+                         uint32_t layerMask) {
+    RefreshColliderIndex();
+    hmm_vec3 center = HMM_MultiplyVec3f(HMM_AddVec3(min, max), 0.5f);
+    hmm_vec3 extents = HMM_MultiplyVec3f(HMM_SubtractVec3(max, min), 0.5f);
+    colliderIndex_.QueryAABB(min, max, [&](EntityId id) {
+        const Collider* collider = colliders_.Get(id);
+        if ((collider->collisionLayer & layerMask) == 0) return;
+        if (collider->type == ColliderType::Plane) {
+            // Box reaches the plane if its projected radius covers the distance
+            hmm_vec3 n = collider->planeNormal;
+            float radius = extents.X * fabsf(n.X) + extents.Y * fabsf(n.Y) + extents.Z * fabsf(n.Z);
+            if (fabsf(HMM_DotVec3(center, n) - collider->planeDistance) > radius) return;
+        }
+        outEntities.push_back(id);
+    });
+    hashGrid_.QueryAABB(min, max, [&](EntityId id) {
+        const Collider* collider = colliders_.Get(id);
+        if (collider && (collider->collisionLayer & layerMask) != 0) outEntities.push_back(id);
+    });
+}
+
+void ECS::QueryCollidersSphere(const hmm_vec3& center, float radius, std::vector<EntityId>& outEntities,
+                               uint32_t layerMask) {
+    RefreshColliderIndex();
+    colliderIndex_.QuerySphere(center, radius, [&](EntityId id) {
+        const Collider* collider = colliders_.Get(id);
+        if ((collider->collisionLayer & layerMask) == 0) return;
+        if (collider->type == ColliderType::Plane &&
+            fabsf(HMM_DotVec3(center, collider->planeNormal) - collider->planeDistance) > radius) {
+            return;
+        }
+        outEntities.push_back(id);
+    });
+    hashGrid_.QuerySphere(center, radius, [&](EntityId id) {
+        const Collider* collider = colliders_.Get(id);
+        if (collider && (collider->collisionLayer & layerMask) != 0) outEntities.push_back(id);
+    });
+}
+
+void ECS::UpdateCollisions(float dt) {
+    // Broad phase: only overlapping, layer-compatible pairs survive
+    FindCollisionPairs();
+    
+    // Narrow phase: gather the touching pairs
+    bodyContacts_.clear();
+    solverContacts_.clear();
+    narrowphaseStats_ = NarrowphaseStats();
+    solverStats_.warmStarted = 0;
+    ++contactStep_;
+    for (const BroadphasePair& pair : broadphasePairs_) {
+        // Lower slot first, so the cache sees a pair the same way every step
+        // (and a reloaded scene, whose generations differ, sees it the same)
+        bool firstLower = EntityIndex(pair.first) < EntityIndex(pair.second);
+        EntityId a = firstLower ? pair.first : pair.second;
+        EntityId b = firstLower ? pair.second : pair.first;
+        
+        // Dynamic bodies whose bounds touch share an island, contact or
+        // not: resting neighbours are pushed apart and touch again
+        const Rigidbody* rbA = rigidbodies_.Get(a);
+        const Rigidbody* rbB = rigidbodies_.Get(b);
+        if (rbA && rbB && !rbA->isKinematic && !rbB->isKinematic) {
+            bodyContacts_.emplace_back(a, b);
+        }
+        
+        const Collider* colA = colliders_.Get(a);
+        const Collider* colB = colliders_.Get(b);
+        int typeA = (int)colA->type, typeB = (int)colB->type;
+        ++narrowphaseStats_.tests[typeA][typeB];
+        
+        CollisionInfo info;
+        if (CheckCollision(a, b, &info)) {
+            ++narrowphaseStats_.contacts[typeA][typeB];
+            // Skip if either is a trigger (no physics response)
+            if (!colA->isTrigger && !colB->isTrigger) {
+                WakeOnContact(a, b);
+                WakeOnContact(b, a);
+                AddContact(a, b, info);
+            }
+        }
+    }
+    
+    // Pairs that stopped touching lose their impulses
+    for (auto it = contactCache_.begin(); it != contactCache_.end();) {
+        if (it->second.step != contactStep_) {
+            it = contactCache_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    SolveContacts();
+    UpdateSleep(dt);
+}
+
+// -- Continuous collision ----------------------------------------------------
+
+void ECS::SweepBody(EntityId id, float dt) {
+    Rigidbody* rb = rigidbodies_.Get(id);
+    Transform* transform = transforms_.Get(id);
+    const Collider* collider = colliders_.Get(id);
+    
+    const hmm_vec3 start = transform->position;
+    const hmm_vec3 motion = HMM_MultiplyVec3f(rb->velocity, dt);
+    float distance = HMM_LengthVec3(motion);
+    int substeps = (int)ceilf(distance / SweepRadius(*collider));
+    if (substeps > kMaxSweepSubsteps) substeps = kMaxSweepSubsteps;
+    ++continuousStats_.swept;
+    
+    // Candidates: whatever the bounds of the whole move reach
+    Transform moved = *transform;
+    moved.position = HMM_AddVec3(start, motion);
+    hmm_vec3 min, max, endMin, endMax;
+    ColliderBounds(*collider, *transform, min, max);
+    ColliderBounds(*collider, moved, endMin, endMax);
+    for (int axis = 0; axis < 3; ++axis) {
+        if (endMin.Elements[axis] < min.Elements[axis]) min.Elements[axis] = endMin.Elements[axis];
+        if (endMax.Elements[axis] > max.Elements[axis]) max.Elements[axis] = endMax.Elements[axis];
+    }
+    sweepCandidates_.clear();
+    auto collect = [&](EntityId other) { sweepCandidates_.push_back(other); };
+    colliderIndex_.QueryAABB(min, max, collect);
+    hashGrid_.QueryAABB(min, max, collect);
+    
+    ContactShape body;
+    MakeContactShape(*collider, *transform, body);
+    sweepShapes_.clear();
+    for (EntityId other : sweepCandidates_) {
+        const Collider* otherCollider = colliders_.Get(other);
+        const Transform* otherTransform = transforms_.Get(other);
+        if (other == id || !otherCollider || !otherTransform || otherCollider->isTrigger) continue;
+        if (!HasContactTest(collider->type, otherCollider->type)) continue;
+        if (!BroadphaseFilter(collider->collisionLayer, collider->collisionMask, false,
+                              otherCollider->collisionLayer, otherCollider->collisionMask,
+                              IsStaticForPairs(other, *otherCollider))) {
+            continue;
+        }
+        ContactShape shape;
+        MakeContactShape(*otherCollider, *otherTransform, shape);
+        if (TestContact(body, shape, nullptr)) continue;  // Already touching: left to the solver
+        sweepShapes_.push_back(shape);
+    }
+    
+    // Whether the body touches a candidate a fraction of the way along
+    auto touches = [&](float fraction) {
+        body.center = HMM_AddVec3(start, HMM_MultiplyVec3f(motion, fraction));
+        for (const ContactShape& shape : sweepShapes_) {
+            if (TestContact(body, shape, nullptr)) return true;
+        }
+        return false;
+    };
+    
+    float impact = 1.0f;
+    if (!sweepShapes_.empty()) {
+        for (int step = 1; step <= substeps; ++step) {
+            ++continuousStats_.substeps;
+            float fraction = (float)step / substeps;
+            if (!touches(fraction)) continue;
+            
+            // First touch between the previous substep and this one
+            float free = (float)(step - 1) / substeps;
+            impact = fraction;
+            for (int i = 0; i < kSweepBisections; ++i) {
+                float mid = (free + impact) * 0.5f;
+                if (touches(mid)) {
+                    impact = mid;
+                } else {
+                    free = mid;
+                }
+            }
+            ++continuousStats_.hits;
+            break;
+        }
+    }
+    
+    transform->position = HMM_AddVec3(start, HMM_MultiplyVec3f(motion, impact));
+    TouchTransform(id, *transform);
+    transforms_.MarkChanged(id);  // Already flushed if it was dirty: the index must see the move
+}
+
+// -- Character controllers ---------------------------------------------------
+
+static constexpr float kCharacterGravity = -9.81f;
+static constexpr int kDepenetrationPasses = 4;
+static constexpr float kMinSlideDistance = 1e-5f;
+static constexpr size_t kCharacterChunkSize = 16;
+static constexpr float kLedgeProbeRadius = 0.05f;
+static constexpr float kLedgeProbeDepth = 0.01f;
+
+ECS::SweepScratch& ECS::ThreadSweepScratch() {
+    unsigned index = jobs_ ? jobs_->CurrentThreadIndex() : 0;
+    return sweepScratch_[index < sweepScratch_.size() ? index : 0];
+}
+
+// What a sweep of scratch.shape within [min, max] could run into, as
+// SweepBody() filters it
+void ECS::GatherSweepShapes(SweepScratch& scratch, const hmm_vec3& min, const hmm_vec3& max,
+                            uint32_t layer, uint32_t mask, EntityId ignore) {
+    scratch.candidates.clear();
+    scratch.shapes.clear();
+    scratch.entities.clear();
+    auto collect = [&](EntityId other) { scratch.candidates.push_back(other); };
+    colliderIndex_.QueryAABB(min, max, collect);
+    hashGrid_.QueryAABB(min, max, collect);
+    
+    for (EntityId other : scratch.candidates) {
+        const Collider* otherCollider = colliders_.Get(other);
+        const Transform* otherTransform = transforms_.Get(other);
+        if (other == ignore || !otherCollider || !otherTransform || otherCollider->isTrigger) continue;
+        if (!HasContactTest(scratch.shape.type, otherCollider->type)) continue;
+        if (!BroadphaseFilter(layer, mask, false, otherCollider->collisionLayer, otherCollider->collisionMask,
+                              IsStaticForPairs(other, *otherCollider))) {
+            continue;
+        }
+        ContactShape shape;
+        MakeContactShape(*otherCollider, *otherTransform, shape);
+        scratch.shapes.push_back(shape);
+        scratch.entities.push_back(other);
+    }
+    scratch.body = ContactShape();
+    scratch.body.collider = &scratch.shape;
+}
+
+// First touch of scratch.body moved from start by motion, found like
+// SweepBody() does and then moved onto the surface with the depth at the
+// first touching bisection point. The capsule stops skin short of it.
+// Shapes it already touches only block a move into them.
+CapsuleSweepHit ECS::SweepGathered(SweepScratch& scratch, const hmm_vec3& start, const hmm_vec3& motion, float skin) {
+    ++scratch.sweeps;
+    scratch.hitShape = -1;
+    CapsuleSweepHit hit;
+    hit.position = HMM_AddVec3(start, motion);
+    ContactShape& body = scratch.body;
+    const size_t count = scratch.shapes.size();
+    scratch.blocking.resize(count);
+    
+    body.center = start;
+    for (size_t i = 0; i < count; ++i) {
+        CollisionInfo info;
+        bool touching = TestContact(body, scratch.shapes[i], &info);
+        if (touching && HMM_DotVec3(motion, info.normal) < 0.0f) {
+            hit.hit = true;
+            hit.entity = scratch.entities[i];
+            hit.fraction = 0.0f;
+            hit.position = start;
+            hit.normal = info.normal;
+            hit.point = info.contactPoint;
+            scratch.hitShape = (int)i;
+            return hit;
+        }
+        scratch.blocking[i] = !touching;
+    }
+    
+    float distance = HMM_LengthVec3(motion);
+    if (distance <= 0.0f || count == 0) return hit;
+    
+    // Index of a blocking shape the body touches a fraction of the way along
+    auto touches = [&](float fraction) {
+        body.center = HMM_AddVec3(start, HMM_MultiplyVec3f(motion, fraction));
+        for (size_t i = 0; i < count; ++i) {
+            if (scratch.blocking[i] && TestContact(body, scratch.shapes[i], nullptr)) return (int)i;
+        }
+        return -1;
+    };
+    
+    float needed = scratch.reach > 0.0f ? ceilf(distance / scratch.reach) : (float)kMaxSweepSubsteps;
+    int substeps = needed < (float)kMaxSweepSubsteps ? (int)needed : kMaxSweepSubsteps;
+    if (substeps < 1) substeps = 1;
+    int shape = -1;
+    float free = 0.0f;
+    float impact = 1.0f;
+    for (int step = 1; step <= substeps && shape < 0; ++step) {
+        float fraction = (float)step / substeps;
+        shape = touches(fraction);
+        if (shape < 0) continue;
+        free = (float)(step - 1) / substeps;
+        impact = fraction;
+        for (int i = 0; i < kSweepBisections; ++i) {
+            float mid = (free + impact) * 0.5f;
+            int touched = touches(mid);
+            if (touched >= 0) {
+                impact = mid;
+                shape = touched;
+            } else {
+                free = mid;
+            }
+        }
+    }
+    if (shape < 0) return hit;
+    
+    // Backed out of the surface along the move by the depth there (exact
+    // for flat ones), which keeps resting heights from wobbling with the
+    // bisection grid. Glancing touches keep the bisection's free point.
+    hmm_vec3 direction = HMM_MultiplyVec3f(motion, 1.0f / distance);
+    float contact = free * distance;
+    CollisionInfo info;
+    body.center = HMM_AddVec3(start, HMM_MultiplyVec3f(motion, impact));
+    if (TestContact(body, scratch.shapes[shape], &info)) {
+        hit.normal = info.normal;
+        hit.point = info.contactPoint;
+        float along = -HMM_DotVec3(direction, info.normal);
+        if (along > 0.1f) {
+            float surface = impact * distance - info.penetration / along;
+            if (surface > contact) contact = surface;
+        }
+    } else {
+        hit.normal = HMM_MultiplyVec3f(direction, -1.0f);
+        hit.point = body.center;
+    }
+    float travel = contact - skin > 0.0f ? contact - skin : 0.0f;
+    hit.hit = true;
+    hit.entity = scratch.entities[shape];
+    scratch.hitShape = shape;
+    hit.fraction = contact / distance;
+    hit.position = HMM_AddVec3(start, HMM_MultiplyVec3f(direction, travel));
+    return hit;
+}
+
+CapsuleSweepHit ECS::SweepCapsuleWith(SweepScratch& scratch, const CapsuleSweep& sweep, uint32_t layerMask) {
+    scratch.shape = Collider();
+    scratch.shape.type = ColliderType::Capsule;
+    scratch.shape.capsuleHeight = sweep.height;
+    scratch.shape.capsuleRadius = sweep.radius;
+    scratch.reach = sweep.radius;
+    
+    const hmm_vec3 half = HMM_Vec3(sweep.radius, sweep.height * 0.5f + sweep.radius, sweep.radius);
+    const hmm_vec3 end = HMM_AddVec3(sweep.start, sweep.motion);
+    hmm_vec3 min, max;
+    for (int axis = 0; axis < 3; ++axis) {
+        min.Elements[axis] = fminf(sweep.start.Elements[axis], end.Elements[axis]) - half.Elements[axis];
+        max.Elements[axis] = fmaxf(sweep.start.Elements[axis], end.Elements[axis]) + half.Elements[axis];
+    }
+    GatherSweepShapes(scratch, min, max, 0xFFFFFFFF, layerMask, sweep.ignore);
+    return SweepGathered(scratch, sweep.start, sweep.motion, 0.0f);
+}
+
+CapsuleSweepHit ECS::SweepCapsule(const CapsuleSweep& sweep, uint32_t layerMask) {
+    RefreshColliderIndex();
+    return SweepCapsuleWith(ThreadSweepScratch(), sweep, layerMask);
+}
+
+void ECS::SweepCapsuleBatch(std::span<const CapsuleSweep> sweeps, std::span<CapsuleSweepHit> outHits, uint32_t layerMask) {
+    const size_t count = sweeps.size() < outHits.size() ? sweeps.size() : outHits.size();
+    if (count == 0) return;
+    
+    // Brought up to date here: the sweeps only read it, from any thread
+    RefreshColliderIndex();
+    auto sweepRange = [&](size_t begin, size_t end) {
+        SweepScratch& scratch = ThreadSweepScratch();
+        for (size_t i = begin; i < end; ++i) {
+            outHits[i] = SweepCapsuleWith(scratch, sweeps[i], layerMask);
+        }
+    };
+    if (jobs_ && count >= kSweepBatchParallelMin) {
+        jobs_->ParallelFor(count, kSweepBatchParallelMin / 4, sweepRange);
+    } else {
+        sweepRange(0, count);
+    }
+}
+
+// Up to kMaxSlideIterations sweeps, each sliding the rest of the move
+// along the surface the last one hit (and along the crease once two
+// surfaces box it in). flattenSteep turns steep normals horizontal, so a
+// sideways move is stopped by steep ground instead of climbing it.
+hmm_vec3 ECS::SlideCharacter(SweepScratch& scratch, const CharacterController& character, hmm_vec3 position,
+                             hmm_vec3 motion, bool flattenSteep) {
+    hmm_vec3 previousNormal = HMM_Vec3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < kMaxSlideIterations; ++i) {
+        if (HMM_DotVec3(motion, motion) < kMinSlideDistance * kMinSlideDistance) break;
+        CapsuleSweepHit hit = SweepGathered(scratch, position, motion, character.skinWidth);
+        position = hit.position;
+        if (!hit.hit) break;
+        
+        hmm_vec3 normal = hit.normal;
+        if (flattenSteep && normal.Y < character.maxSlopeCos) {
+            normal.Y = 0.0f;
+            float length = HMM_LengthVec3(normal);
+            if (length < 1e-4f) break;
+            normal = HMM_MultiplyVec3f(normal, 1.0f / length);
+        }
+        hmm_vec3 rest = HMM_MultiplyVec3f(motion, 1.0f - hit.fraction);
+        float into = HMM_DotVec3(rest, normal);
+        if (into < 0.0f) rest = HMM_SubtractVec3(rest, HMM_MultiplyVec3f(normal, into));
+        if (i > 0 && HMM_DotVec3(rest, previousNormal) < 0.0f) {
+            hmm_vec3 crease = HMM_Cross(previousNormal, normal);
+            float length = HMM_LengthVec3(crease);
+            if (length < 1e-4f) break;
+            crease = HMM_MultiplyVec3f(crease, 1.0f / length);
+            rest = HMM_MultiplyVec3f(crease, HMM_DotVec3(rest, crease));
+        }
+        previousNormal = normal;
+        motion = rest;
+    }
+    return position;
+}
+
+// One step of one character: reads the scene, writes only the character.
+// Returns where it ends up.
+hmm_vec3 ECS::MoveCharacter(CharacterController& character, const Collider& collider, EntityId id,
+                            hmm_vec3 position, float dt, SweepScratch& scratch) {
+    const bool wasGrounded = character.grounded;
+    if (wasGrounded && character.verticalVelocity <= 0.0f) {
+        character.verticalVelocity = 0.0f;
+    } else {
+        character.verticalVelocity += kCharacterGravity * dt;
+    }
+    
+    const hmm_vec3 horizontal = HMM_Vec3(character.moveVelocity.X * dt, 0.0f, character.moveVelocity.Z * dt);
+    const float rise = character.verticalVelocity > 0.0f ? character.verticalVelocity * dt : 0.0f;
+    const float fall = character.verticalVelocity < 0.0f ? -character.verticalVelocity * dt : 0.0f;
+    const bool walking = horizontal.X != 0.0f || horizontal.Z != 0.0f;
+    const float step = wasGrounded && walking ? character.stepHeight : 0.0f;
+    const float snap = wasGrounded && rise == 0.0f ? character.snapDistance : 0.0f;
+    
+    // The swept shape, upright whatever the transform's rotation
+    scratch.shape = collider;
+    const bool capsule = collider.type == ColliderType::Capsule;
+    const float radius = capsule ? collider.capsuleRadius : collider.radius;
+    const float halfHeight = capsule ? collider.capsuleHeight * 0.5f : 0.0f;
+    scratch.reach = radius;
+    
+    // One gather for every sweep below: the whole reach of the move, plus
+    // a radius for stepping out of overlaps and ramps climbed on the way
+    const float margin = radius + character.skinWidth;
+    const float climb = HMM_LengthVec3(horizontal);
+    hmm_vec3 min, max;
+    for (int axis = 0; axis < 3; axis += 2) {
+        float moved = position.Elements[axis] + horizontal.Elements[axis];
+        min.Elements[axis] = fminf(position.Elements[axis], moved) - radius - margin;
+        max.Elements[axis] = fmaxf(position.Elements[axis], moved) + radius + margin;
+    }
+    min.Y = position.Y - fall - snap - halfHeight - radius - margin;
+    max.Y = position.Y + rise + step + climb + halfHeight + radius + margin;
+    GatherSweepShapes(scratch, min, max, collider.collisionLayer, collider.collisionMask, id);
+    
+    // Out of whatever it was left overlapping (spawned inside, moved by
+    // the editor, run into by a body)
+    for (int pass = 0; pass < kDepenetrationPasses; ++pass) {
+        bool overlapped = false;
+        for (const ContactShape& shape : scratch.shapes) {
+            CollisionInfo info;
+            scratch.body.center = position;
+            if (!TestContact(scratch.body, shape, &info)) continue;
+            position = HMM_AddVec3(position, HMM_MultiplyVec3f(info.normal, info.penetration + character.skinWidth));
+            overlapped = true;
+        }
+        if (!overlapped) break;
+    }
+    
+    // Whether the last sweep's hit is ground to stand on. A rounded bottom
+    // on the edge of a ledge gets a slanted normal, so then it is the
+    // surface just past the edge that counts, found with a small probe -
+    // as long as the edge is within a step of where the feet started.
+    const hmm_vec3 level = position;
+    const float highestLedge = level.Y - halfHeight - radius + character.stepHeight;
+    auto groundAt = [&](const CapsuleSweepHit& hit, const hmm_vec3& center, hmm_vec3* outNormal) {
+        *outNormal = hit.normal;
+        if (hit.normal.Y >= character.maxSlopeCos) return true;
+        if (hit.point.Y > highestLedge) return false;
+        hmm_vec3 outward = HMM_Vec3(hit.point.X - center.X, 0.0f, hit.point.Z - center.Z);
+        float length = HMM_LengthVec3(outward);
+        if (length < 1e-4f || scratch.hitShape < 0) return false;
+        Collider probeCollider;
+        probeCollider.radius = kLedgeProbeRadius;
+        ContactShape probe;
+        probe.collider = &probeCollider;
+        probe.center = HMM_AddVec3(hit.point, HMM_MultiplyVec3f(outward, kLedgeProbeRadius / length));
+        probe.center.Y += kLedgeProbeRadius - kLedgeProbeDepth;
+        CollisionInfo info;
+        if (!TestContact(probe, scratch.shapes[scratch.hitShape], &info) || info.normal.Y < character.maxSlopeCos) return false;
+        *outNormal = info.normal;
+        return true;
+    };
+    
+    // Down: the step back, the fall, and the snap that keeps a walking
+    // character on ground that drops away under it
+    auto land = [&](float drop) {
+        character.grounded = false;
+        character.groundNormal = HMM_Vec3(0.0f, 1.0f, 0.0f);
+        character.groundEntity = -1;
+        if (drop + snap <= 0.0f) return;
+        CapsuleSweepHit hit = SweepGathered(scratch, position, HMM_Vec3(0.0f, -(drop + snap), 0.0f), character.skinWidth);
+        float dropped = position.Y - hit.position.Y;
+        hmm_vec3 normal;
+        bool walkable = hit.hit && groundAt(hit, hit.position, &normal);
+        if (walkable && character.verticalVelocity <= 0.0f) {
+            position = hit.position;
+            character.grounded = true;
+            character.groundNormal = normal;
+            character.groundEntity = hit.entity;
+            character.verticalVelocity = 0.0f;
+        } else if (hit.hit && dropped < drop) {
+            position = hit.position;
+            if (!walkable) {
+                // Too steep to stand on: the rest of the drop slides down it
+                position = SlideCharacter(scratch, character, position, HMM_Vec3(0.0f, dropped - drop, 0.0f), false);
+            }
+        } else {
+            position.Y -= drop;  // Nothing within the drop; the snap found no ground
+        }
+    };
+    
+    // Up: the jump, and the step height so low ledges pass underneath
+    float stepped = 0.0f;
+    if (rise + step > 0.0f) {
+        CapsuleSweepHit hit = SweepGathered(scratch, position, HMM_Vec3(0.0f, rise + step, 0.0f), character.skinWidth);
+        float climbed = hit.position.Y - position.Y;
+        stepped = climbed - rise < step ? climbed - rise : step;
+        if (stepped < 0.0f) stepped = 0.0f;
+        if (hit.hit && rise > 0.0f) character.verticalVelocity = 0.0f;  // Head against a ceiling
+        position = hit.position;
+    }
+    
+    // Sideways, then down
+    position = SlideCharacter(scratch, character, position, horizontal, true);
+    land(stepped + fall);
+    
+    // The step led onto nothing walkable (a steep slope, a ledge too high
+    // to stand on): walk on the level instead
+    if (stepped > 0.0f && rise == 0.0f && !character.grounded) {
+        position = SlideCharacter(scratch, character, level, horizontal, true);
+        land(fall);
+    }
+    return position;
+}
+
+void ECS::UpdateCharacters(float dt) {
+    auto start = std::chrono::high_resolution_clock::now();
+    characterStats_ = CharacterStats();
+    if (dt <= 0.0f) return;
+    
+    characterOrder_.clear();
+    View<CharacterController, Transform, Collider>().Each([&](EntityId id, CharacterController&, Transform&, Collider& collider) {
+        if (collider.type == ColliderType::Capsule || collider.type == ColliderType::Sphere) characterOrder_.push_back(id);
+    });
+    if (characterOrder_.empty()) return;
+    // Slot order, like the swept bodies: the moves reach the index in it
+    std::sort(characterOrder_.begin(), characterOrder_.end(), [](EntityId a, EntityId b) { return EntityIndex(a) < EntityIndex(b); });
+    
+    // Every character sweeps the scene as it stands, from any thread. The
+    // grid still holds where crowds were at the last collision pass.
+    RefreshColliderIndex();
+    RebuildHashGrid();
+    for (SweepScratch& scratch : sweepScratch_) scratch.sweeps = 0;
+    characterMoves_.resize(characterOrder_.size());
+    auto moveRange = [&](size_t begin, size_t end) {
+        SweepScratch& scratch = ThreadSweepScratch();
+        for (size_t i = begin; i < end; ++i) {
+            EntityId id = characterOrder_[i];
+            characterMoves_[i] = MoveCharacter(*characters_.Get(id), *colliders_.Get(id), id,
+                                               transforms_.Get(id)->position, dt, scratch);
+        }
+    };
+    if (jobs_) {
+        jobs_->ParallelFor(characterOrder_.size(), kCharacterChunkSize, moveRange);
+    } else {
+        moveRange(0, characterOrder_.size());
+    }
+    
+    for (size_t i = 0; i < characterOrder_.size(); ++i) {
+        EntityId id = characterOrder_[i];
+        Transform* t = transforms_.Get(id);
+        const hmm_vec3& moved = characterMoves_[i];
+        if (Rigidbody* rb = rigidbodies_.Get(id)) {
+            if (rb->isKinematic) rb->velocity = HMM_MultiplyVec3f(HMM_SubtractVec3(moved, t->position), 1.0f / dt);
+        }
+        if (moved.X != t->position.X || moved.Y != t->position.Y || moved.Z != t->position.Z) {
+            t->position = moved;
+            TouchTransform(id, *t);
+            transforms_.MarkChanged(id);  // Already flushed if it was dirty: the index must see the move
+        }
+        characterStats_.grounded += characters_.Get(id)->grounded;
+    }
+    
+    characterStats_.characters = (int)characterOrder_.size();
+    for (const SweepScratch& scratch : sweepScratch_) characterStats_.sweeps += scratch.sweeps;
+    auto end = std::chrono::high_resolution_clock::now();
+    characterStats_.moveMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+// -- Sleeping ----------------------------------------------------------------
+
+bool ECS::IsStaticForPairs(EntityId id, const Collider& collider) const {
+    if (collider.isStatic) return true;
+    const Rigidbody* rb = rigidbodies_.Get(id);
+    return rb && rb->sleeping;
+}
+
+bool ECS::IsSleeping(EntityId id) const {
+    const Rigidbody* rb = rigidbodies_.Get(id);
+    return rb && rb->sleeping;
+}
+
+void ECS::WakeBody(EntityId id) {
+    if (IsAlive(id)) WakeIsland(id);
+}
+
+// A mass of 0 or less (from code or a snapshot) counts as 1
+static float InverseMass(const Rigidbody& rb) {
+    return rb.mass > 0.0f ? 1.0f / rb.mass : 1.0f;
+}
+
+void ECS::ApplyImpulse(EntityId id, const hmm_vec3& impulse) {
+    Rigidbody* rb = rigidbodies_.Get(id);
+    if (!rb || !IsAlive(id) || rb->isKinematic) return;
+    WakeIsland(id);
+    rb->velocity = HMM_AddVec3(rb->velocity, HMM_MultiplyVec3f(impulse, InverseMass(*rb)));
+}
+
+void ECS::SetSleepingEnabled(bool enabled) {
+    sleepingEnabled_ = enabled;
+    if (enabled) return;
+    Rigidbody* bodies = rigidbodies_.Data();
+    const EntityId* ids = rigidbodies_.Entities();
+    for (size_t i = 0; i < rigidbodies_.size(); ++i) {
+        if (bodies[i].sleeping) WakeIsland(ids[i]);
+    }
+}
+
+// Touched by a body that is moving (awake and dynamic, or moved by code
+// this frame): the sleeper's island has to take part again
+void ECS::WakeOnContact(EntityId sleeper, EntityId other) {
+    const Rigidbody* rb = rigidbodies_.Get(sleeper);
+    if (!rb || !rb->sleeping) return;
+    
+    const Collider* otherCollider = colliders_.Get(other);
+    if (!otherCollider || otherCollider->isStatic) return;
+    const Rigidbody* otherRb = rigidbodies_.Get(other);
+    const Transform* otherTransform = transforms_.Get(other);
+    bool moving = (otherRb && !otherRb->isKinematic && !otherRb->sleeping) ||
+                  (otherTransform && otherTransform->dirty);
+    if (moving) WakeIsland(sleeper);
+}
+
+// Wakes the island the body fell asleep with, or just the body
+void ECS::WakeIsland(EntityId id) {
+    uint32_t slot = EntityIndex(id);
+    if (slot < sleepSlots_.size() && sleepSlots_[slot].entity == id && sleepSlots_[slot].island >= 0) {
+        int islandIndex = sleepSlots_[slot].island;
+        SleepIsland& island = sleepIslands_[islandIndex];
+        for (EntityId body : island.bodies) {
+            WakeOne(body);
+        }
+        island.bodies.clear();
+        island.positions.clear();
+        freeSleepIslands_.push_back(islandIndex);
+        return;
+    }
+    const Rigidbody* rb = rigidbodies_.Get(id);
+    if (rb && rb->sleeping && IsAlive(id)) WakeOne(id);  // Loaded asleep, no island
+}
+
+void ECS::WakeOne(EntityId id) {
+    uint32_t slot = EntityIndex(id);
+    if (slot < sleepSlots_.size() && sleepSlots_[slot].entity == id) sleepSlots_[slot] = SleepSlot();
+    if (!IsAlive(id)) return;
+    
+    Rigidbody* rb = rigidbodies_.Get(id);
+    if (!rb) return;
+    rb->sleeping = false;
+    rb->sleepTimer = 0.0f;
+    if (colliders_.Has(id)) UpdateColliderProxy(id);  // Back into the moving tree
+}
+
+// Edits made outside physics since the last step wake what they touch.
+// Sleeping bodies never move on their own, so any logged change to one is
+// such an edit; changes to awake bodies cost a failed lookup.
+void ECS::PollSleepWakeups() {
+    SleepCursors& cursors = sleepCursors_;
+    auto wake = [&](const ComponentChange& change) { WakeIsland(change.entity); };
+    bool complete = cursors.valid &&
+                    ForEachChange<Transform>(cursors.transforms, wake) &&
+                    ForEachChange<Rigidbody>(cursors.rigidbodies, wake) &&
+                    ForEachChange<Collider>(cursors.colliders, wake);
+    if (complete) return;
+    
+    // History lost (physics paused for a while): wake the islands with a
+    // member that is gone or no longer where it fell asleep
+    for (SleepIsland& island : sleepIslands_) {
+        for (size_t i = 0; i < island.bodies.size(); ++i) {
+            const Transform* t = transforms_.Get(island.bodies[i]);
+            const hmm_vec3& p = island.positions[i];
+            if (!IsAlive(island.bodies[i]) || !t || t->position.X != p.X || t->position.Y != p.Y || t->position.Z != p.Z) {
+                WakeIsland(island.bodies[i]);
+                break;
+            }
+        }
+    }
+    cursors.transforms = ChangeCursor<Transform>();
+    cursors.rigidbodies = ChangeCursor<Rigidbody>();
+    cursors.colliders = ChangeCursor<Collider>();
+    cursors.valid = true;
+}
+
+void ECS::UpdateSleep(float dt) {
+    PollSleepWakeups();
+    
+    // Awake dynamic bodies and their sleep timers
+    Rigidbody* bodies = rigidbodies_.Data();
+    const EntityId* ids = rigidbodies_.Entities();
+    const size_t bodyCount = rigidbodies_.size();
+    const float sleepSpeedSq = kSleepSpeed * kSleepSpeed;
+    if (islandIndexOfSlot_.size() < generations_.size()) islandIndexOfSlot_.resize(generations_.size());
+    
+    islandBodies_.clear();
+    islandParent_.clear();
+    sleepStats_.sleeping = 0;
+    for (size_t i = 0; i < bodyCount; ++i) {
+        Rigidbody& rb = bodies[i];
+        if (rb.sleeping) {
+            ++sleepStats_.sleeping;
+            continue;
+        }
+        if (rb.isKinematic) continue;
+        
+        if (sleepingEnabled_ && rb.canSleep && HMM_DotVec3(rb.velocity, rb.velocity) < sleepSpeedSq) {
+            rb.sleepTimer += dt;
+        } else {
+            rb.sleepTimer = 0.0f;
+        }
+        islandIndexOfSlot_[EntityIndex(ids[i])] = (uint32_t)islandBodies_.size();
+        islandParent_.push_back((int)islandBodies_.size());
+        islandBodies_.push_back(ids[i]);
+    }
+    
+    // Union-find over the contacts (path halving)
+    auto find = [&](int i) {
+        while (islandParent_[i] != i) {
+            islandParent_[i] = islandParent_[islandParent_[i]];
+            i = islandParent_[i];
+        }
+        return i;
+    };
+    auto indexOf = [&](EntityId id) -> int {
+        uint32_t index = islandIndexOfSlot_[EntityIndex(id)];
+        return index < islandBodies_.size() && islandBodies_[index] == id ? (int)index : -1;
+    };
+    for (const BroadphasePair& contact : bodyContacts_) {
+        int a = indexOf(contact.first);
+        int b = indexOf(contact.second);
+        if (a < 0 || b < 0) continue;
+        a = find(a);
+        b = find(b);
+        if (a != b) islandParent_[b] = a;
+    }
+    
+    // An island sleeps when every body in it is ready. islandOfRoot_ is
+    // 0 = ready, -1 = not ready, then the sleeping island index + 1.
+    const size_t awakeCount = islandBodies_.size();
+    islandOfRoot_.assign(awakeCount, 0);
+    sleepStats_.islands = 0;
+    for (size_t i = 0; i < awakeCount; ++i) {
+        int root = find((int)i);
+        if (root == (int)i) ++sleepStats_.islands;
+        const Rigidbody* rb = rigidbodies_.Get(islandBodies_[i]);
+        if (!sleepingEnabled_ || !rb->canSleep || rb->sleepTimer < kTimeToSleep) islandOfRoot_[root] = -1;
+    }
+    
+    int fellAsleep = 0;
+    for (size_t i = 0; i < awakeCount; ++i) {
+        int root = find((int)i);
+        if (islandOfRoot_[root] < 0) continue;
+        if (islandOfRoot_[root] == 0) {
+            int islandIndex;
+            if (!freeSleepIslands_.empty()) {
+                islandIndex = freeSleepIslands_.back();
+                freeSleepIslands_.pop_back();
+            } else {
+                islandIndex = (int)sleepIslands_.size();
+                sleepIslands_.emplace_back();
+            }
+            islandOfRoot_[root] = islandIndex + 1;
+            --sleepStats_.islands;
+        }
+        
+        EntityId id = islandBodies_[i];
+        int islandIndex = islandOfRoot_[root] - 1;
+        const Transform* t = transforms_.Get(id);
+        Rigidbody* rb = rigidbodies_.Get(id);
+        rb->sleeping = true;
+        rb->velocity = HMM_Vec3(0.0f, 0.0f, 0.0f);
+        sleepIslands_[islandIndex].bodies.push_back(id);
+        sleepIslands_[islandIndex].positions.push_back(t ? t->position : HMM_Vec3(0.0f, 0.0f, 0.0f));
+        
+        uint32_t slot = EntityIndex(id);
+        if (slot >= sleepSlots_.size()) sleepSlots_.resize(generations_.size());
+        sleepSlots_[slot].entity = id;
+        sleepSlots_[slot].island = islandIndex;
+        if (colliders_.Has(id)) UpdateColliderProxy(id);  // Into the static tree
+        ++fellAsleep;
+    }
+    
+    sleepStats_.awake = (int)awakeCount - fellAsleep;
+    sleepStats_.sleeping += fellAsleep;
+    sleepStats_.sleepingIslands = (int)(sleepIslands_.size() - freeSleepIslands_.size());
+}
+
+// -- Narrowphase -------------------------------------------------------------
+
+// Inverse of an affine matrix (rotation/scale/shear plus translation);
+// false if it squashes space flat
+static bool InvertAffine(const hmm_mat4& m, hmm_mat4* out) {
+    // Elements[column][row]
+    float a = m.Elements[0][0], b = m.Elements[1][0], c = m.Elements[2][0];
+    float d = m.Elements[0][1], e = m.Elements[1][1], f = m.Elements[2][1];
+    float g = m.Elements[0][2], h = m.Elements[1][2], i = m.Elements[2][2];
+
+    float c00 = e * i - f * h;
+    float c01 = f * g - d * i;
+    float c02 = d * h - e * g;
+    float det = a * c00 + b * c01 + c * c02;
+    if (fabsf(det) < 1e-12f) return false;
+    float invDet = 1.0f / det;
+
+    hmm_mat4 r = HMM_Mat4d(1.0f);
+    r.Elements[0][0] = c00 * invDet;
+    r.Elements[1][0] = (c * h - b * i) * invDet;
+    r.Elements[2][0] = (b * f - c * e) * invDet;
+    r.Elements[0][1] = c01 * invDet;
+    r.Elements[1][1] = (a * i - c * g) * invDet;
+    r.Elements[2][1] = (c * d - a * f) * invDet;
+    r.Elements[0][2] = c02 * invDet;
+    r.Elements[1][2] = (b * g - a * h) * invDet;
+    r.Elements[2][2] = (a * e - b * d) * invDet;
+
+    hmm_vec3 t = HMM_Vec3(m.Elements[3][0], m.Elements[3][1], m.Elements[3][2]);
+    for (int row = 0; row < 3; ++row) {
+        r.Elements[3][row] = -(r.Elements[0][row] * t.X + r.Elements[1][row] * t.Y + r.Elements[2][row] * t.Z);
+    }
+    *out = r;
+    return true;
+}
+
+void ECS::MakeContactShape(const Collider& collider, const Transform& transform, ContactShape& outShape) {
+    outShape.collider = &collider;
+    outShape.center = transform.position;
+    if (collider.type == ColliderType::Box || collider.type == ColliderType::Capsule) {
+        TransformAxes(transform, outShape.axes);
+    } else if (collider.type == ColliderType::Mesh) {
+        outShape.meshToWorld = transform.CurrentMatrix();
+        bool invertible = InvertAffine(outShape.meshToWorld, &outShape.worldToMesh);
+        outShape.mesh = invertible ? collisionMeshes_.Get(collider.meshHandle) : nullptr;  // No mesh: no contacts
+    } else if (collider.type == ColliderType::Heightfield) {
+        outShape.meshToWorld = transform.CurrentMatrix();
+        bool invertible = InvertAffine(outShape.meshToWorld, &outShape.worldToMesh);
+        outShape.heightfield = invertible ? heightfields_.Get(collider.heightfieldHandle) : nullptr;
+    }
+}
+
+bool ECS::CheckCollision(EntityId a, EntityId b, CollisionInfo *outInfo) {
+    const Collider *colA = colliders_.Get(a);
+    const Collider *colB = colliders_.Get(b);
+    const Transform *transA = PeekTransform(a);
+    const Transform *transB = PeekTransform(b);
+
+    if (!colA || !colB || !transA || !transB) return false;
+    if (!HasContactTest(colA->type, colB->type)) return false;
+
+    ContactShape shapeA, shapeB;
+    MakeContactShape(*colA, *transA, shapeA);
+    MakeContactShape(*colB, *transB, shapeB);
+    if (!TestContact(shapeA, shapeB, outInfo)) return false;
+    if (outInfo) {
+        outInfo->entityA = a;
+        outInfo->entityB = b;
+    }
+    return true;
+}
+
+// -- Contact solver ----------------------------------------------------------
+
+// Depth beyond kPenetrationSlop is closed at this fraction per position
+// pass; the slop keeps resting contacts touching
+static constexpr float kPositionCorrection = 0.2f;
+static constexpr float kPenetrationSlop = 0.005f;
+static constexpr int kPositionIterations = 3;
+static constexpr float kBounceThreshold = 1.0f;  // Slower impacts don't bounce
+static constexpr float kWarmStartMinCos = 0.95f; // Cached impulses need about the same normal
+
+void ECS::SetSolverIterations(int iterations) {
+    solverIterations_ = iterations < 1 ? 1 : iterations;
+}
+
+void ECS::AddContact(EntityId a, EntityId b, const CollisionInfo& info) {
+    Rigidbody* rbA = rigidbodies_.Get(a);
+    Rigidbody* rbB = rigidbodies_.Get(b);
+    Transform* transA = transforms_.Get(a);
+    Transform* transB = transforms_.Get(b);
+    const Collider* colA = colliders_.Get(a);
+    const Collider* colB = colliders_.Get(b);
+    if (!transA || !transB || !colA || !colB) return;
+    
+    // Determine if objects can move
+    bool aStatic = colA->isStatic || (rbA && rbA->isKinematic);
+    bool bStatic = colB->isStatic || (rbB && rbB->isKinematic);
+    if (aStatic && bStatic) return;
+    
+    SolverContact contact;
+    contact.rbA = rbA;
+    contact.rbB = rbB;
+    contact.transA = transA;
+    contact.transB = transB;
+    contact.a = a;
+    contact.b = b;
+    contact.normal = info.normal;
+    contact.penetration = info.penetration;
+    contact.startA = transA->position;
+    contact.startB = transB->position;
+    contact.invMassA = (!aStatic && rbA) ? InverseMass(*rbA) : 0.0f;
+    contact.invMassB = (!bStatic && rbB) ? InverseMass(*rbB) : 0.0f;
+    float invMassSum = contact.invMassA + contact.invMassB;
+    contact.normalMass = invMassSum > 0.0f ? 1.0f / invMassSum : 0.0f;
+    
+    // Colliders without a Rigidbody are pushed as mass 1
+    float weightA = aStatic ? 0.0f : (rbA ? contact.invMassA : 1.0f);
+    float weightB = bStatic ? 0.0f : (rbB ? contact.invMassB : 1.0f);
+    contact.pushA = weightA / (weightA + weightB);
+    contact.pushB = weightB / (weightA + weightB);
+    
+    // Material: a side without a Rigidbody takes the other side's values
+    if (rbA && rbB) {
+        contact.friction = sqrtf(rbA->friction * rbB->friction);
+    } else {
+        contact.friction = rbA ? rbA->friction : (rbB ? rbB->friction : 0.0f);
+    }
+    float restitution = (rbA && rbB) ? (rbA->bounciness + rbB->bounciness) * 0.5f
+                                     : (rbA ? rbA->bounciness : (rbB ? rbB->bounciness : 0.0f));
+    hmm_vec3 velocityA = rbA ? rbA->velocity : HMM_Vec3(0.0f, 0.0f, 0.0f);
+    hmm_vec3 velocityB = rbB ? rbB->velocity : HMM_Vec3(0.0f, 0.0f, 0.0f);
+    float approach = HMM_DotVec3(HMM_SubtractVec3(velocityA, velocityB), info.normal);
+    contact.corrected = false;
+    contact.bounceVelocity = approach < -kBounceThreshold ? -restitution * approach : 0.0f;
+    
+    // Cached entries still here touched last step (older ones are pruned)
+    auto [entry, inserted] = contactCache_.try_emplace(((uint64_t)(uint32_t)a << 32) | (uint32_t)b);
+    CachedContact& cached = entry->second;
+    if (!inserted && warmStarting_ && HMM_DotVec3(cached.normal, info.normal) > kWarmStartMinCos) {
+        // Keep only the friction that still lies in the contact plane
+        contact.normalImpulse = cached.normalImpulse;
+        contact.tangentImpulse = HMM_SubtractVec3(cached.tangentImpulse,
+            HMM_MultiplyVec3f(info.normal, HMM_DotVec3(cached.tangentImpulse, info.normal)));
+        ++solverStats_.warmStarted;
+    } else {
+        contact.normalImpulse = 0.0f;
+        contact.tangentImpulse = HMM_Vec3(0.0f, 0.0f, 0.0f);
+    }
+    cached.normal = info.normal;
+    cached.step = contactStep_;
+    contact.cached = &cached;
+    
+    solverContacts_.push_back(contact);
+}
+
+void ECS::SolveContacts() {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    auto relativeVelocity = [](const SolverContact& c) {
+        hmm_vec3 velocityA = c.rbA ? c.rbA->velocity : HMM_Vec3(0.0f, 0.0f, 0.0f);
+        hmm_vec3 velocityB = c.rbB ? c.rbB->velocity : HMM_Vec3(0.0f, 0.0f, 0.0f);
+        return HMM_SubtractVec3(velocityA, velocityB);
+    };
+    // Impulse on A, the opposite on B
+    auto applyImpulse = [](SolverContact& c, const hmm_vec3& impulse) {
+        if (c.invMassA > 0.0f) c.rbA->velocity = HMM_AddVec3(c.rbA->velocity, HMM_MultiplyVec3f(impulse, c.invMassA));
+        if (c.invMassB > 0.0f) c.rbB->velocity = HMM_SubtractVec3(c.rbB->velocity, HMM_MultiplyVec3f(impulse, c.invMassB));
+    };
+    
+    // Warm start: last step's impulses first
+    for (SolverContact& c : solverContacts_) {
+        if (c.normalMass == 0.0f) continue;
+        applyImpulse(c, HMM_AddVec3(HMM_MultiplyVec3f(c.normal, c.normalImpulse), c.tangentImpulse));
+    }
+    
+    // Velocity iterations
+    int iterations = 0;
+    while (iterations < solverIterations_) {
+        ++iterations;
+        float largestChange = 0.0f;
+        for (SolverContact& c : solverContacts_) {
+            if (c.normalMass == 0.0f) continue;
+            
+            // Friction: cancel sliding, limited by the normal impulse so far
+            hmm_vec3 velocity = relativeVelocity(c);
+            hmm_vec3 sliding = HMM_SubtractVec3(velocity, HMM_MultiplyVec3f(c.normal, HMM_DotVec3(velocity, c.normal)));
+            hmm_vec3 tangentImpulse = HMM_SubtractVec3(c.tangentImpulse, HMM_MultiplyVec3f(sliding, c.normalMass));
+            float maxFriction = c.friction * c.normalImpulse;
+            float tangentSq = HMM_DotVec3(tangentImpulse, tangentImpulse);
+            if (tangentSq > maxFriction * maxFriction) {
+                tangentImpulse = HMM_MultiplyVec3f(tangentImpulse, maxFriction / sqrtf(tangentSq));
+            }
+            hmm_vec3 tangentDelta = HMM_SubtractVec3(tangentImpulse, c.tangentImpulse);
+            c.tangentImpulse = tangentImpulse;
+            applyImpulse(c, tangentDelta);
+            
+            // Normal: stop approaching (or bounce), never pull together
+            float approach = HMM_DotVec3(relativeVelocity(c), c.normal);
+            float normalImpulse = fmaxf(c.normalImpulse - (approach - c.bounceVelocity) * c.normalMass, 0.0f);
+            float normalDelta = normalImpulse - c.normalImpulse;
+            c.normalImpulse = normalImpulse;
+            applyImpulse(c, HMM_MultiplyVec3f(c.normal, normalDelta));
+            
+            float change = (fabsf(normalDelta) + sqrtf(HMM_DotVec3(tangentDelta, tangentDelta))) / c.normalMass;
+            if (change > largestChange) largestChange = change;
+        }
+        if (largestChange < kSolverTolerance) break;
+    }
+    
+    for (SolverContact& c : solverContacts_) {
+        c.cached->normalImpulse = c.normalImpulse;
+        c.cached->tangentImpulse = c.tangentImpulse;
+    }
+    
+    // Position passes: move the bodies out of each other directly, so the
+    // correction never turns into velocity and resting bodies can sleep.
+    // The remaining depth is estimated from how far both moved since the
+    // narrow phase.
+    for (int pass = 0; pass < kPositionIterations; ++pass) {
+        for (SolverContact& c : solverContacts_) {
+            if (c.normalMass == 0.0f) continue;
+            hmm_vec3 moved = HMM_SubtractVec3(HMM_SubtractVec3(c.transA->position, c.startA),
+                                              HMM_SubtractVec3(c.transB->position, c.startB));
+            float depth = c.penetration - HMM_DotVec3(moved, c.normal);
+            if (depth <= kPenetrationSlop) continue;
+            hmm_vec3 push = HMM_MultiplyVec3f(c.normal, kPositionCorrection * (depth - kPenetrationSlop) * c.normalMass);
+            if (c.invMassA > 0.0f) c.transA->position = HMM_AddVec3(c.transA->position, HMM_MultiplyVec3f(push, c.invMassA));
+            if (c.invMassB > 0.0f) c.transB->position = HMM_SubtractVec3(c.transB->position, HMM_MultiplyVec3f(push, c.invMassB));
+            c.corrected = true;
+        }
+    }
+    for (SolverContact& c : solverContacts_) {
+        if (!c.corrected) continue;
+        // Bodies moved earlier this step are already queued (and their move
+        // was consumed by FindCollisionPairs), so the queue won't log this
+        // correction: log it directly
+        if (c.invMassA > 0.0f) {
+            TouchTransform(c.a, *c.transA);
+            transforms_.MarkChanged(c.a);
+        }
+        if (c.invMassB > 0.0f) {
+            TouchTransform(c.b, *c.transB);
+            transforms_.MarkChanged(c.b);
+        }
+    }
+    
+    // Colliders without a Rigidbody take no impulses: push them out
+    for (SolverContact& c : solverContacts_) {
+        if (c.normalMass != 0.0f) continue;
+        hmm_vec3 correction = HMM_MultiplyVec3f(c.normal, c.penetration);
+        if (c.pushA > 0.0f) {
+            c.transA->position = HMM_AddVec3(c.transA->position, HMM_MultiplyVec3f(correction, c.pushA));
+            TouchTransform(c.a, *c.transA);
+            transforms_.MarkChanged(c.a);
+        }
+        if (c.pushB > 0.0f) {
+            c.transB->position = HMM_SubtractVec3(c.transB->position, HMM_MultiplyVec3f(correction, c.pushB));
+            TouchTransform(c.b, *c.transB);
+            transforms_.MarkChanged(c.b);
+        }
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    solverStats_.contacts = (int)solverContacts_.size();
+    solverStats_.iterations = solverContacts_.empty() ? 0 : iterations;
+    solverStats_.solveMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void ECS::UpdateAnimation(float dt) {
+    ParallelEach<Animator>([&](EntityId, Animator& a) {
+        a.time += dt;
+        if (a.time > 10.0f) a.time = 0.0f;
+    });
+}
+
+void ECS::SyncToRenderer(Renderer& renderer) {
+    if (hierarchyDirty_) RebuildHierarchyOrder();  // May dirty detached orphans
+    FlushTransformChanges();
+    
+    // The hierarchy is only walked when a parent or a child is among the
+    // dirty transforms, so frames that move unparented entities skip it
+    bool dirtyParent = false;
+    bool dirtyChild = false;
+    if (!hierarchyOrder_.empty()) {
+        for (EntityId id : syncQueue_) {
+            uint32_t slot = EntityIndex(id);
+            if (slot < childCount_.size() && childCount_[slot] > 0) dirtyParent = true;
+            if (parents_.Has(id)) dirtyChild = true;
+            if (dirtyParent && dirtyChild) break;
+        }
+    }
+    
+    // A dirty parent dirties its whole subtree (the order is parent-first)
+    if (dirtyParent) {
+        for (EntityId child : hierarchyOrder_) {
+            Transform* t = transforms_.Get(child);
+            if (!t || t->dirty) continue;
+            const Transform* p = transforms_.Get(parents_.Get(child)->parent);
+            if (p && p->dirty) {
+                t->dirty = true;
+                syncQueue_.push_back(child);
+                transforms_.MarkChanged(child);
+                dirtyChild = true;
+            }
+        }
     }
-}
-
-void ECS::UpdateCollisions(float dt) {
-    // Broad phase: Check all pairs with colliders
-    std::vector<EntityId> collidableEntities;
-    for (const auto& [id, _] : colliders_) {
-        collidableEntities.push_back(id);
+    
+    // Gather the queued transforms; static props cost nothing
+    syncBatch_.Clear();
+    syncTransforms_.clear();
+    syncInstances_.clear();
+    
+    for (EntityId id : syncQueue_) {
+        Transform* t = transforms_.Get(id);
+        if (!t || !t->dirty) continue;  // Destroyed since it was queued
+        
+        const Renderable* renderable = renderables_.Get(id);
+        syncBatch_.Push(*t);
+        syncTransforms_.push_back(t);
+        syncInstances_.push_back(renderable ? renderable->instanceId : -1);
     }
+    syncQueue_.clear();
     
-    // Narrow phase: Check collisions and resolve
-    for (size_t i = 0; i < collidableEntities.size(); ++i) {
-        for (size_t j = i + 1; j < collidableEntities.size(); ++j) {
-            EntityId a = collidableEntities[i];
-            EntityId b = collidableEntities[j];
-            
-            Collider* colA = GetCollider(a);
-            Collider* colB = GetCollider(b);
-            
-            // Check collision layers
-            if ((colA->collisionMask & colB->collisionLayer) == 0 ||
-                (colB->collisionMask & colA->collisionLayer) == 0) {
-                continue; // Layers don't match
+    const size_t count = syncBatch_.size();
+    syncMatrices_.resize(count);
+    
+    auto parallelFor = [&](size_t begin, size_t end, const JobSystem::RangeFunc& func) {
+        if (jobs_) {
+            jobs_->ParallelFor(end - begin, kParallelChunkSize, [&](size_t b, size_t e) { func(begin + b, begin + e); });
+        } else {
+            func(begin, end);
+        }
+    };
+    
+    // Local matrices (custom matrices are copied straight through)
+    parallelFor(0, count, [&](size_t begin, size_t end) {
+        ComputeModelMatrices(syncBatch_, begin, end, syncMatrices_.data());
+        for (size_t i = begin; i < end; ++i) {
+            Transform* t = syncTransforms_[i];
+            t->worldMatrix = t->useCustomMatrix ? t->customMatrix : syncMatrices_[i];
+        }
+    });
+    
+    // Children: world = parent world * local, one linear pass per level.
+    // Parents sit on earlier levels, so their world matrices are final.
+    for (size_t level = 0; dirtyChild && level + 1 < hierarchyLevelStart_.size(); ++level) {
+        parallelFor(hierarchyLevelStart_[level], hierarchyLevelStart_[level + 1], [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                EntityId child = hierarchyOrder_[i];
+                Transform* t = transforms_.Get(child);
+                if (!t || !t->dirty) continue;
+                const Transform* p = transforms_.Get(parents_.Get(child)->parent);
+                if (p) t->worldMatrix = HMM_MultiplyMat4(p->worldMatrix, t->worldMatrix);
             }
-            
-            CollisionInfo info;
-            if (CheckCollision(a, b, &info)) {
-                // Skip if either is a trigger (no physics response)
-                if (!colA->isTrigger && !colB->isTrigger) {
-                    ResolveCollision(a, b, info);
-                }
+        });
+    }
+    
+    // Upload and clear. Instances are disjoint, so chunks can write the renderer concurrently
+    parallelFor(0, count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Transform* t = syncTransforms_[i];
+            t->dirty = false;
+            if (syncInstances_[i] >= 0) {
+                renderer.UpdateInstanceTransform(syncInstances_[i], t->worldMatrix);
             }
         }
-    }
+    });
+    
+    UploadInterpolatedBodies(renderer);
+    
+    syncStats_.recomputed = (int)count;
+    syncStats_.total = (int)transforms_.size();
+    syncStats_.hierarchyDepth = hierarchyLevelStart_.empty() ? 0 : (int)hierarchyLevelStart_.size() - 1;
 }
 
-bool ECS::CheckCollision(EntityId a, EntityId b, CollisionInfo *outInfo) {
-    Collider *colA = GetCollider(a);
-    Collider *colB = GetCollider(b);
-    Transform *transA = GetTransform(a);
-    Transform *transB = GetTransform(b);
-
-    if (!colA || !colB || !transA || !transB) return false;
+// -- Fixed-step interpolation ------------------------------------------------
 
-    // ADDED: Sphere vs Plane (most important for ground collision!)
-    if (colA->type == ColliderType::Sphere && colB->type == ColliderType::Plane) {
-        return SphereVsPlane(transA->position, colA->radius, colB->planeNormal, colB->planeDistance, outInfo);
-    }
-    if (colA->type == ColliderType::Plane && colB->type == ColliderType::Sphere) {
-        bool result = SphereVsPlane(transB->position, colB->radius, colA->planeNormal, colA->planeDistance, outInfo);
-        if (result && outInfo) {
-            // Flip normal since we swapped order
-            outInfo->normal = HMM_MultiplyVec3f(outInfo->normal, -1.0f);
-            std::swap(outInfo->entityA, outInfo->entityB);
+void ECS::BeginPhysicsStep() {
+    RestoreInterpolatedBodies();
+    interpolatedBodies_.clear();
+    for (const auto& [id, rb] : rigidbodies_) {
+        if ((rb.isKinematic && !characters_.Has(id)) || rb.sleeping) continue;
+        if (const Transform* t = transforms_.Get(id)) {
+            interpolatedBodies_.push_back({ id, t->position, t->position });
         }
-        return result;
-    }
-
-    // Sphere vs Sphere
-    if (colA->type == ColliderType::Sphere && colB->type == ColliderType::Sphere) {
-        return SphereVsSphere(transA->position, colA->radius, transB->position, colB->radius, outInfo);
     }
+}
 
-    // Sphere vs Box
-    if (colA->type == ColliderType::Sphere && colB->type == ColliderType::Box) {
-        return SphereVsBox(transA->position, colA->radius, transB->position, colB->boxHalfExtents, outInfo);
-    }
-    if (colA->type == ColliderType::Box && colB->type == ColliderType::Sphere) {
-        bool result = SphereVsBox(transB->position, colB->radius, transA->position, colA->boxHalfExtents, outInfo);
-        if (result && outInfo) {
-            // Flip normal since we swapped order
-            outInfo->normal = HMM_MultiplyVec3f(outInfo->normal, -1.0f);
-            std::swap(outInfo->entityA, outInfo->entityB);
-        }
-        return result;
+void ECS::EndPhysicsStep() {
+    // Bodies at rest draw where they are; keep only the ones that moved
+    size_t kept = 0;
+    for (const InterpolatedBody& body : interpolatedBodies_) {
+        const Transform* t = transforms_.Get(body.id);
+        if (!t || !IsAlive(body.id)) continue;
+        if (t->position.X == body.previous.X && t->position.Y == body.previous.Y && t->position.Z == body.previous.Z) continue;
+        interpolatedBodies_[kept] = body;
+        interpolatedBodies_[kept].current = t->position;
+        ++kept;
     }
+    interpolatedBodies_.resize(kept);
+}
 
-    return false;
+void ECS::SetInterpolationAlpha(float alpha) {
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    if (alpha == 1.0f && interpolationAlpha_ < 1.0f) RestoreInterpolatedBodies();
+    interpolationAlpha_ = alpha;
 }
 
-bool ECS::SphereVsSphere(const hmm_vec3 &posA, float radiusA, const hmm_vec3 &posB, float radiusB, CollisionInfo *outInfo) {
-    hmm_vec3 diff = HMM_SubtractVec3(posB, posA);
-    float distSq = HMM_DotVec3(diff, diff);
-    float radiusSum = radiusA + radiusB;
+// Bodies drawn between states get their simulated matrix uploaded again at
+// the next sync (those still moving are drawn interpolated on top)
+void ECS::RestoreInterpolatedBodies() {
+    for (const InterpolatedBody& body : interpolatedBodies_) {
+        if (!IsAlive(body.id)) continue;
+        if (Transform* t = transforms_.Get(body.id)) TouchTransform(body.id, *t);
+    }
+}
 
-    if (distSq < radiusSum * radiusSum) {
-        if (outInfo) {
-            float dist = sqrtf(distSq);
-            outInfo->normal = (dist > 0.001f) ? HMM_MultiplyVec3f(diff, 1.0f / dist) : HMM_Vec3(0.0f, 1.0f, 0.0f);
-            outInfo->penetration = radiusSum - dist;
-            outInfo->contactPoint = HMM_AddVec3(posA, HMM_MultiplyVec3f(outInfo->normal, radiusA - outInfo->penetration * 0.5f));
+void ECS::UploadInterpolatedBodies(Renderer& renderer) {
+    syncStats_.interpolated = 0;
+    if (interpolationAlpha_ >= 1.0f) return;
+    
+    // World matrices are current here, so the drawn matrix is the simulated
+    // one moved back towards the previous state
+    const float back = 1.0f - interpolationAlpha_;
+    for (const InterpolatedBody& body : interpolatedBodies_) {
+        if (!IsAlive(body.id)) continue;
+        const Transform* t = transforms_.Get(body.id);
+        const Renderable* renderable = renderables_.Get(body.id);
+        if (!t || !renderable || renderable->instanceId < 0) continue;
+        // Moved outside physics since the step (editor, teleport): draw as is
+        if (t->position.X != body.current.X || t->position.Y != body.current.Y || t->position.Z != body.current.Z) continue;
+        
+        hmm_vec4 offset = HMM_Vec4((body.previous.X - body.current.X) * back, (body.previous.Y - body.current.Y) * back,
+                                   (body.previous.Z - body.current.Z) * back, 0.0f);
+        if (const Parent* parent = parents_.Get(body.id)) {
+            if (const Transform* p = transforms_.Get(parent->parent)) {
+                offset = HMM_MultiplyMat4ByVec4(p->worldMatrix, offset);
+            }
         }
-        return true;
+        hmm_mat4 matrix = t->worldMatrix;
+        matrix.Elements[3][0] += offset.X;
+        matrix.Elements[3][1] += offset.Y;
+        matrix.Elements[3][2] += offset.Z;
+        renderer.UpdateInstanceTransform(renderable->instanceId, matrix);
+        ++syncStats_.interpolated;
     }
-    return false;
 }
 
-bool ECS::SphereVsBox(const hmm_vec3 &spherePos, float radius, const hmm_vec3 &boxPos, const hmm_vec3 &boxHalfExtents, CollisionInfo *outInfo) {
-    // Find closest point on box to sphere
-    hmm_vec3 closestPoint;
-    closestPoint.X = fmaxf(boxPos.X - boxHalfExtents.X, fminf(spherePos.X, boxPos.X + boxHalfExtents.X));
-    closestPoint.Y = fmaxf(boxPos.Y - boxHalfExtents.Y, fminf(spherePos.Y, boxPos.Y + boxHalfExtents.Y));
-    closestPoint.Z = fmaxf(boxPos.Z - boxHalfExtents.Z, fminf(spherePos.Z, boxPos.Z + boxHalfExtents.Z));
+// -- Determinism -------------------------------------------------------------
 
-    hmm_vec3 diff = HMM_SubtractVec3(spherePos, closestPoint);
-    float distSq = HMM_DotVec3(diff, diff);
-
-    if (distSq < radius * radius) {
-        if (outInfo) {
-            float dist = sqrtf(distSq);
-            outInfo->normal = (dist > 0.001f) ? HMM_MultiplyVec3f(diff, 1.0f / dist) : HMM_Vec3(0.0f, 1.0f, 0.0f);
-            outInfo->penetration = radius - dist;
-            outInfo->contactPoint = closestPoint;
-        }
-        return true;
+void ECS::SetDeterministic(bool enabled) {
+    if (!enabled) {
+        freeSlots_.insert(freeSlots_.end(), deterministicFreeSlots_.begin(), deterministicFreeSlots_.end());
+        deterministicFreeSlots_.clear();
     }
-    return false;
+    deterministic_ = enabled;
 }
 
-// ADDED: Sphere vs Plane collision detection
-bool ECS::SphereVsPlane(const hmm_vec3& spherePos, float radius, const hmm_vec3& planeNormal, float planeDistance, CollisionInfo* outInfo) {
-    // Distance from sphere center to plane (signed distance)
-    // Positive = above plane, Negative = below plane
-    float distanceToPlane = HMM_DotVec3(spherePos, planeNormal) - planeDistance;
+void ECS::SeedRandom(uint32_t seed) {
+    aiRandom_.seed(seed);
+}
+
+void ECS::ResetSimulationCaches() {
+    // Sleeping islands are contact history a snapshot doesn't keep (a
+    // loaded sleeper wakes alone), so everything starts awake
+    Rigidbody* bodies = rigidbodies_.Data();
+    const EntityId* ids = rigidbodies_.Entities();
+    for (size_t i = 0; i < rigidbodies_.size(); ++i) {
+        if (bodies[i].sleeping) WakeIsland(ids[i]);
+    }
+    sleepIslands_.clear();
+    freeSleepIslands_.clear();
+    sleepSlots_.clear();
     
-    // Check if sphere intersects plane
-    if (distanceToPlane < radius) {
-        if (outInfo) {
-            // Penetration is how much the sphere has gone into the plane
-            outInfo->penetration = radius - distanceToPlane;
-            
-            // Normal points away from plane (upward for ground)
-            outInfo->normal = planeNormal;
-            
-            // Contact point on the plane surface
-            outInfo->contactPoint = HMM_SubtractVec3(spherePos, HMM_MultiplyVec3f(planeNormal, distanceToPlane));
-            
-            printf("DEBUG: Sphere-Plane collision | dist=%.3f, penetration=%.3f\n", distanceToPlane, outInfo->penetration);
-        }
-        return true;
+    // Every transform dirty and logged, as after a snapshot load. That also
+    // covers the bodies BeginPhysicsStep() would restore.
+    for (auto [id, t] : transforms_) {
+        TouchTransform(id, t);
     }
+    FlushTransformChanges();
+    interpolatedBodies_.clear();
     
-    return false;
+    contactCache_.clear();
+    broadphase_.Clear();
+    
+    // Trees rebuilt from the pool; the cursors skip what was just logged
+    colliderIndexCursors_.valid = false;
+    RefreshColliderIndex();
+    sleepCursors_.transforms = ChangeCursor<Transform>();
+    sleepCursors_.rigidbodies = ChangeCursor<Rigidbody>();
+    sleepCursors_.colliders = ChangeCursor<Collider>();
+    sleepCursors_.valid = true;
 }
 
-void ECS::ResolveCollision(EntityId a, EntityId b, const CollisionInfo& info) {
-    Rigidbody* rbA = GetRigidbody(a);
-    Rigidbody* rbB = GetRigidbody(b);
-    Transform* transA = GetTransform(a);
-    Transform* transB = GetTransform(b);
-    Collider* colA = GetCollider(a);
-    Collider* colB = GetCollider(b);
-    
-    if (!transA || !transB || !colA || !colB) return;
+uint64_t ECS::SimulationHash() const {
+    // FNV-1a over the values, field by field (padding and cached matrices
+    // are not state)
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+    auto mixTransform = [&](const Transform* t) {
+        if (!t) return;
+        mix(&t->position, sizeof(hmm_vec3));
+        mix(&t->yaw, sizeof(float));
+        mix(&t->pitch, sizeof(float));
+        mix(&t->roll, sizeof(float));
+    };
     
-    // Determine if objects can move
-    bool aStatic = colA->isStatic || (rbA && rbA->isKinematic);
-    bool bStatic = colB->isStatic || (rbB && rbB->isKinematic);
-    
-    if (aStatic && bStatic) return; // Both static, no resolution
+    const EntityId* bodies = rigidbodies_.Entities();
+    const Rigidbody* rigidbodies = rigidbodies_.Data();
+    for (size_t i = 0; i < rigidbodies_.size(); ++i) {
+        const Rigidbody& rb = rigidbodies[i];
+        mix(&rb.velocity, sizeof(hmm_vec3));
+        mix(&rb.sleeping, sizeof(bool));
+        mix(&rb.sleepTimer, sizeof(float));
+        mixTransform(transforms_.Get(bodies[i]));
+    }
     
-    // ADDED: Clamp penetration to prevent explosion
-    float clampedPenetration = fminf(info.penetration, 10.0f);  // Max 10 units correction per frame
-    if (info.penetration > 10.0f) {
-        printf("WARNING: Large penetration %.2f clamped to 10.0\n", info.penetration);
+    const EntityId* agents = ai_controllers_.Entities();
+    const AIController* controllers = ai_controllers_.Data();
+    for (size_t i = 0; i < ai_controllers_.size(); ++i) {
+        const AIController& ai = controllers[i];
+        mix(&ai.state, sizeof(AIState));
+        mix(&ai.stateTimer, sizeof(float));
+        mix(&ai.wanderTarget, sizeof(hmm_vec3));
+        mixTransform(transforms_.Get(agents[i]));
     }
     
-    // FIXED: Position correction along the collision normal
-    hmm_vec3 correction = HMM_MultiplyVec3f(info.normal, clampedPenetration);
+    const EntityId* walkers = characters_.Entities();
+    const CharacterController* characters = characters_.Data();
+    for (size_t i = 0; i < characters_.size(); ++i) {
+        const CharacterController& character = characters[i];
+        mix(&character.moveVelocity, sizeof(hmm_vec3));
+        mix(&character.verticalVelocity, sizeof(float));
+        mix(&character.grounded, sizeof(bool));
+        mixTransform(transforms_.Get(walkers[i]));
+    }
+    return hash;
+}
+
+// -- Hierarchy -------------------------------------------------------------
+
+void ECS::SetParent(EntityId child, EntityId parent) {
+    if (parent == -1) {
+        RemoveParent(child);
+        return;
+    }
+    if (!IsAlive(child) || !IsAlive(parent)) return;
     
-    if (!aStatic && !bStatic) {
-        // Both dynamic - split the correction based on mass
-        float totalMass = (rbA ? rbA->mass : 1.0f) + (rbB ? rbB->mass : 1.0f);
-        float massA = rbA ? rbA->mass : 1.0f;
-        float massB = rbB ? rbB->mass : 1.0f;
-        
-        float correctionA = massB / totalMass;
-        float correctionB = massA / totalMass;
-        
-        // Move A along normal (away from B)
-        transA->position = HMM_AddVec3(transA->position, HMM_MultiplyVec3f(correction, correctionA));
-        transB->position = HMM_SubtractVec3(transB->position, HMM_MultiplyVec3f(correction, correctionB));
-    } else if (!aStatic) {
-        // FIXED: A is dynamic, B is static (e.g., sphere vs plane)
-        // Move A away from B along the normal (push sphere UP out of ground)
-        transA->position = HMM_AddVec3(transA->position, correction);
-        
-        printf("Corrected entity A by %.3f along normal (%.2f, %.2f, %.2f)\n", 
-               clampedPenetration, info.normal.X, info.normal.Y, info.normal.Z);
-    } else if (!bStatic) {
-        // B is dynamic, A is static
-        // Move B away from A along the normal
-        transB->position = HMM_SubtractVec3(transB->position, correction);
+    // Physics and picking read Transform::position as a world position
+    if (colliders_.Has(child) || selectables_.Has(child)) {
+        printf("ERROR: SetParent(%d, %d): entities with a collider or selectable can't be parented\n", child, parent);
+        return;
     }
     
-    // Velocity resolution (impulse-based)
-    if (rbA && rbB && !aStatic && !bStatic) {
-        hmm_vec3 relativeVelocity = HMM_SubtractVec3(rbB->velocity, rbA->velocity);
-        float velocityAlongNormal = HMM_DotVec3(relativeVelocity, info.normal);
-        
-        if (velocityAlongNormal >= 0.0f) return; // Objects moving apart
-        
-        float restitution = (rbA->bounciness + rbB->bounciness) * 0.5f;
-        float impulseScalar = -(1.0f + restitution) * velocityAlongNormal;
-        impulseScalar /= (1.0f / rbA->mass + 1.0f / rbB->mass);
-        
-        hmm_vec3 impulse = HMM_MultiplyVec3f(info.normal, impulseScalar);
-        
-        rbA->velocity = HMM_SubtractVec3(rbA->velocity, HMM_MultiplyVec3f(impulse, 1.0f / rbA->mass));
-        rbB->velocity = HMM_AddVec3(rbB->velocity, HMM_MultiplyVec3f(impulse, 1.0f / rbB->mass));
-    } else if (rbA && !aStatic) {
-        // A is dynamic, B is static - stop velocity along collision normal
-        float velocityAlongNormal = HMM_DotVec3(rbA->velocity, info.normal);
-        
-        // Only correct if moving INTO the static object (downward for ground)
-        if (velocityAlongNormal < 0.0f) {
-            // FIXED: Stop all downward velocity (set Y component to 0 for ground collision)
-            if (fabsf(info.normal.Y) > 0.9f) {  // Ground plane (normal mostly vertical)
-                rbA->velocity.Y = 0.0f;  // Stop falling
-                printf("Stopped downward velocity\n");
-            } else {
-                // General case: reflect velocity
-                hmm_vec3 normalVelocity = HMM_MultiplyVec3f(info.normal, velocityAlongNormal);
-                rbA->velocity = HMM_SubtractVec3(rbA->velocity, HMM_MultiplyVec3f(normalVelocity, 1.0f + rbA->bounciness));
-            }
-        }
-    } else if (rbB && !bStatic) {
-        // B is dynamic, A is static
-        float velocityAlongNormal = HMM_DotVec3(rbB->velocity, info.normal);
-        
-        // Only correct if moving INTO the static object
-        if (velocityAlongNormal > 0.0f) {
-            hmm_vec3 normalVelocity = HMM_MultiplyVec3f(info.normal, velocityAlongNormal);
-            rbB->velocity = HMM_SubtractVec3(rbB->velocity, HMM_MultiplyVec3f(normalVelocity, 1.0f + rbB->bounciness));
+    // Reject cycles: the new parent must not be the child or one of its descendants
+    for (EntityId e = parent; e != -1; ) {
+        if (e == child) {
+            printf("ERROR: SetParent(%d, %d) would create a cycle\n", child, parent);
+            return;
         }
+        const Parent* p = parents_.Get(e);
+        e = p ? p->parent : -1;
     }
+    
+    RemoveParent(child);
+    
+    Parent p;
+    p.parent = parent;
+    parents_.Insert(child, p);
+    hierarchyDirty_ = true;
+    
+    if (childCount_.size() < generations_.size()) childCount_.resize(generations_.size(), 0);
+    ++childCount_[EntityIndex(parent)];
+    
+    if (Transform* t = transforms_.Get(child)) TouchTransform(child, *t);
 }
 
-void ECS::UpdateAnimation(float dt) {
-    for (auto &kv : animators_) {
-        Animator &a = kv.second;
-        a.time += dt;
-        if (a.time > 10.0f) a.time = 0.0f;
+void ECS::RemoveParent(EntityId child) {
+    const Parent* p = parents_.Get(child);
+    if (!p) return;
+    
+    if (IsAlive(p->parent)) --childCount_[EntityIndex(p->parent)];
+    parents_.Remove(child);
+    hierarchyDirty_ = true;
+    
+    if (Transform* t = transforms_.Get(child)) TouchTransform(child, *t);
+}
+
+EntityId ECS::GetParent(EntityId child) const {
+    const Parent* p = parents_.Get(child);
+    return p ? p->parent : -1;
+}
+
+hmm_vec3 ECS::GetWorldPosition(EntityId id) const {
+    const Transform* t = transforms_.Get(id);
+    if (!t) return HMM_Vec3(0.0f, 0.0f, 0.0f);
+    if (!t->dirty) {
+        return HMM_Vec3(t->worldMatrix.Elements[3][0], t->worldMatrix.Elements[3][1], t->worldMatrix.Elements[3][2]);
+    }
+    
+    // Not synced yet: compose up the parent chain
+    hmm_vec4 p = HMM_Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    for (EntityId e = id; e != -1; e = GetParent(e)) {
+        const Transform* et = transforms_.Get(e);
+        if (!et) break;
+        p = HMM_MultiplyMat4ByVec4(et->ModelMatrix(), p);
     }
+    return HMM_Vec3(p.X, p.Y, p.Z);
 }
 
-void ECS::SyncToRenderer(Renderer& renderer) {
-    for (EntityId id : alive_) {
-        auto it = instance_for_entity_.find(id);
-        if (it == instance_for_entity_.end()) continue;
-        int instId = it->second;
-        Transform* t = GetTransform(id);
-        if (t && instId >= 0) {
-            hmm_mat4 modelMatrix = t->ModelMatrix();
-            renderer.UpdateInstanceTransform(instId, modelMatrix);
+// Sorts parented entities by depth (counting sort) so SyncToRenderer can
+// propagate level by level. Only runs after the hierarchy changes.
+void ECS::RebuildHierarchyOrder() {
+    hierarchyOrder_.clear();
+    hierarchyLevelStart_.clear();
+    
+    // Detach children of destroyed parents
+    std::vector<EntityId> orphans;
+    for (const auto& [child, parent] : parents_) {
+        if (!IsAlive(parent.parent)) orphans.push_back(child);
+    }
+    for (EntityId child : orphans) {
+        parents_.Remove(child);
+        if (Transform* t = transforms_.Get(child)) TouchTransform(child, *t);
+    }
+    
+    hierarchyDepthScratch_.assign(generations_.size(), 0);
+    
+    // Depth of a parented entity: 1 + depth of its parent (roots are 0).
+    // Walks up until a known depth, then fills in the path on the way back.
+    std::vector<EntityId> path;
+    int maxDepth = 0;
+    const EntityId* children = parents_.Entities();
+    for (size_t i = 0; i < parents_.size(); ++i) {
+        EntityId e = children[i];
+        path.clear();
+        int depth = 0;
+        while (e != -1) {
+            int known = hierarchyDepthScratch_[EntityIndex(e)];
+            if (known > 0) { depth = known; break; }
+            const Parent* p = parents_.Get(e);
+            if (!p) break;  // Root
+            path.push_back(e);
+            e = p->parent;
+        }
+        for (size_t k = path.size(); k-- > 0; ) {
+            hierarchyDepthScratch_[EntityIndex(path[k])] = ++depth;
         }
+        if (depth > maxDepth) maxDepth = depth;
+    }
+    
+    // Level sizes -> level start offsets -> scatter
+    hierarchyLevelStart_.assign(maxDepth + 1, 0);
+    for (size_t i = 0; i < parents_.size(); ++i) {
+        ++hierarchyLevelStart_[hierarchyDepthScratch_[EntityIndex(children[i])]];
+    }
+    for (int level = 1; level <= maxDepth; ++level) {
+        hierarchyLevelStart_[level] += hierarchyLevelStart_[level - 1];
+    }
+    
+    std::vector<size_t> cursor(hierarchyLevelStart_.begin(), hierarchyLevelStart_.end() - 1);
+    hierarchyOrder_.resize(parents_.size());
+    for (size_t i = 0; i < parents_.size(); ++i) {
+        int depth = hierarchyDepthScratch_[EntityIndex(children[i])];
+        hierarchyOrder_[cursor[depth - 1]++] = children[i];
     }
+    
+    hierarchyDirty_ = false;
 }
 
-void ECS::AddLight(EntityId entity, const Light& light) { lights_[entity] = light; }
-Light* ECS::GetLight(EntityId entity) {
-    auto it = lights_.find(entity);
-    return (it != lights_.end()) ? &it->second : nullptr;
+void ECS::AddLight(EntityId entity, const Light& light) {
+    if (!IsAlive(entity)) return;
+    lights_.Insert(entity, light);
 }
-void ECS::RemoveLight(EntityId entity) { lights_.erase(entity); }
+Light* ECS::GetLight(EntityId entity) { return lights_.Get(entity); }
+void ECS::RemoveLight(EntityId entity) { lights_.Remove(entity); }
 
-void ECS::AddSelectable(EntityId id, const Selectable& sel) { selectables_[id] = sel; }
-Selectable* ECS::GetSelectable(EntityId id) {
-    auto it = selectables_.find(id);
-    return (it != selectables_.end()) ? &it->second : nullptr;
+void ECS::AddSelectable(EntityId id, const Selectable& sel) {
+    if (!IsAlive(id)) return;
+    if (parents_.Has(id)) {
+        printf("ERROR: AddSelectable(%d): parented entities can't be selectable\n", id);
+        return;
+    }
+    selectables_.Insert(id, sel);
 }
-bool ECS::HasSelectable(EntityId id) const { return selectables_.find(id) != selectables_.end(); }
+Selectable* ECS::GetSelectable(EntityId id) { return selectables_.Get(id); }
+bool ECS::HasSelectable(EntityId id) const { return selectables_.Has(id); }
 
 EntityId ECS::RaycastSelection(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir, float maxDistance) {
     EntityId closestEntity = -1;
     float closestDist = maxDistance;
     
-    for (const auto& [id, selectable] : selectables_) {
-        Transform* t = GetTransform(id);
-        if (!t) continue;
+    View<Selectable, Transform>().Each([&](EntityId id, Selectable& selectable, Transform& transform) {
+        Transform* t = &transform;
         
         hmm_vec3 oc = HMM_SubtractVec3(rayOrigin, t->position);
         float a = HMM_DotVec3(rayDir, rayDir);
@@ -601,7 +2460,7 @@ EntityId ECS::RaycastSelection(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir
                 closestEntity = id;
             }
         }
-    }
+    });
     
     return closestEntity;
 }
@@ -613,9 +2472,8 @@ hmm_vec3 ECS::GetPlacementPosition(const hmm_vec3& rayOrigin, const hmm_vec3& ra
     bool foundHit = false;
     
     // Raycast against all selectable entities (including ground)
-    for (const auto& [id, selectable] : selectables_) {
-        Transform* t = GetTransform(id);
-        if (!t) continue;
+    View<Selectable, Transform>().Each([&](EntityId, Selectable& selectable, Transform& transform) {
+        Transform* t = &transform;
         
         // Get world position (accounting for origin offset)
         hmm_vec3 entityPos = t->GetWorldPosition();
@@ -634,7 +2492,7 @@ hmm_vec3 ECS::GetPlacementPosition(const hmm_vec3& rayOrigin, const hmm_vec3& ra
                 foundHit = true;
             }
         }
-    }
+    });
     
     // If we hit something, place at that point (slightly above the surface)
     if (foundHit) {
@@ -664,53 +2522,58 @@ void ECS::CreatePlaneCollider(EntityId entity, const hmm_vec3& normal, float dis
 }
 
 void ECS::CreateMeshCollider(EntityId entity, const Model3D& model) {
+    // Every instance of a model shares one triangle array and BVH
+    int meshHandle = collisionMeshes_.Register(model);
+    const CollisionMesh* mesh = collisionMeshes_.Get(meshHandle);
+    if (!mesh) {
+        printf("Mesh collider skipped: model has no triangles\n");
+        return;
+    }
+    
     Collider collider;
     collider.type = ColliderType::Mesh;
     collider.isStatic = true;
+    collider.meshHandle = meshHandle;
+    collider.meshBoundsMin = mesh->boundsMin;
+    collider.meshBoundsMax = mesh->boundsMax;
     
-    collider.triangles.reserve(model.index_count / 3);
-    
-    hmm_vec3 boundsMin = HMM_Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
-    hmm_vec3 boundsMax = HMM_Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-    
-    for (int i = 0; i < model.index_count; i += 3) {
-        CollisionTriangle tri;
-        
-        Vertex& v0 = model.vertices[model.indices[i + 0]];
-        Vertex& v1 = model.vertices[model.indices[i + 1]];
-        Vertex& v2 = model.vertices[model.indices[i + 2]];
-        
-        tri.v0 = HMM_Vec3(v0.pos[0], v0.pos[1], v0.pos[2]);
-        tri.v1 = HMM_Vec3(v1.pos[0], v1.pos[1], v1.pos[2]);
-        tri.v2 = HMM_Vec3(v2.pos[0], v2.pos[1], v2.pos[2]);
-        
-        hmm_vec3 edge1 = HMM_SubtractVec3(tri.v1, tri.v0);
-        hmm_vec3 edge2 = HMM_SubtractVec3(tri.v2, tri.v0);
-        tri.normal = HMM_NormalizeVec3(HMM_Cross(edge1, edge2));
-        
-        collider.triangles.push_back(tri);
-        
-        boundsMin = HMM_Vec3(
-            fminf(boundsMin.X, fminf(tri.v0.X, fminf(tri.v1.X, tri.v2.X))),
-            fminf(boundsMin.Y, fminf(tri.v0.Y, fminf(tri.v1.Y, tri.v2.Y))),
-            fminf(boundsMin.Z, fminf(tri.v0.Z, fminf(tri.v1.Z, tri.v2.Z)))
-        );
-        boundsMax = HMM_Vec3(
-            fmaxf(boundsMax.X, fmaxf(tri.v0.X, fmaxf(tri.v1.X, tri.v2.X))),
-            fmaxf(boundsMax.Y, fmaxf(tri.v0.Y, fmaxf(tri.v1.Y, tri.v2.Y))),
-            fmaxf(boundsMax.Z, fmaxf(tri.v0.Z, fmaxf(tri.v1.Z, tri.v2.Z)))
-        );
+    AddCollider(entity, collider);
+}
+
+void ECS::CreateHeightfieldCollider(EntityId entity, const Model3D& model, float cellSize) {
+    Heightfield heightfield;
+    if (!BuildHeightfieldFromModel(model, cellSize, heightfield)) {
+        printf("Heightfield collider skipped\n");
+        return;
+    }
+    AddHeightfieldCollider(entity, std::move(heightfield));
+}
+
+void ECS::CreateHeightfieldColliderFromImage(EntityId entity, const char* path, float cellSize, float heightScale) {
+    Heightfield heightfield;
+    if (!BuildHeightfieldFromImage(path, cellSize, heightScale, heightfield)) {
+        printf("Heightfield collider skipped\n");
+        return;
     }
+    AddHeightfieldCollider(entity, std::move(heightfield));
+}
+
+void ECS::AddHeightfieldCollider(EntityId entity, Heightfield&& heightfield) {
+    int columns = heightfield.columns, rows = heightfield.rows;
+    int handle = heightfields_.Add(std::move(heightfield));
+    const Heightfield* added = heightfields_.Get(handle);
     
-    collider.meshBoundsMin = boundsMin;
-    collider.meshBoundsMax = boundsMax;
+    Collider collider;
+    collider.type = ColliderType::Heightfield;
+    collider.isStatic = true;
+    collider.heightfieldHandle = handle;
+    collider.meshBoundsMin = added->boundsMin;
+    collider.meshBoundsMax = added->boundsMax;
     
     AddCollider(entity, collider);
-    
-    printf("Created mesh collider: %zu triangles, bounds: [%.1f, %.1f, %.1f] to [%.1f, %.1f, %.1f]\n",
-           collider.triangles.size(),
-           boundsMin.X, boundsMin.Y, boundsMin.Z,
-           boundsMax.X, boundsMax.Y, boundsMax.Z);
+    printf("Created heightfield collider: %d x %d samples, bounds: [%.1f, %.1f, %.1f] to [%.1f, %.1f, %.1f]\n",
+           columns, rows, added->boundsMin.X, added->boundsMin.Y, added->boundsMin.Z,
+           added->boundsMax.X, added->boundsMax.Y, added->boundsMax.Z);
 }
 
 bool ECS::RayTriangleIntersect(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir,
@@ -730,14 +2593,14 @@ bool ECS::RayTriangleIntersect(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir
     hmm_vec3 s = HMM_SubtractVec3(rayOrigin, tri.v0);
     float u = f * HMM_DotVec3(s, h);
     
-    if (u < 0.0f || u > 1.0f) {
+    if (u < -kRayEdgeTolerance || u > 1.0f + kRayEdgeTolerance) {
         return false;
     }
     
     hmm_vec3 q = HMM_Cross(s, edge1);
     float v = f * HMM_DotVec3(rayDir, q);
     
-    if (v < 0.0f || u + v > 1.0f) {
+    if (v < -kRayEdgeTolerance || u + v > 1.0f + kRayEdgeTolerance) {
         return false;
     }
     
@@ -758,52 +2621,169 @@ RaycastHit ECS::RayMeshIntersect(EntityId entity, const hmm_vec3& rayOrigin,
     hit.distance = maxDistance;
     
     Collider* collider = GetCollider(entity);
-    Transform* transform = GetTransform(entity);
+    const Transform* transform = PeekTransform(entity);
     
     if (!collider || collider->type != ColliderType::Mesh || !transform) {
         return hit;
     }
+    const CollisionMesh* mesh = collisionMeshes_.Get(collider->meshHandle);
+    if (!mesh || mesh->bvhNodes.empty()) {
+        return hit;
+    }
     
-    // NOTE: For now, assume mesh is not transformed (world space triangles)
-    // This works for static ground meshes at the origin
-    // For rotated/scaled meshes, we'd need proper matrix inverse
+    // The ray goes into mesh space instead of every triangle into world
+    // space. The direction is not renormalized, so t is the world distance.
+    hmm_mat4 modelMatrix = transform->CurrentMatrix();
+    hmm_mat4 inverseModel;
+    if (!InvertAffine(modelMatrix, &inverseModel)) {
+        return hit;
+    }
+    hmm_vec4 localOrigin4 = HMM_MultiplyMat4ByVec4(inverseModel, HMM_Vec4(rayOrigin.X, rayOrigin.Y, rayOrigin.Z, 1.0f));
+    hmm_vec4 localDir4 = HMM_MultiplyMat4ByVec4(inverseModel, HMM_Vec4(rayDir.X, rayDir.Y, rayDir.Z, 0.0f));
+    hmm_vec3 localOrigin = HMM_Vec3(localOrigin4.X, localOrigin4.Y, localOrigin4.Z);
+    hmm_vec3 localDir = HMM_Vec3(localDir4.X, localDir4.Y, localDir4.Z);
     
-    // Check all triangles (already in world space)
-    for (size_t i = 0; i < collider->triangles.size(); ++i) {
-        // Transform triangle vertices to world space
-        hmm_mat4 modelMatrix = transform->ModelMatrix();
-        
-        // Transform vertices
-        hmm_vec4 v0_4 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(collider->triangles[i].v0.X, collider->triangles[i].v0.Y, collider->triangles[i].v0.Z, 1.0f));
-        hmm_vec4 v1_4 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(collider->triangles[i].v1.X, collider->triangles[i].v1.Y, collider->triangles[i].v1.Z, 1.0f));
-        hmm_vec4 v2_4 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(collider->triangles[i].v2.X, collider->triangles[i].v2.Y, collider->triangles[i].v2.Z, 1.0f));
-        
-        CollisionTriangle worldTri;
-        worldTri.v0 = HMM_Vec3(v0_4.X, v0_4.Y, v0_4.Z);
-        worldTri.v1 = HMM_Vec3(v1_4.X, v1_4.Y, v1_4.Z);
-        worldTri.v2 = HMM_Vec3(v2_4.X, v2_4.Y, v2_4.Z);
+    float distance = maxDistance;
+    int triangleIndex = RayMeshBVH(mesh->bvhNodes.data(), mesh->bvhNodes.size(), mesh->triangles.data(),
+                                   mesh->trianglePackets.data(), localOrigin, localDir, &distance);
+    if (triangleIndex < 0) {
+        return hit;
+    }
+    
+    // Normal of the hit triangle in world space
+    const CollisionTriangle& tri = mesh->triangles[triangleIndex];
+    hmm_vec4 v0 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri.v0.X, tri.v0.Y, tri.v0.Z, 1.0f));
+    hmm_vec4 v1 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri.v1.X, tri.v1.Y, tri.v1.Z, 1.0f));
+    hmm_vec4 v2 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri.v2.X, tri.v2.Y, tri.v2.Z, 1.0f));
+    hmm_vec3 edge1 = HMM_Vec3(v1.X - v0.X, v1.Y - v0.Y, v1.Z - v0.Z);
+    hmm_vec3 edge2 = HMM_Vec3(v2.X - v0.X, v2.Y - v0.Y, v2.Z - v0.Z);
+    
+    hit.hit = true;
+    hit.entity = entity;
+    hit.distance = distance;
+    hit.triangleIndex = triangleIndex;
+    hit.normal = HMM_NormalizeVec3(HMM_Cross(edge1, edge2));
+    hit.point = HMM_AddVec3(rayOrigin, HMM_MultiplyVec3f(rayDir, distance));
+    
+    return hit;
+}
+
+// Same as RayMeshIntersect(), with the walk in RayHeightfield() instead of the BVH
+RaycastHit ECS::RayHeightfieldIntersect(EntityId entity, const hmm_vec3& rayOrigin,
+                                        const hmm_vec3& rayDir, float maxDistance) {
+    RaycastHit hit;
+    hit.distance = maxDistance;
+    
+    const Collider* collider = colliders_.Get(entity);
+    const Transform* transform = PeekTransform(entity);
+    if (!collider || collider->type != ColliderType::Heightfield || !transform) {
+        return hit;
+    }
+    const Heightfield* heightfield = heightfields_.Get(collider->heightfieldHandle);
+    if (!heightfield) {
+        return hit;
+    }
+    
+    hmm_mat4 modelMatrix = transform->CurrentMatrix();
+    hmm_mat4 inverseModel;
+    if (!InvertAffine(modelMatrix, &inverseModel)) {
+        return hit;
+    }
+    hmm_vec4 localOrigin4 = HMM_MultiplyMat4ByVec4(inverseModel, HMM_Vec4(rayOrigin.X, rayOrigin.Y, rayOrigin.Z, 1.0f));
+    hmm_vec4 localDir4 = HMM_MultiplyMat4ByVec4(inverseModel, HMM_Vec4(rayDir.X, rayDir.Y, rayDir.Z, 0.0f));
+    hmm_vec3 localOrigin = HMM_Vec3(localOrigin4.X, localOrigin4.Y, localOrigin4.Z);
+    hmm_vec3 localDir = HMM_Vec3(localDir4.X, localDir4.Y, localDir4.Z);
+    
+    float distance = maxDistance;
+    int triangleIndex = RayHeightfield(*heightfield, localOrigin, localDir, &distance);
+    if (triangleIndex < 0) {
+        return hit;
+    }
+    
+    // Normal of the hit triangle in world space
+    int cell = triangleIndex / 2;
+    hmm_vec3 triangles[2][3];
+    HeightfieldCellTriangles(*heightfield, cell % (heightfield->columns - 1), cell / (heightfield->columns - 1), triangles);
+    const hmm_vec3* tri = triangles[triangleIndex % 2];
+    hmm_vec4 v0 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri[0].X, tri[0].Y, tri[0].Z, 1.0f));
+    hmm_vec4 v1 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri[1].X, tri[1].Y, tri[1].Z, 1.0f));
+    hmm_vec4 v2 = HMM_MultiplyMat4ByVec4(modelMatrix, HMM_Vec4(tri[2].X, tri[2].Y, tri[2].Z, 1.0f));
+    hmm_vec3 edge1 = HMM_Vec3(v1.X - v0.X, v1.Y - v0.Y, v1.Z - v0.Z);
+    hmm_vec3 edge2 = HMM_Vec3(v2.X - v0.X, v2.Y - v0.Y, v2.Z - v0.Z);
+    
+    hit.hit = true;
+    hit.entity = entity;
+    hit.distance = distance;
+    hit.triangleIndex = triangleIndex;
+    hit.normal = HMM_NormalizeVec3(HMM_Cross(edge1, edge2));
+    hit.point = HMM_AddVec3(rayOrigin, HMM_MultiplyVec3f(rayDir, distance));
+    
+    return hit;
+}
+
+bool ECS::RaycastCollider(EntityId entityId, const Collider& collider, const Transform& transform,
+                          const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, RaycastHit& outHit) {
+    const Transform* t = &transform;
+    
+    switch (collider.type) {
+        case ColliderType::Plane: {
+            float denom = HMM_DotVec3(direction, collider.planeNormal);
+            if (fabsf(denom) > 0.0001f) {
+                float t_param = (collider.planeDistance - HMM_DotVec3(origin, collider.planeNormal)) / denom;
+                if (t_param >= 0.0f && t_param < maxDistance) {
+                    outHit.hit = true;
+                    outHit.entity = entityId;
+                    outHit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, t_param));
+                    outHit.normal = collider.planeNormal;
+                    outHit.distance = t_param;
+                    return true;
+                }
+            }
+            return false;
+        }
         
-        // Recalculate normal in world space
-        hmm_vec3 edge1 = HMM_SubtractVec3(worldTri.v1, worldTri.v0);
-        hmm_vec3 edge2 = HMM_SubtractVec3(worldTri.v2, worldTri.v0);
-        worldTri.normal = HMM_NormalizeVec3(HMM_Cross(edge1, edge2));
+        case ColliderType::Mesh: {
+            RaycastHit hit = RayMeshIntersect(entityId, origin, direction, maxDistance);
+            if (hit.hit && hit.distance < maxDistance) {
+                outHit = hit;
+                return true;
+            }
+            return false;
+        }
         
-        float dist;
-        hmm_vec3 point;
+        case ColliderType::Heightfield: {
+            RaycastHit hit = RayHeightfieldIntersect(entityId, origin, direction, maxDistance);
+            if (hit.hit && hit.distance < maxDistance) {
+                outHit = hit;
+                return true;
+            }
+            return false;
+        }
         
-        if (RayTriangleIntersect(rayOrigin, rayDir, worldTri, &dist, &point)) {
-            if (dist < hit.distance) {
-                hit.hit = true;
-                hit.entity = entity;
-                hit.distance = dist;
-                hit.triangleIndex = (int)i;
-                hit.normal = worldTri.normal;
-                hit.point = point;
+        case ColliderType::Sphere: {
+            hmm_vec3 oc = HMM_SubtractVec3(origin, t->GetWorldPosition());
+            float a = HMM_DotVec3(direction, direction);
+            float b = 2.0f * HMM_DotVec3(oc, direction);
+            float c = HMM_DotVec3(oc, oc) - collider.radius * collider.radius;
+            float discriminant = b * b - 4 * a * c;
+            
+            if (discriminant >= 0.0f) {
+                float t1 = (-b - sqrtf(discriminant)) / (2.0f * a);
+                if (t1 > 0.001f && t1 < maxDistance) {
+                    outHit.hit = true;
+                    outHit.entity = entityId;
+                    outHit.distance = t1;
+                    outHit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, t1));
+                    outHit.normal = HMM_NormalizeVec3(HMM_SubtractVec3(outHit.point, t->GetWorldPosition()));
+                    return true;
+                }
             }
+            return false;
         }
+        
+        default:
+            return false;
     }
-    
-    return hit;
 }
 
 RaycastHit ECS::RaycastPhysics(const hmm_vec3& origin, const hmm_vec3& direction, 
@@ -811,71 +2791,134 @@ RaycastHit ECS::RaycastPhysics(const hmm_vec3& origin, const hmm_vec3& direction
     RaycastHit closestHit;
     closestHit.distance = maxDistance;
     
-    for (const auto& [entityId, collider] : colliders_) {
-        // Layer filtering
-        if ((collider.collisionLayer & layerMask) == 0) {
-            continue;
-        }
-        
-        Transform* t = GetTransform(entityId);
-        if (!t) continue;
-        
-        RaycastHit hit;
+    // Only colliders whose bounds the ray passes through are tested
+    RefreshColliderIndex();
+    auto testCollider = [&](EntityId entityId, float) {
+        const Collider* collider = colliders_.Get(entityId);
+        const Transform* transform = transforms_.Get(entityId);
         
-        switch (collider.type) {
-            case ColliderType::Plane: {
-                float denom = HMM_DotVec3(direction, collider.planeNormal);
-                if (fabsf(denom) > 0.0001f) {
-                    float t_param = (collider.planeDistance - HMM_DotVec3(origin, collider.planeNormal)) / denom;
-                    if (t_param >= 0.0f && t_param < closestHit.distance) {
-                        hit.hit = true;
-                        hit.entity = entityId;
-                        hit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, t_param));
-                        hit.normal = collider.planeNormal;
-                        hit.distance = t_param;
-                        closestHit = hit;
-                    }
-                }
-                break;
-            }
-            
-            case ColliderType::Mesh: {
-                hit = RayMeshIntersect(entityId, origin, direction, closestHit.distance);
-                if (hit.hit && hit.distance < closestHit.distance) {
-                    closestHit = hit;
-                }
-                break;
-            }
-            
-            case ColliderType::Sphere: {
-                hmm_vec3 oc = HMM_SubtractVec3(origin, t->GetWorldPosition());
-                float a = HMM_DotVec3(direction, direction);
-                float b = 2.0f * HMM_DotVec3(oc, direction);
-                float c = HMM_DotVec3(oc, oc) - collider.radius * collider.radius;
-                float discriminant = b * b - 4 * a * c;
-                
-                if (discriminant >= 0.0f) {
-                    float t1 = (-b - sqrtf(discriminant)) / (2.0f * a);
-                    if (t1 > 0.001f && t1 < closestHit.distance) {
-                        hit.hit = true;
-                        hit.entity = entityId;
-                        hit.distance = t1;
-                        hit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, t1));
-                        hit.normal = HMM_NormalizeVec3(HMM_SubtractVec3(hit.point, t->GetWorldPosition()));
-                        closestHit = hit;
-                    }
-                }
-                break;
+        // Layer filtering
+        if (collider && transform && (collider->collisionLayer & layerMask) != 0) {
+            RaycastHit hit;
+            if (RaycastCollider(entityId, *collider, *transform, origin, direction, closestHit.distance, hit)) {
+                closestHit = hit;
             }
-            
-            default:
-                break;
         }
-    }
+        return closestHit.distance;
+    };
+    colliderIndex_.RayCast(origin, direction, maxDistance, testCollider);
+    hashGrid_.RayCast(origin, direction, closestHit.distance, testCollider);
     
     return closestHit;
 }
 
+// Spreads the low 9 bits of v out to every third bit (Morton interleave)
+static uint32_t SpreadBits3(uint32_t v) {
+    v &= 0x1FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+void ECS::RaycastBatch(std::span<const Ray> rays, std::span<RaycastHit> outHits, uint32_t layerMask) {
+    const size_t count = rays.size() < outHits.size() ? rays.size() : outHits.size();
+    if (count == 0) return;
+    
+    // Brought up to date here: the packets only read it, from any thread
+    RefreshColliderIndex();
+    
+    // Coherence order: direction octant first (rays in a packet then cross
+    // node slabs the same way round), then the origin's Morton code on a
+    // 512^3 grid over the batch, so neighbouring rays share packets
+    hmm_vec3 lo = rays[0].origin;
+    hmm_vec3 hi = lo;
+    for (size_t i = 1; i < count; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            lo.Elements[axis] = fminf(lo.Elements[axis], rays[i].origin.Elements[axis]);
+            hi.Elements[axis] = fmaxf(hi.Elements[axis], rays[i].origin.Elements[axis]);
+        }
+    }
+    float scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = hi.Elements[axis] - lo.Elements[axis];
+        scale[axis] = extent > 0.0f ? 511.0f / extent : 0.0f;
+    }
+    rayBatchOrder_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Ray& ray = rays[i];
+        uint32_t octant = (ray.direction.X < 0.0f) | (ray.direction.Y < 0.0f) << 1 | (ray.direction.Z < 0.0f) << 2;
+        uint32_t morton = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            uint32_t cell = (uint32_t)((ray.origin.Elements[axis] - lo.Elements[axis]) * scale[axis]);
+            morton |= SpreadBits3(cell) << axis;
+        }
+        rayBatchOrder_[i] = (uint64_t)(octant << 27 | morton) << 32 | i;
+    }
+    std::sort(rayBatchOrder_.begin(), rayBatchOrder_.end());
+    
+    constexpr int kPacket = kRayPacketWidth;
+    const size_t packets = (count + kPacket - 1) / kPacket;
+    auto tracePackets = [&](size_t begin, size_t end) {
+        for (size_t packet = begin; packet < end; ++packet) {
+            size_t first = packet * kPacket;
+            int lanes = count - first < (size_t)kPacket ? (int)(count - first) : kPacket;
+            RaycastRayPacket(rays, &rayBatchOrder_[first], lanes, outHits, layerMask);
+        }
+    };
+    if (jobs_ && count >= kRaycastBatchParallelMin) {
+        jobs_->ParallelFor(packets, kRaycastBatchParallelMin / kPacket, tracePackets);
+    } else {
+        tracePackets(0, packets);
+    }
+}
+
+void ECS::RaycastRayPacket(std::span<const Ray> rays, const uint64_t* order, int count,
+                           std::span<RaycastHit> outHits, uint32_t layerMask) {
+    constexpr int kPacket = kRayPacketWidth;
+    const Ray* lanes[kPacket];
+    RaycastHit closestHits[kPacket];
+    RayPacket packet;
+    for (int lane = 0; lane < count; ++lane) {
+        lanes[lane] = &rays[(uint32_t)order[lane]];
+        packet.Set(lane, lanes[lane]->origin, lanes[lane]->direction, lanes[lane]->maxDistance);
+        closestHits[lane].distance = lanes[lane]->maxDistance;
+    }
+    
+    // As in RaycastPhysics(), lane by lane: a hit shortens only its own ray
+    auto testLane = [&](EntityId entityId, const Collider& collider, const Transform& transform, int lane) {
+        RaycastHit hit;
+        if (RaycastCollider(entityId, collider, transform, lanes[lane]->origin, lanes[lane]->direction,
+                            closestHits[lane].distance, hit)) {
+            closestHits[lane] = hit;
+        }
+        return closestHits[lane].distance;
+    };
+    colliderIndex_.RayCastPacket(packet, [&](EntityId entityId, uint32_t laneMask) {
+        const Collider* collider = colliders_.Get(entityId);
+        const Transform* transform = transforms_.Get(entityId);
+        if (!collider || !transform || (collider->collisionLayer & layerMask) == 0) return;
+        for (int lane = 0; lane < count; ++lane) {
+            if ((laneMask >> lane) & 1) packet.maxDistance[lane] = testLane(entityId, *collider, *transform, lane);
+        }
+    });
+    
+    // The hash grid is walked cell by cell, which doesn't share across rays
+    for (int lane = 0; lane < count; ++lane) {
+        hashGrid_.RayCast(lanes[lane]->origin, lanes[lane]->direction, closestHits[lane].distance,
+                          [&](EntityId entityId, float) {
+            const Collider* collider = colliders_.Get(entityId);
+            const Transform* transform = transforms_.Get(entityId);
+            if (!collider || !transform || (collider->collisionLayer & layerMask) == 0) {
+                return closestHits[lane].distance;
+            }
+            return testLane(entityId, *collider, *transform, lane);
+        });
+        outHits[(uint32_t)order[lane]] = closestHits[lane];
+    }
+}
+
 // Add this helper function before RaycastSelectionNew
 bool ECS::RayBoxIntersect(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir,
                           const hmm_vec3& boxMin, const hmm_vec3& boxMax,
@@ -918,11 +2961,52 @@ RaycastHit ECS::RaycastSelectionNew(const hmm_vec3& origin, const hmm_vec3& dire
     RaycastHit closestHit;
     closestHit.distance = maxDistance;
     
-    for (const auto& [entityId, selectable] : selectables_) {
-        if (!selectable.canBeSelected) continue;
+    // Box volumes are collected and tested eight at a time
+    BoxPacket boxes;
+    EntityId boxEntities[kRayPacketWidth];
+    int boxCount = 0;
+    auto flushBoxes = [&]() {
+        float distances[kRayPacketWidth];
+        uint32_t hits = RayBoxPacket(boxes, origin, direction, (1u << boxCount) - 1, distances);
+        for (int lane = 0; lane < boxCount; ++lane) {
+            float dist = distances[lane];
+            if (!((hits >> lane) & 1) || dist <= 0.001f || dist >= closestHit.distance) continue;
+            
+            const Transform* t = transforms_.Get(boxEntities[lane]);
+            const Selectable& selectable = *selectables_.Get(boxEntities[lane]);
+            RaycastHit hit;
+            hit.hit = true;
+            hit.entity = boxEntities[lane];
+            hit.distance = dist;
+            hit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, dist));
+            
+            // Calculate normal based on which face was hit
+            hmm_vec3 localPoint = HMM_SubtractVec3(hit.point, t->position);
+            hmm_vec3 center = HMM_MultiplyVec3f(HMM_AddVec3(selectable.boundingBoxMin, selectable.boundingBoxMax), 0.5f);
+            hmm_vec3 toPoint = HMM_SubtractVec3(localPoint, center);
+            
+            // Determine which axis has the largest component (which face)
+            float absX = fabsf(toPoint.X);
+            float absY = fabsf(toPoint.Y);
+            float absZ = fabsf(toPoint.Z);
+            
+            if (absX > absY && absX > absZ) {
+                hit.normal = HMM_Vec3(toPoint.X > 0 ? 1.0f : -1.0f, 0.0f, 0.0f);
+            } else if (absY > absZ) {
+                hit.normal = HMM_Vec3(0.0f, toPoint.Y > 0 ? 1.0f : -1.0f, 0.0f);
+            } else {
+                hit.normal = HMM_Vec3(0.0f, 0.0f, toPoint.Z > 0 ? 1.0f : -1.0f);
+            }
+            
+            closestHit = hit;
+        }
+        boxCount = 0;
+    };
+    
+    auto testSelectable = [&](EntityId entityId, Selectable& selectable, Transform& transform) {
+        if (!selectable.canBeSelected) return;
         
-        Transform* t = GetTransform(entityId);
-        if (!t) continue;
+        Transform* t = &transform;
         
         RaycastHit hit;
         
@@ -949,46 +3033,20 @@ RaycastHit ECS::RaycastSelectionNew(const hmm_vec3& origin, const hmm_vec3& dire
             }
             
             case SelectionVolumeType::Box: {
-                // ADDED: Box selection volume support
-                // Transform box bounds to world space
-                hmm_vec3 worldMin = HMM_AddVec3(t->position, selectable.boundingBoxMin);
-                hmm_vec3 worldMax = HMM_AddVec3(t->position, selectable.boundingBoxMax);
-                
-                float dist;
-                if (RayBoxIntersect(origin, direction, worldMin, worldMax, &dist)) {
-                    if (dist > 0.001f && dist < closestHit.distance) {
-                        hit.hit = true;
-                        hit.entity = entityId;
-                        hit.distance = dist;
-                        hit.point = HMM_AddVec3(origin, HMM_MultiplyVec3f(direction, dist));
-                        
-                        // Calculate normal based on which face was hit
-                        hmm_vec3 localPoint = HMM_SubtractVec3(hit.point, t->position);
-                        hmm_vec3 center = HMM_MultiplyVec3f(HMM_AddVec3(selectable.boundingBoxMin, selectable.boundingBoxMax), 0.5f);
-                        hmm_vec3 toPoint = HMM_SubtractVec3(localPoint, center);
-                        
-                        // Determine which axis has the largest component (which face)
-                        float absX = fabsf(toPoint.X);
-                        float absY = fabsf(toPoint.Y);
-                        float absZ = fabsf(toPoint.Z);
-                        
-                        if (absX > absY && absX > absZ) {
-                            hit.normal = HMM_Vec3(toPoint.X > 0 ? 1.0f : -1.0f, 0.0f, 0.0f);
-                        } else if (absY > absZ) {
-                            hit.normal = HMM_Vec3(0.0f, toPoint.Y > 0 ? 1.0f : -1.0f, 0.0f);
-                        } else {
-                            hit.normal = HMM_Vec3(0.0f, 0.0f, toPoint.Z > 0 ? 1.0f : -1.0f);
-                        }
-                        
-                        closestHit = hit;
-                    }
-                }
+                // Tested in packets, see flushBoxes
+                boxes.Set(boxCount, HMM_AddVec3(t->position, selectable.boundingBoxMin),
+                          HMM_AddVec3(t->position, selectable.boundingBoxMax));
+                boxEntities[boxCount++] = entityId;
+                if (boxCount == kRayPacketWidth) flushBoxes();
                 break;
             }
             
             case SelectionVolumeType::Mesh: {
                 if (selectable.useMeshColliderForPicking) {
-                    hit = RayMeshIntersect(entityId, origin, direction, closestHit.distance);
+                    const Collider* collider = colliders_.Get(entityId);
+                    hit = collider && collider->type == ColliderType::Heightfield
+                              ? RayHeightfieldIntersect(entityId, origin, direction, closestHit.distance)
+                              : RayMeshIntersect(entityId, origin, direction, closestHit.distance);
                     if (hit.hit && hit.distance < closestHit.distance) {
                         closestHit = hit;
                     }
@@ -999,7 +3057,17 @@ RaycastHit ECS::RaycastSelectionNew(const hmm_vec3& origin, const hmm_vec3& dire
             default:
                 break;
         }
-    }
+    };
+    
+    // Only volumes whose bounds the ray passes through are tested
+    RefreshSelectableIndex();
+    selectableIndex_.RayCast(origin, direction, maxDistance, [&](EntityId entityId, float) {
+        Selectable* selectable = selectables_.Get(entityId);
+        Transform* transform = transforms_.Get(entityId);
+        if (selectable && transform) testSelectable(entityId, *selectable, *transform);
+        return closestHit.distance;
+    });
+    if (boxCount > 0) flushBoxes();
     
     return closestHit;
 }
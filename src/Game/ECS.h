@@ -3,12 +3,26 @@
 #include "../../External/HandmadeMath.h"
 #include "../Renderer/Renderer.h"
 #include "Components.h"
+#include "ComponentPool.h"
+#include "ComponentView.h"
+#include "CommandBuffer.h"
+#include "TransformBatch.h"
+#include "SweepAndPrune.h"
+#include "SpatialIndex.h"
+#include "SpatialHashGrid.h"
+#include "CollisionMeshes.h"
+#include "Heightfield.h"
+#include "Narrowphase.h"
 #include "../../include/Model.h"
-#include <unordered_map>
+#include "../Utilities/JobSystem.h"
 #include <vector>
+#include <deque>
 #include <optional>
-
-using EntityId = int;
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <type_traits>
+#include <utility>
 
 // ============================================================================
 // RAYCAST HIT RESULT - Declared BEFORE ECS class
@@ -22,15 +36,29 @@ struct RaycastHit {
     int triangleIndex = -1;
 };
 
-// ============================================================================
-// COLLISION INFO - Declared BEFORE ECS class
-// ============================================================================
-struct CollisionInfo {
-    EntityId entityA;
-    EntityId entityB;
-    hmm_vec3 normal;
-    float penetration;
-    hmm_vec3 contactPoint;
+// One ray of ECS::RaycastBatch()
+struct Ray {
+    hmm_vec3 origin{0.0f, 0.0f, 0.0f};
+    hmm_vec3 direction{0.0f, 0.0f, 1.0f};
+    float maxDistance = 1000.0f;
+};
+
+// Upright capsule (a segment of `height` along Y, `radius` round it) moved from start by motion
+struct CapsuleSweep {
+    hmm_vec3 start{0.0f, 0.0f, 0.0f};
+    hmm_vec3 motion{0.0f, 0.0f, 0.0f};
+    float height = 1.0f;
+    float radius = 0.5f;
+    EntityId ignore = -1;  // Usually the swept character's own collider
+};
+
+struct CapsuleSweepHit {
+    bool hit = false;
+    EntityId entity = -1;
+    float fraction = 1.0f;                 // Of the motion covered when it touches
+    hmm_vec3 position{0.0f, 0.0f, 0.0f};   // Capsule centre there (or at the end of a miss)
+    hmm_vec3 normal{0.0f, 1.0f, 0.0f};     // From the hit collider towards the capsule
+    hmm_vec3 point{0.0f, 0.0f, 0.0f};      // Contact point
 };
 
 // ============================================================================
@@ -41,14 +69,22 @@ public:
     ECS();
     ~ECS();
 
-    // Entity lifecycle
+    // Entity lifecycle (O(1), slots are recycled with a new generation)
     EntityId CreateEntity();
     void DestroyEntity(EntityId id);
+    bool IsAlive(EntityId id) const;
 
     // Components
     void AddTransform(EntityId id, const Transform& t);
     bool HasTransform(EntityId id) const;
-    Transform* GetTransform(EntityId id);
+    Transform* GetTransform(EntityId id);            // Marks the transform dirty
+    const Transform* PeekTransform(EntityId id) const; // Read-only, leaves it clean
+    hmm_vec3 GetWorldPosition(EntityId id) const;      // Includes parent transforms
+
+    // A child's Transform is relative to its parent; entities with a Collider or Selectable can't be parented
+    void SetParent(EntityId child, EntityId parent);   // parent = -1 detaches
+    void RemoveParent(EntityId child);
+    EntityId GetParent(EntityId child) const;
 
     void AddRigidbody(EntityId id, const Rigidbody& rb);
     Rigidbody* GetRigidbody(EntityId id);
@@ -62,6 +98,9 @@ public:
 
     void AddAnimator(EntityId id, const Animator& a);
     Animator* GetAnimator(EntityId id);
+
+    void AddCharacter(EntityId id, const CharacterController& character);
+    CharacterController* GetCharacter(EntityId id);
     
     void AddBillboard(EntityId id, const Billboard& b);
     Billboard* GetBillboard(EntityId id);
@@ -79,6 +118,64 @@ public:
     Selectable* GetSelectable(EntityId id);
     bool HasSelectable(EntityId id) const;
 
+    // Typed queries over entities that have all of Ts:
+    //   ecs.View<Transform, Rigidbody>().Each([](EntityId id, Transform& t, Rigidbody& rb) { ... });
+    template <typename... Ts>
+    ComponentView<Ts...> View() { return ComponentView<Ts...>(Storage<Ts>()...); }
+
+    template <typename... Ts, typename Func>
+    void Each(Func&& func) { View<Ts...>().Each(std::forward<Func>(func)); }
+
+    // Each() split across the job system; func must only touch the entity it is given
+    template <typename... Ts, typename Func>
+    void ParallelEach(Func&& func, size_t minChunkSize = kParallelChunkSize) {
+        ComponentView<Ts...> view = View<Ts...>();
+        if (!jobs_) {
+            view.Each(func);
+            return;
+        }
+        jobs_->ParallelFor(view.SizeHint(), minChunkSize, [&](size_t begin, size_t end) {
+            view.EachInRange(begin, end, func);
+        });
+    }
+
+    // Job system used by ParallelEach (nullptr = run everything inline)
+    void SetJobSystem(JobSystem* jobs);
+    JobSystem* GetJobSystem() const { return jobs_; }
+
+    // Deferred structural changes, played back on the main thread at the sync point in frame()
+    CommandBuffer& Commands();
+    void PlaybackCommands(Renderer& renderer);
+
+    // Change tracking: ForEachChange<T>() visits what was added, changed or removed since the cursor
+    template <typename T>
+    uint64_t ChangeCursor() {
+        if constexpr (std::is_same_v<T, Transform>) FlushTransformChanges();
+        return Storage<T>().ChangeCursor();
+    }
+
+    template <typename T, typename Func>
+    bool ForEachChange(uint64_t& cursor, Func&& func) {
+        if constexpr (std::is_same_v<T, Transform>) FlushTransformChanges();
+        return Storage<T>().ForEachChange(cursor, func);
+    }
+
+    template <typename T>
+    void MarkChanged(EntityId id) {
+        if constexpr (std::is_same_v<T, Transform>) MarkTransformDirty(id);
+        else Storage<T>().MarkChanged(id);
+    }
+
+    void MarkTransformDirty(EntityId id);
+    void FlushTransformChanges();  // Main thread, outside parallel systems
+
+    // Advances the change-tracking frame and trims old history (end of frame())
+    void EndFrame();
+
+    // Raw pool access for a component type (specialized below the class)
+    template <typename T>
+    ComponentPool<T>& Storage();
+
     // Rendering linkage
     int AddRenderable(EntityId id, int meshId, Renderer& renderer);
     bool HasRenderable(EntityId id) const;
@@ -95,6 +192,95 @@ public:
     void UpdateCollisions(float dt);
     bool CheckCollision(EntityId a, EntityId b, CollisionInfo* outInfo = nullptr);
 
+    // Sleeping: islands of bodies slower than kSleepSpeed for kTimeToSleep sleep and wake together
+    static constexpr float kSleepSpeed = 0.1f;
+    static constexpr float kTimeToSleep = 0.5f;
+    void WakeBody(EntityId id);
+    void ApplyImpulse(EntityId id, const hmm_vec3& impulse);
+    bool IsSleeping(EntityId id) const;
+    void SetSleepingEnabled(bool enabled);  // Off wakes everything
+    bool IsSleepingEnabled() const { return sleepingEnabled_; }
+
+    struct SleepStats {
+        int awake = 0;            // Dynamic bodies simulated last step
+        int sleeping = 0;
+        int islands = 0;          // Awake islands
+        int sleepingIslands = 0;
+    };
+    const SleepStats& GetSleepStats() const { return sleepStats_; }
+
+    // Contact solver: warm-started sequential impulses, then position passes for the penetration
+    static constexpr int kDefaultSolverIterations = 8;
+    static constexpr float kSolverTolerance = 0.001f;  // m/s
+    void SetSolverIterations(int iterations);
+    int GetSolverIterations() const { return solverIterations_; }
+    void SetWarmStarting(bool enabled) { warmStarting_ = enabled; }
+    bool IsWarmStarting() const { return warmStarting_; }
+
+    struct ContactSolverStats {
+        int contacts = 0;
+        int warmStarted = 0;  // Contacts that started from cached impulses
+        int iterations = 0;   // Velocity iterations run last step
+        float solveMs = 0.0f;
+    };
+    const ContactSolverStats& GetContactSolverStats() const { return solverStats_; }
+
+    // Continuous collision: fast Rigidbody::continuousCollision bodies move in substeps and stop at impact
+    static constexpr int kMaxSweepSubsteps = 128;
+    static constexpr int kSweepBisections = 5;
+
+    struct ContinuousStats {
+        int swept = 0;     // Bodies moved in substeps last step
+        int hits = 0;      // Of those, stopped at a time of impact
+        int substeps = 0;
+    };
+    const ContinuousStats& GetContinuousStats() const { return continuousStats_; }
+
+    // Character controllers: UpdateCharacters() sweeps each one through the scene (step up, slide, snap down)
+    static constexpr int kMaxSlideIterations = 4;
+    void UpdateCharacters(float dt);
+
+    struct CharacterStats {
+        int characters = 0;  // Moved last step
+        int grounded = 0;
+        int sweeps = 0;
+        float moveMs = 0.0f;
+    };
+    const CharacterStats& GetCharacterStats() const { return characterStats_; }
+
+    // First collider an upright capsule touches on its way, filtered by collision layer
+    CapsuleSweepHit SweepCapsule(const CapsuleSweep& sweep, uint32_t layerMask = 0xFFFFFFFF);
+    void SweepCapsuleBatch(std::span<const CapsuleSweep> sweeps, std::span<CapsuleSweepHit> outHits,
+                           uint32_t layerMask = 0xFFFFFFFF);
+    static constexpr size_t kSweepBatchParallelMin = 64;
+
+    // Narrowphase tests and touching pairs last UpdateCollisions(), by the two ColliderTypes
+    struct NarrowphaseStats {
+        int tests[kColliderTypeCount][kColliderTypeCount] = {};
+        int contacts[kColliderTypeCount][kColliderTypeCount] = {};
+    };
+    const NarrowphaseStats& GetNarrowphaseStats() const { return narrowphaseStats_; }
+
+    // Pair finder used by UpdateCollisions(); the AABB tree is kept for queries either way
+    enum class BroadphaseMode : uint8_t { AABBTree, SweepAndPrune };
+    void SetBroadphaseMode(BroadphaseMode mode);
+    BroadphaseMode GetBroadphaseMode() const { return broadphaseMode_; }
+    const SweepAndPrune::Stats& GetBroadphaseStats() const { return broadphase_.GetStats(); }
+    SpatialIndex::Stats GetColliderIndexStats() const { return colliderIndex_.GetStats(); }
+
+    // Collision layers kept in a spatial hash grid instead of the pair finder (0 = off, see SpatialHashGrid.h)
+    void SetHashGridLayers(uint32_t layers);
+    uint32_t GetHashGridLayers() const { return hashGridLayers_; }
+    void SetHashGridCellSize(float cellSize);
+    float GetHashGridCellSize() const { return hashGrid_.GetCellSize(); }
+    const SpatialHashGrid::Stats& GetHashGridStats() const { return hashGrid_.GetStats(); }
+
+    // Colliders whose bounds overlap the box / sphere, filtered by collision layer
+    void QueryColliders(const hmm_vec3& min, const hmm_vec3& max, std::vector<EntityId>& outEntities,
+                        uint32_t layerMask = 0xFFFFFFFF);
+    void QueryCollidersSphere(const hmm_vec3& center, float radius, std::vector<EntityId>& outEntities,
+                              uint32_t layerMask = 0xFFFFFFFF);
+
     // ========================================================================
     // NEW RAYCAST SYSTEM
     // ========================================================================
@@ -103,6 +289,11 @@ public:
     RaycastHit RaycastPhysics(const hmm_vec3& origin, const hmm_vec3& direction, 
                               float maxDistance = 1000.0f, uint32_t layerMask = 0xFFFFFFFF);
     
+    // Many physics raycasts at once; outHits[i] is exactly what RaycastPhysics(rays[i]) returns
+    void RaycastBatch(std::span<const Ray> rays, std::span<RaycastHit> outHits,
+                      uint32_t layerMask = 0xFFFFFFFF);
+    static constexpr size_t kRaycastBatchParallelMin = 256;
+    
     // Selection raycast (checks selectables) - NEW VERSION
     RaycastHit RaycastSelectionNew(const hmm_vec3& origin, const hmm_vec3& direction,
                                    float maxDistance = 1000.0f);
@@ -121,6 +312,11 @@ public:
     // Create plane collider (infinite ground)
     void CreatePlaneCollider(EntityId entity, const hmm_vec3& normal, float distance);
     
+    // Create heightfield collider (large terrain, see Heightfield.h) from a model, a heightmap or a built field
+    void CreateHeightfieldCollider(EntityId entity, const Model3D& model, float cellSize);
+    void CreateHeightfieldColliderFromImage(EntityId entity, const char* path, float cellSize, float heightScale);
+    void AddHeightfieldCollider(EntityId entity, Heightfield&& heightfield);
+    
     // ========================================================================
     // LEGACY COMPATIBILITY (kept for existing code)
     // ========================================================================
@@ -128,39 +324,294 @@ public:
     EntityId RaycastSelection(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir, float maxDistance = 1000.0f);
     hmm_vec3 GetPlacementPosition(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir, float distance = 10.0f);
 
-    // Sync transforms to renderer
+    // Sync transforms to renderer (only dirty transforms are recomputed)
     void SyncToRenderer(Renderer& renderer);
+    
+    // Counters from the last SyncToRenderer() call
+    struct TransformSyncStats {
+        int recomputed = 0;  // World matrices rebuilt
+        int total = 0;       // Transforms visited
+        int hierarchyDepth = 0;
+        int interpolated = 0;  // Bodies drawn between physics states
+    };
+    const TransformSyncStats& GetTransformSyncStats() const { return syncStats_; }
+    
+    // Render interpolation: SyncToRenderer() draws bodies at lerp(before, after, alpha) of the last step (1 = off)
+    void BeginPhysicsStep();
+    void EndPhysicsStep();
+    void SetInterpolationAlpha(float alpha);
+    float GetInterpolationAlpha() const { return interpolationAlpha_; }
+    
+    // Deterministic mode for recordings: bit-identical results whatever the thread count (fixed dt)
+    void SetDeterministic(bool enabled);
+    bool IsDeterministic() const { return deterministic_; }
+    
+    // The AI's random numbers (wander timers and targets)
+    void SeedRandom(uint32_t seed);
+    
+    // Forgets cached impulses, index tree shapes and pending changes, as loading a snapshot would
+    void ResetSimulationCaches();
+    
+    // Hash of the simulated state: bodies, AI and characters in pool order
+    uint64_t SimulationHash() const;
+    
     std::vector<EntityId> GetScreenSpaceEntities() const;
     std::vector<EntityId> AllEntities() const;
 
-    const std::unordered_map<EntityId, Light>& GetLights() const { return lights_; }
-    const std::unordered_map<EntityId, Transform>& GetTransforms() const { return transforms_; }
-    const std::unordered_map<EntityId, Selectable>& GetSelectables() const { return selectables_; }
-    const std::unordered_map<EntityId, Collider>& GetColliders() const { return colliders_; }
-    const std::unordered_map<EntityId, Rigidbody>& GetRigidbodies() const { return rigidbodies_; } // ADDED
+    const ComponentPool<Light>& GetLights() const { return lights_; }
+    const ComponentPool<Transform>& GetTransforms() const { return transforms_; }
+    const ComponentPool<Selectable>& GetSelectables() const { return selectables_; }
+    const ComponentPool<Collider>& GetColliders() const { return colliders_; }
+    const ComponentPool<Rigidbody>& GetRigidbodies() const { return rigidbodies_; } // ADDED
+    const CollisionMeshRegistry& GetCollisionMeshes() const { return collisionMeshes_; }
+    const HeightfieldRegistry& GetHeightfields() const { return heightfields_; }
 
 private:
-    EntityId nextId_ = 1;
+    friend class SceneSnapshot;
+
+    static constexpr uint32_t kDeadSlot = 0xFFFFFFFFu;
+    static constexpr size_t kParallelChunkSize = 1024;
+
+    JobSystem* jobs_ = nullptr;
+    TransformSyncStats syncStats_;
+    bool deterministic_ = false;
+    
+    // UpdateAI() only, which runs on one thread
+    static constexpr uint32_t kDefaultRandomSeed = 1;
+    std::minstd_rand aiRandom_{kDefaultRandomSeed};
+    float RandomFloat() { return (float)(aiRandom_() - std::minstd_rand::min()) / (float)(std::minstd_rand::max() - std::minstd_rand::min()); }
+
+    // Parented entities sorted parent-first, one range of hierarchyOrder_ per depth
+    std::vector<EntityId> hierarchyOrder_;
+    std::vector<size_t> hierarchyLevelStart_;
+    std::vector<int> hierarchyDepthScratch_;
+    std::vector<uint32_t> childCount_;  // Per entity slot
+    bool hierarchyDirty_ = false;
+    void RebuildHierarchyOrder();
+
+    // One command buffer, dirty-transform list and swept-body list per job thread (0 = main)
+    std::vector<CommandBuffer> commandBuffers_;
+    std::vector<std::vector<EntityId>> dirtyTransforms_;
+    std::vector<std::vector<EntityId>> sweptBodies_;
+    std::vector<EntityId> syncQueue_;  // Flushed dirty transforms awaiting SyncToRenderer
+    void EnsureThreadSlots();
+
+    // Sets the dirty flag and queues the entity once until the next sync (one writer per entity)
+    void TouchTransform(EntityId id, Transform& t) {
+        if (t.dirty) return;
+        t.dirty = true;
+        unsigned index = jobs_ ? jobs_->CurrentThreadIndex() : 0;
+        dirtyTransforms_[index < dirtyTransforms_.size() ? index : 0].push_back(id);
+    }
+
+    static constexpr uint32_t kChangeHistoryFrames = 2;
+    uint32_t frame_ = 0;
+
+    template <typename Func>
+    void ForEachPool(Func&& func) {
+        func(transforms_); func(rigidbodies_); func(colliders_); func(ai_controllers_);
+        func(animators_); func(characters_); func(billboards_); func(screen_spaces_); func(lights_);
+        func(selectables_); func(renderables_); func(parents_);
+    }
+    void ReserveEntities(size_t count);
+    template <typename T> void PlaybackComponentAdds();
+    template <typename T> void PlaybackComponentRemoves();
+
+    // Collision broadphase: sweep and prune over colliders with useBroadPhase (except planes)
+    SweepAndPrune broadphase_;
+    std::vector<BroadphasePair> broadphasePairs_;
+    BroadphaseMode broadphaseMode_ = BroadphaseMode::AABBTree;
+    void FindCollisionPairs();
+
+    // Hash grid for hashGridLayers_, rebuilt by FindCollisionPairs()
+    SpatialHashGrid hashGrid_;
+    uint32_t hashGridLayers_ = 0;
+    std::vector<BroadphaseProxy> hashGridProxies_;
+    std::vector<EntityId> hashGridMembers_;  // Entity in the grid, per entity slot
+    bool FitsHashGrid(const Collider& collider, const Transform& transform) const;
+    bool InHashGrid(EntityId id) const {
+        uint32_t slot = EntityIndex(id);
+        return slot < hashGridMembers_.size() && hashGridMembers_[slot] == id;
+    }
+    void RebuildHashGrid();
+
+    // Spatial indexes over collider bounds and selection volumes, kept up to date from the change logs
+    struct IndexCursors {
+        uint64_t transforms = 0;
+        uint64_t colliders = 0;
+        uint64_t selectables = 0;
+        bool valid = false;
+    };
+    static constexpr float kColliderIndexMargin = 0.2f;
+    SpatialIndex colliderIndex_{kColliderIndexMargin};
+    SpatialIndex selectableIndex_{kColliderIndexMargin};
+    IndexCursors colliderIndexCursors_;
+    IndexCursors selectableIndexCursors_;
+
+    // Triangle data shared by mesh colliders (Collider::meshHandle)
+    CollisionMeshRegistry collisionMeshes_;
+    // Height grids shared by heightfield colliders (Collider::heightfieldHandle)
+    HeightfieldRegistry heightfields_;
+    std::vector<EntityId> indexChanges_;
+    void RefreshColliderIndex();
+    void RefreshSelectableIndex();
+    void UpdateColliderProxy(EntityId id);
+    void UpdateSelectableProxy(EntityId id);
+
+    // SyncToRenderer scratch: dirty transforms gathered for the batch kernel
+    TransformBatch syncBatch_;
+    std::vector<Transform*> syncTransforms_;
+    std::vector<int> syncInstances_;
+    std::vector<hmm_mat4> syncMatrices_;
+
+    // Rigidbodies that moved in the last physics step, positions before and after it
+    struct InterpolatedBody {
+        EntityId id;
+        hmm_vec3 previous;
+        hmm_vec3 current;
+    };
+    std::vector<InterpolatedBody> interpolatedBodies_;
+    float interpolationAlpha_ = 1.0f;
+    void RestoreInterpolatedBodies();
+    void UploadInterpolatedBodies(Renderer& renderer);
+
+    // Sleeping islands; sleepSlots_ maps an entity slot to its island while it sleeps
+    struct SleepIsland {
+        std::vector<EntityId> bodies;
+        std::vector<hmm_vec3> positions;  // Where they fell asleep (checked when change history is lost)
+    };
+    struct SleepSlot {
+        EntityId entity = -1;
+        int island = -1;
+    };
+    struct SleepCursors {
+        uint64_t transforms = 0;
+        uint64_t rigidbodies = 0;
+        uint64_t colliders = 0;
+        bool valid = false;
+    };
+    std::vector<SleepIsland> sleepIslands_;
+    std::vector<int> freeSleepIslands_;
+    std::vector<SleepSlot> sleepSlots_;
+    SleepCursors sleepCursors_;
+    bool sleepingEnabled_ = true;
+    SleepStats sleepStats_;
+    // UpdateSleep() scratch: broadphase pairs, awake bodies and a union-find over them
+    std::vector<BroadphasePair> bodyContacts_;
+    std::vector<EntityId> islandBodies_;
+    std::vector<int> islandParent_;
+    std::vector<int> islandOfRoot_;
+    std::vector<uint32_t> islandIndexOfSlot_;
+    void UpdateSleep(float dt);
+    void PollSleepWakeups();
+    void WakeOnContact(EntityId sleeper, EntityId other);
+    void WakeIsland(EntityId id);
+    void WakeOne(EntityId id);
+    bool IsStaticForPairs(EntityId id, const Collider& collider) const;
+
+    // Contact cache: impulses of each touching pair (lower slot first) from its last step
+    struct CachedContact {
+        hmm_vec3 normal;
+        hmm_vec3 tangentImpulse;
+        float normalImpulse;
+        uint32_t step;
+    };
+    // One touching pair being solved this step; the normal points from B towards A
+    struct SolverContact {
+        Rigidbody* rbA;
+        Rigidbody* rbB;
+        Transform* transA;
+        Transform* transB;
+        CachedContact* cached;
+        EntityId a;
+        EntityId b;
+        hmm_vec3 normal;
+        hmm_vec3 tangentImpulse;  // Accumulated this step (friction)
+        float normalImpulse;
+        float penetration;
+        float invMassA;
+        float invMassB;
+        float normalMass;         // 1 / (invMassA + invMassB), 0 if neither takes impulses
+        float pushA;              // Shares of the push-out when normalMass is 0
+        float pushB;
+        float friction;
+        float bounceVelocity;     // Separation speed restitution asks for
+        hmm_vec3 startA;          // Positions at the narrow phase (for the position passes)
+        hmm_vec3 startB;
+        bool corrected;           // Moved by a position pass
+    };
+    std::unordered_map<uint64_t, CachedContact> contactCache_;
+    std::vector<SolverContact> solverContacts_;
+    uint32_t contactStep_ = 0;
+    int solverIterations_ = kDefaultSolverIterations;
+    bool warmStarting_ = true;
+    ContactSolverStats solverStats_;
+    NarrowphaseStats narrowphaseStats_;
+    ContinuousStats continuousStats_;
+    std::vector<EntityId> sweepOrder_;
+    std::vector<EntityId> sweepCandidates_;
+    std::vector<ContactShape> sweepShapes_;
+    void SweepBody(EntityId id, float dt);
+    
+    // Capsule sweep scratch, one per job thread
+    struct SweepScratch {
+        Collider shape;     // The swept collider, kept upright
+        ContactShape body;
+        float reach = 0.0f; // Longest substep
+        std::vector<EntityId> candidates;
+        std::vector<ContactShape> shapes;
+        std::vector<EntityId> entities;  // Per shape
+        std::vector<uint8_t> blocking;   // Per shape
+        int hitShape = -1;               // Of the last sweep
+        int sweeps = 0;
+    };
+    std::vector<SweepScratch> sweepScratch_;
+    std::vector<EntityId> characterOrder_;
+    std::vector<hmm_vec3> characterMoves_;  // New position per characterOrder_ entry
+    CharacterStats characterStats_;
+    SweepScratch& ThreadSweepScratch();
+    void GatherSweepShapes(SweepScratch& scratch, const hmm_vec3& min, const hmm_vec3& max,
+                           uint32_t layer, uint32_t mask, EntityId ignore);
+    CapsuleSweepHit SweepGathered(SweepScratch& scratch, const hmm_vec3& start, const hmm_vec3& motion, float skin);
+    CapsuleSweepHit SweepCapsuleWith(SweepScratch& scratch, const CapsuleSweep& sweep, uint32_t layerMask);
+    hmm_vec3 SlideCharacter(SweepScratch& scratch, const CharacterController& character, hmm_vec3 position,
+                            hmm_vec3 motion, bool flattenSteep);
+    hmm_vec3 MoveCharacter(CharacterController& character, const Collider& collider, EntityId id,
+                           hmm_vec3 position, float dt, SweepScratch& scratch);
+    void AddContact(EntityId a, EntityId b, const CollisionInfo& info);
+    void SolveContacts();
+
+    // Entity slots: generations, free lists (deterministic frees queue separately) and alive_ positions
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> freeSlots_;
+    std::deque<uint32_t> deterministicFreeSlots_;
+    std::vector<uint32_t> aliveSlot_;
     std::vector<EntityId> alive_;
 
-    std::unordered_map<EntityId, Transform> transforms_;
-    std::unordered_map<EntityId, Rigidbody> rigidbodies_;
-    std::unordered_map<EntityId, Collider> colliders_;
-    std::unordered_map<EntityId, AIController> ai_controllers_;
-    std::unordered_map<EntityId, Animator> animators_;
-    std::unordered_map<EntityId, Billboard> billboards_;
-    std::unordered_map<EntityId, ScreenSpace> screen_spaces_;
-    std::unordered_map<EntityId, Light> lights_;
-    std::unordered_map<EntityId, Selectable> selectables_;
-
-    std::unordered_map<EntityId, int> mesh_for_entity_;
-    std::unordered_map<EntityId, int> instance_for_entity_;
-    
-    // Collision helpers
-    bool SphereVsSphere(const hmm_vec3& posA, float radiusA, const hmm_vec3& posB, float radiusB, CollisionInfo* outInfo);
-    bool SphereVsBox(const hmm_vec3& spherePos, float radius, const hmm_vec3& boxPos, const hmm_vec3& boxHalfExtents, CollisionInfo* outInfo);
-    bool SphereVsPlane(const hmm_vec3& spherePos, float radius, const hmm_vec3& planeNormal, float planeDistance, CollisionInfo* outInfo);
-    void ResolveCollision(EntityId a, EntityId b, const CollisionInfo& info);
+    // Component storage (dense sparse-set pools, see ComponentPool.h)
+    ComponentPool<Transform> transforms_;
+    ComponentPool<Rigidbody> rigidbodies_;
+    ComponentPool<Collider> colliders_;
+    ComponentPool<AIController> ai_controllers_;
+    ComponentPool<Animator> animators_;
+    ComponentPool<CharacterController> characters_;
+    ComponentPool<Billboard> billboards_;
+    ComponentPool<ScreenSpace> screen_spaces_;
+    ComponentPool<Light> lights_;
+    ComponentPool<Selectable> selectables_;
+    ComponentPool<Renderable> renderables_;
+    ComponentPool<Parent> parents_;
+    
+    // Collider and transform as a narrowphase shape (see Narrowphase.h)
+    void MakeContactShape(const Collider& collider, const Transform& transform, ContactShape& outShape);
+    
+    // Closest hit of one collider along the ray, if nearer than maxDistance
+    bool RaycastCollider(EntityId entity, const Collider& collider, const Transform& transform,
+                         const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, RaycastHit& outHit);
+    // RaycastBatch() scratch: rays in coherence order and the packet being traced
+    std::vector<uint64_t> rayBatchOrder_;
+    void RaycastRayPacket(std::span<const Ray> rays, const uint64_t* order, int count,
+                          std::span<RaycastHit> outHits, uint32_t layerMask);
     
     // NEW: Ray-triangle intersection
     bool RayTriangleIntersect(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir,
@@ -169,9 +620,81 @@ private:
     // NEW: Ray-mesh intersection
     RaycastHit RayMeshIntersect(EntityId entity, const hmm_vec3& rayOrigin, 
                                 const hmm_vec3& rayDir, float maxDistance);
+    RaycastHit RayHeightfieldIntersect(EntityId entity, const hmm_vec3& rayOrigin,
+                                       const hmm_vec3& rayDir, float maxDistance);
     
     // ADDED: Ray-box intersection (for AABB selection volumes)
     bool RayBoxIntersect(const hmm_vec3& rayOrigin, const hmm_vec3& rayDir,
                         const hmm_vec3& boxMin, const hmm_vec3& boxMax,
                         float* outDistance);
-};
\ No newline at end of file
+};
+
+// ============================================================================
+// COMPONENT TYPE -> POOL MAPPING
+// ============================================================================
+template <> inline ComponentPool<Transform>& ECS::Storage<Transform>() { return transforms_; }
+template <> inline ComponentPool<Rigidbody>& ECS::Storage<Rigidbody>() { return rigidbodies_; }
+template <> inline ComponentPool<Collider>& ECS::Storage<Collider>() { return colliders_; }
+template <> inline ComponentPool<AIController>& ECS::Storage<AIController>() { return ai_controllers_; }
+template <> inline ComponentPool<Animator>& ECS::Storage<Animator>() { return animators_; }
+template <> inline ComponentPool<CharacterController>& ECS::Storage<CharacterController>() { return characters_; }
+template <> inline ComponentPool<Billboard>& ECS::Storage<Billboard>() { return billboards_; }
+template <> inline ComponentPool<ScreenSpace>& ECS::Storage<ScreenSpace>() { return screen_spaces_; }
+template <> inline ComponentPool<Light>& ECS::Storage<Light>() { return lights_; }
+template <> inline ComponentPool<Selectable>& ECS::Storage<Selectable>() { return selectables_; }
+template <> inline ComponentPool<Renderable>& ECS::Storage<Renderable>() { return renderables_; }
+template <> inline ComponentPool<Parent>& ECS::Storage<Parent>() { return parents_; }
+
+// ============================================================================
+// COMPONENT MASKS - describe which components a system reads/writes
+// ============================================================================
+using ComponentMask = uint32_t;
+
+template <typename T> constexpr ComponentMask ComponentBit();
+template <> constexpr ComponentMask ComponentBit<Transform>() { return 1u << 0; }
+template <> constexpr ComponentMask ComponentBit<Rigidbody>() { return 1u << 1; }
+template <> constexpr ComponentMask ComponentBit<Collider>() { return 1u << 2; }
+template <> constexpr ComponentMask ComponentBit<AIController>() { return 1u << 3; }
+template <> constexpr ComponentMask ComponentBit<Animator>() { return 1u << 4; }
+template <> constexpr ComponentMask ComponentBit<Billboard>() { return 1u << 5; }
+template <> constexpr ComponentMask ComponentBit<ScreenSpace>() { return 1u << 6; }
+template <> constexpr ComponentMask ComponentBit<Light>() { return 1u << 7; }
+template <> constexpr ComponentMask ComponentBit<Selectable>() { return 1u << 8; }
+template <> constexpr ComponentMask ComponentBit<Renderable>() { return 1u << 9; }
+template <> constexpr ComponentMask ComponentBit<Parent>() { return 1u << 10; }
+template <> constexpr ComponentMask ComponentBit<CharacterController>() { return 1u << 11; }
+
+// Non-component shared state that systems can also declare
+constexpr ComponentMask kColliderIndexBit = 1u << 29;     // Collider index and hash grid
+constexpr ComponentMask kRendererResourceBit = 1u << 30;  // Renderer instance data
+constexpr ComponentMask kEntityListBit = 1u << 31;        // Entity creation/destruction
+
+template <typename... Ts>
+constexpr ComponentMask ComponentMaskOf() { return (ComponentBit<Ts>() | ... | 0u); }
+
+// ============================================================================
+// COMPONENT OBSERVER - Polls the changes of one component type
+// ============================================================================
+// Poll() reports every add/change/remove since the last one; false if history was trimmed (rescan, Reset())
+template <typename T>
+class ComponentObserver {
+public:
+    void Reset(ECS& ecs) {
+        cursor_ = ecs.ChangeCursor<T>();
+        attached_ = true;
+    }
+    void Detach() { attached_ = false; }
+    bool IsAttached() const { return attached_; }
+
+    template <typename Func>
+    bool Poll(ECS& ecs, Func&& func) {
+        if (!attached_) return false;
+        return ecs.ForEachChange<T>(cursor_, [&](const ComponentChange& change) {
+            func(change.entity, change.kind);
+        });
+    }
+
+private:
+    uint64_t cursor_ = 0;
+    bool attached_ = false;
+};
@@ -0,0 +1,824 @@
+#include "EcsBenchmark.h"
+#include "ComponentPool.h"
+#include "ComponentView.h"
+#include "FixedTimestep.h"
+#include "SceneSnapshot.h"
+#include "SystemScheduler.h"
+#include "TransformBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+EcsBenchmark::StorageStats EcsBenchmark::MeasureStorage(int entityCount) {
+    StorageStats stats;
+    if (entityCount <= 0) return stats;
+    stats.entities = entityCount;
+    
+    // Same entities every run: handles with mixed generations, as after
+    // some churn, and random velocities
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<EntityId> ids((size_t)entityCount);
+    std::vector<Transform> transforms((size_t)entityCount);
+    std::vector<Rigidbody> bodies((size_t)entityCount);
+    for (int i = 0; i < entityCount; ++i) {
+        ids[i] = MakeEntityId((uint32_t)i, rng() & 7);
+        transforms[i].position = HMM_Vec3(unit(rng) * 100.0f, 0.0f, unit(rng) * 100.0f);
+        bodies[i].velocity = HMM_Vec3(unit(rng), unit(rng), unit(rng));
+    }
+    std::vector<EntityId> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    const float dt = 1.0f / 60.0f;
+    
+    std::unordered_map<EntityId, Transform> mapTransforms;
+    std::unordered_map<EntityId, Rigidbody> mapBodies;
+    auto start = Clock::now();
+    for (int i = 0; i < entityCount; ++i) {
+        mapTransforms[ids[i]] = transforms[i];
+        mapBodies[ids[i]] = bodies[i];
+    }
+    stats.mapInsertMs = MillisecondsSince(start);
+    
+    ComponentPool<Transform> poolTransforms;
+    ComponentPool<Rigidbody> poolBodies;
+    start = Clock::now();
+    for (int i = 0; i < entityCount; ++i) {
+        poolTransforms.Insert(ids[i], transforms[i]);
+        poolBodies.Insert(ids[i], bodies[i]);
+    }
+    stats.poolInsertMs = MillisecondsSince(start);
+    
+    // The integration pass as UpdatePhysics() wrote it over the maps
+    start = Clock::now();
+    for (auto& [id, rb] : mapBodies) {
+        auto it = mapTransforms.find(id);
+        if (it == mapTransforms.end()) continue;
+        it->second.position = HMM_AddVec3(it->second.position, HMM_MultiplyVec3f(rb.velocity, dt));
+    }
+    stats.mapIterateMs = MillisecondsSince(start);
+    
+    start = Clock::now();
+    const EntityId* bodyIds = poolBodies.Entities();
+    Rigidbody* rbs = poolBodies.Data();
+    for (size_t i = 0; i < poolBodies.size(); ++i) {
+        Transform* t = poolTransforms.Get(bodyIds[i]);
+        if (!t) continue;
+        t->position = HMM_AddVec3(t->position, HMM_MultiplyVec3f(rbs[i].velocity, dt));
+    }
+    stats.poolIterateMs = MillisecondsSince(start);
+    
+    for (EntityId id : ids) {
+        const hmm_vec3& a = mapTransforms[id].position;
+        const hmm_vec3& b = poolTransforms.Get(id)->position;
+        if (a.X != b.X || a.Y != b.Y || a.Z != b.Z) ++stats.mismatches;
+    }
+    
+    // Random lookups, as gameplay code resolving handles it holds
+    float mapSum = 0.0f;
+    start = Clock::now();
+    for (EntityId id : shuffled) {
+        auto it = mapTransforms.find(id);
+        if (it != mapTransforms.end()) mapSum += it->second.position.X;
+    }
+    stats.mapLookupMs = MillisecondsSince(start);
+    
+    float poolSum = 0.0f;
+    start = Clock::now();
+    for (EntityId id : shuffled) {
+        if (const Transform* t = poolTransforms.Get(id)) poolSum += t->position.X;
+    }
+    stats.poolLookupMs = MillisecondsSince(start);
+    if (mapSum != poolSum) ++stats.mismatches;
+    
+    const size_t removeCount = shuffled.size() / 2;
+    start = Clock::now();
+    for (size_t i = 0; i < removeCount; ++i) {
+        mapTransforms.erase(shuffled[i]);
+        mapBodies.erase(shuffled[i]);
+    }
+    stats.mapRemoveMs = MillisecondsSince(start);
+    
+    start = Clock::now();
+    for (size_t i = 0; i < removeCount; ++i) {
+        poolTransforms.Remove(shuffled[i]);
+        poolBodies.Remove(shuffled[i]);
+    }
+    stats.poolRemoveMs = MillisecondsSince(start);
+    if (mapTransforms.size() != poolTransforms.size() || mapBodies.size() != poolBodies.size()) ++stats.mismatches;
+    
+    printf("Storage, %d entities (unordered_map vs ComponentPool): insert %.2f / %.2f ms, integrate %.2f / %.2f ms, "
+           "lookup %.2f / %.2f ms, remove half %.2f / %.2f ms, %d mismatches\n",
+           entityCount, stats.mapInsertMs, stats.poolInsertMs, stats.mapIterateMs, stats.poolIterateMs,
+           stats.mapLookupMs, stats.poolLookupMs, stats.mapRemoveMs, stats.poolRemoveMs, stats.mismatches);
+    return stats;
+}
+
+EcsBenchmark::ViewStats EcsBenchmark::MeasureViews(int entityCount) {
+    ViewStats stats;
+    if (entityCount <= 0) return stats;
+    stats.entities = entityCount;
+    
+    // Every entity has a Transform, a random half of them a Rigidbody
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::unordered_map<EntityId, Transform> mapTransforms;
+    std::unordered_map<EntityId, Rigidbody> mapBodies;
+    ComponentPool<Transform> poolTransforms;
+    ComponentPool<Rigidbody> poolBodies;
+    for (int i = 0; i < entityCount; ++i) {
+        EntityId id = MakeEntityId((uint32_t)i, 0);
+        Transform t;
+        t.position = HMM_Vec3(unit(rng) * 100.0f, 0.0f, unit(rng) * 100.0f);
+        mapTransforms[id] = t;
+        poolTransforms.Insert(id, t);
+        if (rng() & 1) {
+            Rigidbody rb;
+            rb.velocity = HMM_Vec3(unit(rng), unit(rng), unit(rng));
+            mapBodies[id] = rb;
+            poolBodies.Insert(id, rb);
+        }
+    }
+    
+    // A few passes so the timings are not dominated by the first touch
+    constexpr int kPasses = 8;
+    const float dt = 1.0f / 60.0f;
+    int mapVisited = 0;
+    auto start = Clock::now();
+    for (int pass = 0; pass < kPasses; ++pass) {
+        for (auto& [id, rb] : mapBodies) {
+            auto it = mapTransforms.find(id);
+            if (it == mapTransforms.end()) continue;
+            it->second.position = HMM_AddVec3(it->second.position, HMM_MultiplyVec3f(rb.velocity, dt));
+            ++mapVisited;
+        }
+    }
+    double mapMs = MillisecondsSince(start);
+    
+    int viewVisited = 0;
+    ComponentView<Rigidbody, Transform> view(poolBodies, poolTransforms);
+    start = Clock::now();
+    for (int pass = 0; pass < kPasses; ++pass) {
+        view.Each([&](EntityId, Rigidbody& rb, Transform& t) {
+            t.position = HMM_AddVec3(t.position, HMM_MultiplyVec3f(rb.velocity, dt));
+            ++viewVisited;
+        });
+    }
+    double viewMs = MillisecondsSince(start);
+    
+    stats.visited = viewVisited / kPasses;
+    if (mapVisited != viewVisited) ++stats.mismatches;
+    for (const auto& [id, t] : mapTransforms) {
+        const hmm_vec3& b = poolTransforms.Get(id)->position;
+        if (t.position.X != b.X || t.position.Y != b.Y || t.position.Z != b.Z) {
+            ++stats.mismatches;
+            break;
+        }
+    }
+    if (viewVisited > 0) {
+        stats.mapNsPerEntity = mapMs * 1e6 / mapVisited;
+        stats.viewNsPerEntity = viewMs * 1e6 / viewVisited;
+    }
+    
+    printf("Views, %d entities, %d with a Rigidbody: map + find %.2f ns/entity, View::Each %.2f ns/entity, %d mismatches\n",
+           entityCount, stats.visited, stats.mapNsPerEntity, stats.viewNsPerEntity, stats.mismatches);
+    return stats;
+}
+
+// Spheres raining onto a ground slab, plus wanderers and animators, laid
+// out the same way for every run
+static void SpawnScalingScene(ECS& ecs, int entityCount) {
+    EntityId ground = ecs.CreateEntity();
+    Transform groundTransform;
+    groundTransform.position = HMM_Vec3(0.0f, -0.5f, 0.0f);
+    ecs.AddTransform(ground, groundTransform);
+    Collider groundCollider;
+    groundCollider.type = ColliderType::Box;
+    groundCollider.boxHalfExtents = HMM_Vec3(500.0f, 0.5f, 500.0f);
+    groundCollider.isStatic = true;
+    ecs.AddCollider(ground, groundCollider);
+    
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float extent = sqrtf((float)entityCount) * 1.5f;
+    for (int i = 0; i < entityCount; ++i) {
+        EntityId id = ecs.CreateEntity();
+        Transform t;
+        t.position = HMM_Vec3(unit(rng) * extent, 0.5f, unit(rng) * extent);
+        if (i % 8 == 0) {
+            ecs.AddTransform(id, t);
+            ecs.AddAI(id, AIController());
+        } else {
+            t.position.Y = 1.0f + (unit(rng) + 1.0f) * 5.0f;
+            ecs.AddTransform(id, t);
+            Collider collider;
+            collider.type = ColliderType::Sphere;
+            collider.radius = 0.5f;
+            ecs.AddCollider(id, collider);
+            Rigidbody rb;
+            rb.velocity = HMM_Vec3(unit(rng), 0.0f, unit(rng));
+            ecs.AddRigidbody(id, rb);
+        }
+        if (i % 2 == 0) ecs.AddAnimator(id, Animator());
+    }
+}
+
+EcsBenchmark::ScalingStats EcsBenchmark::MeasureThreadScaling(int entityCount, unsigned maxThreads, int frames) {
+    ScalingStats stats;
+    if (entityCount <= 0 || maxThreads == 0 || frames <= 0) return stats;
+    stats.entities = entityCount;
+    stats.frames = frames;
+    
+    const float dt = FixedTimestep(60.0f).StepSize();
+    uint64_t referenceHash = 0;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        JobSystem jobs;
+        jobs.Init(threads - 1);
+        jobs.SetSingleThreaded(threads == 1);
+        
+        ECS ecs;
+        Renderer renderer;
+        ecs.SetJobSystem(&jobs);
+        ecs.SetDeterministic(true);
+        SpawnScalingScene(ecs, entityCount);
+        ecs.PlaybackCommands(renderer);
+        ecs.SyncToRenderer(renderer);
+        ecs.EndFrame();
+        ecs.ResetSimulationCaches();
+        ecs.SeedRandom(12345);
+        
+        // The same systems and masks as RegisterSystems() in Main.cpp
+        SystemScheduler scheduler;
+        scheduler.AddSystem("AI",
+            ComponentMaskOf<AIController, Transform, CharacterController>(),
+            ComponentMaskOf<AIController, Transform, CharacterController>(),
+            [&]() { ecs.UpdateAI(dt); });
+        scheduler.AddSystem("Animation", ComponentMaskOf<Animator>(), ComponentMaskOf<Animator>(),
+            [&]() { ecs.UpdateAnimation(dt); });
+        SystemScheduler physicsScheduler;
+        physicsScheduler.AddSystem("Physics",
+            ComponentMaskOf<Collider, Rigidbody, Transform>() | kColliderIndexBit,
+            ComponentMaskOf<Rigidbody, Transform>() | kColliderIndexBit,
+            [&]() { ecs.UpdatePhysics(dt); });
+        physicsScheduler.AddSystem("Collisions",
+            ComponentMaskOf<Collider, Rigidbody, Transform>() | kColliderIndexBit,
+            ComponentMaskOf<Rigidbody, Transform>() | kColliderIndexBit,
+            [&]() { ecs.UpdateCollisions(dt); });
+        
+        uint64_t hash = 0;
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            scheduler.Run(jobs);
+            ecs.BeginPhysicsStep();
+            physicsScheduler.Run(jobs);
+            ecs.EndPhysicsStep();
+            hash = ecs.SimulationHash();
+            ecs.PlaybackCommands(renderer);
+            ecs.SyncToRenderer(renderer);
+            ecs.EndFrame();
+        }
+        stats.msPerFrame.push_back(MillisecondsSince(start) / frames);
+        jobs.Shutdown();
+        
+        if (threads == 1) referenceHash = hash;
+        else if (hash != referenceHash) ++stats.mismatches;
+    }
+    
+    printf("Thread scaling, %d entities, %d frames:", entityCount, frames);
+    for (size_t i = 0; i < stats.msPerFrame.size(); ++i) {
+        printf(" %zu: %.2f ms (%.2fx)", i + 1, stats.msPerFrame[i], stats.msPerFrame[0] / stats.msPerFrame[i]);
+    }
+    printf(", %d mismatches\n", stats.mismatches);
+    return stats;
+}
+
+// Largest difference between two matrices relative to the reference's
+// largest element (translations can be far bigger than the rotation part)
+static float MatrixError(const hmm_mat4& a, const hmm_mat4& reference) {
+    float magnitude = 1.0f;
+    float error = 0.0f;
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            magnitude = std::max(magnitude, fabsf(reference.Elements[col][row]));
+            error = std::max(error, fabsf(a.Elements[col][row] - reference.Elements[col][row]));
+        }
+    }
+    return error / magnitude;
+}
+
+EcsBenchmark::TransformStats EcsBenchmark::CheckTransformBatch(int transformCount) {
+    TransformStats stats;
+    stats.kernel = TransformBatchKernelName();
+    if (transformCount <= 0) return stats;
+    stats.transforms = transformCount;
+    
+    // Same transforms every run. A quarter of the angles are everyday ones,
+    // a quarter negative, a quarter multiples of 90 degrees (quadrant edges
+    // of the sincos reduction) and a quarter up to 100 turns either way.
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+    auto angle = [&](int kind) {
+        switch (kind) {
+            case 0: return (unit(rng) + 1.0f) * 180.0f;
+            case 1: return -(unit(rng) + 1.0f) * 180.0f;
+            case 2: return 90.0f * (float)((int)(rng() % 41) - 20);
+            default: return unit(rng) * 36000.0f;
+        }
+    };
+    std::vector<Transform> transforms((size_t)transformCount);
+    TransformBatch batch;
+    batch.Reserve(transforms.size());
+    for (int i = 0; i < transformCount; ++i) {
+        Transform& t = transforms[i];
+        t.position = HMM_Vec3(unit(rng) * 1000.0f, unit(rng) * 100.0f, unit(rng) * 1000.0f);
+        t.pitch = angle(i % 4);
+        t.yaw = angle((i / 4) % 4);
+        t.roll = angle((i / 16) % 4);
+        t.scale = HMM_Vec3(scale(rng), scale(rng), scale(rng));
+        t.originOffset = HMM_Vec3(unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f);
+        batch.Push(t);
+    }
+    
+    std::vector<hmm_mat4> reference((size_t)transformCount);
+    auto start = Clock::now();
+    for (int i = 0; i < transformCount; ++i) {
+        reference[i] = transforms[i].ModelMatrix();
+    }
+    stats.modelMatrixNs = MillisecondsSince(start) * 1e6 / transformCount;
+    
+    std::vector<hmm_mat4> out((size_t)transformCount);
+    start = Clock::now();
+    ComputeModelMatrices(batch, 0, batch.size(), out.data());
+    stats.kernelNs = MillisecondsSince(start) * 1e6 / transformCount;
+    
+    auto check = [&](const hmm_mat4& m, int i) {
+        float error = MatrixError(m, reference[i]);
+        stats.maxError = std::max(stats.maxError, error);
+        if (!(error <= kTransformTolerance)) ++stats.mismatches;
+    };
+    for (int i = 0; i < transformCount; ++i) check(out[i], i);
+    
+    ComputeModelMatricesScalar(batch, 0, batch.size(), out.data());
+    for (int i = 0; i < transformCount; ++i) check(out[i], i);
+    
+    // Short ranges: lengths 0..19 mix the 8-wide, 4-wide and single lanes,
+    // and odd offsets start them unaligned
+    const hmm_mat4 untouched = HMM_Mat4d(-12345.0f);
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t length = 0; length < 20 && offset + length <= batch.size(); ++length) {
+            for (int path = 0; path < 2; ++path) {
+                std::vector<hmm_mat4> range(batch.size() < 32 ? batch.size() : 32, untouched);
+                if (path == 0) ComputeModelMatrices(batch, offset, offset + length, range.data());
+                else ComputeModelMatricesScalar(batch, offset, offset + length, range.data());
+                for (size_t i = 0; i < range.size(); ++i) {
+                    if (i >= offset && i < offset + length) check(range[i], (int)i);
+                    else if (memcmp(&range[i], &untouched, sizeof(hmm_mat4)) != 0) ++stats.mismatches;
+                }
+            }
+        }
+    }
+    
+    printf("Transform batch (%s), %d transforms: ModelMatrix() %.1f ns, kernel %.1f ns per transform, "
+           "max relative error %.2g, %d mismatches\n",
+           stats.kernel, transformCount, stats.modelMatrixNs, stats.kernelNs, stats.maxError, stats.mismatches);
+    return stats;
+}
+
+// World position of a parented entity the slow way: ModelMatrix() composed
+// up the chain
+static hmm_vec3 ComposedWorldPosition(ECS& ecs, EntityId id) {
+    hmm_vec4 p = HMM_Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    for (EntityId e = id; e != -1; e = ecs.GetParent(e)) {
+        p = HMM_MultiplyMat4ByVec4(ecs.PeekTransform(e)->ModelMatrix(), p);
+    }
+    return HMM_Vec3(p.X, p.Y, p.Z);
+}
+
+static float PositionError(const hmm_vec3& a, const hmm_vec3& reference) {
+    float magnitude = std::max(1.0f, HMM_LengthVec3(reference));
+    return HMM_LengthVec3(HMM_SubtractVec3(a, reference)) / magnitude;
+}
+
+EcsBenchmark::HierarchyStats EcsBenchmark::MeasureHierarchy(int depth, int wide, int unparented) {
+    HierarchyStats stats;
+    if (depth <= 0 || wide <= 0 || unparented < 0) return stats;
+    stats.depth = depth;
+    stats.unparented = unparented;
+    
+    ECS ecs;
+    Renderer renderer;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto spawn = [&](EntityId parent, const hmm_vec3& position, float yaw) {
+        EntityId id = ecs.CreateEntity();
+        Transform t;
+        t.position = position;
+        t.yaw = yaw;
+        ecs.AddTransform(id, t);
+        if (parent != -1) ecs.SetParent(id, parent);
+        return id;
+    };
+    
+    // Chain: each link one unit further along its parent's turned X axis
+    std::vector<EntityId> chain;
+    chain.push_back(spawn(-1, HMM_Vec3(0.0f, 0.0f, 0.0f), 0.0f));
+    for (int i = 0; i < depth; ++i) {
+        chain.push_back(spawn(chain.back(), HMM_Vec3(1.0f, 0.0f, 0.0f), 2.0f));
+    }
+    
+    // Tree: a root, sqrt(wide) branches and the rest as leaves under them
+    std::vector<EntityId> tree;
+    tree.push_back(spawn(-1, HMM_Vec3(0.0f, 0.0f, 50.0f), 0.0f));
+    const int branches = std::max(1, (int)sqrtf((float)wide));
+    for (int i = 0; i < branches; ++i) {
+        tree.push_back(spawn(tree[0], HMM_Vec3(unit(rng) * 20.0f, 0.0f, unit(rng) * 20.0f), unit(rng) * 180.0f));
+    }
+    for (int i = branches; i < wide; ++i) {
+        tree.push_back(spawn(tree[1 + i % branches], HMM_Vec3(unit(rng), unit(rng), unit(rng)), unit(rng) * 180.0f));
+    }
+    stats.wide = (int)tree.size() - 1;
+    
+    std::vector<EntityId> crowd;
+    for (int i = 0; i < unparented; ++i) {
+        EntityId id = ecs.CreateEntity();
+        Transform t;
+        t.position = HMM_Vec3(unit(rng) * 100.0f, 0.0f, unit(rng) * 100.0f);
+        t.yaw = unit(rng) * 180.0f;
+        t.scale = HMM_Vec3(0.5f + unit(rng) * 0.4f, 1.0f + unit(rng) * 0.5f, 2.0f + unit(rng));
+        t.originOffset = HMM_Vec3(unit(rng) * 5.0f, unit(rng), unit(rng) * 5.0f);
+        ecs.AddTransform(id, t);
+        crowd.push_back(id);
+    }
+    ecs.SyncToRenderer(renderer);
+    
+    auto check = [&]() {
+        for (const std::vector<EntityId>* group : { &chain, &tree }) {
+            for (EntityId id : *group) {
+                if (!(PositionError(ecs.GetWorldPosition(id), ComposedWorldPosition(ecs, id)) <= kHierarchyTolerance)) {
+                    ++stats.mismatches;
+                }
+            }
+        }
+        for (EntityId id : crowd) {
+            if (!(PositionError(ecs.GetWorldPosition(id), ecs.PeekTransform(id)->GetWorldPosition()) <= kTransformTolerance)) {
+                ++stats.mismatches;
+            }
+        }
+    };
+    
+    // Each case moves the crowd plus `extra` (if any) for a few frames
+    constexpr int kFrames = 16;
+    auto measure = [&](EntityId extra) {
+        double ms = 0.0;
+        for (int frame = 0; frame < kFrames; ++frame) {
+            for (EntityId id : crowd) ecs.GetTransform(id)->position.Y = 0.01f * frame;
+            if (extra != -1) ecs.GetTransform(extra)->yaw += 1.0f;
+            auto start = Clock::now();
+            ecs.SyncToRenderer(renderer);
+            ms += MillisecondsSince(start);
+            ecs.EndFrame();
+        }
+        check();
+        return ms / kFrames;
+    };
+    stats.unparentedMs = measure(-1);
+    stats.leafMs = measure(chain.back());
+    stats.deepRootMs = measure(chain.front());
+    stats.wideRootMs = measure(tree.front());
+    
+    printf("Hierarchy, chain of %d, tree of %d, %d unparented: sync %.3f ms unparented only, %.3f ms + leaf, "
+           "%.3f ms + chain root, %.3f ms + tree root, %d mismatches\n",
+           stats.depth, stats.wide, stats.unparented, stats.unparentedMs, stats.leafMs, stats.deepRootMs,
+           stats.wideRootMs, stats.mismatches);
+    return stats;
+}
+
+// A scene like init()'s, one Add call per component. Every eighth entity
+// is a prop parented to the tree before it.
+static std::vector<EntityId> SpawnSnapshotScene(ECS& ecs, int entityCount) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float extent = sqrtf((float)entityCount) * 2.0f;
+    std::vector<EntityId> entities;
+    entities.reserve((size_t)entityCount);
+    EntityId lastTree = -1;
+    for (int i = 0; i < entityCount; ++i) {
+        EntityId id = ecs.CreateEntity();
+        entities.push_back(id);
+        Transform t;
+        t.position = HMM_Vec3(unit(rng) * extent, 0.0f, unit(rng) * extent);
+        t.yaw = unit(rng) * 180.0f;
+        
+        Selectable selectable;
+        switch (i % 8) {
+            case 0: case 1: case 2: case 3: {
+                t.scale = HMM_Vec3(1.0f + unit(rng) * 0.2f, 1.0f + unit(rng) * 0.2f, 1.0f + unit(rng) * 0.2f);
+                t.originOffset = HMM_Vec3(-19.5f, 2.4f, 2.2f);
+                ecs.AddTransform(id, t);
+                Collider collider;
+                collider.type = ColliderType::Sphere;
+                collider.radius = 2.0f;
+                collider.isStatic = true;
+                ecs.AddCollider(id, collider);
+                selectable.name = "Tree";
+                selectable.boundingSphereRadius = 3.0f;
+                ecs.AddSelectable(id, selectable);
+                lastTree = id;
+                break;
+            }
+            case 4: case 5: {
+                t.position.Y = 0.9f;
+                ecs.AddTransform(id, t);
+                Collider collider;
+                collider.type = ColliderType::Capsule;
+                collider.capsuleHeight = 1.0f;
+                collider.capsuleRadius = 0.4f;
+                ecs.AddCollider(id, collider);
+                Rigidbody rb;
+                rb.isKinematic = true;
+                rb.affectedByGravity = false;
+                ecs.AddRigidbody(id, rb);
+                CharacterController character;
+                character.moveVelocity = HMM_Vec3(unit(rng), 0.0f, unit(rng));
+                ecs.AddCharacter(id, character);
+                AIController ai;
+                ai.state = AIState::Wander;
+                ai.wanderTarget = HMM_Vec3(unit(rng) * extent, 0.0f, unit(rng) * extent);
+                ecs.AddAI(id, ai);
+                ecs.AddAnimator(id, Animator());
+                selectable.name = "Enemy";
+                selectable.volumeType = SelectionVolumeType::Box;
+                ecs.AddSelectable(id, selectable);
+                break;
+            }
+            case 6: {
+                t.position.Y = 4.0f;
+                ecs.AddTransform(id, t);
+                Light light = { HMM_Vec3(1.0f, 0.9f, 0.7f), 0.8f, 10.0f + unit(rng), true };
+                ecs.AddLight(id, light);
+                selectable.name = "Light";
+                selectable.volumeType = SelectionVolumeType::Icon;
+                ecs.AddSelectable(id, selectable);
+                break;
+            }
+            default: {
+                t.position = HMM_Vec3(0.0f, 3.0f, 0.0f);
+                ecs.AddTransform(id, t);
+                Animator animator;
+                animator.time = unit(rng) + 1.0f;
+                ecs.AddAnimator(id, animator);
+                ecs.SetParent(id, lastTree);
+                break;
+            }
+        }
+    }
+    return entities;
+}
+
+static bool SameVec3(const hmm_vec3& a, const hmm_vec3& b) {
+    return a.X == b.X && a.Y == b.Y && a.Z == b.Z;
+}
+
+// True if both have the component and it matches field by field, or
+// neither has it
+template <typename T, typename Same>
+static bool SameComponent(const T* a, const T* b, Same&& same) {
+    if (!a || !b) return !a && !b;
+    return same(*a, *b);
+}
+
+// Position of each entity in the list it was saved or loaded as
+using EntityOrder = std::unordered_map<EntityId, size_t>;
+
+static EntityOrder OrderOf(const std::vector<EntityId>& entities) {
+    EntityOrder order;
+    order.reserve(entities.size());
+    for (size_t i = 0; i < entities.size(); ++i) order[entities[i]] = i;
+    return order;
+}
+
+static bool SameEntity(ECS& original, EntityId a, ECS& loaded, EntityId b,
+                       const EntityOrder& originalOrder, const EntityOrder& loadedOrder) {
+    bool same = SameComponent(original.PeekTransform(a), loaded.PeekTransform(b), [](const Transform& x, const Transform& y) {
+        return SameVec3(x.position, y.position) && SameVec3(x.scale, y.scale) && SameVec3(x.originOffset, y.originOffset) &&
+               x.yaw == y.yaw && x.pitch == y.pitch && x.roll == y.roll && x.useCustomMatrix == y.useCustomMatrix;
+    });
+    same = same && SameComponent(original.GetRigidbody(a), loaded.GetRigidbody(b), [](const Rigidbody& x, const Rigidbody& y) {
+        return SameVec3(x.velocity, y.velocity) && x.mass == y.mass && x.affectedByGravity == y.affectedByGravity &&
+               x.isKinematic == y.isKinematic && x.drag == y.drag && x.bounciness == y.bounciness &&
+               x.friction == y.friction && x.canSleep == y.canSleep && x.sleeping == y.sleeping &&
+               x.sleepTimer == y.sleepTimer && x.continuousCollision == y.continuousCollision;
+    });
+    same = same && SameComponent(original.GetCollider(a), loaded.GetCollider(b), [](const Collider& x, const Collider& y) {
+        return x.type == y.type && x.radius == y.radius && SameVec3(x.boxHalfExtents, y.boxHalfExtents) &&
+               x.capsuleHeight == y.capsuleHeight && x.capsuleRadius == y.capsuleRadius &&
+               SameVec3(x.planeNormal, y.planeNormal) && x.planeDistance == y.planeDistance &&
+               x.isTrigger == y.isTrigger && x.isStatic == y.isStatic && x.useBroadPhase == y.useBroadPhase &&
+               x.collisionMask == y.collisionMask && x.collisionLayer == y.collisionLayer;
+    });
+    same = same && SameComponent(original.GetSelectable(a), loaded.GetSelectable(b), [](const Selectable& x, const Selectable& y) {
+        return strcmp(x.name, y.name) == 0 && x.isSelected == y.isSelected && x.volumeType == y.volumeType &&
+               x.boundingSphereRadius == y.boundingSphereRadius && SameVec3(x.boundingBoxMin, y.boundingBoxMin) &&
+               SameVec3(x.boundingBoxMax, y.boundingBoxMax) && x.canBeSelected == y.canBeSelected &&
+               x.editorLayer == y.editorLayer;
+    });
+    same = same && SameComponent(original.GetAI(a), loaded.GetAI(b), [](const AIController& x, const AIController& y) {
+        return x.state == y.state && x.stateTimer == y.stateTimer && SameVec3(x.wanderTarget, y.wanderTarget);
+    });
+    same = same && SameComponent(original.GetAnimator(a), loaded.GetAnimator(b), [](const Animator& x, const Animator& y) {
+        return x.currentClip == y.currentClip && x.time == y.time;
+    });
+    same = same && SameComponent(original.GetLight(a), loaded.GetLight(b), [](const Light& x, const Light& y) {
+        return SameVec3(x.color, y.color) && x.intensity == y.intensity && x.radius == y.radius && x.enabled == y.enabled;
+    });
+    same = same && SameComponent(original.GetCharacter(a), loaded.GetCharacter(b),
+                                 [](const CharacterController& x, const CharacterController& y) {
+        return SameVec3(x.moveVelocity, y.moveVelocity) && x.verticalVelocity == y.verticalVelocity &&
+               x.stepHeight == y.stepHeight && x.maxSlopeCos == y.maxSlopeCos;
+    });
+    
+    // Parents by position in the entity lists
+    EntityId parentA = original.GetParent(a), parentB = loaded.GetParent(b);
+    if ((parentA == -1) != (parentB == -1)) return false;
+    if (parentA != -1) {
+        auto indexA = originalOrder.find(parentA), indexB = loadedOrder.find(parentB);
+        same = same && indexA != originalOrder.end() && indexB != loadedOrder.end() && indexA->second == indexB->second;
+    }
+    return same;
+}
+
+// Saves one entity with a broken component and checks Load() rejects the
+// file without creating anything
+template <typename Corrupt>
+static bool RejectsCorrupt(const char* path, Corrupt&& corrupt) {
+    ECS source;
+    EntityId id = source.CreateEntity();
+    source.AddTransform(id, Transform());
+    Collider collider;
+    source.AddCollider(id, collider);
+    source.AddRigidbody(id, Rigidbody());
+    corrupt(source, id);
+    if (!SceneSnapshot::Save(source, path, { id })) return false;
+    
+    ECS target;
+    Renderer renderer;
+    size_t before = target.AllEntities().size();
+    return SceneSnapshot::Load(target, renderer, path) < 0 && target.AllEntities().size() == before;
+}
+
+EcsBenchmark::SnapshotStats EcsBenchmark::MeasureSnapshot(int entityCount, const char* path) {
+    SnapshotStats stats;
+    if (entityCount <= 0) return stats;
+    stats.entities = entityCount;
+    
+    ECS original;
+    auto start = Clock::now();
+    std::vector<EntityId> originalIds = SpawnSnapshotScene(original, entityCount);
+    stats.constructMs = MillisecondsSince(start);
+    
+    start = Clock::now();
+    if (!SceneSnapshot::Save(original, path, originalIds)) {
+        ++stats.mismatches;
+        return stats;
+    }
+    stats.saveMs = MillisecondsSince(start);
+    if (FILE* file = fopen(path, "rb")) {
+        fseek(file, 0, SEEK_END);
+        stats.bytes = (size_t)ftell(file);
+        fclose(file);
+    }
+    
+    ECS loaded;
+    Renderer renderer;
+    std::vector<EntityId> loadedIds;
+    start = Clock::now();
+    int count = SceneSnapshot::Load(loaded, renderer, path, &loadedIds);
+    stats.loadMs = MillisecondsSince(start);
+    if (count != entityCount || loadedIds.size() != originalIds.size()) {
+        ++stats.mismatches;
+    } else {
+        EntityOrder originalOrder = OrderOf(originalIds), loadedOrder = OrderOf(loadedIds);
+        for (size_t i = 0; i < originalIds.size(); ++i) {
+            if (!SameEntity(original, originalIds[i], loaded, loadedIds[i], originalOrder, loadedOrder)) ++stats.mismatches;
+        }
+    }
+    
+    // Bytes no component can hold. They are written through memcpy, as a
+    // damaged or hostile file would deliver them.
+    std::string badPath = std::string(path) + ".bad";
+    auto setByte = [](void* field, uint8_t value) { memcpy(field, &value, 1); };
+    if (!RejectsCorrupt(badPath.c_str(), [&](ECS& ecs, EntityId id) { setByte(&ecs.GetCollider(id)->type, 200); })) {
+        ++stats.mismatches;
+    }
+    if (!RejectsCorrupt(badPath.c_str(), [&](ECS& ecs, EntityId id) { setByte(&ecs.GetCollider(id)->isStatic, 2); })) {
+        ++stats.mismatches;
+    }
+    if (!RejectsCorrupt(badPath.c_str(), [&](ECS& ecs, EntityId id) { setByte(&ecs.GetRigidbody(id)->sleeping, 0x80); })) {
+        ++stats.mismatches;
+    }
+    remove(badPath.c_str());
+    remove(path);
+    
+    printf("Snapshot, %d entities (%zu bytes): Add calls %.2f ms, save %.2f ms, load %.2f ms, %d mismatches\n",
+           entityCount, stats.bytes, stats.constructMs, stats.saveMs, stats.loadMs, stats.mismatches);
+    return stats;
+}
+
+// Live entities in slot order
+static std::vector<EntityId> EntitiesBySlot(const ECS& ecs) {
+    std::vector<EntityId> entities = ecs.AllEntities();
+    std::sort(entities.begin(), entities.end(), [](EntityId a, EntityId b) { return EntityIndex(a) < EntityIndex(b); });
+    return entities;
+}
+
+EcsBenchmark::SlotStats EcsBenchmark::CheckSlotReuse(int entityCount, int cycles) {
+    SlotStats stats;
+    if (entityCount <= 0 || cycles <= 0) return stats;
+    
+    // Each entity carries a label in its position, which the two sides
+    // give out in the same order
+    float nextLabel = 0.0f;
+    uint32_t slots[2] = {};
+    auto create = [&](ECS& ecs, int side, float label) {
+        EntityId id = ecs.CreateEntity();
+        Transform t;
+        t.position = HMM_Vec3(label, 0.0f, 0.0f);
+        ecs.AddTransform(id, t);
+        slots[side] = std::max(slots[side], EntityIndex(id) + 1);
+    };
+    auto labels = [](ECS& ecs) {
+        std::vector<float> result;
+        for (EntityId id : EntitiesBySlot(ecs)) result.push_back(ecs.GetTransform(id)->position.X);
+        return result;
+    };
+    
+    ECS recorded, replayed;
+    for (int i = 0; i < entityCount; ++i) {
+        create(recorded, 0, 0.0f);
+    }
+    std::vector<EntityId> made = EntitiesBySlot(recorded);
+    for (size_t i = 0; i < made.size(); i += 3) {
+        recorded.DestroyEntity(made[i]);
+    }
+    for (EntityId id : EntitiesBySlot(recorded)) {
+        recorded.GetTransform(id)->position.X = nextLabel;
+        create(replayed, 1, nextLabel);
+        nextLabel += 1.0f;
+    }
+    recorded.SetDeterministic(true);
+    replayed.SetDeterministic(true);
+    
+    stats.entities = (int)recorded.AllEntities().size();
+    stats.cycles = cycles;
+    stats.churn = std::max(1, stats.entities / 10);
+    stats.slotsBefore = slots[0];
+    uint32_t replayedSlots = slots[1];
+    std::mt19937 rng(12345);
+    std::vector<size_t> ranks;
+    for (int cycle = 0; cycle < cycles; ++cycle) {
+        ranks.resize(recorded.AllEntities().size());
+        for (size_t i = 0; i < ranks.size(); ++i) ranks[i] = i;
+        std::shuffle(ranks.begin(), ranks.end(), rng);
+        std::vector<EntityId> recordedBySlot = EntitiesBySlot(recorded), replayedBySlot = EntitiesBySlot(replayed);
+        for (int i = 0; i < stats.churn; ++i) {
+            recorded.DestroyEntity(recordedBySlot[ranks[i]]);
+            replayed.DestroyEntity(replayedBySlot[ranks[i]]);
+        }
+        for (int i = 0; i <= stats.churn; ++i) {
+            create(recorded, 0, nextLabel);
+            create(replayed, 1, nextLabel);
+            nextLabel += 1.0f;
+        }
+        if (labels(recorded) != labels(replayed)) ++stats.mismatches;
+    }
+    // Only the one more per cycle needs a fresh slot
+    stats.slotsAfter = slots[0];
+    stats.slotsFresh = stats.slotsBefore + (uint32_t)(cycles * (stats.churn + 1));
+    if (slots[0] > stats.slotsBefore + cycles || slots[1] > replayedSlots + cycles) ++stats.mismatches;
+    
+    // Out of deterministic mode every free slot is reusable again
+    recorded.SetDeterministic(false);
+    uint32_t slotsUsed = slots[0];
+    uint32_t gaps = slotsUsed - (uint32_t)recorded.AllEntities().size();
+    for (uint32_t i = 0; i < gaps; ++i) {
+        create(recorded, 0, nextLabel);
+    }
+    if (slots[0] > slotsUsed) ++stats.mismatches;
+    
+    printf("Slot reuse: %d entities, %d cycles of %d: %u slots before, %u after (%u with a fresh slot each), "
+           "%d mismatches\n",
+           stats.entities, cycles, stats.churn, stats.slotsBefore, stats.slotsAfter, stats.slotsFresh, stats.mismatches);
+    return stats;
+}
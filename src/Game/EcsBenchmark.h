@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ECS.h"
+#include "../Utilities/JobSystem.h"
+#include <vector>
+
+// ============================================================================
+// ECS BENCHMARK - Headless measurements of the entity storage and systems
+// ============================================================================
+// Run by --benchmark. A non-zero `mismatches` is a failure, not a slow run.
+
+class EcsBenchmark {
+public:
+    // Per-type unordered_maps against ComponentPool: add, integrate, look up, remove
+    struct StorageStats {
+        int entities = 0;
+        int mismatches = 0;  // Entities whose integrated position differs between the two
+        double mapInsertMs = 0.0;
+        double poolInsertMs = 0.0;
+        double mapIterateMs = 0.0;
+        double poolIterateMs = 0.0;
+        double mapLookupMs = 0.0;
+        double poolLookupMs = 0.0;
+        double mapRemoveMs = 0.0;
+        double poolRemoveMs = 0.0;
+    };
+    static StorageStats MeasureStorage(int entityCount);
+
+    // Walking one map and looking up the other against View<Rigidbody, Transform>()
+    struct ViewStats {
+        int entities = 0;
+        int visited = 0;     // Entities with both components
+        int mismatches = 0;  // 1 if the view visited other entities than the map loop
+        double mapNsPerEntity = 0.0;
+        double viewNsPerEntity = 0.0;
+    };
+    static ViewStats MeasureViews(int entityCount);
+
+    // The game's frame on 1 to maxThreads threads; deterministic, so every run ends on the same hash
+    struct ScalingStats {
+        int entities = 0;
+        int frames = 0;
+        int mismatches = 0;              // Thread counts whose final hash differs from 1 thread
+        std::vector<double> msPerFrame;  // [threads - 1]
+    };
+    static ScalingStats MeasureThreadScaling(int entityCount, unsigned maxThreads, int frames = 120);
+
+    static constexpr float kTransformTolerance = 1e-5f;  // Relative to the matrix's largest element
+
+    // The SIMD ModelMatrix kernel against Transform::ModelMatrix(), whole and in ranges
+    struct TransformStats {
+        int transforms = 0;
+        int mismatches = 0;  // Matrices off by more than the tolerance, or written outside their range
+        float maxError = 0.0f;  // Relative, over every path
+        double modelMatrixNs = 0.0;  // Per transform
+        double kernelNs = 0.0;
+        const char* kernel = "";
+    };
+    static TransformStats CheckTransformBatch(int transformCount);
+
+    // A 256-link chain composed in the other order drifts by about 4e-5
+    static constexpr float kHierarchyTolerance = 1e-4f;
+
+    // SyncToRenderer() with a deep chain, a wide tree and an unparented crowd
+    struct HierarchyStats {
+        int depth = 0;       // Of the chain
+        int wide = 0;        // Entities in the two-level tree
+        int unparented = 0;
+        int mismatches = 0;  // World positions off by more than the tolerances
+        double unparentedMs = 0.0;  // Per SyncToRenderer(), with the unparented ones moving
+        double leafMs = 0.0;        // ... and the chain's leaf
+        double deepRootMs = 0.0;    // ... and the chain's root
+        double wideRootMs = 0.0;    // ... and the tree's root
+    };
+    static HierarchyStats MeasureHierarchy(int depth, int wide, int unparented);
+
+    // Building a scene with Add calls against saving and loading it as a SceneSnapshot
+    struct SnapshotStats {
+        int entities = 0;
+        int mismatches = 0;  // Components that differ after the round trip, bad files that loaded
+        double constructMs = 0.0;  // Add calls, as init() builds a scene
+        double saveMs = 0.0;
+        double loadMs = 0.0;
+        size_t bytes = 0;
+    };
+    static SnapshotStats MeasureSnapshot(int entityCount, const char* path);
+
+    // A recording against its replay: destroyed slots must be reused in the same order
+    struct SlotStats {
+        int entities = 0;
+        int cycles = 0;
+        int churn = 0;          // Entities destroyed per cycle (one more is created)
+        int mismatches = 0;     // Cycles whose slot order differs, plus fresh slots taken while some were free
+        uint32_t slotsBefore = 0;   // Of the recorded ECS, when deterministic mode begins
+        uint32_t slotsAfter = 0;
+        uint32_t slotsFresh = 0;    // What a fresh slot per entity would have needed
+    };
+    static SlotStats CheckSlotReuse(int entityCount, int cycles);
+};
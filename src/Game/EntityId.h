@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// ============================================================================
+// ENTITY HANDLES
+// ============================================================================
+// An EntityId packs a slot index (low bits) and a generation (high bits)
+// into a plain int so it can still be printed with %d and compared against
+// -1. When an entity is destroyed its slot is recycled with a bumped
+// generation, so stale handles held elsewhere (billboard targets, editor
+// selection) no longer match and ECS::IsAlive() reports them as dead.
+using EntityId = int;
+
+constexpr uint32_t kEntityIndexBits = 20;                       // ~1M live entities
+constexpr uint32_t kEntityIndexMask = (1u << kEntityIndexBits) - 1;
+constexpr uint32_t kEntityGenerationBits = 11;                  // keeps the sign bit clear
+constexpr uint32_t kEntityGenerationMask = (1u << kEntityGenerationBits) - 1;
+
+inline uint32_t EntityIndex(EntityId id) { return (uint32_t)id & kEntityIndexMask; }
+inline uint32_t EntityGeneration(EntityId id) { return ((uint32_t)id >> kEntityIndexBits) & kEntityGenerationMask; }
+
+inline EntityId MakeEntityId(uint32_t index, uint32_t generation) {
+    return (EntityId)(((generation & kEntityGenerationMask) << kEntityIndexBits) | (index & kEntityIndexMask));
+}
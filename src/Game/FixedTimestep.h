@@ -0,0 +1,72 @@
+#pragma once
+
+// ============================================================================
+// FIXED TIMESTEP - Turns variable frame times into fixed simulation steps
+// ============================================================================
+// Frame time goes into an accumulator; every whole step in it is one
+// simulation step of exactly StepSize() seconds, so physics behaves the same
+// at 30 or 240 frames per second. A long frame (loading, a breakpoint) would
+// otherwise ask for dozens of steps that take longer than the frame itself,
+// so at most maxSubsteps run and the rest of the backlog is dropped.
+//
+// What is left in the accumulator is how far the renderer is between the
+// last two steps: Alpha() is that fraction (0..1), which SyncToRenderer()
+// uses to interpolate moving bodies (see ECS::SetInterpolationAlpha()).
+
+class FixedTimestep {
+public:
+    static constexpr float kMinStepRate = 10.0f;
+    static constexpr float kMaxStepRate = 480.0f;
+
+    explicit FixedTimestep(float stepRate = 60.0f, int maxSubsteps = 4) {
+        SetStepRate(stepRate);
+        SetMaxSubsteps(maxSubsteps);
+    }
+
+    // Adds one frame's time and returns the number of steps to run for it
+    int Advance(double frameTime) {
+        if (frameTime > 0.0) accumulator_ += frameTime;
+        int steps = (int)(accumulator_ / stepSize_);
+        if (steps > maxSubsteps_) {
+            // Keep the fraction so Alpha() stays continuous
+            accumulator_ -= (steps - maxSubsteps_) * stepSize_;
+            droppedSteps_ += steps - maxSubsteps_;
+            steps = maxSubsteps_;
+        }
+        accumulator_ -= steps * stepSize_;
+        if (accumulator_ < 0.0) accumulator_ = 0.0;  // Rounding
+        lastSteps_ = steps;
+        return steps;
+    }
+
+    // Forgets pending time (simulation paused)
+    void Reset() {
+        accumulator_ = 0.0;
+        lastSteps_ = 0;
+    }
+
+    void SetStepRate(float stepsPerSecond) {
+        if (stepsPerSecond < kMinStepRate) stepsPerSecond = kMinStepRate;
+        if (stepsPerSecond > kMaxStepRate) stepsPerSecond = kMaxStepRate;
+        stepRate_ = stepsPerSecond;
+        stepSize_ = 1.0 / stepsPerSecond;
+        if (accumulator_ > stepSize_) accumulator_ = stepSize_;
+    }
+
+    void SetMaxSubsteps(int maxSubsteps) { maxSubsteps_ = maxSubsteps < 1 ? 1 : maxSubsteps; }
+
+    float StepRate() const { return stepRate_; }
+    float StepSize() const { return (float)stepSize_; }
+    int MaxSubsteps() const { return maxSubsteps_; }
+    float Alpha() const { return (float)(accumulator_ / stepSize_); }
+    int LastSteps() const { return lastSteps_; }        // Steps run by the last Advance()
+    int DroppedSteps() const { return droppedSteps_; }  // Total skipped by the clamp
+
+private:
+    double accumulator_ = 0.0;
+    double stepSize_ = 1.0 / 60.0;
+    float stepRate_ = 60.0f;
+    int maxSubsteps_ = 4;
+    int lastSteps_ = 0;
+    int droppedSteps_ = 0;
+};
@@ -0,0 +1,377 @@
+#include "Heightfield.h"
+#include "../../External/stb_image.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+
+// Same as ECS::RayTriangleIntersect()
+static constexpr float kRayEpsilon = 0.0000001f;
+
+// Larger grids would overflow the cell numbering of RayHeightfield()
+static constexpr int64_t kMaxHeightfieldSamples = (int64_t)1 << 28;
+
+static inline float Min(float a, float b) { return a < b ? a : b; }
+static inline float Max(float a, float b) { return a > b ? a : b; }
+
+// -- Building ------------------------------------------------------------------
+
+bool BuildHeightfield(const float* heights, int columns, int rows, float cellSize,
+                      float originX, float originZ, Heightfield& out) {
+    if (columns < 2 || rows < 2 || !(cellSize > 0.0f) || (int64_t)columns * rows > kMaxHeightfieldSamples) {
+        printf("ERROR: Heightfield needs at least 2 x 2 samples and a positive cell size\n");
+        return false;
+    }
+
+    const size_t count = (size_t)columns * rows;
+    float lowest = FLT_MAX, highest = -FLT_MAX;
+    for (size_t i = 0; i < count; ++i) {
+        lowest = Min(lowest, heights[i]);
+        highest = Max(highest, heights[i]);
+    }
+
+    out.columns = columns;
+    out.rows = rows;
+    out.cellSize = cellSize;
+    out.originX = originX;
+    out.originZ = originZ;
+    out.minHeight = lowest;
+    out.heightStep = (highest - lowest) / 65535.0f;
+    out.samples.resize(count);
+    const float toSample = out.heightStep > 0.0f ? 1.0f / out.heightStep : 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        float sample = (heights[i] - lowest) * toSample + 0.5f;
+        out.samples[i] = (uint16_t)Min(sample, 65535.0f);
+    }
+    FinishHeightfield(out);
+    return true;
+}
+
+void FinishHeightfield(Heightfield& heightfield) {
+    const int B = kHeightfieldBlockCells;
+    const int cellColumns = heightfield.columns - 1;
+    const int cellRows = heightfield.rows - 1;
+    heightfield.blockColumns = (cellColumns + B - 1) / B;
+    heightfield.blockRows = (cellRows + B - 1) / B;
+    heightfield.blockMin.assign((size_t)heightfield.blockColumns * heightfield.blockRows, 0xFFFF);
+    heightfield.blockMax.assign((size_t)heightfield.blockColumns * heightfield.blockRows, 0);
+
+    // A block covers the samples at both ends of its cells, so neighbouring
+    // blocks share their border samples
+    uint16_t lowest = 0xFFFF, highest = 0;
+    for (int z = 0; z < heightfield.rows; ++z) {
+        const uint16_t* row = &heightfield.samples[(size_t)z * heightfield.columns];
+        int firstBlockRow = z > 0 ? (z - 1) / B : 0;
+        int lastBlockRow = z < cellRows ? z / B : heightfield.blockRows - 1;
+        for (int x = 0; x < heightfield.columns; ++x) {
+            uint16_t sample = row[x];
+            if (sample < lowest) lowest = sample;
+            if (sample > highest) highest = sample;
+            int firstBlockColumn = x > 0 ? (x - 1) / B : 0;
+            int lastBlockColumn = x < cellColumns ? x / B : heightfield.blockColumns - 1;
+            for (int bz = firstBlockRow; bz <= lastBlockRow; ++bz) {
+                for (int bx = firstBlockColumn; bx <= lastBlockColumn; ++bx) {
+                    size_t block = (size_t)bz * heightfield.blockColumns + bx;
+                    if (sample < heightfield.blockMin[block]) heightfield.blockMin[block] = sample;
+                    if (sample > heightfield.blockMax[block]) heightfield.blockMax[block] = sample;
+                }
+            }
+        }
+    }
+
+    heightfield.boundsMin = HMM_Vec3(heightfield.originX,
+                                     heightfield.minHeight + lowest * heightfield.heightStep,
+                                     heightfield.originZ);
+    heightfield.boundsMax = HMM_Vec3(heightfield.originX + cellColumns * heightfield.cellSize,
+                                     heightfield.minHeight + highest * heightfield.heightStep,
+                                     heightfield.originZ + cellRows * heightfield.cellSize);
+
+    // FNV-1a over the grid's layout and samples
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+    mix(&heightfield.columns, sizeof(int));
+    mix(&heightfield.rows, sizeof(int));
+    mix(&heightfield.cellSize, sizeof(float));
+    mix(&heightfield.originX, sizeof(float));
+    mix(&heightfield.originZ, sizeof(float));
+    mix(&heightfield.minHeight, sizeof(float));
+    mix(&heightfield.heightStep, sizeof(float));
+    mix(heightfield.samples.data(), heightfield.samples.size() * sizeof(uint16_t));
+    heightfield.contentHash = hash;
+}
+
+bool BuildHeightfieldFromModel(const Model3D& model, float cellSize, Heightfield& out) {
+    if (model.vertex_count == 0 || model.index_count < 3 || !(cellSize > 0.0f)) {
+        printf("ERROR: Heightfield needs a model with triangles and a positive cell size\n");
+        return false;
+    }
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxZ = -FLT_MAX;
+    for (int i = 0; i < model.vertex_count; ++i) {
+        const float* pos = model.vertices[i].pos;
+        minX = Min(minX, pos[0]); maxX = Max(maxX, pos[0]);
+        minY = Min(minY, pos[1]);
+        minZ = Min(minZ, pos[2]); maxZ = Max(maxZ, pos[2]);
+    }
+    int64_t columns = (int64_t)ceilf((maxX - minX) / cellSize) + 1;
+    int64_t rows = (int64_t)ceilf((maxZ - minZ) / cellSize) + 1;
+    if (columns < 2) columns = 2;
+    if (rows < 2) rows = 2;
+    if (columns * rows > kMaxHeightfieldSamples) {
+        printf("ERROR: Heightfield of %lld x %lld samples is too large; use a larger cell size\n",
+               (long long)columns, (long long)rows);
+        return false;
+    }
+
+    // Each triangle fills in the samples inside its XZ shadow
+    std::vector<float> heights((size_t)(columns * rows), -FLT_MAX);
+    const float invCell = 1.0f / cellSize;
+    for (int i = 0; i + 2 < model.index_count; i += 3) {
+        const float* a = model.vertices[model.indices[i + 0]].pos;
+        const float* b = model.vertices[model.indices[i + 1]].pos;
+        const float* c = model.vertices[model.indices[i + 2]].pos;
+        float area = (b[0] - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (b[2] - a[2]);
+        if (fabsf(area) < 1e-12f) continue;  // Wall: no height of its own
+        float invArea = 1.0f / area;
+
+        int x0 = (int)ceilf((Min(a[0], Min(b[0], c[0])) - minX) * invCell);
+        int x1 = (int)floorf((Max(a[0], Max(b[0], c[0])) - minX) * invCell);
+        int z0 = (int)ceilf((Min(a[2], Min(b[2], c[2])) - minZ) * invCell);
+        int z1 = (int)floorf((Max(a[2], Max(b[2], c[2])) - minZ) * invCell);
+        if (x1 >= columns) x1 = (int)columns - 1;
+        if (z1 >= rows) z1 = (int)rows - 1;
+        for (int z = z0 < 0 ? 0 : z0; z <= z1; ++z) {
+            float pz = minZ + z * cellSize;
+            for (int x = x0 < 0 ? 0 : x0; x <= x1; ++x) {
+                float px = minX + x * cellSize;
+                // Barycentric weights in XZ; a little slack keeps shared
+                // edges covered
+                float wb = ((px - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (pz - a[2])) * invArea;
+                float wc = ((b[0] - a[0]) * (pz - a[2]) - (px - a[0]) * (b[2] - a[2])) * invArea;
+                float wa = 1.0f - wb - wc;
+                if (wa < -1e-5f || wb < -1e-5f || wc < -1e-5f) continue;
+                float y = wa * a[1] + wb * b[1] + wc * c[1];
+                float& height = heights[(size_t)z * columns + x];
+                if (y > height) height = y;
+            }
+        }
+    }
+    for (float& height : heights) {
+        if (height == -FLT_MAX) height = minY;
+    }
+    return BuildHeightfield(heights.data(), (int)columns, (int)rows, cellSize, minX, minZ, out);
+}
+
+bool BuildHeightfieldFromImage(const char* path, float cellSize, float heightScale, Heightfield& out) {
+    int width, height, channels;
+    stbi_us* pixels = stbi_load_16(path, &width, &height, &channels, 1);
+    if (!pixels) {
+        printf("ERROR: Failed to load heightmap: %s\n", path);
+        printf("STB Error: %s\n", stbi_failure_reason());
+        return false;
+    }
+
+    std::vector<float> heights((size_t)width * height);
+    const float scale = heightScale / 65535.0f;
+    for (size_t i = 0; i < heights.size(); ++i) {
+        heights[i] = pixels[i] * scale;
+    }
+    stbi_image_free(pixels);
+
+    float originX = -0.5f * (width - 1) * cellSize;
+    float originZ = -0.5f * (height - 1) * cellSize;
+    if (!BuildHeightfield(heights.data(), width, height, cellSize, originX, originZ, out)) return false;
+    printf("Loaded heightmap: %s (%dx%d)\n", path, width, height);
+    return true;
+}
+
+// -- Queries -------------------------------------------------------------------
+
+bool HeightfieldTriangleAt(const Heightfield& heightfield, float x, float z, hmm_vec3 outTriangle[3]) {
+    if (heightfield.samples.empty()) return false;
+    float fx = (x - heightfield.originX) / heightfield.cellSize;
+    float fz = (z - heightfield.originZ) / heightfield.cellSize;
+    if (!(fx >= 0.0f && fz >= 0.0f && fx <= (float)(heightfield.columns - 1) && fz <= (float)(heightfield.rows - 1))) {
+        return false;
+    }
+    int cellX = (int)fx < heightfield.columns - 2 ? (int)fx : heightfield.columns - 2;
+    int cellZ = (int)fz < heightfield.rows - 2 ? (int)fz : heightfield.rows - 2;
+    hmm_vec3 triangles[2][3];
+    HeightfieldCellTriangles(heightfield, cellX, cellZ, triangles);
+    int half = (fz - cellZ) >= (fx - cellX) ? 0 : 1;
+    for (int i = 0; i < 3; ++i) outTriangle[i] = triangles[half][i];
+    return true;
+}
+
+// Möller-Trumbore with ECS::RayTriangleIntersect()'s epsilons
+static bool RayTriangle(const hmm_vec3& origin, const hmm_vec3& direction, const hmm_vec3& v0,
+                        const hmm_vec3& v1, const hmm_vec3& v2, float* outDistance) {
+    hmm_vec3 edge1 = HMM_SubtractVec3(v1, v0);
+    hmm_vec3 edge2 = HMM_SubtractVec3(v2, v0);
+    hmm_vec3 h = HMM_Cross(direction, edge2);
+    float a = HMM_DotVec3(edge1, h);
+    if (a > -kRayEpsilon && a < kRayEpsilon) return false;
+
+    float f = 1.0f / a;
+    hmm_vec3 s = HMM_SubtractVec3(origin, v0);
+    float u = f * HMM_DotVec3(s, h);
+    if (u < -kRayEdgeTolerance || u > 1.0f + kRayEdgeTolerance) return false;
+
+    hmm_vec3 q = HMM_Cross(s, edge1);
+    float v = f * HMM_DotVec3(direction, q);
+    if (v < -kRayEdgeTolerance || u + v > 1.0f + kRayEdgeTolerance) return false;
+
+    *outDistance = f * HMM_DotVec3(edge2, q);
+    return *outDistance > kRayEpsilon;
+}
+
+// Squares of `size` numbered from (0, 0) at the origin, countX by countZ.
+// Calls visit(x, z, tEnter, tExit) for each square the ray's XZ projection
+// crosses between tStart and tEnd, nearest first, until visit returns true.
+template <typename Visit>
+static bool WalkSquares(float originX, float originZ, float dirX, float dirZ, float size, int countX, int countZ,
+                        float tStart, float tEnd, Visit&& visit) {
+    const float invSize = 1.0f / size;
+    int x = (int)floorf((originX + dirX * tStart) * invSize);
+    int z = (int)floorf((originZ + dirZ * tStart) * invSize);
+    x = x < 0 ? 0 : (x >= countX ? countX - 1 : x);
+    z = z < 0 ? 0 : (z >= countZ ? countZ - 1 : z);
+
+    // Ray distance to the next square boundary on each axis and between two
+    const int stepX = dirX > 0.0f ? 1 : -1;
+    const int stepZ = dirZ > 0.0f ? 1 : -1;
+    float nextX = dirX != 0.0f ? ((x + (dirX > 0.0f ? 1 : 0)) * size - originX) / dirX : FLT_MAX;
+    float nextZ = dirZ != 0.0f ? ((z + (dirZ > 0.0f ? 1 : 0)) * size - originZ) / dirZ : FLT_MAX;
+    const float deltaX = dirX != 0.0f ? size / fabsf(dirX) : FLT_MAX;
+    const float deltaZ = dirZ != 0.0f ? size / fabsf(dirZ) : FLT_MAX;
+
+    float t = tStart;
+    for (;;) {
+        float exit = Min(Min(nextX, nextZ), tEnd);
+        if (exit < t) exit = t;
+        if (visit(x, z, t, exit)) return true;
+        if (exit >= tEnd) return false;
+        t = exit;
+        if (nextX < nextZ) {
+            x += stepX;
+            if (x < 0 || x >= countX) return false;
+            nextX += deltaX;
+        } else {
+            z += stepZ;
+            if (z < 0 || z >= countZ) return false;
+            nextZ += deltaZ;
+        }
+    }
+}
+
+int RayHeightfield(const Heightfield& heightfield, const hmm_vec3& origin, const hmm_vec3& direction,
+                   float* inOutDistance) {
+    if (heightfield.samples.empty()) return -1;
+
+    // Clip the ray to the field's box first (slab test)
+    float tStart = 0.0f, tEnd = *inOutDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        float o = origin.Elements[axis], d = direction.Elements[axis];
+        float lo = heightfield.boundsMin.Elements[axis], hi = heightfield.boundsMax.Elements[axis];
+        if (d == 0.0f) {
+            if (o < lo || o > hi) return -1;
+            continue;
+        }
+        float t0 = (lo - o) / d, t1 = (hi - o) / d;
+        if (t0 > t1) { float swap = t0; t0 = t1; t1 = swap; }
+        tStart = Max(tStart, t0);
+        tEnd = Min(tEnd, t1);
+    }
+    if (tStart > tEnd) return -1;
+
+    // Heights the ray spans between two distances, with rounding slack
+    const float slack = heightfield.heightStep + 1e-4f;
+    auto spans = [&](float tEnter, float tExit, uint16_t lo, uint16_t hi) {
+        float y0 = origin.Y + direction.Y * tEnter, y1 = origin.Y + direction.Y * tExit;
+        return Min(y0, y1) <= heightfield.minHeight + hi * heightfield.heightStep + slack &&
+               Max(y0, y1) >= heightfield.minHeight + lo * heightfield.heightStep - slack;
+    };
+
+    const int B = kHeightfieldBlockCells;
+    const int cellColumns = heightfield.columns - 1;
+    const int cellRows = heightfield.rows - 1;
+    const float localX = origin.X - heightfield.originX;
+    const float localZ = origin.Z - heightfield.originZ;
+    const float blockSize = heightfield.cellSize * B;
+    int hitIndex = -1;
+    float hitDistance = *inOutDistance;
+
+    WalkSquares(localX, localZ, direction.X, direction.Z, blockSize, heightfield.blockColumns, heightfield.blockRows,
+                tStart, tEnd, [&](int bx, int bz, float blockEnter, float blockExit) {
+        size_t block = (size_t)bz * heightfield.blockColumns + bx;
+        if (!spans(blockEnter, blockExit, heightfield.blockMin[block], heightfield.blockMax[block])) return false;
+
+        // The block's cells, walked from the block's corner
+        const int firstX = bx * B, firstZ = bz * B;
+        const int countX = cellColumns - firstX < B ? cellColumns - firstX : B;
+        const int countZ = cellRows - firstZ < B ? cellRows - firstZ : B;
+        return WalkSquares(localX - firstX * heightfield.cellSize, localZ - firstZ * heightfield.cellSize,
+                           direction.X, direction.Z, heightfield.cellSize, countX, countZ, blockEnter, blockExit,
+                           [&](int cx, int cz, float cellEnter, float cellExit) {
+            const int x = firstX + cx, z = firstZ + cz;
+            const uint16_t* row = &heightfield.samples[(size_t)z * heightfield.columns];
+            const uint16_t* next = row + heightfield.columns;
+            uint16_t lo = row[x], hi = row[x];
+            for (uint16_t sample : { row[x + 1], next[x], next[x + 1] }) {
+                if (sample < lo) lo = sample;
+                if (sample > hi) hi = sample;
+            }
+            if (!spans(cellEnter, cellExit, lo, hi)) return false;
+
+            // A hit is inside this cell, so no later cell can be nearer
+            hmm_vec3 triangles[2][3];
+            HeightfieldCellTriangles(heightfield, x, z, triangles);
+            for (int half = 0; half < 2; ++half) {
+                float t;
+                if (RayTriangle(origin, direction, triangles[half][0], triangles[half][1], triangles[half][2], &t) &&
+                    t < hitDistance) {
+                    hitDistance = t;
+                    hitIndex = 2 * (z * cellColumns + x) + half;
+                }
+            }
+            return hitIndex >= 0;
+        });
+    });
+
+    if (hitIndex >= 0) *inOutDistance = hitDistance;
+    return hitIndex;
+}
+
+// -- Registry ------------------------------------------------------------------
+
+int HeightfieldRegistry::Add(Heightfield&& heightfield) {
+    if (heightfield.samples.empty()) return kInvalidHandle;
+
+    auto range = byContent_.equal_range(heightfield.contentHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Heightfield& known = fields_[it->second];
+        if (known.columns == heightfield.columns && known.rows == heightfield.rows &&
+            known.cellSize == heightfield.cellSize && known.originX == heightfield.originX &&
+            known.originZ == heightfield.originZ && known.minHeight == heightfield.minHeight &&
+            known.heightStep == heightfield.heightStep && known.samples == heightfield.samples) {
+            return it->second;
+        }
+    }
+
+    int handle = (int)fields_.size();
+    byContent_.emplace(heightfield.contentHash, handle);
+    fields_.push_back(std::move(heightfield));
+    return handle;
+}
+
+size_t HeightfieldRegistry::MemoryBytes() const {
+    size_t bytes = fields_.capacity() * sizeof(Heightfield);
+    for (const Heightfield& heightfield : fields_) {
+        bytes += heightfield.samples.capacity() * sizeof(uint16_t);
+        bytes += (heightfield.blockMin.capacity() + heightfield.blockMax.capacity()) * sizeof(uint16_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Components.h"
+#include "../../include/Model.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// HEIGHTFIELD - Terrain collider over a regular grid of heights
+// ============================================================================
+// Samples sit every cellSize along the heightfield's local X and Z, starting
+// at (originX, originZ), and each is a uint16_t step between minHeight and
+// the highest sample. A cell is two triangles split along the diagonal from
+// its (x, z) corner to its (x + 1, z + 1) corner; the ground under them is
+// solid, so contacts push shapes that sink into it back up, never down.
+//
+// Nothing is searched. The cells under a box come from dividing by the cell
+// size (ForEachHeightfieldTriangle()), and a ray walks the cells its XZ
+// projection crosses in order (a 2D DDA), so the first hit ends it. Blocks
+// of kHeightfieldBlockCells x kHeightfieldBlockCells cells keep their
+// height range, which lets the walk step over whole blocks the ray passes
+// above or below.
+//
+// Like collision meshes, heightfields are shared by handle
+// (Collider::heightfieldHandle), stay in local space (queries are moved into
+// it through the entity's inverse transform) and are never removed.
+
+constexpr int kHeightfieldBlockCells = 16;
+
+struct Heightfield {
+    int columns = 0;  // Samples along X
+    int rows = 0;     // Samples along Z
+    float cellSize = 1.0f;
+    float originX = 0.0f;  // Local position of sample (0, 0)
+    float originZ = 0.0f;
+    float minHeight = 0.0f;
+    float heightStep = 0.0f;         // Height of one sample unit
+    std::vector<uint16_t> samples;   // rows * columns, one row of X samples after another
+
+    // Lowest and highest sample of each block of cells, blockColumns per row
+    int blockColumns = 0;
+    int blockRows = 0;
+    std::vector<uint16_t> blockMin;
+    std::vector<uint16_t> blockMax;
+
+    hmm_vec3 boundsMin{0.0f, 0.0f, 0.0f};
+    hmm_vec3 boundsMax{0.0f, 0.0f, 0.0f};
+    uint64_t contentHash = 0;  // Of the grid and its samples, for HeightfieldRegistry::Add()
+
+    float Height(int x, int z) const {
+        return minHeight + samples[(size_t)z * columns + x] * heightStep;
+    }
+    hmm_vec3 Vertex(int x, int z) const {
+        return HMM_Vec3(originX + x * cellSize, Height(x, z), originZ + z * cellSize);
+    }
+};
+
+// Quantizes `heights` (rows * columns, one row of X samples after another)
+// into `out` and fills in its blocks and bounds. False for fewer than 2 x 2
+// samples or a cell size that isn't positive.
+bool BuildHeightfield(const float* heights, int columns, int rows, float cellSize,
+                      float originX, float originZ, Heightfield& out);
+
+// Blocks, bounds and hash of a heightfield whose grid and samples are set
+void FinishHeightfield(Heightfield& heightfield);
+
+// Samples the model's upward-facing surface every cellSize across its XZ
+// bounds (the highest triangle over each sample wins; samples no triangle
+// covers get the model's lowest point). A ground quad from
+// QuadGeometry::CreateGroundQuad() gives a flat field of its size.
+bool BuildHeightfieldFromModel(const Model3D& model, float cellSize, Heightfield& out);
+
+// Greyscale image (8 or 16 bits, other images are converted) as heights:
+// one sample per pixel, black at 0 and white at heightScale, image rows
+// along +Z. The field is centred on the origin.
+bool BuildHeightfieldFromImage(const char* path, float cellSize, float heightScale, Heightfield& out);
+
+// The two triangles of cell (x, z), wound so their normals point up
+inline void HeightfieldCellTriangles(const Heightfield& heightfield, int x, int z, hmm_vec3 outTriangles[2][3]) {
+    hmm_vec3 v00 = heightfield.Vertex(x, z);
+    hmm_vec3 v10 = heightfield.Vertex(x + 1, z);
+    hmm_vec3 v01 = heightfield.Vertex(x, z + 1);
+    hmm_vec3 v11 = heightfield.Vertex(x + 1, z + 1);
+    outTriangles[0][0] = v00; outTriangles[0][1] = v01; outTriangles[0][2] = v11;
+    outTriangles[1][0] = v00; outTriangles[1][1] = v11; outTriangles[1][2] = v10;
+}
+
+// Triangle under local (x, z), false outside the field
+bool HeightfieldTriangleAt(const Heightfield& heightfield, float x, float z, hmm_vec3 outTriangle[3]);
+
+// Closest triangle hit by origin + t * direction (local space) with
+// epsilon < t < *inOutDistance. Returns its index (2 * cell + half, cells
+// numbered like samples without the last column) and shortens
+// *inOutDistance, or returns -1.
+int RayHeightfield(const Heightfield& heightfield, const hmm_vec3& origin, const hmm_vec3& direction,
+                   float* inOutDistance);
+
+// Calls func(v0, v1, v2) for both triangles of every cell whose XZ square and
+// height range overlap [boxMin, boxMax] (local space)
+template <typename Func>
+void ForEachHeightfieldTriangle(const Heightfield& heightfield, const hmm_vec3& boxMin, const hmm_vec3& boxMax,
+                                Func&& func) {
+    if (heightfield.samples.empty()) return;
+    const float invCell = 1.0f / heightfield.cellSize;
+    const int lastCell[2] = { heightfield.columns - 2, heightfield.rows - 2 };
+    int first[2], last[2];
+    const float origin[2] = { heightfield.originX, heightfield.originZ };
+    for (int axis = 0; axis < 2; ++axis) {
+        const int element = axis * 2;  // X, then Z
+        float lo = (boxMin.Elements[element] - origin[axis]) * invCell;
+        float hi = (boxMax.Elements[element] - origin[axis]) * invCell;
+        if (hi < 0.0f || lo > (float)(lastCell[axis] + 1)) return;
+        first[axis] = lo > 0.0f ? (int)lo : 0;
+        last[axis] = hi < (float)lastCell[axis] ? (int)hi : lastCell[axis];
+    }
+
+    hmm_vec3 triangles[2][3];
+    for (int z = first[1]; z <= last[1]; ++z) {
+        const uint16_t* row = &heightfield.samples[(size_t)z * heightfield.columns];
+        const uint16_t* next = row + heightfield.columns;
+        for (int x = first[0]; x <= last[0]; ++x) {
+            uint16_t lo = row[x], hi = row[x];
+            for (uint16_t sample : { row[x + 1], next[x], next[x + 1] }) {
+                if (sample < lo) lo = sample;
+                if (sample > hi) hi = sample;
+            }
+            if (heightfield.minHeight + hi * heightfield.heightStep < boxMin.Y ||
+                heightfield.minHeight + lo * heightfield.heightStep > boxMax.Y) {
+                continue;
+            }
+            HeightfieldCellTriangles(heightfield, x, z, triangles);
+            func(triangles[0][0], triangles[0][1], triangles[0][2]);
+            func(triangles[1][0], triangles[1][1], triangles[1][2]);
+        }
+    }
+}
+
+class HeightfieldRegistry {
+public:
+    static constexpr int kInvalidHandle = -1;
+
+    // Takes a finished heightfield; one identical to a registered field
+    // (as when a scene snapshot is loaded again) returns that field instead
+    int Add(Heightfield&& heightfield);
+
+    const Heightfield* Get(int handle) const {
+        return handle >= 0 && handle < (int)fields_.size() ? &fields_[handle] : nullptr;
+    }
+
+    int Count() const { return (int)fields_.size(); }
+
+    // Heap bytes held by all heightfields
+    size_t MemoryBytes() const;
+
+private:
+    std::vector<Heightfield> fields_;
+    std::unordered_multimap<uint64_t, int> byContent_;  // contentHash -> handle
+};
@@ -0,0 +1,333 @@
+#include "MeshBVH.h"
+#include "RayKernels.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+// Centroid bins per axis when looking for a split
+static constexpr int kBinCount = 12;
+
+// Cost of visiting an inner node and of testing one triangle. Leaves are
+// tested eight triangles per RayTrianglePacket() call, which makes
+// triangles cheap next to the two box tests and the branch of a node.
+static constexpr float kTraversalCost = 1.0f;
+static constexpr float kTriangleCost = 0.3f;
+
+// Leaves may stay this big when splitting them would not pay off
+static constexpr uint32_t kMaxLeafTriangles = 8;
+
+// std::min/max rather than fminf/fmaxf: the build runs these a few dozen
+// times per triangle and level, and without fast-math the latter are calls
+static hmm_vec3 MinVec3(const hmm_vec3& a, const hmm_vec3& b) {
+    return HMM_Vec3(std::min(a.X, b.X), std::min(a.Y, b.Y), std::min(a.Z, b.Z));
+}
+
+static hmm_vec3 MaxVec3(const hmm_vec3& a, const hmm_vec3& b) {
+    return HMM_Vec3(std::max(a.X, b.X), std::max(a.Y, b.Y), std::max(a.Z, b.Z));
+}
+
+// Half the surface area; only ever compared against itself
+static float Area(const hmm_vec3& min, const hmm_vec3& max) {
+    hmm_vec3 d = HMM_SubtractVec3(max, min);
+    return d.X * d.Y + d.Y * d.Z + d.Z * d.X;
+}
+
+namespace {
+
+struct Bounds {
+    hmm_vec3 min = HMM_Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    hmm_vec3 max = HMM_Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    void Grow(const hmm_vec3& point) {
+        min = MinVec3(min, point);
+        max = MaxVec3(max, point);
+    }
+    void Grow(const Bounds& other) {
+        min = MinVec3(min, other.min);
+        max = MaxVec3(max, other.max);
+    }
+    float HalfArea() const { return min.X > max.X ? 0.0f : Area(min, max); }
+};
+
+// Triangle as the build sees it; these are partitioned in place
+struct BuildTriangle {
+    Bounds bounds;
+    hmm_vec3 centroid;
+    uint32_t index;
+};
+
+struct Bin {
+    Bounds bounds;
+    uint32_t count = 0;
+};
+
+// Range of build triangles still to be turned into a subtree. A second
+// child records its parent, whose offset is only known once the first
+// child's subtree has been laid out.
+struct BuildTask {
+    uint32_t first;
+    uint32_t count;
+    int depth;
+    int parent;
+};
+
+} // namespace
+
+void BuildMeshBVH(std::vector<CollisionTriangle>& triangles, std::vector<MeshBVHNode>& outNodes) {
+    outNodes.clear();
+    if (triangles.empty()) return;
+
+    const uint32_t triangleCount = (uint32_t)triangles.size();
+    std::vector<BuildTriangle> build(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; ++i) {
+        const CollisionTriangle& tri = triangles[i];
+        build[i].bounds.Grow(tri.v0);
+        build[i].bounds.Grow(tri.v1);
+        build[i].bounds.Grow(tri.v2);
+        build[i].centroid = HMM_MultiplyVec3f(HMM_AddVec3(HMM_AddVec3(tri.v0, tri.v1), tri.v2), 1.0f / 3.0f);
+        build[i].index = i;
+    }
+
+    outNodes.reserve(2 * (triangleCount / 2 + 1));
+    std::vector<BuildTask> tasks;
+    tasks.push_back({ 0, triangleCount, 0, -1 });
+    while (!tasks.empty()) {
+        BuildTask task = tasks.back();
+        tasks.pop_back();
+
+        const uint32_t index = (uint32_t)outNodes.size();
+        if (task.parent >= 0) outNodes[task.parent].offset = index;
+        outNodes.emplace_back();
+
+        Bounds bounds;
+        Bounds centroidBounds;
+        for (uint32_t i = task.first; i < task.first + task.count; ++i) {
+            bounds.Grow(build[i].bounds);
+            centroidBounds.Grow(build[i].centroid);
+        }
+        outNodes[index].min = bounds.min;
+        outNodes[index].max = bounds.max;
+
+        // Cheapest binned split over all three axes
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = FLT_MAX;
+        for (int axis = 0; axis < 3 && task.count > 1; ++axis) {
+            float lo = centroidBounds.min.Elements[axis];
+            float extent = centroidBounds.max.Elements[axis] - lo;
+            if (extent <= 0.0f) continue;
+
+            Bin bins[kBinCount];
+            float scale = kBinCount / extent;
+            for (uint32_t i = task.first; i < task.first + task.count; ++i) {
+                int b = std::min(kBinCount - 1, (int)((build[i].centroid.Elements[axis] - lo) * scale));
+                bins[b].bounds.Grow(build[i].bounds);
+                ++bins[b].count;
+            }
+
+            // Sweep from the right to know each right half's area, then from
+            // the left pricing every plane
+            float rightArea[kBinCount];
+            uint32_t rightCount[kBinCount];
+            Bounds right;
+            uint32_t count = 0;
+            for (int b = kBinCount - 1; b > 0; --b) {
+                right.Grow(bins[b].bounds);
+                count += bins[b].count;
+                rightArea[b] = right.HalfArea();
+                rightCount[b] = count;
+            }
+            Bounds left;
+            count = 0;
+            for (int b = 0; b < kBinCount - 1; ++b) {
+                left.Grow(bins[b].bounds);
+                count += bins[b].count;
+                if (count == 0 || rightCount[b + 1] == 0) continue;
+                float cost = left.HalfArea() * count + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+
+        // Leaf if no split is possible, none beats testing every triangle
+        // (costs scaled by the node's area) and the leaf is small enough,
+        // or the tree has reached the depth traversal can handle
+        float area = bounds.HalfArea();
+        bool noGain = area <= 0.0f || kTraversalCost + kTriangleCost * bestCost / area >= kTriangleCost * task.count;
+        if (bestAxis < 0 || (noGain && task.count <= kMaxLeafTriangles) || task.depth + 1 >= kMaxMeshBVHDepth) {
+            outNodes[index].offset = task.first;
+            outNodes[index].count = task.count;
+            continue;
+        }
+
+        float lo = centroidBounds.min.Elements[bestAxis];
+        float scale = kBinCount / (centroidBounds.max.Elements[bestAxis] - lo);
+        BuildTriangle* begin = build.data() + task.first;
+        BuildTriangle* middle = std::partition(begin, begin + task.count, [&](const BuildTriangle& tri) {
+            int b = std::min(kBinCount - 1, (int)((tri.centroid.Elements[bestAxis] - lo) * scale));
+            return b < bestSplit;
+        });
+        uint32_t leftCount = (uint32_t)(middle - begin);
+        if (leftCount == 0 || leftCount == task.count) {
+            outNodes[index].offset = task.first;
+            outNodes[index].count = task.count;
+            continue;
+        }
+
+        // Second child first so the first one is laid out right after us
+        outNodes[index].count = 0;
+        tasks.push_back({ task.first + leftCount, task.count - leftCount, task.depth + 1, (int)index });
+        tasks.push_back({ task.first, leftCount, task.depth + 1, -1 });
+    }
+
+    std::vector<CollisionTriangle> sorted(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; ++i) sorted[i] = triangles[build[i].index];
+    triangles.swap(sorted);
+}
+
+// Distance at which the ray enters the box, if it does before maxDistance
+static bool RayEntersBox(const hmm_vec3& origin, const hmm_vec3& inverseDirection, float maxDistance,
+                         const MeshBVHNode& node, float* outEntry) {
+    float tmin = 0.0f;
+    float tmax = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t1 = (node.min.Elements[axis] - origin.Elements[axis]) * inverseDirection.Elements[axis];
+        float t2 = (node.max.Elements[axis] - origin.Elements[axis]) * inverseDirection.Elements[axis];
+        // A NaN from 0 * inf (ray parallel to a slab face) fails every
+        // comparison, so std::min/max with the running value first keep
+        // that value; unlike fminf/fmaxf they compile to single instructions
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
+    }
+    *outEntry = tmin;
+    return tmin <= tmax;
+}
+
+// Möller-Trumbore, same tolerances as ECS::RayTriangleIntersect()
+static bool RayTriangle(const hmm_vec3& origin, const hmm_vec3& direction,
+                        const CollisionTriangle& tri, float* outDistance) {
+    const float EPSILON = 0.0000001f;
+
+    hmm_vec3 edge1 = HMM_SubtractVec3(tri.v1, tri.v0);
+    hmm_vec3 edge2 = HMM_SubtractVec3(tri.v2, tri.v0);
+    hmm_vec3 h = HMM_Cross(direction, edge2);
+    float a = HMM_DotVec3(edge1, h);
+    if (a > -EPSILON && a < EPSILON) return false;
+
+    float f = 1.0f / a;
+    hmm_vec3 s = HMM_SubtractVec3(origin, tri.v0);
+    float u = f * HMM_DotVec3(s, h);
+    if (u < -kRayEdgeTolerance || u > 1.0f + kRayEdgeTolerance) return false;
+
+    hmm_vec3 q = HMM_Cross(s, edge1);
+    float v = f * HMM_DotVec3(direction, q);
+    if (v < -kRayEdgeTolerance || u + v > 1.0f + kRayEdgeTolerance) return false;
+
+    float t = f * HMM_DotVec3(edge2, q);
+    if (t <= EPSILON) return false;
+    *outDistance = t;
+    return true;
+}
+
+int RayMeshBVH(const MeshBVHNode* nodes, size_t nodeCount, const CollisionTriangle* triangles,
+               const TrianglePacket* packets, const hmm_vec3& origin, const hmm_vec3& direction,
+               float* inOutDistance) {
+    if (nodeCount == 0) return -1;
+
+    hmm_vec3 inverse = HMM_Vec3(1.0f / direction.X, 1.0f / direction.Y, 1.0f / direction.Z);
+    float closest = *inOutDistance;
+    int hitTriangle = -1;
+
+    float entry;
+    if (!RayEntersBox(origin, inverse, closest, nodes[0], &entry)) return -1;
+
+    // Far children waiting for a visit, with the distance they start at.
+    // At most one per level of the current path.
+    struct Pending {
+        uint32_t node;
+        float entry;
+    };
+    Pending stack[kMaxMeshBVHDepth];
+    int stackSize = 0;
+
+    uint32_t index = 0;
+    for (;;) {
+        const MeshBVHNode& node = nodes[index];
+        if (node.count > 0 && packets) {
+            // The leaf's lanes of each packet it overlaps
+            const uint32_t end = node.offset + node.count;
+            for (uint32_t first = node.offset; first < end;) {
+                uint32_t packet = first / kRayPacketWidth;
+                uint32_t lane = first % kRayPacketWidth;
+                uint32_t lanes = std::min(end - first, kRayPacketWidth - lane);
+                float distances[kRayPacketWidth];
+                uint32_t hits = RayTrianglePacket(packets[packet], origin, direction, closest,
+                                                  ((1u << lanes) - 1) << lane, distances);
+                for (int l = 0; hits != 0; ++l, hits >>= 1) {
+                    if ((hits & 1) && distances[l] < closest) {
+                        closest = distances[l];
+                        hitTriangle = (int)(packet * kRayPacketWidth + l);
+                    }
+                }
+                first += lanes;
+            }
+        } else if (node.count > 0) {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                float t;
+                if (RayTriangle(origin, direction, triangles[i], &t) && t < closest) {
+                    closest = t;
+                    hitTriangle = (int)i;
+                }
+            }
+        } else {
+            uint32_t nearChild = index + 1;
+            uint32_t farChild = node.offset;
+            float nearEntry, farEntry;
+            bool hitNear = RayEntersBox(origin, inverse, closest, nodes[nearChild], &nearEntry);
+            bool hitFar = RayEntersBox(origin, inverse, closest, nodes[farChild], &farEntry);
+            if (hitNear && hitFar) {
+                if (farEntry < nearEntry) {
+                    std::swap(nearChild, farChild);
+                    std::swap(nearEntry, farEntry);
+                }
+                stack[stackSize++] = { farChild, farEntry };
+                index = nearChild;
+                continue;
+            }
+            if (hitNear || hitFar) {
+                index = hitNear ? nearChild : farChild;
+                continue;
+            }
+        }
+
+        // Next waiting subtree that still starts before the closest hit
+        while (stackSize > 0 && stack[stackSize - 1].entry > closest) --stackSize;
+        if (stackSize == 0) break;
+        index = stack[--stackSize].node;
+    }
+
+    if (hitTriangle >= 0) *inOutDistance = closest;
+    return hitTriangle;
+}
+
+bool ValidateMeshBVH(const MeshBVHNode* nodes, size_t nodeCount, size_t triangleCount) {
+    // Children always come after their parent, so one forward pass sees
+    // every parent before its children
+    std::vector<int> depth(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const MeshBVHNode& node = nodes[i];
+        if (depth[i] >= kMaxMeshBVHDepth) return false;
+        if (node.count > 0) {
+            if ((uint64_t)node.offset + node.count > triangleCount) return false;
+            continue;
+        }
+        if (i + 1 >= nodeCount || node.offset <= i + 1 || node.offset >= nodeCount) return false;
+        depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+        depth[node.offset] = std::max(depth[node.offset], depth[i] + 1);
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Components.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// MESH BVH - Static bounding volume hierarchy over a mesh collider's triangles
+// ============================================================================
+// Built once when the collider is created. Splits are chosen with the
+// surface area heuristic: triangle centroids are binned along each axis and
+// the plane with the lowest expected cost of tracing a ray through both
+// halves wins; a node becomes a leaf when no split beats testing its
+// triangles directly. The triangles are reordered so every leaf covers one
+// contiguous range, and the nodes are flattened depth-first into 32-byte
+// MeshBVHNode records (an inner node's first child is the next node).
+//
+// Traversal is an iterative loop with a fixed stack (the build caps the
+// depth at kMaxMeshBVHDepth) that enters the nearer child first and skips
+// subtrees beyond the closest hit so far. Everything works in mesh-local
+// space; callers move the ray into it.
+
+constexpr int kMaxMeshBVHDepth = 64;
+
+// Reorders `triangles` into leaf order and replaces `outNodes` with the tree
+void BuildMeshBVH(std::vector<CollisionTriangle>& triangles, std::vector<MeshBVHNode>& outNodes);
+
+// Closest triangle hit by origin + t * direction with epsilon < t < *inOutDistance.
+// Returns its index and shortens *inOutDistance, or returns -1. Leaves are
+// tested with RayTrianglePacket() when `packets` (PackTriangles() of the
+// same triangles) is given, one triangle at a time otherwise.
+int RayMeshBVH(const MeshBVHNode* nodes, size_t nodeCount, const CollisionTriangle* triangles,
+               const TrianglePacket* packets, const hmm_vec3& origin, const hmm_vec3& direction,
+               float* inOutDistance);
+
+// Calls func(first, count) for every leaf whose box overlaps [boxMin, boxMax]
+// (mesh space): triangles [first, first + count) may touch the box. Same
+// fixed-stack traversal as RayMeshBVH(), without ordering.
+template <typename Func>
+void QueryMeshBVH(const MeshBVHNode* nodes, size_t nodeCount, const hmm_vec3& boxMin, const hmm_vec3& boxMax,
+                  Func&& func) {
+    if (nodeCount == 0) return;
+    auto overlaps = [&](const MeshBVHNode& node) {
+        return node.min.X <= boxMax.X && node.max.X >= boxMin.X &&
+               node.min.Y <= boxMax.Y && node.max.Y >= boxMin.Y &&
+               node.min.Z <= boxMax.Z && node.max.Z >= boxMin.Z;
+    };
+    if (!overlaps(nodes[0])) return;
+
+    uint32_t stack[kMaxMeshBVHDepth];
+    int stackSize = 0;
+    uint32_t index = 0;
+    for (;;) {
+        const MeshBVHNode& node = nodes[index];
+        if (node.count > 0) {
+            func(node.offset, node.count);
+        } else {
+            uint32_t nearChild = index + 1;
+            uint32_t farChild = node.offset;
+            bool hitNear = overlaps(nodes[nearChild]);
+            bool hitFar = overlaps(nodes[farChild]);
+            if (hitNear && hitFar) {
+                stack[stackSize++] = farChild;
+                index = nearChild;
+                continue;
+            }
+            if (hitNear || hitFar) {
+                index = hitNear ? nearChild : farChild;
+                continue;
+            }
+        }
+        if (stackSize == 0) break;
+        index = stack[--stackSize];
+    }
+}
+
+// True if every node is in range and no deeper than traversal allows
+// (for trees that come from outside, such as scene snapshots)
+bool ValidateMeshBVH(const MeshBVHNode* nodes, size_t nodeCount, size_t triangleCount);
@@ -0,0 +1,885 @@
+#include "Narrowphase.h"
+#include "MeshBVH.h"
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+// Edge axes only win a box-box test when clearly shallower than the best
+// face axis; face contacts are the stable ones for resting boxes
+static constexpr float kEdgeAxisBias = 0.95f;
+static constexpr float kParallelEpsilon = 1e-5f;
+// Points closer than this give no direction; touching shapes take a face's
+static constexpr float kTouchDistance = 0.001f;
+
+static inline hmm_vec3 Lerp(const hmm_vec3& a, const hmm_vec3& b, float t) {
+    return HMM_AddVec3(a, HMM_MultiplyVec3f(HMM_SubtractVec3(b, a), t));
+}
+
+// fminf/fmaxf are library calls on most compilers (NaN rules); the kernels
+// call these in their inner loops
+static inline float Min(float a, float b) { return a < b ? a : b; }
+static inline float Max(float a, float b) { return a > b ? a : b; }
+
+static inline float Clamp01(float x) {
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+static inline hmm_vec3 TransformPoint(const hmm_mat4& m, const hmm_vec3& p) {
+    hmm_vec3 r;
+    for (int row = 0; row < 3; ++row) {
+        r.Elements[row] = m.Elements[0][row] * p.X + m.Elements[1][row] * p.Y +
+                          m.Elements[2][row] * p.Z + m.Elements[3][row];
+    }
+    return r;
+}
+
+// -- Manifold ----------------------------------------------------------------
+
+static inline void BeginManifold(CollisionInfo& out) {
+    out.pointCount = 0;
+    out.penetration = 0.0f;
+}
+
+// Keeps the deepest kMaxContactPoints points
+static void AddPoint(CollisionInfo& out, const hmm_vec3& point, float depth) {
+    if (out.pointCount < kMaxContactPoints) {
+        out.points[out.pointCount] = point;
+        out.depths[out.pointCount] = depth;
+        ++out.pointCount;
+    } else {
+        int shallowest = 0;
+        for (int i = 1; i < kMaxContactPoints; ++i) {
+            if (out.depths[i] < out.depths[shallowest]) shallowest = i;
+        }
+        if (depth <= out.depths[shallowest]) return;
+        out.points[shallowest] = point;
+        out.depths[shallowest] = depth;
+    }
+    if (depth > out.penetration) out.penetration = depth;
+}
+
+static bool EndManifold(CollisionInfo& out) {
+    if (out.pointCount == 0) return false;
+    hmm_vec3 sum = HMM_Vec3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < out.pointCount; ++i) sum = HMM_AddVec3(sum, out.points[i]);
+    out.contactPoint = HMM_MultiplyVec3f(sum, 1.0f / out.pointCount);
+    return true;
+}
+
+// Ball of radiusA around pointA against pointB, the closest point of B's
+// core (radiusB around it, 0 for a solid surface). `fallback` is the normal
+// when the two points coincide.
+static bool BallContact(const hmm_vec3& pointA, float radiusA, const hmm_vec3& pointB, float radiusB,
+                        const hmm_vec3& fallback, CollisionInfo& out) {
+    hmm_vec3 diff = HMM_SubtractVec3(pointA, pointB);
+    float distSq = HMM_DotVec3(diff, diff);
+    float radiusSum = radiusA + radiusB;
+    if (distSq >= radiusSum * radiusSum) return false;
+
+    float dist = sqrtf(distSq);
+    BeginManifold(out);
+    out.normal = dist > kTouchDistance ? HMM_MultiplyVec3f(diff, 1.0f / dist) : fallback;
+    float depth = radiusSum - dist;
+    AddPoint(out, HMM_SubtractVec3(pointA, HMM_MultiplyVec3f(out.normal, radiusA - depth * 0.5f)), depth);
+    return EndManifold(out);
+}
+
+// -- Closest points ----------------------------------------------------------
+
+static hmm_vec3 ClosestPointOnSegment(const hmm_vec3& p, const hmm_vec3& a, const hmm_vec3& b) {
+    hmm_vec3 ab = HMM_SubtractVec3(b, a);
+    float lengthSq = HMM_DotVec3(ab, ab);
+    if (lengthSq < kParallelEpsilon) return a;
+    return Lerp(a, b, Clamp01(HMM_DotVec3(HMM_SubtractVec3(p, a), ab) / lengthSq));
+}
+
+// Closest points of segments p1-q1 and p2-q2 (Ericson, Real-Time Collision Detection 5.1.9)
+static void ClosestPointsSegments(const hmm_vec3& p1, const hmm_vec3& q1, const hmm_vec3& p2, const hmm_vec3& q2,
+                                  hmm_vec3* outC1, hmm_vec3* outC2) {
+    hmm_vec3 d1 = HMM_SubtractVec3(q1, p1);
+    hmm_vec3 d2 = HMM_SubtractVec3(q2, p2);
+    hmm_vec3 r = HMM_SubtractVec3(p1, p2);
+    float a = HMM_DotVec3(d1, d1);
+    float e = HMM_DotVec3(d2, d2);
+    float f = HMM_DotVec3(d2, r);
+    float s, t;
+    if (a <= kParallelEpsilon && e <= kParallelEpsilon) {
+        s = t = 0.0f;
+    } else if (a <= kParallelEpsilon) {
+        s = 0.0f;
+        t = Clamp01(f / e);
+    } else {
+        float c = HMM_DotVec3(d1, r);
+        if (e <= kParallelEpsilon) {
+            t = 0.0f;
+            s = Clamp01(-c / a);
+        } else {
+            float b = HMM_DotVec3(d1, d2);
+            float denom = a * e - b * b;
+            s = denom > kParallelEpsilon ? Clamp01((b * f - c * e) / denom) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = Clamp01(-c / a);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = Clamp01((b - c) / a);
+            }
+        }
+    }
+    *outC1 = HMM_AddVec3(p1, HMM_MultiplyVec3f(d1, s));
+    *outC2 = HMM_AddVec3(p2, HMM_MultiplyVec3f(d2, t));
+}
+
+// Closest point of triangle abc to p (Ericson 5.1.5)
+static hmm_vec3 ClosestPointOnTriangle(const hmm_vec3& p, const hmm_vec3& a, const hmm_vec3& b, const hmm_vec3& c) {
+    hmm_vec3 ab = HMM_SubtractVec3(b, a);
+    hmm_vec3 ac = HMM_SubtractVec3(c, a);
+    hmm_vec3 ap = HMM_SubtractVec3(p, a);
+    float d1 = HMM_DotVec3(ab, ap);
+    float d2 = HMM_DotVec3(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    hmm_vec3 bp = HMM_SubtractVec3(p, b);
+    float d3 = HMM_DotVec3(ab, bp);
+    float d4 = HMM_DotVec3(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return HMM_AddVec3(a, HMM_MultiplyVec3f(ab, d1 / (d1 - d3)));
+    }
+
+    hmm_vec3 cp = HMM_SubtractVec3(p, c);
+    float d5 = HMM_DotVec3(ab, cp);
+    float d6 = HMM_DotVec3(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return HMM_AddVec3(a, HMM_MultiplyVec3f(ac, d2 / (d2 - d6)));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        return Lerp(b, c, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    return HMM_AddVec3(a, HMM_AddVec3(HMM_MultiplyVec3f(ab, vb * denom), HMM_MultiplyVec3f(ac, vc * denom)));
+}
+
+// Closest point of the segment to the triangle and the matching point on
+// the triangle; returns false if the segment passes through it
+static bool ClosestPointsSegmentTriangle(const hmm_vec3& p, const hmm_vec3& q, const hmm_vec3& a, const hmm_vec3& b,
+                                         const hmm_vec3& c, hmm_vec3* outOnSegment, hmm_vec3* outOnTriangle) {
+    hmm_vec3 normal = HMM_Cross(HMM_SubtractVec3(b, a), HMM_SubtractVec3(c, a));
+    float sp = HMM_DotVec3(HMM_SubtractVec3(p, a), normal);
+    float sq = HMM_DotVec3(HMM_SubtractVec3(q, a), normal);
+    if ((sp < 0.0f) != (sq < 0.0f)) {
+        // Crosses the plane: inside the triangle means they intersect
+        hmm_vec3 hit = Lerp(p, q, sp / (sp - sq));
+        hmm_vec3 onTriangle = ClosestPointOnTriangle(hit, a, b, c);
+        hmm_vec3 gap = HMM_SubtractVec3(hit, onTriangle);
+        if (HMM_DotVec3(gap, gap) < kParallelEpsilon) {
+            *outOnSegment = hit;
+            *outOnTriangle = hit;
+            return false;
+        }
+    }
+
+    // Otherwise the closest pair involves an endpoint or a triangle edge
+    float bestSq = FLT_MAX;
+    auto consider = [&](const hmm_vec3& onSegment, const hmm_vec3& onTriangle) {
+        hmm_vec3 gap = HMM_SubtractVec3(onSegment, onTriangle);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq < bestSq) {
+            bestSq = distSq;
+            *outOnSegment = onSegment;
+            *outOnTriangle = onTriangle;
+        }
+    };
+    consider(p, ClosestPointOnTriangle(p, a, b, c));
+    consider(q, ClosestPointOnTriangle(q, a, b, c));
+    const hmm_vec3* corners[4] = { &a, &b, &c, &a };
+    for (int i = 0; i < 3; ++i) {
+        hmm_vec3 onSegment, onEdge;
+        ClosestPointsSegments(p, q, *corners[i], *corners[i + 1], &onSegment, &onEdge);
+        consider(onSegment, onEdge);
+    }
+    return true;
+}
+
+// Closest point of the (turned) box to p
+static hmm_vec3 ClosestPointOnBox(const ContactShape& box, const hmm_vec3& p) {
+    const hmm_vec3& half = box.collider->boxHalfExtents;
+    hmm_vec3 offset = HMM_SubtractVec3(p, box.center);
+    hmm_vec3 result = box.center;
+    for (int i = 0; i < 3; ++i) {
+        float d = HMM_DotVec3(offset, box.axes[i]);
+        d = Max(-half.Elements[i], Min(d, half.Elements[i]));
+        result = HMM_AddVec3(result, HMM_MultiplyVec3f(box.axes[i], d));
+    }
+    return result;
+}
+
+static void CapsuleSegment(const ContactShape& capsule, hmm_vec3* outP, hmm_vec3* outQ) {
+    hmm_vec3 half = HMM_MultiplyVec3f(capsule.axes[1], capsule.collider->capsuleHeight * 0.5f);
+    *outP = HMM_SubtractVec3(capsule.center, half);
+    *outQ = HMM_AddVec3(capsule.center, half);
+}
+
+// -- Kernels -------------------------------------------------------------------
+// Each tests shape a (of the row's type) against shape b (the column's) and
+// reports the normal from b towards a.
+
+static bool SphereSphere(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    return BallContact(a.center, a.collider->radius, b.center, b.collider->radius, HMM_Vec3(0.0f, 1.0f, 0.0f), out);
+}
+
+static bool SphereBox(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const float radius = a.collider->radius;
+    const hmm_vec3& half = b.collider->boxHalfExtents;
+    hmm_vec3 offset = HMM_SubtractVec3(a.center, b.center);
+
+    // Centre inside or on the surface: out through the nearest face
+    int axis = -1;
+    float nearest = FLT_MAX;
+    float side = 1.0f;
+    for (int i = 0; i < 3; ++i) {
+        float d = HMM_DotVec3(offset, b.axes[i]);
+        float gap = half.Elements[i] - fabsf(d);
+        if (gap < -kTouchDistance) {
+            axis = -1;
+            break;
+        }
+        if (gap < nearest) {
+            axis = i;
+            nearest = gap;
+            side = d < 0.0f ? -1.0f : 1.0f;
+        }
+    }
+    if (axis < 0) {
+        return BallContact(a.center, radius, ClosestPointOnBox(b, a.center), 0.0f, HMM_Vec3(0.0f, 1.0f, 0.0f), out);
+    }
+
+    BeginManifold(out);
+    out.normal = HMM_MultiplyVec3f(b.axes[axis], side);
+    AddPoint(out, a.center, radius + nearest);
+    return EndManifold(out);
+}
+
+static bool SphereCapsule(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    hmm_vec3 p, q;
+    CapsuleSegment(b, &p, &q);
+    return BallContact(a.center, a.collider->radius, ClosestPointOnSegment(a.center, p, q),
+                       b.collider->capsuleRadius, b.axes[0], out);
+}
+
+static bool SpherePlane(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const hmm_vec3& normal = b.collider->planeNormal;
+    float distance = HMM_DotVec3(a.center, normal) - b.collider->planeDistance;
+    if (distance >= a.collider->radius) return false;
+
+    BeginManifold(out);
+    out.normal = normal;
+    AddPoint(out, HMM_SubtractVec3(a.center, HMM_MultiplyVec3f(normal, distance)), a.collider->radius - distance);
+    return EndManifold(out);
+}
+
+static bool CapsuleCapsule(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    hmm_vec3 pA, qA, pB, qB, onA, onB;
+    CapsuleSegment(a, &pA, &qA);
+    CapsuleSegment(b, &pB, &qB);
+    ClosestPointsSegments(pA, qA, pB, qB, &onA, &onB);
+    return BallContact(onA, a.collider->capsuleRadius, onB, b.collider->capsuleRadius, a.axes[0], out);
+}
+
+// Closest points of the segment pq and the box, both in box space (the box
+// centred on the origin); false if the segment enters the box. The squared
+// distance along the segment is quadratic between the points where it
+// crosses a slab plane, so each piece is minimized directly.
+static bool ClosestPointsSegmentBox(const hmm_vec3& p, const hmm_vec3& q, const hmm_vec3& half,
+                                    hmm_vec3* outOnSegment, hmm_vec3* outOnBox) {
+    hmm_vec3 d = HMM_SubtractVec3(q, p);
+    float breaks[8] = { 0.0f, 1.0f };
+    int breakCount = 2;
+    for (int i = 0; i < 3; ++i) {
+        if (fabsf(d.Elements[i]) < kParallelEpsilon) continue;
+        for (float plane : { -half.Elements[i], half.Elements[i] }) {
+            float t = (plane - p.Elements[i]) / d.Elements[i];
+            if (t > 0.0f && t < 1.0f) breaks[breakCount++] = t;
+        }
+    }
+    for (int i = 1; i < breakCount; ++i) {
+        for (int k = i; k > 0 && breaks[k - 1] > breaks[k]; --k) std::swap(breaks[k - 1], breaks[k]);
+    }
+
+    float bestSq = FLT_MAX;
+    float bestT = 0.0f;
+    for (int piece = 0; piece + 1 < breakCount; ++piece) {
+        float t0 = breaks[piece], t1 = breaks[piece + 1];
+        float mid = 0.5f * (t0 + t1);
+        // Axes outside the slab on this piece pull towards that face
+        float a = 0.0f, b = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            float x = p.Elements[i] + mid * d.Elements[i];
+            float face = x > half.Elements[i] ? half.Elements[i] : (x < -half.Elements[i] ? -half.Elements[i] : x);
+            if (face == x) continue;
+            a += d.Elements[i] * d.Elements[i];
+            b += d.Elements[i] * (p.Elements[i] - face);
+        }
+        float t = a > 0.0f ? Max(t0, Min(-b / a, t1)) : t0;
+        hmm_vec3 point = Lerp(p, q, t);
+        hmm_vec3 gap;
+        for (int i = 0; i < 3; ++i) {
+            float x = point.Elements[i];
+            gap.Elements[i] = x - Max(-half.Elements[i], Min(x, half.Elements[i]));
+        }
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq < bestSq) {
+            bestSq = distSq;
+            bestT = t;
+        }
+    }
+
+    *outOnSegment = Lerp(p, q, bestT);
+    for (int i = 0; i < 3; ++i) {
+        outOnBox->Elements[i] = Max(-half.Elements[i], Min(outOnSegment->Elements[i], half.Elements[i]));
+    }
+    return bestSq > 0.0f;
+}
+
+static bool CapsuleBox(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const float radius = a.collider->capsuleRadius;
+    const hmm_vec3& half = b.collider->boxHalfExtents;
+    hmm_vec3 ends[2];
+    CapsuleSegment(a, &ends[0], &ends[1]);
+
+    // Into box space, where the box is axis-aligned at the origin
+    hmm_vec3 local[2];
+    for (int e = 0; e < 2; ++e) {
+        hmm_vec3 offset = HMM_SubtractVec3(ends[e], b.center);
+        local[e] = HMM_Vec3(HMM_DotVec3(offset, b.axes[0]), HMM_DotVec3(offset, b.axes[1]), HMM_DotVec3(offset, b.axes[2]));
+    }
+    auto toWorld = [&](const hmm_vec3& point) {
+        return HMM_AddVec3(b.center, HMM_AddVec3(HMM_MultiplyVec3f(b.axes[0], point.X),
+               HMM_AddVec3(HMM_MultiplyVec3f(b.axes[1], point.Y), HMM_MultiplyVec3f(b.axes[2], point.Z))));
+    };
+
+    hmm_vec3 onSegment, onBox;
+    if (ClosestPointsSegmentBox(local[0], local[1], half, &onSegment, &onBox)) {
+        hmm_vec3 gap = HMM_SubtractVec3(onSegment, onBox);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq >= radius * radius) return false;
+        if (distSq > kTouchDistance * kTouchDistance) {
+            return BallContact(toWorld(onSegment), radius, toWorld(onBox), 0.0f, HMM_Vec3(0.0f, 1.0f, 0.0f), out);
+        }
+    }
+
+    // The segment enters or touches the box: push out through the face
+    // needing the shortest move
+    int axis = 0;
+    float best = FLT_MAX;
+    float side = 1.0f;
+    for (int i = 0; i < 3; ++i) {
+        float lowest = Min(local[0].Elements[i], local[1].Elements[i]);
+        float highest = Max(local[0].Elements[i], local[1].Elements[i]);
+        float outPositive = half.Elements[i] - lowest + radius;
+        float outNegative = highest + half.Elements[i] + radius;
+        if (outPositive < best) {
+            best = outPositive;
+            axis = i;
+            side = 1.0f;
+        }
+        if (outNegative < best) {
+            best = outNegative;
+            axis = i;
+            side = -1.0f;
+        }
+    }
+    BeginManifold(out);
+    out.normal = HMM_MultiplyVec3f(b.axes[axis], side);
+    AddPoint(out, toWorld(onSegment), best);
+    return EndManifold(out);
+}
+
+static bool CapsulePlane(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const hmm_vec3& normal = b.collider->planeNormal;
+    const float radius = a.collider->capsuleRadius;
+    hmm_vec3 ends[2];
+    CapsuleSegment(a, &ends[0], &ends[1]);
+
+    BeginManifold(out);
+    out.normal = normal;
+    for (const hmm_vec3& end : ends) {
+        float distance = HMM_DotVec3(end, normal) - b.collider->planeDistance;
+        if (distance < radius) AddPoint(out, HMM_SubtractVec3(end, HMM_MultiplyVec3f(normal, distance)), radius - distance);
+    }
+    return EndManifold(out);
+}
+
+static bool BoxPlane(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const hmm_vec3& normal = b.collider->planeNormal;
+    const hmm_vec3& half = a.collider->boxHalfExtents;
+
+    // Reject on the box's extent along the normal before looking at corners
+    hmm_vec3 extent;
+    float reach = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        extent.Elements[i] = half.Elements[i] * HMM_DotVec3(a.axes[i], normal);
+        reach += fabsf(extent.Elements[i]);
+    }
+    float centerDistance = HMM_DotVec3(a.center, normal) - b.collider->planeDistance;
+    if (centerDistance >= reach) return false;
+
+    BeginManifold(out);
+    out.normal = normal;
+    for (int corner = 0; corner < 8; ++corner) {
+        hmm_vec3 point = a.center;
+        float distance = centerDistance;
+        for (int i = 0; i < 3; ++i) {
+            float sign = (corner & (1 << i)) ? 1.0f : -1.0f;
+            point = HMM_AddVec3(point, HMM_MultiplyVec3f(a.axes[i], sign * half.Elements[i]));
+            distance += sign * extent.Elements[i];
+        }
+        if (distance < 0.0f) AddPoint(out, HMM_SubtractVec3(point, HMM_MultiplyVec3f(normal, distance * 0.5f)), -distance);
+    }
+    if (out.pointCount == 0) {
+        // Only grazing (rounding): the deepest corner
+        AddPoint(out, HMM_SubtractVec3(a.center, HMM_MultiplyVec3f(normal, centerDistance)), reach - centerDistance);
+    }
+    return EndManifold(out);
+}
+
+// Clips polygon `in` (count points) to dot(p, axis) <= limit
+static int ClipPolygon(const hmm_vec3* in, int count, const hmm_vec3& axis, float limit, hmm_vec3* out) {
+    int outCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const hmm_vec3& from = in[i];
+        const hmm_vec3& to = in[(i + 1) % count];
+        float dFrom = HMM_DotVec3(from, axis) - limit;
+        float dTo = HMM_DotVec3(to, axis) - limit;
+        if (dFrom <= 0.0f) out[outCount++] = from;
+        if ((dFrom <= 0.0f) != (dTo <= 0.0f)) out[outCount++] = Lerp(from, to, dFrom / (dFrom - dTo));
+    }
+    return outCount;
+}
+
+static bool BoxBox(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const hmm_vec3& halfA = a.collider->boxHalfExtents;
+    const hmm_vec3& halfB = b.collider->boxHalfExtents;
+    const hmm_vec3 offset = HMM_SubtractVec3(b.center, a.center);
+
+    // Rotation of b in a's frame; the epsilon keeps near-parallel edge
+    // axes from reporting false separations
+    float r[3][3], absR[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            r[i][j] = HMM_DotVec3(a.axes[i], b.axes[j]);
+            absR[i][j] = fabsf(r[i][j]) + kParallelEpsilon;
+        }
+    }
+
+    // Axis 0-2: a's faces, 3-5: b's faces, 6-14: edge pairs (3 * i + j)
+    float bestOverlap = FLT_MAX;
+    float bestFaceOverlap = FLT_MAX;
+    int bestAxis = -1;
+    hmm_vec3 bestNormal = HMM_Vec3(0.0f, 1.0f, 0.0f);
+    auto consider = [&](int axis, const hmm_vec3& direction, float radiusA, float radiusB) {
+        float distance = HMM_DotVec3(offset, direction);
+        float overlap = radiusA + radiusB - fabsf(distance);
+        if (overlap < 0.0f) return false;
+        bool better = axis < 6 ? overlap < bestOverlap : overlap < bestFaceOverlap * kEdgeAxisBias && overlap < bestOverlap;
+        if (better) {
+            bestOverlap = overlap;
+            bestAxis = axis;
+            // b lies along +direction: the normal from b towards a points back
+            bestNormal = HMM_MultiplyVec3f(direction, distance > 0.0f ? -1.0f : 1.0f);
+        }
+        if (axis < 6 && overlap < bestFaceOverlap) bestFaceOverlap = overlap;
+        return true;
+    };
+    for (int i = 0; i < 3; ++i) {
+        float radiusB = halfB.X * absR[i][0] + halfB.Y * absR[i][1] + halfB.Z * absR[i][2];
+        if (!consider(i, a.axes[i], halfA.Elements[i], radiusB)) return false;
+    }
+    for (int j = 0; j < 3; ++j) {
+        float radiusA = halfA.X * absR[0][j] + halfA.Y * absR[1][j] + halfA.Z * absR[2][j];
+        if (!consider(3 + j, b.axes[j], radiusA, halfB.Elements[j])) return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            hmm_vec3 direction = HMM_Cross(a.axes[i], b.axes[j]);
+            float lengthSq = HMM_DotVec3(direction, direction);
+            if (lengthSq < kParallelEpsilon) continue;  // Parallel edges: a face axis covers it
+            direction = HMM_MultiplyVec3f(direction, 1.0f / sqrtf(lengthSq));
+            float radiusA = 0.0f, radiusB = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                radiusA += halfA.Elements[k] * fabsf(HMM_DotVec3(a.axes[k], direction));
+                radiusB += halfB.Elements[k] * fabsf(HMM_DotVec3(b.axes[k], direction));
+            }
+            if (!consider(6 + 3 * i + j, direction, radiusA, radiusB)) return false;
+        }
+    }
+
+    BeginManifold(out);
+    out.normal = bestNormal;
+
+    if (bestAxis >= 6) {
+        // Edge against edge: the edges of each box nearest the other one
+        int i = (bestAxis - 6) / 3;
+        int j = (bestAxis - 6) % 3;
+        hmm_vec3 edgeA = a.center, edgeB = b.center;
+        for (int k = 0; k < 3; ++k) {
+            if (k != i) {
+                float sign = HMM_DotVec3(a.axes[k], bestNormal) > 0.0f ? -1.0f : 1.0f;
+                edgeA = HMM_AddVec3(edgeA, HMM_MultiplyVec3f(a.axes[k], sign * halfA.Elements[k]));
+            }
+            if (k != j) {
+                float sign = HMM_DotVec3(b.axes[k], bestNormal) > 0.0f ? 1.0f : -1.0f;
+                edgeB = HMM_AddVec3(edgeB, HMM_MultiplyVec3f(b.axes[k], sign * halfB.Elements[k]));
+            }
+        }
+        hmm_vec3 alongA = HMM_MultiplyVec3f(a.axes[i], halfA.Elements[i]);
+        hmm_vec3 alongB = HMM_MultiplyVec3f(b.axes[j], halfB.Elements[j]);
+        hmm_vec3 onA, onB;
+        ClosestPointsSegments(HMM_SubtractVec3(edgeA, alongA), HMM_AddVec3(edgeA, alongA),
+                              HMM_SubtractVec3(edgeB, alongB), HMM_AddVec3(edgeB, alongB), &onA, &onB);
+        AddPoint(out, Lerp(onA, onB, 0.5f), bestOverlap);
+        return EndManifold(out);
+    }
+
+    // Face contact: the reference face is on the box that owns the axis and
+    // faces the other box; the incident face is the other box's face most
+    // opposed to it
+    const bool referenceIsA = bestAxis < 3;
+    const ContactShape& reference = referenceIsA ? a : b;
+    const ContactShape& incident = referenceIsA ? b : a;
+    const hmm_vec3& halfRef = reference.collider->boxHalfExtents;
+    const hmm_vec3& halfInc = incident.collider->boxHalfExtents;
+    const int refAxis = bestAxis % 3;
+    const hmm_vec3 refNormal = referenceIsA ? HMM_MultiplyVec3f(bestNormal, -1.0f) : bestNormal;
+
+    int incAxis = 0;
+    float incDot = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float d = HMM_DotVec3(incident.axes[k], refNormal);
+        if (fabsf(d) > fabsf(incDot)) {
+            incDot = d;
+            incAxis = k;
+        }
+    }
+    hmm_vec3 incFace = HMM_AddVec3(incident.center, HMM_MultiplyVec3f(incident.axes[incAxis],
+                                   (incDot > 0.0f ? -1.0f : 1.0f) * halfInc.Elements[incAxis]));
+    hmm_vec3 u = HMM_MultiplyVec3f(incident.axes[(incAxis + 1) % 3], halfInc.Elements[(incAxis + 1) % 3]);
+    hmm_vec3 v = HMM_MultiplyVec3f(incident.axes[(incAxis + 2) % 3], halfInc.Elements[(incAxis + 2) % 3]);
+
+    // Each clip plane can add one point: 4 + 4 at most
+    hmm_vec3 polygon[8], clipped[8];
+    polygon[0] = HMM_AddVec3(incFace, HMM_AddVec3(u, v));
+    polygon[1] = HMM_AddVec3(incFace, HMM_SubtractVec3(v, u));
+    polygon[2] = HMM_SubtractVec3(incFace, HMM_AddVec3(u, v));
+    polygon[3] = HMM_AddVec3(incFace, HMM_SubtractVec3(u, v));
+    int count = 4;
+    for (int side = 1; side <= 2 && count > 0; ++side) {
+        int k = (refAxis + side) % 3;
+        const hmm_vec3& axis = reference.axes[k];
+        float centerDot = HMM_DotVec3(reference.center, axis);
+        count = ClipPolygon(polygon, count, axis, centerDot + halfRef.Elements[k], clipped);
+        count = ClipPolygon(clipped, count, HMM_MultiplyVec3f(axis, -1.0f), halfRef.Elements[k] - centerDot, polygon);
+    }
+
+    float refPlane = HMM_DotVec3(reference.center, refNormal) + halfRef.Elements[refAxis];
+    for (int k = 0; k < count; ++k) {
+        float separation = HMM_DotVec3(polygon[k], refNormal) - refPlane;
+        if (separation <= 0.0f) {
+            AddPoint(out, HMM_SubtractVec3(polygon[k], HMM_MultiplyVec3f(refNormal, separation * 0.5f)), -separation);
+        }
+    }
+    if (out.pointCount == 0) {
+        AddPoint(out, Lerp(a.center, b.center, 0.5f), bestOverlap);  // Rounding left nothing
+    }
+    EndManifold(out);
+    out.penetration = bestOverlap;
+    return true;
+}
+
+// The world box [min, max] into mesh space (|M| * extents covers any
+// rotation or scale)
+static void MeshSpaceBox(const ContactShape& mesh, const hmm_vec3& min, const hmm_vec3& max,
+                         hmm_vec3* outMin, hmm_vec3* outMax) {
+    hmm_vec3 center = HMM_MultiplyVec3f(HMM_AddVec3(min, max), 0.5f);
+    hmm_vec3 extents = HMM_MultiplyVec3f(HMM_SubtractVec3(max, min), 0.5f);
+    hmm_vec3 localCenter = TransformPoint(mesh.worldToMesh, center);
+    hmm_vec3 localExtents;
+    for (int row = 0; row < 3; ++row) {
+        localExtents.Elements[row] = 0.0f;
+        for (int col = 0; col < 3; ++col) {
+            localExtents.Elements[row] += fabsf(mesh.worldToMesh.Elements[col][row]) * extents.Elements[col];
+        }
+    }
+    *outMin = HMM_SubtractVec3(localCenter, localExtents);
+    *outMax = HMM_AddVec3(localCenter, localExtents);
+}
+
+// Mesh triangles that may touch the world box [min, max], in world space
+template <typename Func>
+static void ForEachMeshTriangle(const ContactShape& mesh, const hmm_vec3& min, const hmm_vec3& max, Func&& func) {
+    if (!mesh.mesh || mesh.mesh->bvhNodes.empty()) return;
+
+    hmm_vec3 localMin, localMax;
+    MeshSpaceBox(mesh, min, max, &localMin, &localMax);
+
+    const CollisionTriangle* triangles = mesh.mesh->triangles.data();
+    QueryMeshBVH(mesh.mesh->bvhNodes.data(), mesh.mesh->bvhNodes.size(), localMin, localMax,
+                 [&](uint32_t first, uint32_t count) {
+        for (uint32_t i = first; i < first + count; ++i) {
+            const CollisionTriangle& tri = triangles[i];
+            // Leaf-mates outside the box are dropped before the transform
+            bool outside = false;
+            for (int axis = 0; axis < 3 && !outside; ++axis) {
+                float lo = Min(tri.v0.Elements[axis], Min(tri.v1.Elements[axis], tri.v2.Elements[axis]));
+                float hi = Max(tri.v0.Elements[axis], Max(tri.v1.Elements[axis], tri.v2.Elements[axis]));
+                outside = lo > localMax.Elements[axis] || hi < localMin.Elements[axis];
+            }
+            if (outside) continue;
+            func(TransformPoint(mesh.meshToWorld, tri.v0), TransformPoint(mesh.meshToWorld, tri.v1),
+                 TransformPoint(mesh.meshToWorld, tri.v2));
+        }
+    });
+}
+
+// Normal of the deepest triangle contact; a point for each of the deepest
+static inline void AddTriangleContact(CollisionInfo& out, const hmm_vec3& normal, const hmm_vec3& point, float depth) {
+    if (out.pointCount == 0 || depth > out.penetration) out.normal = normal;
+    AddPoint(out, point, depth);
+}
+
+static bool SphereMesh(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const float radius = a.collider->radius;
+    hmm_vec3 reach = HMM_Vec3(radius, radius, radius);
+
+    BeginManifold(out);
+    ForEachMeshTriangle(b, HMM_SubtractVec3(a.center, reach), HMM_AddVec3(a.center, reach),
+                        [&](const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+        hmm_vec3 onTriangle = ClosestPointOnTriangle(a.center, v0, v1, v2);
+        hmm_vec3 gap = HMM_SubtractVec3(a.center, onTriangle);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq >= radius * radius) return;
+        float dist = sqrtf(distSq);
+        hmm_vec3 normal = dist > kTouchDistance ? HMM_MultiplyVec3f(gap, 1.0f / dist)
+                                                : HMM_NormalizeVec3(HMM_Cross(HMM_SubtractVec3(v1, v0), HMM_SubtractVec3(v2, v0)));
+        AddTriangleContact(out, normal, onTriangle, radius - dist);
+    });
+    return EndManifold(out);
+}
+
+static bool CapsuleMesh(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    const float radius = a.collider->capsuleRadius;
+    hmm_vec3 p, q;
+    CapsuleSegment(a, &p, &q);
+    hmm_vec3 reach = HMM_Vec3(radius, radius, radius);
+    hmm_vec3 min = HMM_SubtractVec3(HMM_Vec3(Min(p.X, q.X), Min(p.Y, q.Y), Min(p.Z, q.Z)), reach);
+    hmm_vec3 max = HMM_AddVec3(HMM_Vec3(Max(p.X, q.X), Max(p.Y, q.Y), Max(p.Z, q.Z)), reach);
+
+    BeginManifold(out);
+    ForEachMeshTriangle(b, min, max, [&](const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+        hmm_vec3 onSegment, onTriangle;
+        bool apart = ClosestPointsSegmentTriangle(p, q, v0, v1, v2, &onSegment, &onTriangle);
+        hmm_vec3 gap = HMM_SubtractVec3(onSegment, onTriangle);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (apart && distSq >= radius * radius) return;
+        if (!apart || distSq <= kTouchDistance * kTouchDistance) {
+            // Passes through or touches: out along the face normal, on the capsule's side
+            hmm_vec3 normal = HMM_NormalizeVec3(HMM_Cross(HMM_SubtractVec3(v1, v0), HMM_SubtractVec3(v2, v0)));
+            if (HMM_DotVec3(HMM_SubtractVec3(a.center, v0), normal) < 0.0f) normal = HMM_MultiplyVec3f(normal, -1.0f);
+            float lowest = Min(HMM_DotVec3(HMM_SubtractVec3(p, v0), normal), HMM_DotVec3(HMM_SubtractVec3(q, v0), normal));
+            AddTriangleContact(out, normal, onTriangle, radius - lowest);
+            return;
+        }
+        float dist = sqrtf(distSq);
+        AddTriangleContact(out, HMM_MultiplyVec3f(gap, 1.0f / dist), onTriangle, radius - dist);
+    });
+    return EndManifold(out);
+}
+
+// Heightfield triangles under the world box [min, max], in world space
+template <typename Func>
+static void ForEachFieldTriangle(const ContactShape& field, const hmm_vec3& min, const hmm_vec3& max, Func&& func) {
+    if (!field.heightfield) return;
+
+    hmm_vec3 localMin, localMax;
+    MeshSpaceBox(field, min, max, &localMin, &localMax);
+    ForEachHeightfieldTriangle(*field.heightfield, localMin, localMax,
+                               [&](const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+        func(TransformPoint(field.meshToWorld, v0), TransformPoint(field.meshToWorld, v1),
+             TransformPoint(field.meshToWorld, v2));
+    });
+}
+
+static inline hmm_vec3 FaceNormal(const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+    return HMM_NormalizeVec3(HMM_Cross(HMM_SubtractVec3(v1, v0), HMM_SubtractVec3(v2, v0)));
+}
+
+// How far the world point is below the heightfield triangle over it, along
+// that triangle's normal; false above the surface or off the field
+static bool BelowSurface(const ContactShape& field, const hmm_vec3& point, hmm_vec3* outNormal, float* outDepth) {
+    hmm_vec3 local = TransformPoint(field.worldToMesh, point);
+    hmm_vec3 triangle[3];
+    if (!HeightfieldTriangleAt(*field.heightfield, local.X, local.Z, triangle)) return false;
+    hmm_vec3 v0 = TransformPoint(field.meshToWorld, triangle[0]);
+    hmm_vec3 normal = FaceNormal(v0, TransformPoint(field.meshToWorld, triangle[1]),
+                                 TransformPoint(field.meshToWorld, triangle[2]));
+    float height = HMM_DotVec3(HMM_SubtractVec3(point, v0), normal);
+    if (height >= 0.0f) return false;
+    *outNormal = normal;
+    *outDepth = -height;
+    return true;
+}
+
+// Triangles the centre is behind are skipped: a centre under the surface is
+// pushed up by the triangle over it instead
+static bool SphereHeightfield(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    if (!b.heightfield) return false;
+    const float radius = a.collider->radius;
+    hmm_vec3 reach = HMM_Vec3(radius, radius, radius);
+
+    BeginManifold(out);
+    ForEachFieldTriangle(b, HMM_SubtractVec3(a.center, reach), HMM_AddVec3(a.center, reach),
+                         [&](const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+        hmm_vec3 onTriangle = ClosestPointOnTriangle(a.center, v0, v1, v2);
+        hmm_vec3 gap = HMM_SubtractVec3(a.center, onTriangle);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq >= radius * radius) return;
+        hmm_vec3 face = FaceNormal(v0, v1, v2);
+        if (HMM_DotVec3(gap, face) < 0.0f) return;
+        float dist = sqrtf(distSq);
+        hmm_vec3 normal = dist > kTouchDistance ? HMM_MultiplyVec3f(gap, 1.0f / dist) : face;
+        AddTriangleContact(out, normal, onTriangle, radius - dist);
+    });
+    hmm_vec3 normal;
+    float depth;
+    if (BelowSurface(b, a.center, &normal, &depth)) {
+        AddTriangleContact(out, normal, HMM_AddVec3(a.center, HMM_MultiplyVec3f(normal, depth)), radius + depth);
+    }
+    return EndManifold(out);
+}
+
+static bool CapsuleHeightfield(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    if (!b.heightfield) return false;
+    const float radius = a.collider->capsuleRadius;
+    hmm_vec3 ends[2];
+    CapsuleSegment(a, &ends[0], &ends[1]);
+    const hmm_vec3& p = ends[0];
+    const hmm_vec3& q = ends[1];
+    hmm_vec3 reach = HMM_Vec3(radius, radius, radius);
+    hmm_vec3 min = HMM_SubtractVec3(HMM_Vec3(Min(p.X, q.X), Min(p.Y, q.Y), Min(p.Z, q.Z)), reach);
+    hmm_vec3 max = HMM_AddVec3(HMM_Vec3(Max(p.X, q.X), Max(p.Y, q.Y), Max(p.Z, q.Z)), reach);
+
+    BeginManifold(out);
+    ForEachFieldTriangle(b, min, max, [&](const hmm_vec3& v0, const hmm_vec3& v1, const hmm_vec3& v2) {
+        hmm_vec3 face = FaceNormal(v0, v1, v2);
+        hmm_vec3 onSegment, onTriangle;
+        if (!ClosestPointsSegmentTriangle(p, q, v0, v1, v2, &onSegment, &onTriangle)) {
+            // Passes through (a bump under a lying capsule): up out of it
+            float lowest = Min(HMM_DotVec3(HMM_SubtractVec3(p, v0), face), HMM_DotVec3(HMM_SubtractVec3(q, v0), face));
+            AddTriangleContact(out, face, onTriangle, radius - lowest);
+            return;
+        }
+        hmm_vec3 gap = HMM_SubtractVec3(onSegment, onTriangle);
+        float distSq = HMM_DotVec3(gap, gap);
+        if (distSq >= radius * radius || HMM_DotVec3(gap, face) < 0.0f) return;
+        float dist = sqrtf(distSq);
+        hmm_vec3 normal = dist > kTouchDistance ? HMM_MultiplyVec3f(gap, 1.0f / dist) : face;
+        AddTriangleContact(out, normal, onTriangle, radius - dist);
+    });
+    for (const hmm_vec3& end : ends) {
+        hmm_vec3 normal;
+        float depth;
+        if (BelowSurface(b, end, &normal, &depth)) {
+            AddTriangleContact(out, normal, HMM_AddVec3(end, HMM_MultiplyVec3f(normal, depth)), radius + depth);
+        }
+    }
+    return EndManifold(out);
+}
+
+// Corners under the surface, each against the triangle over it, as in
+// BoxPlane(). Terrain poking into a face between the corners is missed,
+// which is fine for ground that is smooth at the scale of a box.
+static bool BoxHeightfield(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    if (!b.heightfield) return false;
+    const hmm_vec3& half = a.collider->boxHalfExtents;
+
+    BeginManifold(out);
+    for (int corner = 0; corner < 8; ++corner) {
+        hmm_vec3 point = a.center;
+        for (int i = 0; i < 3; ++i) {
+            float sign = (corner & (1 << i)) ? 1.0f : -1.0f;
+            point = HMM_AddVec3(point, HMM_MultiplyVec3f(a.axes[i], sign * half.Elements[i]));
+        }
+        hmm_vec3 normal;
+        float depth;
+        if (BelowSurface(b, point, &normal, &depth)) {
+            AddTriangleContact(out, normal, HMM_AddVec3(point, HMM_MultiplyVec3f(normal, depth * 0.5f)), depth);
+        }
+    }
+    return EndManifold(out);
+}
+
+// -- Dispatch ------------------------------------------------------------------
+
+using ContactTest = bool (*)(const ContactShape& a, const ContactShape& b, CollisionInfo& out);
+
+// The column's kernel run the other way round
+template <ContactTest Test>
+static bool Swapped(const ContactShape& a, const ContactShape& b, CollisionInfo& out) {
+    if (!Test(b, a, out)) return false;
+    out.normal = HMM_MultiplyVec3f(out.normal, -1.0f);
+    return true;
+}
+
+// Indexed [a's ColliderType][b's ColliderType]
+static const ContactTest kContactTests[kColliderTypeCount][kColliderTypeCount] = {
+    //                 Sphere                       Box                       Capsule                       Mesh                  Plane                 Heightfield
+    /* Sphere      */ { SphereSphere,               SphereBox,                SphereCapsule,                SphereMesh,           SpherePlane,          SphereHeightfield },
+    /* Box         */ { Swapped<SphereBox>,         BoxBox,                   Swapped<CapsuleBox>,          nullptr,              BoxPlane,             BoxHeightfield },
+    /* Capsule     */ { Swapped<SphereCapsule>,     CapsuleBox,               CapsuleCapsule,               CapsuleMesh,          CapsulePlane,         CapsuleHeightfield },
+    /* Mesh        */ { Swapped<SphereMesh>,        nullptr,                  Swapped<CapsuleMesh>,         nullptr,              nullptr,              nullptr },
+    /* Plane       */ { Swapped<SpherePlane>,       Swapped<BoxPlane>,        Swapped<CapsulePlane>,        nullptr,              nullptr,              nullptr },
+    /* Heightfield */ { Swapped<SphereHeightfield>, Swapped<BoxHeightfield>,  Swapped<CapsuleHeightfield>,  nullptr,              nullptr,              nullptr },
+};
+
+bool HasContactTest(ColliderType a, ColliderType b) {
+    return (int)a < kColliderTypeCount && (int)b < kColliderTypeCount && kContactTests[(int)a][(int)b] != nullptr;
+}
+
+bool TestContact(const ContactShape& a, const ContactShape& b, CollisionInfo* outInfo) {
+    ColliderType typeA = a.collider->type;
+    ColliderType typeB = b.collider->type;
+    if (!HasContactTest(typeA, typeB)) return false;
+    CollisionInfo scratch;
+    return kContactTests[(int)typeA][(int)typeB](a, b, outInfo ? *outInfo : scratch);
+}
+
+void TransformAxes(const Transform& transform, hmm_vec3 outAxes[3]) {
+    if (transform.pitch == 0.0f && transform.yaw == 0.0f && transform.roll == 0.0f) {
+        outAxes[0] = HMM_Vec3(1.0f, 0.0f, 0.0f);
+        outAxes[1] = HMM_Vec3(0.0f, 1.0f, 0.0f);
+        outAxes[2] = HMM_Vec3(0.0f, 0.0f, 1.0f);
+        return;
+    }
+    // Same rotation as Transform::ModelMatrix()
+    hmm_mat4 rx = HMM_Rotate(transform.pitch, HMM_Vec3(1.0f, 0.0f, 0.0f));
+    hmm_mat4 ry = HMM_Rotate(transform.yaw, HMM_Vec3(0.0f, 1.0f, 0.0f));
+    hmm_mat4 rz = HMM_Rotate(transform.roll, HMM_Vec3(0.0f, 0.0f, 1.0f));
+    hmm_mat4 rotation = HMM_MultiplyMat4(HMM_MultiplyMat4(rx, ry), rz);
+    for (int col = 0; col < 3; ++col) {
+        outAxes[col] = HMM_Vec3(rotation.Elements[col][0], rotation.Elements[col][1], rotation.Elements[col][2]);
+    }
+}
+
+const char* ColliderTypeName(ColliderType type) {
+    static const char* kNames[kColliderTypeCount] = { "Sphere", "Box", "Capsule", "Mesh", "Plane", "Heightfield" };
+    return (int)type < kColliderTypeCount ? kNames[(int)type] : "Unknown";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Components.h"
+#include "CollisionMeshes.h"
+#include "Heightfield.h"
+
+// ============================================================================
+// NARROWPHASE - Contact tests between two colliders
+// ============================================================================
+// Every pair of collider types has one kernel in a table indexed by the two
+// ColliderTypes; a pair given the other way round runs the same kernel with
+// the shapes swapped and the normal flipped. Kernels work in world space on
+// ContactShapes (a collider and where it is), never allocate, and report up
+// to kMaxContactPoints points:
+//
+//   box-box          separating axis test over the 15 axes. On a face axis
+//                    the incident face is clipped against the reference
+//                    face's sides; on an edge axis the two closest edges
+//                    give one point.
+//   capsule-*        closest points between the capsule's segment and the
+//                    other shape, then as for a sphere at that point
+//   sphere/capsule   triangles near the shape come from the mesh BVH (in
+//     vs mesh        mesh space) and are tested in world space; the deepest
+//                    one gives the normal
+//   *-heightfield    as for a mesh, with the triangles of the cells under
+//                    the shape looked up directly. The ground is solid: a
+//                    shape below the surface is pushed up, never down.
+//                    Boxes test their corners against the triangle under
+//                    each, as against a plane.
+//
+// Boxes and capsules turn with their Transform (a capsule's segment runs
+// along its local Y); like spheres they ignore its scale. Box-mesh, pairs
+// of meshes, planes and heightfields have no kernel and never touch.
+
+constexpr int kMaxContactPoints = 4;
+
+struct CollisionInfo {
+    EntityId entityA;
+    EntityId entityB;
+    hmm_vec3 normal;        // From B towards A
+    float penetration;      // Deepest
+    hmm_vec3 contactPoint;  // Centre of the points below
+    int pointCount = 0;
+    hmm_vec3 points[kMaxContactPoints];
+    float depths[kMaxContactPoints];
+};
+
+// A collider placed in the world for the kernels
+struct ContactShape {
+    const Collider* collider = nullptr;
+    hmm_vec3 center{0.0f, 0.0f, 0.0f};  // Transform::position
+    hmm_vec3 axes[3] = { {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} };  // Box, capsule
+    const CollisionMesh* mesh = nullptr;  // Mesh colliders
+    const Heightfield* heightfield = nullptr;  // Heightfield colliders
+    hmm_mat4 meshToWorld;  // Mesh and heightfield colliders
+    hmm_mat4 worldToMesh;
+};
+
+constexpr int kColliderTypeCount = 6;
+
+// False when the shapes don't touch or the pair has no kernel
+bool TestContact(const ContactShape& a, const ContactShape& b, CollisionInfo* outInfo);
+bool HasContactTest(ColliderType a, ColliderType b);
+
+// The transform's rotation as its local X, Y and Z axes in world space
+void TransformAxes(const Transform& transform, hmm_vec3 outAxes[3]);
+
+const char* ColliderTypeName(ColliderType type);
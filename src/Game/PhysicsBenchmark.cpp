@@ -0,0 +1,1489 @@
+#include "PhysicsBenchmark.h"
+#include "MeshBVH.h"
+#include "Narrowphase.h"
+#include "RayKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+static constexpr float kBoxSize = 1.0f;
+static constexpr float kBoxGap = 0.02f;  // Between neighbours, so only stacked boxes touch
+static constexpr float kEyeHeight = 1.7f;
+static constexpr float kCapsuleHeight = 1.0f;  // The player's capsule
+static constexpr float kCapsuleRadius = 0.4f;
+static constexpr float kSweepStep = 1.0f / 60.0f;
+
+void PhysicsBenchmark::SpawnBoxPyramid(ECS& ecs, const hmm_vec3& groundCenter, int layers) {
+    Clear(ecs);
+    
+    const float pitch = kBoxSize + kBoxGap;
+    for (int layer = 0; layer < layers; ++layer) {
+        int side = layers - layer;
+        float start = -0.5f * (side - 1) * pitch;
+        float y = groundCenter.Y + (layer + 0.5f) * kBoxSize;
+        for (int i = 0; i < side; ++i) {
+            for (int j = 0; j < side; ++j) {
+                EntityId id = ecs.CreateEntity();
+                
+                Transform t;
+                t.position = HMM_Vec3(groundCenter.X + start + i * pitch, y, groundCenter.Z + start + j * pitch);
+                ecs.AddTransform(id, t);
+                
+                Collider collider;
+                collider.type = ColliderType::Box;
+                collider.boxHalfExtents = HMM_Vec3(0.5f * kBoxSize, 0.5f * kBoxSize, 0.5f * kBoxSize);
+                ecs.AddCollider(id, collider);
+                
+                Rigidbody rb;
+                rb.drag = 0.0f;
+                ecs.AddRigidbody(id, rb);
+                
+                bodies_.push_back(id);
+            }
+        }
+    }
+    
+    stats_ = Stats();
+    stats_.bodies = (int)bodies_.size();
+    time_ = 0.0f;
+    lastMoving_ = 0.0f;
+    printf("Spawned box pyramid: %d boxes in %d layers\n", stats_.bodies, layers);
+}
+
+void PhysicsBenchmark::Clear(ECS& ecs) {
+    for (EntityId id : bodies_) {
+        ecs.DestroyEntity(id);
+    }
+    bodies_.clear();
+    stats_ = Stats();
+}
+
+void PhysicsBenchmark::AfterStep(ECS& ecs, float dt) {
+    if (bodies_.empty() || stats_.settled) return;
+    
+    time_ += dt;
+    ++stats_.steps;
+    const ECS::ContactSolverStats& solver = ecs.GetContactSolverStats();
+    stats_.solveMsTotal += solver.solveMs;
+    if (solver.solveMs > stats_.solveMsMax) stats_.solveMsMax = solver.solveMs;
+    stats_.iterationsTotal += solver.iterations;
+    
+    bool allAsleep = true;
+    bool moving = false;
+    const float sleepSpeedSq = ECS::kSleepSpeed * ECS::kSleepSpeed;
+    for (EntityId id : bodies_) {
+        const Rigidbody* rb = ecs.GetRigidbody(id);
+        if (!rb || rb->sleeping) continue;
+        allAsleep = false;
+        if (HMM_DotVec3(rb->velocity, rb->velocity) >= sleepSpeedSq) moving = true;
+    }
+    if (moving) lastMoving_ = time_;
+    
+    if (allAsleep || time_ - lastMoving_ >= ECS::kTimeToSleep) {
+        stats_.settled = true;
+        stats_.settleTime = lastMoving_;
+        printf("Box pyramid settled after %.2f s (%d steps), solver %.3f ms/step avg, %.3f ms max\n",
+               stats_.settleTime, stats_.steps, stats_.solveMsTotal / stats_.steps, stats_.solveMsMax);
+    }
+}
+
+const PhysicsBenchmark::Stats& PhysicsBenchmark::RunBoxPyramid(int layers, int maxSteps) {
+    ECS ecs;
+    Renderer renderer;
+    const hmm_vec3 groundCenter = HMM_Vec3(0.0f, -4.0f, 0.0f);
+    EntityId ground = ecs.CreateEntity();
+    Transform t;
+    t.position = groundCenter;
+    ecs.AddTransform(ground, t);
+    ecs.CreatePlaneCollider(ground, HMM_Vec3(0.0f, 1.0f, 0.0f), groundCenter.Y);
+    SpawnBoxPyramid(ecs, groundCenter, layers);
+    
+    const float dt = 1.0f / 60.0f;
+    for (int step = 0; step < maxSteps && !stats_.settled; ++step) {
+        ecs.BeginPhysicsStep();
+        ecs.UpdatePhysics(dt);
+        ecs.UpdateCollisions(dt);
+        ecs.EndPhysicsStep();
+        AfterStep(ecs, dt);
+        ecs.SyncToRenderer(renderer);
+        ecs.EndFrame();
+    }
+    if (!stats_.settled) {
+        printf("ERROR: Box pyramid still moving after %d steps (%.3f ms/step avg solver)\n", stats_.steps,
+               stats_.steps > 0 ? stats_.solveMsTotal / stats_.steps : 0.0f);
+    }
+    bodies_.clear();  // They went with the ECS
+    return stats_;
+}
+
+const PhysicsBenchmark::RaycastStats& PhysicsBenchmark::MeasureRaycasts(ECS& ecs, const hmm_vec3& center, float radius,
+                                                                        int rayCount) {
+    raycastStats_ = RaycastStats();
+    if (rayCount <= 0) return raycastStats_;
+    
+    // Same rays every run: from a point in the circle to another, the ray
+    // ending at its target like a line-of-sight check
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> targetHeight(0.0f, 3.0f);
+    std::vector<Ray> rays((size_t)rayCount);
+    for (Ray& ray : rays) {
+        ray.origin = HMM_Vec3(center.X + unit(rng) * radius, center.Y + kEyeHeight, center.Z + unit(rng) * radius);
+        hmm_vec3 target = HMM_Vec3(center.X + unit(rng) * radius, center.Y + targetHeight(rng), center.Z + unit(rng) * radius);
+        hmm_vec3 toTarget = HMM_SubtractVec3(target, ray.origin);
+        ray.maxDistance = HMM_LengthVec3(toTarget);
+        ray.direction = ray.maxDistance > 0.0f ? HMM_MultiplyVec3f(toTarget, 1.0f / ray.maxDistance) : HMM_Vec3(0.0f, -1.0f, 0.0f);
+    }
+    
+    using Clock = std::chrono::high_resolution_clock;
+    auto raysPerSec = [&](Clock::time_point start, Clock::time_point end) {
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return seconds > 0.0 ? rayCount / seconds : 0.0;
+    };
+    
+    std::vector<RaycastHit> single((size_t)rayCount);
+    auto start = Clock::now();
+    for (int i = 0; i < rayCount; ++i) {
+        single[i] = ecs.RaycastPhysics(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+    }
+    raycastStats_.singleRaysPerSec = raysPerSec(start, Clock::now());
+    
+    std::vector<RaycastHit> batch((size_t)rayCount);
+    JobSystem* jobs = ecs.GetJobSystem();
+    ecs.SetJobSystem(nullptr);
+    start = Clock::now();
+    ecs.RaycastBatch(rays, batch);
+    raycastStats_.batchRaysPerSec = raysPerSec(start, Clock::now());
+    ecs.SetJobSystem(jobs);
+    
+    std::vector<RaycastHit> parallel;
+    if (jobs) {
+        parallel.resize((size_t)rayCount);
+        start = Clock::now();
+        ecs.RaycastBatch(rays, parallel);
+        raycastStats_.parallelRaysPerSec = raysPerSec(start, Clock::now());
+        raycastStats_.threads = jobs->ThreadCount();
+    }
+    
+    auto same = [](const RaycastHit& a, const RaycastHit& b) {
+        return a.hit == b.hit && (!a.hit || (a.entity == b.entity && a.distance == b.distance));
+    };
+    raycastStats_.rays = rayCount;
+    for (int i = 0; i < rayCount; ++i) {
+        raycastStats_.hits += single[i].hit;
+        if (!same(single[i], batch[i]) || (jobs && !same(single[i], parallel[i]))) ++raycastStats_.mismatches;
+    }
+    
+    printf("Raycasts: %d rays, %d hits: %.2f M rays/s single, %.2f M rays/s batched, %.2f M rays/s on %u threads, %d mismatches\n",
+           rayCount, raycastStats_.hits, raycastStats_.singleRaysPerSec * 1e-6, raycastStats_.batchRaysPerSec * 1e-6,
+           raycastStats_.parallelRaysPerSec * 1e-6, raycastStats_.threads, raycastStats_.mismatches);
+    return raycastStats_;
+}
+
+const PhysicsBenchmark::SweepStats& PhysicsBenchmark::MeasureCapsuleSweeps(ECS& ecs, const hmm_vec3& center, float radius,
+                                                                           int sweepCount) {
+    sweepStats_ = SweepStats();
+    if (sweepCount <= 0) return sweepStats_;
+    
+    // Same sweeps every run: one step of a character walking or sprinting
+    // (up to 12 m/s) and falling at up to 10 m/s, from standing height
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> speed(0.0f, 12.0f);
+    std::uniform_real_distribution<float> fallSpeed(0.0f, 10.0f);
+    std::vector<CapsuleSweep> sweeps((size_t)sweepCount);
+    const float standing = kCapsuleHeight * 0.5f + kCapsuleRadius;
+    for (CapsuleSweep& sweep : sweeps) {
+        sweep.start = HMM_Vec3(center.X + unit(rng) * radius, center.Y + standing + 0.05f, center.Z + unit(rng) * radius);
+        float angle = unit(rng) * 3.14159265f;
+        float walk = speed(rng);
+        sweep.motion = HMM_MultiplyVec3f(HMM_Vec3(sinf(angle) * walk, -fallSpeed(rng), cosf(angle) * walk), kSweepStep);
+        sweep.height = kCapsuleHeight;
+        sweep.radius = kCapsuleRadius;
+    }
+    
+    using Clock = std::chrono::high_resolution_clock;
+    auto sweepsPerSec = [&](Clock::time_point start, Clock::time_point end) {
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return seconds > 0.0 ? sweepCount / seconds : 0.0;
+    };
+    
+    std::vector<CapsuleSweepHit> single((size_t)sweepCount);
+    auto start = Clock::now();
+    for (int i = 0; i < sweepCount; ++i) {
+        single[i] = ecs.SweepCapsule(sweeps[i]);
+    }
+    sweepStats_.singleSweepsPerSec = sweepsPerSec(start, Clock::now());
+    
+    std::vector<CapsuleSweepHit> batch((size_t)sweepCount);
+    JobSystem* jobs = ecs.GetJobSystem();
+    ecs.SetJobSystem(nullptr);
+    start = Clock::now();
+    ecs.SweepCapsuleBatch(sweeps, batch);
+    sweepStats_.batchSweepsPerSec = sweepsPerSec(start, Clock::now());
+    ecs.SetJobSystem(jobs);
+    
+    std::vector<CapsuleSweepHit> parallel;
+    if (jobs) {
+        parallel.resize((size_t)sweepCount);
+        start = Clock::now();
+        ecs.SweepCapsuleBatch(sweeps, parallel);
+        sweepStats_.parallelSweepsPerSec = sweepsPerSec(start, Clock::now());
+        sweepStats_.threads = jobs->ThreadCount();
+    }
+    
+    auto same = [](const CapsuleSweepHit& a, const CapsuleSweepHit& b) {
+        return a.hit == b.hit && (!a.hit || (a.entity == b.entity && a.fraction == b.fraction));
+    };
+    sweepStats_.sweeps = sweepCount;
+    for (int i = 0; i < sweepCount; ++i) {
+        sweepStats_.hits += single[i].hit;
+        if (!same(single[i], batch[i]) || (jobs && !same(single[i], parallel[i]))) ++sweepStats_.mismatches;
+    }
+    
+    printf("Capsule sweeps: %d sweeps, %d hits: %.2f M sweeps/s single, %.2f M sweeps/s batched, %.2f M sweeps/s on %u threads, %d mismatches\n",
+           sweepCount, sweepStats_.hits, sweepStats_.singleSweepsPerSec * 1e-6, sweepStats_.batchSweepsPerSec * 1e-6,
+           sweepStats_.parallelSweepsPerSec * 1e-6, sweepStats_.threads, sweepStats_.mismatches);
+    return sweepStats_;
+}
+
+namespace {
+
+constexpr float kWalkSpeed = 4.0f;
+
+EntityId AddWalker(ECS& ecs, const hmm_vec3& position) {
+    EntityId id = ecs.CreateEntity();
+    Transform t;
+    t.position = position;
+    ecs.AddTransform(id, t);
+    Collider collider;
+    collider.type = ColliderType::Capsule;
+    collider.capsuleHeight = kCapsuleHeight;
+    collider.capsuleRadius = kCapsuleRadius;
+    ecs.AddCollider(id, collider);
+    Rigidbody rb;
+    rb.isKinematic = true;
+    rb.affectedByGravity = false;
+    rb.canSleep = false;
+    ecs.AddRigidbody(id, rb);
+    ecs.AddCharacter(id, CharacterController());
+    return id;
+}
+
+EntityId AddStaticBox(ECS& ecs, const Transform& t, const hmm_vec3& halfExtents) {
+    EntityId id = ecs.CreateEntity();
+    ecs.AddTransform(id, t);
+    Collider collider;
+    collider.type = ColliderType::Box;
+    collider.boxHalfExtents = halfExtents;
+    collider.isStatic = true;
+    ecs.AddCollider(id, collider);
+    return id;
+}
+
+void StepCharacters(ECS& ecs, Renderer& renderer) {
+    ecs.BeginPhysicsStep();
+    ecs.UpdateCharacters(kSweepStep);
+    ecs.UpdatePhysics(kSweepStep);
+    ecs.UpdateCollisions(kSweepStep);
+    ecs.EndPhysicsStep();
+    ecs.SyncToRenderer(renderer);
+    ecs.EndFrame();
+}
+
+} // namespace
+
+const PhysicsBenchmark::CharacterMoveStats& PhysicsBenchmark::CheckCharacterMoves() {
+    characterMoveStats_ = CharacterMoveStats();
+    CharacterMoveStats& stats = characterMoveStats_;
+    const float standing = kCapsuleHeight * 0.5f + kCapsuleRadius;
+    Renderer renderer;
+    
+    // Walk one second along X onto a step 3 m ahead, ending a metre onto it
+    {
+        ECS ecs;
+        EntityId ground = ecs.CreateEntity();
+        ecs.AddTransform(ground, Transform());
+        ecs.CreatePlaneCollider(ground, HMM_Vec3(0.0f, 1.0f, 0.0f), 0.0f);
+        const float stepHeight = CharacterController().stepHeight;
+        Transform step;
+        step.position = HMM_Vec3(5.0f, stepHeight * 0.5f, 0.0f);
+        AddStaticBox(ecs, step, HMM_Vec3(2.0f, stepHeight * 0.5f, 2.0f));
+        EntityId walker = AddWalker(ecs, HMM_Vec3(0.0f, standing, 0.0f));
+        ecs.GetCharacter(walker)->moveVelocity = HMM_Vec3(kWalkSpeed, 0.0f, 0.0f);
+        for (int i = 0; i < 60; ++i) {
+            StepCharacters(ecs, renderer);
+        }
+        const hmm_vec3 end = ecs.PeekTransform(walker)->position;
+        stats.stepTopError = end.Y - (standing + stepHeight);
+        stats.climbedStep = end.X > 3.5f && fabsf(stats.stepTopError) < 0.05f && ecs.GetCharacter(walker)->grounded;
+        if (!stats.climbedStep) {
+            printf("ERROR: Character moves: stopped at (%.2f, %.2f) instead of on the %.2f m step\n", end.X, end.Y, stepHeight);
+            ++stats.failures;
+        }
+    }
+    
+    // Walk down a 30 degree ramp from its top; every step on it must stay grounded
+    {
+        ECS ecs;
+        EntityId ground = ecs.CreateEntity();
+        ecs.AddTransform(ground, Transform());
+        ecs.CreatePlaneCollider(ground, HMM_Vec3(0.0f, 1.0f, 0.0f), 0.0f);
+        Transform ramp;
+        ramp.roll = 30.0f;
+        hmm_vec3 axes[3];
+        TransformAxes(ramp, axes);
+        const float halfLength = 4.0f;
+        hmm_vec3 down = axes[0].Y < 0.0f ? axes[0] : HMM_MultiplyVec3f(axes[0], -1.0f);  // Along the ramp, downhill
+        ramp.position = HMM_Vec3(0.0f, -down.Y * halfLength, 0.0f);  // Low end on the ground
+        AddStaticBox(ecs, ramp, HMM_Vec3(halfLength, 0.01f, 2.0f));
+        const hmm_vec3 top = HMM_SubtractVec3(ramp.position, HMM_MultiplyVec3f(down, halfLength - 0.5f));
+        EntityId walker = AddWalker(ecs, HMM_Vec3(top.X, top.Y + standing + 0.05f, top.Z));
+        const hmm_vec3 heading = HMM_NormalizeVec3(HMM_Vec3(down.X, 0.0f, down.Z));
+        ecs.GetCharacter(walker)->moveVelocity = HMM_MultiplyVec3f(heading, kWalkSpeed);
+        const float rampEnd = HMM_DotVec3(HMM_AddVec3(ramp.position, HMM_MultiplyVec3f(down, halfLength - 0.5f)), heading);
+        bool landed = false;
+        for (int i = 0; i < 180; ++i) {
+            StepCharacters(ecs, renderer);
+            const CharacterController* character = ecs.GetCharacter(walker);
+            landed = landed || character->grounded;
+            if (!landed) continue;
+            if (HMM_DotVec3(ecs.PeekTransform(walker)->position, heading) > rampEnd) break;
+            ++stats.slopeSteps;
+            if (!character->grounded) ++stats.slopeAirborne;
+        }
+        if (stats.slopeSteps == 0 || stats.slopeAirborne > 0) {
+            printf("ERROR: Character moves: airborne for %d of %d steps down the ramp\n", stats.slopeAirborne, stats.slopeSteps);
+            ++stats.failures;
+        }
+    }
+    
+    printf("Character moves: step %s (%+.3f m from its top), ramp %d steps, %d airborne, %d failures\n",
+           stats.climbedStep ? "climbed" : "not climbed", stats.stepTopError, stats.slopeSteps, stats.slopeAirborne,
+           stats.failures);
+    return characterMoveStats_;
+}
+
+namespace {
+
+struct BroadphaseRun {
+    std::vector<int> contacts;  // Per frame
+    long long pairs = 0;
+    double ms = 0.0;
+};
+
+constexpr float kCrowdRadius = 0.5f;
+
+// Where sphere `i` of the crowd is in `frame`; every tenth one is static
+hmm_vec3 CrowdSpot(const std::vector<hmm_vec3>& spots, size_t i, int frame) {
+    if (i % 10 == 0) return spots[i];
+    float phase = frame * 0.3f + i * 0.7f;
+    return HMM_AddVec3(spots[i], HMM_Vec3(sinf(phase) * 0.4f, 0.0f, cosf(phase) * 0.4f));
+}
+
+// One pass over the crowd; `brute` takes every collider out of the
+// broadphase, so each is paired with all the others, and `gridLayers`
+// puts the spheres in the hash grid instead
+BroadphaseRun RunBroadphase(const std::vector<hmm_vec3>& spots, int frames, bool brute, ECS::BroadphaseMode mode,
+                            uint32_t gridLayers = 0) {
+    ECS ecs;
+    Renderer renderer;
+    ecs.SetBroadphaseMode(mode);
+    ecs.SetHashGridLayers(gridLayers);
+    std::vector<EntityId> entities;
+    entities.reserve(spots.size());
+    for (size_t i = 0; i < spots.size(); ++i) {
+        EntityId id = ecs.CreateEntity();
+        Transform t;
+        t.position = spots[i];
+        ecs.AddTransform(id, t);
+        Collider collider;
+        collider.type = ColliderType::Sphere;
+        collider.radius = kCrowdRadius;
+        collider.isStatic = i % 10 == 0;
+        collider.useBroadPhase = !brute;
+        if (gridLayers != 0) collider.collisionLayer = gridLayers;
+        ecs.AddCollider(id, collider);
+        entities.push_back(id);
+    }
+    
+    using Clock = std::chrono::high_resolution_clock;
+    BroadphaseRun run;
+    for (int frame = 0; frame < frames; ++frame) {
+        // Positions are set every frame, so whatever the collision response
+        // did last frame the three passes test the same scene
+        for (size_t i = 0; i < entities.size(); ++i) {
+            if (i % 10 == 0) continue;
+            ecs.GetTransform(entities[i])->position = CrowdSpot(spots, i, frame);
+        }
+        auto start = Clock::now();
+        ecs.UpdateCollisions(kSweepStep);
+        run.ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        
+        const ECS::NarrowphaseStats& narrowphase = ecs.GetNarrowphaseStats();
+        int contacts = 0;
+        for (int a = 0; a < kColliderTypeCount; ++a) {
+            for (int b = 0; b < kColliderTypeCount; ++b) {
+                run.pairs += narrowphase.tests[a][b];
+                contacts += narrowphase.contacts[a][b];
+            }
+        }
+        run.contacts.push_back(contacts);
+        ecs.SyncToRenderer(renderer);  // Clears Transform::dirty, so next frame's moves are logged
+        ecs.EndFrame();
+    }
+    return run;
+}
+
+// The crowd's overlapping pairs in `frame`, by testing every sphere
+// against every other the way the narrowphase does
+int CountCrowdContacts(const std::vector<hmm_vec3>& spots, int frame) {
+    std::vector<hmm_vec3> positions(spots.size());
+    for (size_t i = 0; i < spots.size(); ++i) {
+        positions[i] = CrowdSpot(spots, i, frame);
+    }
+    const float reachSq = (kCrowdRadius * 2.0f) * (kCrowdRadius * 2.0f);
+    int contacts = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        for (size_t j = i + 1; j < positions.size(); ++j) {
+            if (i % 10 == 0 && j % 10 == 0) continue;  // Both static
+            hmm_vec3 diff = HMM_SubtractVec3(positions[i], positions[j]);
+            if (HMM_DotVec3(diff, diff) < reachSq) ++contacts;
+        }
+    }
+    return contacts;
+}
+
+// Spheres spread so each has about one neighbour in reach, like a dense
+// enemy wave
+std::vector<hmm_vec3> SpreadCrowd(int count) {
+    std::mt19937 rng(12345);
+    const float extent = sqrtf((float)count) * 1.2f;
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<hmm_vec3> spots((size_t)count);
+    for (hmm_vec3& spot : spots) {
+        spot = HMM_Vec3(unit(rng) * extent, 0.5f, unit(rng) * extent);
+    }
+    return spots;
+}
+
+} // namespace
+
+const PhysicsBenchmark::BroadphaseStats& PhysicsBenchmark::MeasureBroadphase(int colliderCount, int frames) {
+    broadphaseStats_ = BroadphaseStats();
+    if (colliderCount <= 0 || frames <= 0) return broadphaseStats_;
+    
+    std::vector<hmm_vec3> spots = SpreadCrowd(colliderCount);
+    BroadphaseRun brute = RunBroadphase(spots, frames, true, ECS::BroadphaseMode::SweepAndPrune);
+    BroadphaseRun sweep = RunBroadphase(spots, frames, false, ECS::BroadphaseMode::SweepAndPrune);
+    BroadphaseRun tree = RunBroadphase(spots, frames, false, ECS::BroadphaseMode::AABBTree);
+    
+    BroadphaseStats& stats = broadphaseStats_;
+    stats.colliders = colliderCount;
+    stats.frames = frames;
+    long long contacts = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        contacts += brute.contacts[frame];
+        if (sweep.contacts[frame] != brute.contacts[frame] || tree.contacts[frame] != brute.contacts[frame]) {
+            ++stats.mismatches;
+        }
+    }
+    stats.contacts = (int)(contacts / frames);
+    stats.bruteForcePairs = (int)(brute.pairs / frames);
+    stats.sweepPairs = (int)(sweep.pairs / frames);
+    stats.treePairs = (int)(tree.pairs / frames);
+    stats.bruteForceMs = brute.ms / frames;
+    stats.sweepMs = sweep.ms / frames;
+    stats.treeMs = tree.ms / frames;
+    
+    printf("Broadphase: %d spheres, %d contacts/frame: brute force %d pairs %.2f ms, sweep and prune %d pairs %.2f ms, "
+           "AABB tree %d pairs %.2f ms, %d mismatches\n",
+           colliderCount, stats.contacts, stats.bruteForcePairs, stats.bruteForceMs, stats.sweepPairs, stats.sweepMs,
+           stats.treePairs, stats.treeMs, stats.mismatches);
+    return broadphaseStats_;
+}
+
+const PhysicsBenchmark::HashGridStats& PhysicsBenchmark::MeasureHashGrid(int sphereCount, int frames) {
+    hashGridStats_ = HashGridStats();
+    if (sphereCount <= 0 || frames <= 0) return hashGridStats_;
+    
+    std::vector<hmm_vec3> spots = SpreadCrowd(sphereCount);
+    BroadphaseRun grid = RunBroadphase(spots, frames, false, ECS::BroadphaseMode::SweepAndPrune, kEnemyCollisionLayer);
+    
+    // Every pair, outside the ECS: at 100k spheres the brute-force pass of
+    // MeasureBroadphase() would hand it five billion pairs
+    using Clock = std::chrono::high_resolution_clock;
+    HashGridStats& stats = hashGridStats_;
+    long long contacts = 0;
+    double bruteMs = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto start = Clock::now();
+        int expected = CountCrowdContacts(spots, frame);
+        bruteMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        contacts += expected;
+        if (grid.contacts[frame] != expected) ++stats.mismatches;
+    }
+    
+    stats.spheres = sphereCount;
+    stats.frames = frames;
+    stats.contacts = (int)(contacts / frames);
+    stats.gridPairs = (int)(grid.pairs / frames);
+    stats.gridMs = grid.ms / frames;
+    stats.bruteForceMs = bruteMs / frames;
+    
+    printf("Hash grid: %d spheres, %d contacts/frame: every pair %.2f ms, hash grid %d pairs %.2f ms, %d mismatches\n",
+           sphereCount, stats.contacts, stats.bruteForceMs, stats.gridPairs, stats.gridMs, stats.mismatches);
+    return hashGridStats_;
+}
+
+const PhysicsBenchmark::QueryStats& PhysicsBenchmark::MeasureQueries(int colliderCount, int queryCount) {
+    queryStats_ = QueryStats();
+    if (colliderCount <= 0 || queryCount <= 0) return queryStats_;
+    
+    // Every eighth collider is a static tree trunk, the rest 0.5 m enemies
+    std::mt19937 rng(12345);
+    const float extent = sqrtf((float)colliderCount) * 2.0f;
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    ECS ecs;
+    Renderer renderer;
+    struct Sphere {
+        EntityId entity;
+        hmm_vec3 center;
+        float radius;
+    };
+    std::vector<Sphere> spheres((size_t)colliderCount);
+    for (int i = 0; i < colliderCount; ++i) {
+        Sphere& sphere = spheres[i];
+        sphere.entity = ecs.CreateEntity();
+        sphere.center = HMM_Vec3(unit(rng) * extent, i % 8 == 0 ? 1.5f : 0.5f, unit(rng) * extent);
+        sphere.radius = i % 8 == 0 ? 1.5f : 0.5f;
+        Transform t;
+        t.position = sphere.center;
+        ecs.AddTransform(sphere.entity, t);
+        Collider collider;
+        collider.type = ColliderType::Sphere;
+        collider.radius = sphere.radius;
+        collider.isStatic = i % 8 == 0;
+        ecs.AddCollider(sphere.entity, collider);
+    }
+    ecs.SyncToRenderer(renderer);
+    ecs.EndFrame();
+    
+    // One frame of movement, so the moving spheres' fat boxes in the index
+    // are no longer centred on them
+    for (int i = 0; i < colliderCount; ++i) {
+        if (i % 8 == 0) continue;
+        spheres[i].center = HMM_AddVec3(spheres[i].center, HMM_Vec3(unit(rng) * 0.15f, 0.0f, unit(rng) * 0.15f));
+        ecs.GetTransform(spheres[i].entity)->position = spheres[i].center;
+    }
+    ecs.SyncToRenderer(renderer);
+    ecs.EndFrame();
+    
+    std::vector<hmm_vec3> points((size_t)queryCount);
+    std::vector<Ray> rays((size_t)queryCount);
+    for (int i = 0; i < queryCount; ++i) {
+        points[i] = HMM_Vec3(unit(rng) * extent, 1.0f, unit(rng) * extent);
+        float angle = unit(rng) * 3.14159265f;
+        rays[i].origin = HMM_Vec3(points[i].X, 2.5f + unit(rng) * 0.5f, points[i].Z);
+        rays[i].direction = HMM_NormalizeVec3(HMM_Vec3(sinf(angle), -0.1f, cosf(angle)));
+        rays[i].maxDistance = 30.0f;
+    }
+    const hmm_vec3 halfBox = HMM_Vec3(2.0f, 2.0f, 2.0f);
+    const float sphereRadius = 3.0f;
+    
+    using Clock = std::chrono::high_resolution_clock;
+    auto usPerQuery = [&](Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queryCount;
+    };
+    
+    // Through the index
+    std::vector<std::vector<EntityId>> boxes((size_t)queryCount), balls((size_t)queryCount);
+    std::vector<RaycastHit> hits((size_t)queryCount);
+    auto start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        ecs.QueryColliders(HMM_SubtractVec3(points[i], halfBox), HMM_AddVec3(points[i], halfBox), boxes[i]);
+    }
+    queryStats_.boxUs = usPerQuery(start);
+    start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        ecs.QueryCollidersSphere(points[i], sphereRadius, balls[i]);
+    }
+    queryStats_.sphereUs = usPerQuery(start);
+    start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        hits[i] = ecs.RaycastPhysics(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+    }
+    queryStats_.rayUs = usPerQuery(start);
+    
+    // Scanning every collider, with the tests the index and RaycastCollider()
+    // apply to a sphere
+    std::vector<std::vector<EntityId>> scanBoxes((size_t)queryCount), scanBalls((size_t)queryCount);
+    std::vector<RaycastHit> scanHits((size_t)queryCount);
+    auto bounds = [](const Sphere& sphere, hmm_vec3& min, hmm_vec3& max) {
+        hmm_vec3 extents = HMM_Vec3(sphere.radius, sphere.radius, sphere.radius);
+        min = HMM_SubtractVec3(sphere.center, extents);
+        max = HMM_AddVec3(sphere.center, extents);
+    };
+    start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        hmm_vec3 queryMin = HMM_SubtractVec3(points[i], halfBox), queryMax = HMM_AddVec3(points[i], halfBox);
+        for (const Sphere& sphere : spheres) {
+            hmm_vec3 min, max;
+            bounds(sphere, min, max);
+            if (DynamicAABBTree::BoxesOverlap(min, max, queryMin, queryMax)) scanBoxes[i].push_back(sphere.entity);
+        }
+    }
+    queryStats_.scanBoxUs = usPerQuery(start);
+    start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        for (const Sphere& sphere : spheres) {
+            hmm_vec3 min, max;
+            bounds(sphere, min, max);
+            if (DynamicAABBTree::SphereOverlapsBox(points[i], sphereRadius, min, max)) scanBalls[i].push_back(sphere.entity);
+        }
+    }
+    queryStats_.scanSphereUs = usPerQuery(start);
+    start = Clock::now();
+    for (int i = 0; i < queryCount; ++i) {
+        const Ray& ray = rays[i];
+        RaycastHit& closest = scanHits[i];
+        closest.distance = ray.maxDistance;
+        for (const Sphere& sphere : spheres) {
+            hmm_vec3 oc = HMM_SubtractVec3(ray.origin, sphere.center);
+            float a = HMM_DotVec3(ray.direction, ray.direction);
+            float b = 2.0f * HMM_DotVec3(oc, ray.direction);
+            float c = HMM_DotVec3(oc, oc) - sphere.radius * sphere.radius;
+            float discriminant = b * b - 4 * a * c;
+            if (discriminant < 0.0f) continue;
+            float t = (-b - sqrtf(discriminant)) / (2.0f * a);
+            if (t > 0.001f && t < closest.distance) {
+                closest.hit = true;
+                closest.entity = sphere.entity;
+                closest.distance = t;
+            }
+        }
+    }
+    queryStats_.scanRayUs = usPerQuery(start);
+    
+    size_t boxResults = 0, sphereResults = 0;
+    for (int i = 0; i < queryCount; ++i) {
+        std::sort(boxes[i].begin(), boxes[i].end());
+        std::sort(scanBoxes[i].begin(), scanBoxes[i].end());
+        std::sort(balls[i].begin(), balls[i].end());
+        std::sort(scanBalls[i].begin(), scanBalls[i].end());
+        bool sameHit = hits[i].hit == scanHits[i].hit &&
+                       (!hits[i].hit || (hits[i].entity == scanHits[i].entity && hits[i].distance == scanHits[i].distance));
+        if (boxes[i] != scanBoxes[i] || balls[i] != scanBalls[i] || !sameHit) ++queryStats_.mismatches;
+        boxResults += boxes[i].size();
+        sphereResults += balls[i].size();
+        queryStats_.rayHits += hits[i].hit;
+    }
+    queryStats_.colliders = colliderCount;
+    queryStats_.queries = queryCount;
+    queryStats_.boxResults = (double)boxResults / queryCount;
+    queryStats_.sphereResults = (double)sphereResults / queryCount;
+    
+    printf("Queries, %d colliders: box %.2f us (%.1f found), sphere %.2f us (%.1f found), ray %.2f us (%d/%d hit); "
+           "scanning: box %.2f us, sphere %.2f us, ray %.2f us; %d mismatches\n",
+           colliderCount, queryStats_.boxUs, queryStats_.boxResults, queryStats_.sphereUs, queryStats_.sphereResults,
+           queryStats_.rayUs, queryStats_.rayHits, queryCount, queryStats_.scanBoxUs, queryStats_.scanSphereUs,
+           queryStats_.scanRayUs, queryStats_.mismatches);
+    return queryStats_;
+}
+
+const PhysicsBenchmark::MeshRaycastStats& PhysicsBenchmark::MeasureMeshRaycasts(const Model3D& model, int rayCount) {
+    meshRaycastStats_ = MeshRaycastStats();
+    if (rayCount <= 0) return meshRaycastStats_;
+    
+    CollisionMeshRegistry registry;
+    const CollisionMesh* mesh = registry.Get(registry.Register(model));
+    if (!mesh) {
+        printf("ERROR: Mesh raycasts: the model has no triangles\n");
+        ++meshRaycastStats_.mismatches;
+        return meshRaycastStats_;
+    }
+    
+    // Same rays every run: from a sphere around the mesh to a point inside
+    // its bounds, so most of them hit
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> inside(0.0f, 1.0f);
+    hmm_vec3 center = HMM_MultiplyVec3f(HMM_AddVec3(mesh->boundsMin, mesh->boundsMax), 0.5f);
+    hmm_vec3 size = HMM_SubtractVec3(mesh->boundsMax, mesh->boundsMin);
+    float reach = HMM_LengthVec3(size);
+    std::vector<Ray> rays((size_t)rayCount);
+    for (Ray& ray : rays) {
+        hmm_vec3 away;
+        do {
+            away = HMM_Vec3(unit(rng), unit(rng), unit(rng));
+        } while (HMM_DotVec3(away, away) < 0.01f);
+        ray.origin = HMM_AddVec3(center, HMM_MultiplyVec3f(HMM_NormalizeVec3(away), reach));
+        hmm_vec3 target = HMM_AddVec3(mesh->boundsMin, HMM_MultiplyVec3(size, HMM_Vec3(inside(rng), inside(rng), inside(rng))));
+        ray.direction = HMM_NormalizeVec3(HMM_SubtractVec3(target, ray.origin));
+        ray.maxDistance = 2.0f * reach;
+    }
+    
+    using Clock = std::chrono::high_resolution_clock;
+    auto raysPerSec = [&](Clock::time_point start) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return seconds > 0.0 ? rayCount / seconds : 0.0;
+    };
+    auto traceBVH = [&](const TrianglePacket* packets, std::vector<float>& distances) {
+        for (int i = 0; i < rayCount; ++i) {
+            distances[i] = rays[i].maxDistance;
+            if (RayMeshBVH(mesh->bvhNodes.data(), mesh->bvhNodes.size(), mesh->triangles.data(), packets,
+                           rays[i].origin, rays[i].direction, &distances[i]) < 0) {
+                distances[i] = -1.0f;
+            }
+        }
+    };
+    
+    std::vector<float> packet((size_t)rayCount), scalar((size_t)rayCount), brute((size_t)rayCount);
+    auto start = Clock::now();
+    traceBVH(mesh->trianglePackets.data(), packet);
+    meshRaycastStats_.packetRaysPerSec = raysPerSec(start);
+    start = Clock::now();
+    traceBVH(nullptr, scalar);
+    meshRaycastStats_.scalarRaysPerSec = raysPerSec(start);
+    
+    // Every packet with the scalar kernel, the closest hit shortening the ray
+    start = Clock::now();
+    for (int i = 0; i < rayCount; ++i) {
+        float closest = rays[i].maxDistance;
+        bool hit = false;
+        for (size_t first = 0; first < mesh->triangles.size(); first += kRayPacketWidth) {
+            size_t count = std::min(mesh->triangles.size() - first, (size_t)kRayPacketWidth);
+            float distances[kRayPacketWidth];
+            uint32_t lanes = RayTrianglePacketScalar(mesh->trianglePackets[first / kRayPacketWidth], rays[i].origin,
+                                                     rays[i].direction, closest, (1u << count) - 1, distances);
+            for (int lane = 0; lane < kRayPacketWidth; ++lane) {
+                if ((lanes & (1u << lane)) && distances[lane] < closest) {
+                    closest = distances[lane];
+                    hit = true;
+                }
+            }
+        }
+        brute[i] = hit ? closest : -1.0f;
+    }
+    meshRaycastStats_.bruteRaysPerSec = raysPerSec(start);
+    
+    auto same = [](float a, float b) {
+        if ((a < 0.0f) != (b < 0.0f)) return false;
+        return fabsf(a - b) <= kMeshDistanceTolerance * fmaxf(1.0f, fabsf(b));
+    };
+    meshRaycastStats_.triangles = (int)mesh->triangles.size();
+    meshRaycastStats_.bvhNodes = (int)mesh->bvhNodes.size();
+    meshRaycastStats_.rays = rayCount;
+    for (int i = 0; i < rayCount; ++i) {
+        meshRaycastStats_.hits += brute[i] >= 0.0f;
+        if (!same(packet[i], brute[i]) || !same(scalar[i], brute[i])) ++meshRaycastStats_.mismatches;
+    }
+    
+    printf("Mesh raycasts (%s): %d triangles, %d BVH nodes, %d rays, %d hits: %.2f M rays/s packed, "
+           "%.2f M rays/s one triangle at a time, %.2f M rays/s without the BVH, %d mismatches\n",
+           RayKernelName(), meshRaycastStats_.triangles, meshRaycastStats_.bvhNodes, rayCount, meshRaycastStats_.hits,
+           meshRaycastStats_.packetRaysPerSec * 1e-6, meshRaycastStats_.scalarRaysPerSec * 1e-6,
+           meshRaycastStats_.bruteRaysPerSec * 1e-6, meshRaycastStats_.mismatches);
+    return meshRaycastStats_;
+}
+
+const PhysicsBenchmark::RayKernelStats& PhysicsBenchmark::CheckRayKernels(int packetCount) {
+    rayKernelStats_ = RayKernelStats();
+    if (packetCount <= 0) return rayKernelStats_;
+    RayKernelStats& stats = rayKernelStats_;
+    
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> inside(0.0f, 1.0f);
+    auto point = [&](float scale) { return HMM_Vec3(unit(rng) * scale, unit(rng) * scale, unit(rng) * scale); };
+    auto direction = [&]() {
+        hmm_vec3 d;
+        do {
+            d = point(1.0f);
+        } while (HMM_DotVec3(d, d) < 0.01f);
+        return HMM_NormalizeVec3(d);
+    };
+    
+    // Masks must match exactly; the distances of the lanes hit closely
+    const float maxDistance = 100.0f;
+    auto compare = [&](uint32_t simdMask, uint32_t scalarMask, const float* simd, const float* scalar, int& hits) {
+        bool same = simdMask == scalarMask;
+        for (int lane = 0; lane < kRayPacketWidth; ++lane) {
+            if (!(simdMask & scalarMask & (1u << lane))) continue;
+            ++hits;
+            float error = fabsf(simd[lane] - scalar[lane]) / fmaxf(1.0f, fabsf(scalar[lane]));
+            stats.maxDistanceError = fmaxf(stats.maxDistanceError, error);
+            if (!(error <= kMeshDistanceTolerance)) same = false;
+        }
+        if (!same) ++stats.mismatches;
+    };
+    
+    // One ray against eight triangles. Half the rays go through a point on
+    // one triangle's edge or at a corner, where rounding decides.
+    std::vector<TrianglePacket> trianglePackets((size_t)packetCount);
+    std::vector<Ray> triangleRays((size_t)packetCount);
+    for (int i = 0; i < packetCount; ++i) {
+        CollisionTriangle triangles[kRayPacketWidth];
+        for (CollisionTriangle& triangle : triangles) {
+            triangle.v0 = point(5.0f);
+            triangle.v1 = HMM_AddVec3(triangle.v0, point(2.0f));
+            triangle.v2 = HMM_AddVec3(triangle.v0, point(2.0f));
+        }
+        std::vector<TrianglePacket> packed;
+        PackTriangles(triangles, kRayPacketWidth, packed);
+        trianglePackets[i] = packed[0];
+        
+        const CollisionTriangle& aim = triangles[rng() % kRayPacketWidth];
+        float u = inside(rng), v = inside(rng) * (1.0f - u);
+        switch (rng() % 4) {
+            case 0: v = 1.0f - u; break;       // On the v1-v2 edge
+            case 1: u = 0.0f; v = 0.0f; break;  // At v0
+            default: break;                    // Inside
+        }
+        hmm_vec3 target = HMM_AddVec3(aim.v0, HMM_AddVec3(HMM_MultiplyVec3f(HMM_SubtractVec3(aim.v1, aim.v0), u),
+                                                          HMM_MultiplyVec3f(HMM_SubtractVec3(aim.v2, aim.v0), v)));
+        triangleRays[i].origin = HMM_AddVec3(target, HMM_MultiplyVec3f(direction(), 10.0f));
+        triangleRays[i].direction = HMM_NormalizeVec3(HMM_SubtractVec3(target, triangleRays[i].origin));
+    }
+    
+    using Clock = std::chrono::high_resolution_clock;
+    std::vector<uint32_t> simdMasks((size_t)packetCount), scalarMasks((size_t)packetCount);
+    std::vector<float> simdDistances((size_t)packetCount * kRayPacketWidth), scalarDistances((size_t)packetCount * kRayPacketWidth);
+    auto start = Clock::now();
+    for (int i = 0; i < packetCount; ++i) {
+        simdMasks[i] = RayTrianglePacket(trianglePackets[i], triangleRays[i].origin, triangleRays[i].direction,
+                                         maxDistance, 0xFF, &simdDistances[(size_t)i * kRayPacketWidth]);
+    }
+    stats.simdNsPerPacket = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / packetCount;
+    start = Clock::now();
+    for (int i = 0; i < packetCount; ++i) {
+        scalarMasks[i] = RayTrianglePacketScalar(trianglePackets[i], triangleRays[i].origin, triangleRays[i].direction,
+                                                 maxDistance, 0xFF, &scalarDistances[(size_t)i * kRayPacketWidth]);
+    }
+    stats.scalarNsPerPacket = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / packetCount;
+    for (int i = 0; i < packetCount; ++i) {
+        compare(simdMasks[i], scalarMasks[i], &simdDistances[(size_t)i * kRayPacketWidth],
+                &scalarDistances[(size_t)i * kRayPacketWidth], stats.triangleHits);
+    }
+    
+    // One ray against eight boxes; every fourth ray runs along an axis
+    // (infinite inverse on the other two) and many start inside a box
+    for (int i = 0; i < packetCount; ++i) {
+        BoxPacket boxes;
+        for (int lane = 0; lane < kRayPacketWidth; ++lane) {
+            hmm_vec3 min = point(5.0f);
+            boxes.Set(lane, min, HMM_AddVec3(min, HMM_Vec3(inside(rng) * 3.0f, inside(rng) * 3.0f, inside(rng) * 3.0f)));
+        }
+        hmm_vec3 origin = point(6.0f);
+        hmm_vec3 dir = direction();
+        if (i % 4 == 0) {
+            int axis = (int)(rng() % 3);
+            dir = HMM_Vec3(0.0f, 0.0f, 0.0f);
+            dir.Elements[axis] = unit(rng) < 0.0f ? -1.0f : 1.0f;
+        }
+        float simd[kRayPacketWidth], scalar[kRayPacketWidth];
+        uint32_t simdMask = RayBoxPacket(boxes, origin, dir, 0xFF, simd);
+        uint32_t scalarMask = RayBoxPacketScalar(boxes, origin, dir, 0xFF, scalar);
+        compare(simdMask, scalarMask, simd, scalar, stats.boxHits);
+    }
+    
+    // Eight rays against one box (masks only)
+    for (int i = 0; i < packetCount; ++i) {
+        RayPacket rays;
+        for (int lane = 0; lane < kRayPacketWidth; ++lane) {
+            rays.Set(lane, point(6.0f), direction(), inside(rng) * 12.0f);
+        }
+        hmm_vec3 min = point(3.0f);
+        hmm_vec3 max = HMM_AddVec3(min, HMM_Vec3(inside(rng) * 3.0f, inside(rng) * 3.0f, inside(rng) * 3.0f));
+        uint32_t simdMask = RayPacketBox(rays, min, max, rays.laneMask);
+        uint32_t scalarMask = RayPacketBoxScalar(rays, min, max, rays.laneMask);
+        if (simdMask != scalarMask) ++stats.mismatches;
+        for (uint32_t lanes = simdMask; lanes != 0; lanes &= lanes - 1) ++stats.rayPacketHits;
+    }
+    
+    stats.packets = packetCount;
+    printf("Ray kernels (%s): %d packets each, %d triangle / %d box / %d ray-packet lanes hit, "
+           "triangles %.1f ns/packet SIMD vs %.1f ns scalar, max distance error %.2g, %d mismatches\n",
+           RayKernelName(), packetCount, stats.triangleHits, stats.boxHits, stats.rayPacketHits,
+           stats.simdNsPerPacket, stats.scalarNsPerPacket, stats.maxDistanceError, stats.mismatches);
+    return rayKernelStats_;
+}
+
+const PhysicsBenchmark::MeshInstanceStats& PhysicsBenchmark::MeasureMeshInstances(const Model3D& model, int instanceCount) {
+    meshInstanceStats_ = MeshInstanceStats();
+    if (instanceCount <= 0) return meshInstanceStats_;
+    MeshInstanceStats& stats = meshInstanceStats_;
+    
+    // A square forest, spaced so the rays aimed at one tree below (which
+    // start up to 3.6 times its reach out at the largest scale) can't meet
+    // another
+    ECS ecs;
+    Renderer renderer;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    float reachFromOrigin = 0.0f;
+    for (int i = 0; i < model.vertex_count; ++i) {
+        const float* p = model.vertices[i].pos;
+        reachFromOrigin = fmaxf(reachFromOrigin, sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+    }
+    const float spacing = 8.0f * reachFromOrigin;
+    const int side = (int)ceilf(sqrtf((float)instanceCount));
+    std::vector<EntityId> trees((size_t)instanceCount);
+    for (int i = 0; i < instanceCount; ++i) {
+        trees[i] = ecs.CreateEntity();
+        Transform t;
+        t.position = HMM_Vec3((i % side) * spacing, 0.0f, (i / side) * spacing);
+        t.yaw = unit(rng) * 180.0f;
+        float scale = 1.0f + unit(rng) * 0.2f;
+        t.scale = HMM_Vec3(scale, scale, scale);
+        ecs.AddTransform(trees[i], t);
+        ecs.CreateMeshCollider(trees[i], model);
+        if (!ecs.GetCollider(trees[i])) {
+            printf("ERROR: Mesh instances: the model has no triangles\n");
+            ++stats.mismatches;
+            return meshInstanceStats_;
+        }
+    }
+    ecs.SyncToRenderer(renderer);
+    ecs.EndFrame();
+    
+    const CollisionMeshRegistry& meshes = ecs.GetCollisionMeshes();
+    const Collider* first = ecs.GetCollider(trees[0]);
+    const CollisionMesh* mesh = meshes.Get(first->meshHandle);
+    stats.instances = instanceCount;
+    stats.triangles = (int)mesh->triangles.size();
+    stats.sharedBytes = meshes.MemoryBytes() + (size_t)instanceCount * sizeof(Collider);
+    stats.copiedBytes = (size_t)instanceCount * (sizeof(Collider) + mesh->triangles.size() * sizeof(CollisionTriangle));
+    
+    // Every tenth tree: a ray from outside its bounds to a point inside,
+    // against the triangles moved into world space
+    std::uniform_real_distribution<float> inside(0.0f, 1.0f);
+    std::vector<CollisionTriangle> world(mesh->triangles.size());
+    std::vector<TrianglePacket> packets;
+    for (int i = 0; i < instanceCount; i += 10) {
+        const Transform* transform = ecs.PeekTransform(trees[i]);
+        hmm_mat4 m = transform->CurrentMatrix();
+        auto toWorld = [&](const hmm_vec3& p) {
+            hmm_vec4 v = HMM_MultiplyMat4ByVec4(m, HMM_Vec4(p.X, p.Y, p.Z, 1.0f));
+            return HMM_Vec3(v.X, v.Y, v.Z);
+        };
+        hmm_vec3 lo = HMM_Vec3(1e30f, 1e30f, 1e30f), hi = HMM_Vec3(-1e30f, -1e30f, -1e30f);
+        for (size_t k = 0; k < world.size(); ++k) {
+            world[k].v0 = toWorld(mesh->triangles[k].v0);
+            world[k].v1 = toWorld(mesh->triangles[k].v1);
+            world[k].v2 = toWorld(mesh->triangles[k].v2);
+            for (const hmm_vec3* v : { &world[k].v0, &world[k].v1, &world[k].v2 }) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    lo.Elements[axis] = fminf(lo.Elements[axis], v->Elements[axis]);
+                    hi.Elements[axis] = fmaxf(hi.Elements[axis], v->Elements[axis]);
+                }
+            }
+        }
+        PackTriangles(world.data(), world.size(), packets);
+        
+        hmm_vec3 size = HMM_SubtractVec3(hi, lo);
+        hmm_vec3 target = HMM_AddVec3(lo, HMM_MultiplyVec3(size, HMM_Vec3(inside(rng), inside(rng), inside(rng))));
+        hmm_vec3 away;
+        do {
+            away = HMM_Vec3(unit(rng), unit(rng), unit(rng));
+        } while (HMM_DotVec3(away, away) < 0.01f);
+        float reach = HMM_LengthVec3(size);
+        hmm_vec3 origin = HMM_AddVec3(target, HMM_MultiplyVec3f(HMM_NormalizeVec3(away), reach));
+        hmm_vec3 direction = HMM_NormalizeVec3(HMM_SubtractVec3(target, origin));
+        
+        float closest = 2.0f * reach;
+        bool hit = false;
+        for (size_t k = 0; k < world.size(); k += kRayPacketWidth) {
+            size_t count = std::min(world.size() - k, (size_t)kRayPacketWidth);
+            float distances[kRayPacketWidth];
+            uint32_t lanes = RayTrianglePacketScalar(packets[k / kRayPacketWidth], origin, direction, closest,
+                                                     (1u << count) - 1, distances);
+            for (int lane = 0; lane < kRayPacketWidth; ++lane) {
+                if ((lanes & (1u << lane)) && distances[lane] < closest) {
+                    closest = distances[lane];
+                    hit = true;
+                }
+            }
+        }
+        
+        RaycastHit result = ecs.RaycastPhysics(origin, direction, 2.0f * reach);
+        bool same = result.hit == hit &&
+                    (!hit || (result.entity == trees[i] &&
+                              fabsf(result.distance - closest) <= kMeshDistanceTolerance * 10.0f * fmaxf(1.0f, closest)));
+        if (!same) ++stats.mismatches;
+        ++stats.rays;
+    }
+    
+    printf("Mesh instances: %d trees of %d triangles: %.2f MB shared, %.2f MB with a copy per collider; "
+           "%d rays, %d mismatches\n",
+           instanceCount, stats.triangles, stats.sharedBytes / (1024.0 * 1024.0), stats.copiedBytes / (1024.0 * 1024.0),
+           stats.rays, stats.mismatches);
+    return meshInstanceStats_;
+}
+
+namespace {
+
+constexpr int kTunnelingSteps = 30;
+
+struct TunnelingRun {
+    bool reachedFarSide = false;
+    int swept = 0;
+    int hits = 0;
+};
+
+// Steps `body` from `start` at `velocity` at whatever `ecs` holds, reports
+// whether `farSide` was ever true of its position, and removes it again
+template <typename FarSide>
+TunnelingRun RunTunneling(ECS& ecs, Renderer& renderer, FarSide&& farSide, const Collider& body, const hmm_vec3& start,
+                          const hmm_vec3& velocity, bool gravity, bool sweep, float dt) {
+    EntityId id = ecs.CreateEntity();
+    Transform t;
+    t.position = start;
+    ecs.AddTransform(id, t);
+    ecs.AddCollider(id, body);
+    Rigidbody rb;
+    rb.velocity = velocity;
+    rb.affectedByGravity = gravity;
+    rb.drag = 0.0f;
+    rb.continuousCollision = sweep;
+    ecs.AddRigidbody(id, rb);
+    
+    TunnelingRun run;
+    for (int step = 0; step < kTunnelingSteps; ++step) {
+        ecs.BeginPhysicsStep();
+        ecs.UpdatePhysics(dt);
+        ecs.UpdateCollisions(dt);
+        ecs.EndPhysicsStep();
+        ecs.SyncToRenderer(renderer);
+        ecs.EndFrame();
+        run.swept += ecs.GetContinuousStats().swept;
+        run.hits += ecs.GetContinuousStats().hits;
+        if (farSide(ecs.PeekTransform(id)->position)) run.reachedFarSide = true;
+    }
+    ecs.DestroyEntity(id);
+    return run;
+}
+
+} // namespace
+
+const PhysicsBenchmark::TunnelingStats& PhysicsBenchmark::CheckTunneling(float dt) {
+    tunnelingStats_ = TunnelingStats();
+    TunnelingStats& stats = tunnelingStats_;
+    
+    Collider sphere;
+    sphere.type = ColliderType::Sphere;
+    sphere.radius = 0.2f;
+    Collider box;
+    box.type = ColliderType::Box;
+    box.boxHalfExtents = HMM_Vec3(0.2f, 0.2f, 0.2f);
+    Collider capsule;
+    capsule.type = ColliderType::Capsule;
+    capsule.capsuleRadius = 0.2f;
+    capsule.capsuleHeight = 0.6f;
+    const float speeds[] = { 20.0f, 60.0f, 200.0f };
+    Renderer renderer;
+    
+    auto record = [&](const TunnelingRun& swept, const TunnelingRun& unswept, const char* what, float speed) {
+        ++stats.cases;
+        stats.swept += swept.swept;
+        stats.hits += swept.hits;
+        if (swept.reachedFarSide) {
+            printf("ERROR: Tunneling: %s at %.0f m/s went through\n", what, speed);
+            ++stats.tunneled;
+        }
+        if (unswept.reachedFarSide) ++stats.tunneledUnswept;
+    };
+    
+    // A 10 cm wall, fired at along X
+    for (float yaw : { 0.0f, 30.0f }) {
+        Transform wall;
+        wall.position = HMM_Vec3(0.0f, 2.0f, 0.0f);
+        wall.yaw = yaw;
+        hmm_vec3 axes[3];
+        TransformAxes(wall, axes);
+        ECS ecs;
+        EntityId id = ecs.CreateEntity();
+        ecs.AddTransform(id, wall);
+        Collider collider;
+        collider.type = ColliderType::Box;
+        collider.boxHalfExtents = HMM_Vec3(0.05f, 50.0f, 50.0f);
+        collider.isStatic = true;
+        ecs.AddCollider(id, collider);
+        auto beyondWall = [&](const hmm_vec3& p) { return HMM_DotVec3(HMM_SubtractVec3(p, wall.position), axes[0]) > 0.0f; };
+        for (const Collider* body : { &sphere, &box, &capsule }) {
+            for (float speed : speeds) {
+                const hmm_vec3 start = HMM_Vec3(-8.3f, 2.0f, 0.3f);  // No step ends exactly on the wall's middle
+                const hmm_vec3 velocity = HMM_Vec3(speed, 0.0f, 0.0f);
+                TunnelingRun swept = RunTunneling(ecs, renderer, beyondWall, *body, start, velocity, false, true, dt);
+                TunnelingRun unswept = RunTunneling(ecs, renderer, beyondWall, *body, start, velocity, false, false, dt);
+                record(swept, unswept, yaw == 0.0f ? "body at a wall" : "body at a turned wall", speed);
+            }
+        }
+    }
+    
+    // A floor of one layer of triangles, dropped onto (boxes have no mesh test)
+    const int cells = 20;
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    for (int z = 0; z <= cells; ++z) {
+        for (int x = 0; x <= cells; ++x) {
+            Vertex v = {};
+            v.pos[0] = (float)(x - cells / 2);
+            v.pos[2] = (float)(z - cells / 2);
+            v.normal[1] = 1.0f;
+            vertices.push_back(v);
+        }
+    }
+    for (int z = 0; z < cells; ++z) {
+        for (int x = 0; x < cells; ++x) {
+            uint16_t corner = (uint16_t)(z * (cells + 1) + x);
+            uint16_t quad[6] = { corner, (uint16_t)(corner + cells + 1), (uint16_t)(corner + 1),
+                                 (uint16_t)(corner + 1), (uint16_t)(corner + cells + 1), (uint16_t)(corner + cells + 2) };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    Model3D floor = {};
+    floor.vertices = vertices.data();
+    floor.indices = indices.data();
+    floor.vertex_count = (int)vertices.size();
+    floor.index_count = (int)indices.size();
+    ECS ecs;
+    EntityId id = ecs.CreateEntity();
+    ecs.AddTransform(id, Transform());
+    ecs.CreateMeshCollider(id, floor);
+    auto belowFloor = [](const hmm_vec3& p) { return p.Y < 0.0f; };
+    Collider ball = sphere;
+    ball.radius = 0.5f;
+    Collider tallCapsule = capsule;
+    tallCapsule.capsuleRadius = 0.3f;
+    tallCapsule.capsuleHeight = 1.0f;
+    for (const Collider* body : { &ball, &tallCapsule }) {
+        for (float speed : speeds) {
+            const hmm_vec3 start = HMM_Vec3(0.3f, 8.0f, 0.6f);
+            const hmm_vec3 velocity = HMM_Vec3(0.0f, -speed, 0.0f);
+            TunnelingRun swept = RunTunneling(ecs, renderer, belowFloor, *body, start, velocity, true, true, dt);
+            TunnelingRun unswept = RunTunneling(ecs, renderer, belowFloor, *body, start, velocity, true, false, dt);
+            record(swept, unswept, "body onto a mesh floor", speed);
+        }
+    }
+    
+    printf("Tunneling at %.0f fps: %d cases, %d went through with continuous collision (%d without), "
+           "%d swept steps, %d stopped at impact\n",
+           1.0f / dt, stats.cases, stats.tunneled, stats.tunneledUnswept, stats.swept, stats.hits);
+    return tunnelingStats_;
+}
+
+namespace {
+
+constexpr int kGroundCells = 16;  // Each way, for the mesh and heightfield grounds
+constexpr float kGroundCellSize = 0.5f;
+constexpr float kPushSlack = 1e-3f;  // Pushed past the reported depth, and the depth still allowed after
+
+bool IsGround(ColliderType type) {
+    return type == ColliderType::Mesh || type == ColliderType::Plane || type == ColliderType::Heightfield;
+}
+
+// A slope, the same for all three grounds. Curved ground would leave a
+// shape pushed out of one triangle a little inside the next.
+constexpr float kSlopeX = 0.2f;
+constexpr float kSlopeZ = -0.1f;
+
+float GroundHeight(float x, float z) {
+    return kSlopeX * x + kSlopeZ * z;
+}
+
+} // namespace
+
+const PhysicsBenchmark::NarrowphaseStats& PhysicsBenchmark::MeasureNarrowphase(int testCount) {
+    narrowphaseStats_ = NarrowphaseStats();
+    NarrowphaseStats& stats = narrowphaseStats_;
+    if (testCount <= 0) return stats;
+    stats.tests = testCount;
+    
+    // Two sets of spheres, boxes and capsules (so each type can meet itself),
+    // indexed by ColliderType, and one of each ground at the origin
+    ECS ecs;
+    Collider primitives[3];
+    primitives[0].type = ColliderType::Sphere;
+    primitives[0].radius = 0.5f;
+    primitives[1].type = ColliderType::Box;
+    primitives[1].boxHalfExtents = HMM_Vec3(0.6f, 0.3f, 0.4f);
+    primitives[2].type = ColliderType::Capsule;
+    primitives[2].capsuleHeight = 1.0f;
+    primitives[2].capsuleRadius = 0.3f;
+    std::vector<EntityId> bodies[2][3];
+    for (auto& set : bodies) {
+        for (int type = 0; type < 3; ++type) {
+            set[type].resize((size_t)testCount);
+            for (EntityId& id : set[type]) {
+                id = ecs.CreateEntity();
+                ecs.AddTransform(id, Transform());
+                ecs.AddCollider(id, primitives[type]);
+            }
+        }
+    }
+    
+    // Cells split along the same diagonal as heightfield cells, so the
+    // heightfield sampled from the mesh is the same surface
+    const float half = kGroundCells * kGroundCellSize * 0.5f;
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    for (int z = 0; z <= kGroundCells; ++z) {
+        for (int x = 0; x <= kGroundCells; ++x) {
+            Vertex v = {};
+            v.pos[0] = x * kGroundCellSize - half;
+            v.pos[2] = z * kGroundCellSize - half;
+            v.pos[1] = GroundHeight(v.pos[0], v.pos[2]);
+            v.normal[1] = 1.0f;
+            vertices.push_back(v);
+        }
+    }
+    for (int z = 0; z < kGroundCells; ++z) {
+        for (int x = 0; x < kGroundCells; ++x) {
+            uint16_t corner = (uint16_t)(z * (kGroundCells + 1) + x);
+            uint16_t quad[6] = { corner, (uint16_t)(corner + kGroundCells + 1), (uint16_t)(corner + kGroundCells + 2),
+                                 corner, (uint16_t)(corner + kGroundCells + 2), (uint16_t)(corner + 1) };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    Model3D ground = {};
+    ground.vertices = vertices.data();
+    ground.indices = indices.data();
+    ground.vertex_count = (int)vertices.size();
+    ground.index_count = (int)indices.size();
+    EntityId grounds[kColliderTypeCount] = {};
+    for (ColliderType type : { ColliderType::Mesh, ColliderType::Plane, ColliderType::Heightfield }) {
+        EntityId id = ecs.CreateEntity();
+        ecs.AddTransform(id, Transform());
+        if (type == ColliderType::Mesh) ecs.CreateMeshCollider(id, ground);
+        if (type == ColliderType::Plane) ecs.CreatePlaneCollider(id, HMM_NormalizeVec3(HMM_Vec3(-kSlopeX, 1.0f, -kSlopeZ)), 0.0f);
+        if (type == ColliderType::Heightfield) ecs.CreateHeightfieldCollider(id, ground, kGroundCellSize);
+        grounds[(int)type] = id;
+    }
+    
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    auto place = [&](EntityId id, const hmm_vec3& position) {
+        Transform* t = ecs.GetTransform(id);
+        t->position = position;
+        t->yaw = angle(rng);
+        t->pitch = angle(rng);
+        t->roll = angle(rng);
+    };
+    
+    using Clock = std::chrono::high_resolution_clock;
+    std::vector<EntityId> firsts((size_t)testCount), seconds((size_t)testCount);
+    std::vector<CollisionInfo> infos((size_t)testCount);
+    std::vector<char> hits((size_t)testCount);
+    for (int a = 0; a < kColliderTypeCount; ++a) {
+        for (int b = a; b < kColliderTypeCount; ++b) {
+            if (!HasContactTest((ColliderType)a, (ColliderType)b)) continue;
+            const bool onGround = IsGround((ColliderType)a) || IsGround((ColliderType)b);
+            
+            // Near a ground anywhere over its middle, from half a metre
+            // below to a metre above; near each other for two primitives
+            for (int i = 0; i < testCount; ++i) {
+                firsts[i] = IsGround((ColliderType)a) ? grounds[a] : bodies[0][a][i];
+                seconds[i] = IsGround((ColliderType)b) ? grounds[b] : bodies[1][b][i];
+                if (onGround) {
+                    EntityId body = IsGround((ColliderType)a) ? seconds[i] : firsts[i];
+                    float x = unit(rng) * (half - 1.0f);
+                    float z = unit(rng) * (half - 1.0f);
+                    place(body, HMM_Vec3(x, GroundHeight(x, z) + 0.25f + unit(rng) * 0.75f, z));
+                } else {
+                    place(firsts[i], HMM_Vec3(0.0f, 0.0f, 0.0f));
+                    place(seconds[i], HMM_Vec3(unit(rng) * 1.5f, unit(rng) * 1.5f, unit(rng) * 1.5f));
+                }
+            }
+            
+            auto start = Clock::now();
+            for (int i = 0; i < testCount; ++i) {
+                hits[i] = ecs.CheckCollision(firsts[i], seconds[i], &infos[i]);
+            }
+            stats.ns[a][b] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / testCount;
+            
+            // The normal points from the second shape to the first, so the
+            // first moves along it (the second against it, off a ground)
+            int pairHits = 0, pairMismatches = 0;
+            for (int i = 0; i < testCount; ++i) {
+                CollisionInfo swapped;
+                bool swappedHit = ecs.CheckCollision(seconds[i], firsts[i], &swapped);
+                if (swappedHit != (bool)hits[i]) {
+                    ++pairMismatches;
+                    continue;
+                }
+                if (!hits[i]) continue;
+                ++pairHits;
+                const CollisionInfo& info = infos[i];
+                if (HMM_DotVec3(info.normal, swapped.normal) > -0.999f ||
+                    fabsf(info.penetration - swapped.penetration) > kPushSlack) {
+                    ++pairMismatches;
+                    continue;
+                }
+                const bool moveFirst = !IsGround((ColliderType)a);
+                Transform* t = ecs.GetTransform(moveFirst ? firsts[i] : seconds[i]);
+                hmm_vec3 push = HMM_MultiplyVec3f(info.normal, info.penetration + kPushSlack);
+                t->position = moveFirst ? HMM_AddVec3(t->position, push) : HMM_SubtractVec3(t->position, push);
+                CollisionInfo after;
+                if (ecs.CheckCollision(firsts[i], seconds[i], &after) && after.penetration > kPushSlack) ++pairMismatches;
+            }
+            
+            const char* nameA = ColliderTypeName((ColliderType)a);
+            const char* nameB = ColliderTypeName((ColliderType)b);
+            if (pairMismatches) {
+                printf("ERROR: Narrowphase: %d of %d %s-%s tests not symmetric or not separated by their depth\n",
+                       pairMismatches, testCount, nameA, nameB);
+            }
+            printf("Narrowphase %s-%s: %.0f ns per test, %d of %d touching\n", nameA, nameB, stats.ns[a][b], pairHits, testCount);
+            ++stats.pairs;
+            stats.hits += pairHits;
+            stats.mismatches += pairMismatches;
+        }
+    }
+    
+    printf("Narrowphase: %d pair types, %d tests each, %d touching, %d mismatches\n",
+           stats.pairs, testCount, stats.hits, stats.mismatches);
+    return stats;
+}
+
+namespace {
+
+// Mesh colliders index their vertices with uint16_t, so the terrain mesh is
+// split into chunks of this many cells each way
+constexpr int kTerrainChunkCells = 128;
+
+float TerrainHeight(float x, float z) {
+    return 6.0f * sinf(x * 0.05f) * cosf(z * 0.043f) + 1.5f * sinf(x * 0.31f + z * 0.27f);
+}
+
+} // namespace
+
+const PhysicsBenchmark::HeightfieldRayStats& PhysicsBenchmark::MeasureHeightfieldRaycasts(int samples, int rayCount) {
+    heightfieldRayStats_ = HeightfieldRayStats();
+    HeightfieldRayStats& stats = heightfieldRayStats_;
+    if (samples < 2 || rayCount <= 0) return stats;
+    stats.samples = samples;
+    stats.rays = rayCount;
+    
+    // Heights a metre apart, centred on the origin
+    const float half = 0.5f * (samples - 1);
+    std::vector<float> heights((size_t)samples * samples);
+    for (int z = 0; z < samples; ++z) {
+        for (int x = 0; x < samples; ++x) heights[(size_t)z * samples + x] = TerrainHeight(x - half, z - half);
+    }
+    Heightfield field;
+    if (!BuildHeightfield(heights.data(), samples, samples, 1.0f, -half, -half, field)) return stats;
+    
+    // The mesh takes the field's quantized vertices and splits its cells
+    // the same way, so both hold exactly the same triangles. Each chunk
+    // keeps its own index buffer: models register by their indices.
+    ECS meshScene;
+    const int cells = samples - 1;
+    std::vector<std::vector<Vertex>> chunkVertices;
+    std::vector<std::vector<uint16_t>> chunkIndices;
+    for (int chunkZ = 0; chunkZ < cells; chunkZ += kTerrainChunkCells) {
+        for (int chunkX = 0; chunkX < cells; chunkX += kTerrainChunkCells) {
+            const int columns = std::min(kTerrainChunkCells, cells - chunkX) + 1;
+            const int rows = std::min(kTerrainChunkCells, cells - chunkZ) + 1;
+            std::vector<Vertex>& vertices = chunkVertices.emplace_back();
+            std::vector<uint16_t>& indices = chunkIndices.emplace_back();
+            for (int z = 0; z < rows; ++z) {
+                for (int x = 0; x < columns; ++x) {
+                    hmm_vec3 p = field.Vertex(chunkX + x, chunkZ + z);
+                    Vertex v = {};
+                    v.pos[0] = p.X;
+                    v.pos[1] = p.Y;
+                    v.pos[2] = p.Z;
+                    v.normal[1] = 1.0f;
+                    vertices.push_back(v);
+                }
+            }
+            for (int z = 0; z + 1 < rows; ++z) {
+                for (int x = 0; x + 1 < columns; ++x) {
+                    uint16_t corner = (uint16_t)(z * columns + x);
+                    uint16_t quad[6] = { corner, (uint16_t)(corner + columns), (uint16_t)(corner + columns + 1),
+                                         corner, (uint16_t)(corner + columns + 1), (uint16_t)(corner + 1) };
+                    indices.insert(indices.end(), quad, quad + 6);
+                }
+            }
+            Model3D chunk = {};
+            chunk.vertices = vertices.data();
+            chunk.indices = indices.data();
+            chunk.vertex_count = (int)vertices.size();
+            chunk.index_count = (int)indices.size();
+            EntityId id = meshScene.CreateEntity();
+            meshScene.AddTransform(id, Transform());
+            meshScene.CreateMeshCollider(id, chunk);
+        }
+    }
+    meshScene.EndFrame();
+    stats.meshBytes = meshScene.GetCollisionMeshes().MemoryBytes();
+    
+    ECS fieldScene;
+    EntityId ground = fieldScene.CreateEntity();
+    fieldScene.AddTransform(ground, Transform());
+    fieldScene.AddHeightfieldCollider(ground, std::move(field));
+    fieldScene.EndFrame();
+    stats.fieldBytes = fieldScene.GetHeightfields().MemoryBytes();
+    
+    // Camera picks straight down, shots towards the horizon that cross
+    // hundreds of cells, and level rays through the hills that mostly
+    // leave the field
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float maxDistance = 2.0f * samples;
+    using Clock = std::chrono::high_resolution_clock;
+    static const char* kKinds[3] = { "steep", "shallow", "level" };
+    std::vector<Ray> rays((size_t)rayCount);
+    std::vector<RaycastHit> fieldHits((size_t)rayCount), meshHits((size_t)rayCount);
+    for (int kind = 0; kind < 3; ++kind) {
+        for (Ray& ray : rays) {
+            ray.origin = HMM_Vec3(unit(rng) * half * 0.9f, 20.0f + 10.0f * unit(rng), unit(rng) * half * 0.9f);
+            hmm_vec3 direction;
+            if (kind == 0) {
+                direction = HMM_Vec3(unit(rng) * 0.5f, -1.0f, unit(rng) * 0.5f);
+            } else if (kind == 1) {
+                direction = HMM_Vec3(unit(rng), -0.03f - 0.03f * fabsf(unit(rng)), unit(rng));
+            } else {
+                ray.origin.Y = 3.0f * unit(rng);
+                direction = HMM_Vec3(unit(rng), 0.0f, unit(rng));
+            }
+            ray.direction = HMM_NormalizeVec3(direction);
+            ray.maxDistance = maxDistance;
+        }
+        
+        auto start = Clock::now();
+        for (int i = 0; i < rayCount; ++i) {
+            fieldHits[i] = fieldScene.RaycastPhysics(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+        }
+        auto middle = Clock::now();
+        for (int i = 0; i < rayCount; ++i) {
+            meshHits[i] = meshScene.RaycastPhysics(rays[i].origin, rays[i].direction, rays[i].maxDistance);
+        }
+        auto end = Clock::now();
+        stats.fieldUs[kind] = std::chrono::duration<double, std::micro>(middle - start).count() / rayCount;
+        stats.meshUs[kind] = std::chrono::duration<double, std::micro>(end - middle).count() / rayCount;
+        
+        int kindHits = 0, kindMismatches = 0;
+        for (int i = 0; i < rayCount; ++i) {
+            const RaycastHit& a = fieldHits[i];
+            const RaycastHit& b = meshHits[i];
+            kindHits += a.hit;
+            if (a.hit != b.hit ||
+                (a.hit && fabsf(a.distance - b.distance) > kMeshDistanceTolerance * std::max(1.0f, a.distance))) {
+                ++kindMismatches;
+            }
+        }
+        printf("Heightfield rays (%s): %d of %d hit, %.2f us per ray against %.2f us for the mesh, %d mismatches\n",
+               kKinds[kind], kindHits, rayCount, stats.fieldUs[kind], stats.meshUs[kind], kindMismatches);
+        stats.hits += kindHits;
+        stats.mismatches += kindMismatches;
+    }
+    
+    printf("Heightfield %d x %d: %.1f MB against %.1f MB as mesh colliders, %d mismatches\n", samples, samples,
+           stats.fieldBytes / (1024.0 * 1024.0), stats.meshBytes / (1024.0 * 1024.0), stats.mismatches);
+    return stats;
+}
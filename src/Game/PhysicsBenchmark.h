@@ -0,0 +1,231 @@
+#pragma once
+
+#include "ECS.h"
+#include <vector>
+
+// ============================================================================
+// PHYSICS BENCHMARK - Stress scenes and checks run by --benchmark
+// ============================================================================
+
+class PhysicsBenchmark {
+public:
+    static constexpr int kPyramidLayers = 14;  // 14^2 + 13^2 + ... + 1 = 1015 boxes
+
+    // Unit boxes dropped on the ground (physics only); AfterStep() times how long they take to settle
+    void SpawnBoxPyramid(ECS& ecs, const hmm_vec3& groundCenter, int layers = kPyramidLayers);
+    void Clear(ECS& ecs);
+    void AfterStep(ECS& ecs, float dt);
+
+    struct Stats {
+        int bodies = 0;
+        int steps = 0;             // Physics steps since the spawn
+        bool settled = false;
+        float settleTime = 0.0f;   // Simulated seconds until the last box stopped
+        float solveMsTotal = 0.0f; // Until settled
+        float solveMsMax = 0.0f;
+        int iterationsTotal = 0;
+    };
+    const Stats& GetStats() const { return stats_; }
+    bool IsRunning() const { return !bodies_.empty(); }
+
+    // Headless: the pyramid on a ground plane in its own ECS, stepped at 60 Hz until settled
+    static constexpr int kPyramidStepCap = 60 * 60;
+    const Stats& RunBoxPyramid(int layers = kPyramidLayers, int maxSteps = kPyramidStepCap);
+
+    static constexpr int kBenchmarkRays = 16384;
+
+    // Sight lines around center: RaycastPhysics() against RaycastBatch() on one thread and on the job system
+    struct RaycastStats {
+        int rays = 0;
+        int hits = 0;
+        int mismatches = 0;               // Batched results that differ from RaycastPhysics()
+        double singleRaysPerSec = 0.0;
+        double batchRaysPerSec = 0.0;
+        double parallelRaysPerSec = 0.0;  // 0 without a job system
+        unsigned threads = 1;
+    };
+    const RaycastStats& MeasureRaycasts(ECS& ecs, const hmm_vec3& center, float radius, int rayCount = kBenchmarkRays);
+    const RaycastStats& GetRaycastStats() const { return raycastStats_; }
+
+    static constexpr int kBenchmarkSweeps = 16384;
+
+    // Walking steps around center: SweepCapsule() against SweepCapsuleBatch()
+    struct SweepStats {
+        int sweeps = 0;
+        int hits = 0;
+        int mismatches = 0;                 // Batched results that differ from SweepCapsule()
+        double singleSweepsPerSec = 0.0;
+        double batchSweepsPerSec = 0.0;
+        double parallelSweepsPerSec = 0.0;  // 0 without a job system
+        unsigned threads = 1;
+    };
+    const SweepStats& MeasureCapsuleSweeps(ECS& ecs, const hmm_vec3& center, float radius,
+                                           int sweepCount = kBenchmarkSweeps);
+    const SweepStats& GetSweepStats() const { return sweepStats_; }
+
+    // A character walking onto a step of CharacterController::stepHeight and down a 30 degree ramp
+    struct CharacterMoveStats {
+        bool climbedStep = false;
+        float stepTopError = 0.0f;  // Height above or below the step's top where it ended
+        int slopeSteps = 0;         // Physics steps spent on the ramp
+        int slopeAirborne = 0;      // Of those, not grounded
+        int failures = 0;
+    };
+    const CharacterMoveStats& CheckCharacterMoves();
+    const CharacterMoveStats& GetCharacterMoveStats() const { return characterMoveStats_; }
+
+    static constexpr int kBenchmarkFrames = 10;
+
+    // A drifting crowd of spheres: every pair against sweep and prune against the AABB tree
+    struct BroadphaseStats {
+        int colliders = 0;
+        int frames = 0;
+        int contacts = 0;     // Per frame, averaged
+        int mismatches = 0;   // Frames whose contacts differ from the brute-force pass
+        int bruteForcePairs = 0;  // Pairs handed to the narrowphase per frame, averaged
+        int sweepPairs = 0;
+        int treePairs = 0;
+        double bruteForceMs = 0.0;  // UpdateCollisions() per frame
+        double sweepMs = 0.0;
+        double treeMs = 0.0;
+    };
+    const BroadphaseStats& MeasureBroadphase(int colliderCount, int frames = kBenchmarkFrames);
+    const BroadphaseStats& GetBroadphaseStats() const { return broadphaseStats_; }
+
+    // The same kind of crowd in the spatial hash grid against testing every pair
+    struct HashGridStats {
+        int spheres = 0;
+        int frames = 0;
+        int contacts = 0;     // Per frame, averaged
+        int mismatches = 0;   // Frames whose contacts differ from testing every pair
+        int gridPairs = 0;    // Pairs handed to the narrowphase per frame, averaged
+        double bruteForceMs = 0.0;  // Every pair, per frame
+        double gridMs = 0.0;        // UpdateCollisions() per frame
+    };
+    const HashGridStats& MeasureHashGrid(int sphereCount, int frames = kBenchmarkFrames);
+    const HashGridStats& GetHashGridStats() const { return hashGridStats_; }
+
+    static constexpr int kBenchmarkQueries = 1000;
+
+    // Box, sphere and ray queries through the collider index against a scan of every collider
+    struct QueryStats {
+        int colliders = 0;
+        int queries = 0;      // Of each kind
+        int mismatches = 0;   // Queries whose results differ from the scan
+        double boxResults = 0.0;     // Entities per query, averaged
+        double sphereResults = 0.0;
+        int rayHits = 0;
+        double boxUs = 0.0;          // Per query, through the index
+        double sphereUs = 0.0;
+        double rayUs = 0.0;
+        double scanBoxUs = 0.0;      // Per query, scanning every collider
+        double scanSphereUs = 0.0;
+        double scanRayUs = 0.0;
+    };
+    const QueryStats& MeasureQueries(int colliderCount, int queryCount = kBenchmarkQueries);
+    const QueryStats& GetQueryStats() const { return queryStats_; }
+
+    static constexpr float kMeshDistanceTolerance = 1e-4f;  // Relative
+
+    // Rays at a collision mesh: packed BVH against one triangle at a time and against no BVH
+    struct MeshRaycastStats {
+        int triangles = 0;
+        int bvhNodes = 0;
+        int rays = 0;
+        int hits = 0;
+        int mismatches = 0;          // Rays where the three paths disagree
+        double packetRaysPerSec = 0.0;
+        double scalarRaysPerSec = 0.0;  // BVH, one triangle at a time
+        double bruteRaysPerSec = 0.0;   // Every triangle, no BVH
+    };
+    const MeshRaycastStats& MeasureMeshRaycasts(const Model3D& model, int rayCount = kBenchmarkRays);
+    const MeshRaycastStats& GetMeshRaycastStats() const { return meshRaycastStats_; }
+
+    static constexpr int kBenchmarkPackets = 100000;
+
+    // Random packets through the SIMD ray kernels and their scalar versions
+    struct RayKernelStats {
+        int packets = 0;              // Of each kind
+        int triangleHits = 0;         // Lanes hit, for a sense of coverage
+        int boxHits = 0;
+        int rayPacketHits = 0;
+        int mismatches = 0;           // Packets whose SIMD and scalar results differ
+        float maxDistanceError = 0.0f;  // Relative
+        double simdNsPerPacket = 0.0;   // Triangle packets
+        double scalarNsPerPacket = 0.0;
+    };
+    const RayKernelStats& CheckRayKernels(int packetCount = kBenchmarkPackets);
+    const RayKernelStats& GetRayKernelStats() const { return rayKernelStats_; }
+
+    // A forest sharing one collision mesh: its memory, and rays against the triangles in world space
+    struct MeshInstanceStats {
+        int instances = 0;
+        int triangles = 0;          // Per instance
+        size_t sharedBytes = 0;     // Collision mesh registry plus the colliders
+        size_t copiedBytes = 0;     // The colliders, each with its own triangles
+        int rays = 0;
+        int mismatches = 0;         // Rays whose hit differs from the world-space triangles
+    };
+    const MeshInstanceStats& MeasureMeshInstances(const Model3D& model, int instanceCount = 10000);
+    const MeshInstanceStats& GetMeshInstanceStats() const { return meshInstanceStats_; }
+
+    static constexpr float kTunnelingStep = 0.1f;  // 10 fps
+
+    // Fast bodies at a thin wall and a mesh floor at 10 fps, with and without continuous collision
+    struct TunnelingStats {
+        int cases = 0;
+        int tunneled = 0;          // Bodies that reached the far side with continuous collision
+        int tunneledUnswept = 0;   // The same without it, for comparison
+        int swept = 0;             // Steps that moved a body in substeps
+        int hits = 0;              // Of those, stopped at a time of impact
+    };
+    const TunnelingStats& CheckTunneling(float dt = kTunnelingStep);
+    const TunnelingStats& GetTunnelingStats() const { return tunnelingStats_; }
+
+    static constexpr int kBenchmarkContacts = 2000;
+
+    // Random placements of every pair of collider types with a contact test
+    struct NarrowphaseStats {
+        int pairs = 0;        // Pair types measured
+        int tests = 0;        // Per pair type
+        int hits = 0;
+        int mismatches = 0;   // Swapped tests that disagree, or contacts that pushing out leaves touching
+        double ns[kColliderTypeCount][kColliderTypeCount] = {};  // Per test, first type <= second
+    };
+    const NarrowphaseStats& MeasureNarrowphase(int testCount = kBenchmarkContacts);
+    const NarrowphaseStats& GetNarrowphaseStats() const { return narrowphaseStats_; }
+
+    static constexpr int kTerrainSamples = 1025;
+
+    // Rays at a heightfield and at the same surface as mesh colliders, through RaycastPhysics()
+    struct HeightfieldRayStats {
+        int samples = 0;         // Per side
+        size_t fieldBytes = 0;
+        size_t meshBytes = 0;
+        int rays = 0;            // Of each kind: steep, shallow, level
+        int hits = 0;
+        int mismatches = 0;      // Rays whose hit or distance differs between the two
+        double fieldUs[3] = {};  // Per ray, by kind
+        double meshUs[3] = {};
+    };
+    const HeightfieldRayStats& MeasureHeightfieldRaycasts(int samples = kTerrainSamples, int rayCount = kBenchmarkRays);
+    const HeightfieldRayStats& GetHeightfieldRayStats() const { return heightfieldRayStats_; }
+
+private:
+    std::vector<EntityId> bodies_;
+    Stats stats_;
+    RaycastStats raycastStats_;
+    SweepStats sweepStats_;
+    CharacterMoveStats characterMoveStats_;
+    BroadphaseStats broadphaseStats_;
+    HashGridStats hashGridStats_;
+    QueryStats queryStats_;
+    MeshRaycastStats meshRaycastStats_;
+    RayKernelStats rayKernelStats_;
+    MeshInstanceStats meshInstanceStats_;
+    TunnelingStats tunnelingStats_;
+    NarrowphaseStats narrowphaseStats_;
+    HeightfieldRayStats heightfieldRayStats_;
+    float time_ = 0.0f;
+    float lastMoving_ = 0.0f;  // Time of the last step a box was moving
+};
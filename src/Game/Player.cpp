@@ -30,20 +30,27 @@ void PlayerController::Spawn(const hmm_vec3 &pos) {
 
     Rigidbody rb;
     rb.mass = 1.0f;
-    rb.affectedByGravity = true; // Player affected by gravity
-    rb.drag = 0.1f; // Some air resistance
+    rb.affectedByGravity = false; // The character controller applies gravity
+    rb.drag = 0.0f;
     rb.bounciness = 0.0f; // Don't bounce
-    rb.isKinematic = false; // Affected by physics
+    rb.isKinematic = true; // Moved by ECS::UpdateCharacters(), pushes bodies it walks into
+    rb.canSleep = false; // Input writes the controller every frame
+    rb.friction = 0.0f;
     ecs_.AddRigidbody(entityId_, rb);
 
-    // ADDED: Player collider (sphere for smooth movement)
+    // Player collider: capsule swept by the character controller, as tall
+    // as the old radius 0.5 sphere so the model still sits on the ground
     Collider playerCollider;
-    playerCollider.type = ColliderType::Sphere;
-    playerCollider.radius = 0.5f; // Player body radius
+    playerCollider.type = ColliderType::Capsule;
+    playerCollider.capsuleHeight = 0.2f;
+    playerCollider.capsuleRadius = 0.4f;
     playerCollider.isStatic = false;
     playerCollider.isTrigger = false;
     ecs_.AddCollider(entityId_, playerCollider);
 
+    CharacterController controller;
+    ecs_.AddCharacter(entityId_, controller);
+
     // ADDED: Selectable component (for editor selection & visualization)
     Selectable playerSelectable;
     playerSelectable.name = "Player";
@@ -60,8 +67,8 @@ void PlayerController::Spawn(const hmm_vec3 &pos) {
     // FIXED: Initialize model yaw with inverted camera yaw
     modelYaw_ = -camera_.GetYaw(); // Added negative sign
 
-    printf("Player spawned at (%.2f, %.2f, %.2f) with collider radius=%.2f and selectable sphere radius=%.2f\n",
-            pos.X, pos.Y, pos.Z, playerCollider.radius, playerSelectable.boundingSphereRadius);
+    printf("Player spawned at (%.2f, %.2f, %.2f) with capsule radius=%.2f and selectable sphere radius=%.2f\n",
+            pos.X, pos.Y, pos.Z, playerCollider.capsuleRadius, playerSelectable.boundingSphereRadius);
 }
 
 void PlayerController::HandleEvent(const sapp_event *ev) {
@@ -189,6 +196,7 @@ void PlayerController::Update(float dt) {
 
     Transform *t = ecs_.GetTransform(entityId_);
     Rigidbody *rb = ecs_.GetRigidbody(entityId_);
+    CharacterController *controller = ecs_.GetCharacter(entityId_);
 
     if (!t) {
         printf("ERROR: No transform found for player entity!\n");
@@ -198,12 +206,12 @@ void PlayerController::Update(float dt) {
     if (gameState_.IsPlaying()) {
         // PLAYING MODE: Move player with physics, camera follows
 
-        // ADDED: Check if grounded (simple check: Y position near ground level)
-        isGrounded_ = (t->position.Y <= -3.5f); // Ground is at Y=-4, player radius is 0.5
+        // Grounded as of the last character sweep
+        isGrounded_ = controller && controller->grounded;
 
         // ADDED: Handle jump
-        if (jump_ && isGrounded_ && rb) {
-            rb->velocity.Y = jumpForce_; // Apply upward velocity
+        if (jump_ && isGrounded_) {
+            controller->verticalVelocity = jumpForce_; // Apply upward velocity
             jump_ = false; // Consume jump input
             printf("Player jumped!\n");
         }
@@ -213,8 +221,8 @@ void PlayerController::Update(float dt) {
         hmm_vec3 right_dir = camera_.GetRightDirection();
         float speed = moveSpeed_ * (sprint_ ? 2.0f : 1.0f);
 
-        // CHANGED: Apply movement as velocity change (not direct position change)
-        // This allows physics/collision to handle the actual movement
+        // Apply movement as a wanted velocity; the character controller
+        // sweeps it against the world and slides along what it hits
         hmm_vec3 moveDir = HMM_Vec3(0.0f, 0.0f, 0.0f);
         if (forward_) moveDir = HMM_AddVec3(moveDir, forward_dir);
         if (back_) moveDir = HMM_SubtractVec3(moveDir, forward_dir);
@@ -229,7 +237,9 @@ void PlayerController::Update(float dt) {
         }
 
         // Apply horizontal velocity (preserve Y velocity for jumping/falling)
-        if (rb) {
+        if (controller) {
+            controller->moveVelocity = HMM_Vec3(moveDir.X * speed, 0.0f, moveDir.Z * speed);
+        } else if (rb) {
             rb->velocity.X = moveDir.X * speed;
             rb->velocity.Z = moveDir.Z * speed;
         } else {
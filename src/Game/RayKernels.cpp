@@ -0,0 +1,327 @@
+#include "RayKernels.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+    #define RAY_KERNELS_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RAY_KERNELS_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+// The SIMD and scalar versions only round alike if neither has its
+// multiply-adds fused, which GCC and Clang do by default once FMA is enabled
+#if defined(__clang__)
+    #pragma clang fp contract(off)
+#elif defined(__GNUC__)
+    #pragma GCC optimize("fp-contract=off")
+#endif
+
+void BoxPacket::Set(int lane, const hmm_vec3& min, const hmm_vec3& max) {
+    minX[lane] = min.X; minY[lane] = min.Y; minZ[lane] = min.Z;
+    maxX[lane] = max.X; maxY[lane] = max.Y; maxZ[lane] = max.Z;
+}
+
+void RayPacket::Set(int lane, const hmm_vec3& origin, const hmm_vec3& direction, float distance) {
+    originX[lane] = origin.X; originY[lane] = origin.Y; originZ[lane] = origin.Z;
+    inverseX[lane] = 1.0f / direction.X; inverseY[lane] = 1.0f / direction.Y; inverseZ[lane] = 1.0f / direction.Z;
+    maxDistance[lane] = distance;
+    laneMask |= 1u << lane;
+}
+
+void PackTriangles(const CollisionTriangle* triangles, size_t count, std::vector<TrianglePacket>& outPackets) {
+    outPackets.assign((count + kRayPacketWidth - 1) / kRayPacketWidth, TrianglePacket{});
+    for (size_t i = 0; i < count; ++i) {
+        TrianglePacket& packet = outPackets[i / kRayPacketWidth];
+        size_t lane = i % kRayPacketWidth;
+        const CollisionTriangle& tri = triangles[i];
+        hmm_vec3 edge1 = HMM_SubtractVec3(tri.v1, tri.v0);
+        hmm_vec3 edge2 = HMM_SubtractVec3(tri.v2, tri.v0);
+        packet.v0x[lane] = tri.v0.X; packet.v0y[lane] = tri.v0.Y; packet.v0z[lane] = tri.v0.Z;
+        packet.e1x[lane] = edge1.X; packet.e1y[lane] = edge1.Y; packet.e1z[lane] = edge1.Z;
+        packet.e2x[lane] = edge2.X; packet.e2y[lane] = edge2.Y; packet.e2z[lane] = edge2.Z;
+    }
+}
+
+// ============================================================================
+// Lane types: the kernels below are written once against these
+// ============================================================================
+// Each provides splat construction, Load/Store, + - * /, ordered < and >
+// (false for NaN, like scalar compares) returning a mask, MinNum/MaxNum
+// with fminf/fmaxf's NaN handling (a NaN operand loses), and Select.
+// Masks provide & | AndNot and Bits(), one bit per lane.
+
+namespace {
+
+struct Mask1 {
+    bool m;
+    friend Mask1 operator&(Mask1 a, Mask1 b) { return { a.m && b.m }; }
+    friend Mask1 operator|(Mask1 a, Mask1 b) { return { a.m || b.m }; }
+    friend Mask1 AndNot(Mask1 a, Mask1 b) { return { a.m && !b.m }; }
+    friend uint32_t Bits(Mask1 a) { return a.m ? 1u : 0u; }
+};
+
+struct Lane1 {
+    static constexpr int kWidth = 1;
+    float v;
+
+    Lane1() = default;
+    Lane1(float f) : v(f) {}
+
+    static Lane1 Load(const float* p) { return Lane1(*p); }
+    void Store(float* p) const { *p = v; }
+    friend Lane1 operator+(Lane1 a, Lane1 b) { return Lane1(a.v + b.v); }
+    friend Lane1 operator-(Lane1 a, Lane1 b) { return Lane1(a.v - b.v); }
+    friend Lane1 operator*(Lane1 a, Lane1 b) { return Lane1(a.v * b.v); }
+    friend Lane1 operator/(Lane1 a, Lane1 b) { return Lane1(a.v / b.v); }
+    friend Mask1 operator<(Lane1 a, Lane1 b) { return { a.v < b.v }; }
+    friend Mask1 operator>(Lane1 a, Lane1 b) { return { a.v > b.v }; }
+    friend Lane1 MinNum(Lane1 a, Lane1 b) { return Lane1(fminf(a.v, b.v)); }
+    friend Lane1 MaxNum(Lane1 a, Lane1 b) { return Lane1(fmaxf(a.v, b.v)); }
+    friend Lane1 Select(Mask1 m, Lane1 a, Lane1 b) { return m.m ? a : b; }
+};
+
+#if defined(RAY_KERNELS_SSE2) || defined(RAY_KERNELS_AVX2)
+struct Mask4 {
+    __m128 m;
+    friend Mask4 operator&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.m, b.m) }; }
+    friend Mask4 operator|(Mask4 a, Mask4 b) { return { _mm_or_ps(a.m, b.m) }; }
+    friend Mask4 AndNot(Mask4 a, Mask4 b) { return { _mm_andnot_ps(b.m, a.m) }; }
+    friend uint32_t Bits(Mask4 a) { return (uint32_t)_mm_movemask_ps(a.m); }
+};
+
+struct Lane4 {
+    static constexpr int kWidth = 4;
+    __m128 v;
+
+    Lane4() = default;
+    Lane4(float f) : v(_mm_set1_ps(f)) {}
+    Lane4(__m128 x) : v(x) {}
+
+    static Lane4 Load(const float* p) { return Lane4(_mm_loadu_ps(p)); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+    friend Lane4 operator+(Lane4 a, Lane4 b) { return Lane4(_mm_add_ps(a.v, b.v)); }
+    friend Lane4 operator-(Lane4 a, Lane4 b) { return Lane4(_mm_sub_ps(a.v, b.v)); }
+    friend Lane4 operator*(Lane4 a, Lane4 b) { return Lane4(_mm_mul_ps(a.v, b.v)); }
+    friend Lane4 operator/(Lane4 a, Lane4 b) { return Lane4(_mm_div_ps(a.v, b.v)); }
+    friend Mask4 operator<(Lane4 a, Lane4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+    friend Mask4 operator>(Lane4 a, Lane4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    // _mm_min_ps returns b when either is NaN; a NaN b is replaced by a
+    friend Lane4 MinNum(Lane4 a, Lane4 b) {
+        __m128 bNaN = _mm_cmpunord_ps(b.v, b.v);
+        return Lane4(_mm_or_ps(_mm_and_ps(bNaN, a.v), _mm_andnot_ps(bNaN, _mm_min_ps(a.v, b.v))));
+    }
+    friend Lane4 MaxNum(Lane4 a, Lane4 b) {
+        __m128 bNaN = _mm_cmpunord_ps(b.v, b.v);
+        return Lane4(_mm_or_ps(_mm_and_ps(bNaN, a.v), _mm_andnot_ps(bNaN, _mm_max_ps(a.v, b.v))));
+    }
+    friend Lane4 Select(Mask4 m, Lane4 a, Lane4 b) {
+        return Lane4(_mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)));
+    }
+};
+#endif
+
+#if defined(RAY_KERNELS_AVX2)
+struct Mask8 {
+    __m256 m;
+    friend Mask8 operator&(Mask8 a, Mask8 b) { return { _mm256_and_ps(a.m, b.m) }; }
+    friend Mask8 operator|(Mask8 a, Mask8 b) { return { _mm256_or_ps(a.m, b.m) }; }
+    friend Mask8 AndNot(Mask8 a, Mask8 b) { return { _mm256_andnot_ps(b.m, a.m) }; }
+    friend uint32_t Bits(Mask8 a) { return (uint32_t)_mm256_movemask_ps(a.m); }
+};
+
+struct Lane8 {
+    static constexpr int kWidth = 8;
+    __m256 v;
+
+    Lane8() = default;
+    Lane8(float f) : v(_mm256_set1_ps(f)) {}
+    Lane8(__m256 x) : v(x) {}
+
+    static Lane8 Load(const float* p) { return Lane8(_mm256_loadu_ps(p)); }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+    friend Lane8 operator+(Lane8 a, Lane8 b) { return Lane8(_mm256_add_ps(a.v, b.v)); }
+    friend Lane8 operator-(Lane8 a, Lane8 b) { return Lane8(_mm256_sub_ps(a.v, b.v)); }
+    friend Lane8 operator*(Lane8 a, Lane8 b) { return Lane8(_mm256_mul_ps(a.v, b.v)); }
+    friend Lane8 operator/(Lane8 a, Lane8 b) { return Lane8(_mm256_div_ps(a.v, b.v)); }
+    friend Mask8 operator<(Lane8 a, Lane8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    friend Mask8 operator>(Lane8 a, Lane8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    friend Lane8 MinNum(Lane8 a, Lane8 b) {
+        __m256 bNaN = _mm256_cmp_ps(b.v, b.v, _CMP_UNORD_Q);
+        return Lane8(_mm256_blendv_ps(_mm256_min_ps(a.v, b.v), a.v, bNaN));
+    }
+    friend Lane8 MaxNum(Lane8 a, Lane8 b) {
+        __m256 bNaN = _mm256_cmp_ps(b.v, b.v, _CMP_UNORD_Q);
+        return Lane8(_mm256_blendv_ps(_mm256_max_ps(a.v, b.v), a.v, bNaN));
+    }
+    friend Lane8 Select(Mask8 m, Lane8 a, Lane8 b) { return Lane8(_mm256_blendv_ps(b.v, a.v, m.m)); }
+};
+#endif
+
+// ============================================================================
+// Kernels: V::kWidth lanes of a packet starting at `lane`
+// ============================================================================
+
+// Möller-Trumbore exactly as ECS::RayTriangleIntersect() writes it
+template <typename V>
+inline uint32_t TriangleLanes(const TrianglePacket& p, int lane, const hmm_vec3& o, const hmm_vec3& d,
+                              float maxDistance, float* outDistance) {
+    const V epsilon(0.0000001f);
+    const V dx(d.X), dy(d.Y), dz(d.Z);
+
+    V e1x = V::Load(p.e1x + lane), e1y = V::Load(p.e1y + lane), e1z = V::Load(p.e1z + lane);
+    V e2x = V::Load(p.e2x + lane), e2y = V::Load(p.e2y + lane), e2z = V::Load(p.e2z + lane);
+
+    // h = d x e2, a = e1 . h
+    V hx = dy * e2z - dz * e2y;
+    V hy = dz * e2x - dx * e2z;
+    V hz = dx * e2y - dy * e2x;
+    V a = e1x * hx + e1y * hy + e1z * hz;
+    auto parallel = (a > V(-0.0000001f)) & (a < epsilon);
+
+    V f = V(1.0f) / a;
+    V sx = V(o.X) - V::Load(p.v0x + lane);
+    V sy = V(o.Y) - V::Load(p.v0y + lane);
+    V sz = V(o.Z) - V::Load(p.v0z + lane);
+    V u = f * (sx * hx + sy * hy + sz * hz);
+    auto outside = (u < V(-kRayEdgeTolerance)) | (u > V(1.0f + kRayEdgeTolerance));
+
+    // q = s x e1
+    V qx = sy * e1z - sz * e1y;
+    V qy = sz * e1x - sx * e1z;
+    V qz = sx * e1y - sy * e1x;
+    V v = f * (dx * qx + dy * qy + dz * qz);
+    outside = outside | (v < V(-kRayEdgeTolerance)) | (u + v > V(1.0f + kRayEdgeTolerance));
+
+    V t = f * (e2x * qx + e2y * qy + e2z * qz);
+    t.Store(outDistance + lane);
+    return Bits(AndNot((t > epsilon) & (t < V(maxDistance)), parallel | outside)) << lane;
+}
+
+// Slab test exactly as ECS::RayBoxIntersect() writes it
+template <typename V>
+inline uint32_t BoxLanes(const BoxPacket& p, int lane, const hmm_vec3& o, const hmm_vec3& inverse,
+                         float* outDistance) {
+    const V ix(inverse.X), iy(inverse.Y), iz(inverse.Z);
+    V t1 = (V::Load(p.minX + lane) - V(o.X)) * ix;
+    V t2 = (V::Load(p.maxX + lane) - V(o.X)) * ix;
+    V t3 = (V::Load(p.minY + lane) - V(o.Y)) * iy;
+    V t4 = (V::Load(p.maxY + lane) - V(o.Y)) * iy;
+    V t5 = (V::Load(p.minZ + lane) - V(o.Z)) * iz;
+    V t6 = (V::Load(p.maxZ + lane) - V(o.Z)) * iz;
+
+    V tmin = MaxNum(MaxNum(MinNum(t1, t2), MinNum(t3, t4)), MinNum(t5, t6));
+    V tmax = MinNum(MinNum(MaxNum(t1, t2), MaxNum(t3, t4)), MaxNum(t5, t6));
+    auto miss = (tmax < V(0.0f)) | (tmin > tmax);
+
+    // Inside the box: the exit point
+    Select(tmin < V(0.0f), tmax, tmin).Store(outDistance + lane);
+    return (~Bits(miss) & ((1u << V::kWidth) - 1)) << lane;
+}
+
+// Slab test against [0, maxDistance] exactly as
+// DynamicAABBTree::RayOverlapsBox() writes it, one ray per lane. tmin and
+// tmax never become NaN (MinNum/MaxNum drop the NaN of 0 * inf), so
+// !(tmin > tmax) is its tmin <= tmax.
+template <typename V>
+inline uint32_t RayLanesBox(const RayPacket& p, int lane, const hmm_vec3& min, const hmm_vec3& max) {
+    V ox = V::Load(p.originX + lane), oy = V::Load(p.originY + lane), oz = V::Load(p.originZ + lane);
+    V ix = V::Load(p.inverseX + lane), iy = V::Load(p.inverseY + lane), iz = V::Load(p.inverseZ + lane);
+    V t1 = (V(min.X) - ox) * ix;
+    V t2 = (V(max.X) - ox) * ix;
+    V tmin = MaxNum(V(0.0f), MinNum(t1, t2));
+    V tmax = MinNum(V::Load(p.maxDistance + lane), MaxNum(t1, t2));
+    t1 = (V(min.Y) - oy) * iy;
+    t2 = (V(max.Y) - oy) * iy;
+    tmin = MaxNum(tmin, MinNum(t1, t2));
+    tmax = MinNum(tmax, MaxNum(t1, t2));
+    t1 = (V(min.Z) - oz) * iz;
+    t2 = (V(max.Z) - oz) * iz;
+    tmin = MaxNum(tmin, MinNum(t1, t2));
+    tmax = MinNum(tmax, MaxNum(t1, t2));
+    return (~Bits(tmin > tmax) & ((1u << V::kWidth) - 1)) << lane;
+}
+
+template <typename V>
+inline uint32_t TrianglePacketWide(const TrianglePacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                                   float maxDistance, uint32_t laneMask, float* outDistance) {
+    uint32_t hits = 0;
+    for (int lane = 0; lane < kRayPacketWidth; lane += V::kWidth) {
+        if ((laneMask >> lane) & ((1u << V::kWidth) - 1)) {
+            hits |= TriangleLanes<V>(packet, lane, origin, direction, maxDistance, outDistance);
+        }
+    }
+    return hits & laneMask;
+}
+
+template <typename V>
+inline uint32_t BoxPacketWide(const BoxPacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                              uint32_t laneMask, float* outDistance) {
+    hmm_vec3 inverse = HMM_Vec3(1.0f / direction.X, 1.0f / direction.Y, 1.0f / direction.Z);
+    uint32_t hits = 0;
+    for (int lane = 0; lane < kRayPacketWidth; lane += V::kWidth) {
+        if ((laneMask >> lane) & ((1u << V::kWidth) - 1)) {
+            hits |= BoxLanes<V>(packet, lane, origin, inverse, outDistance);
+        }
+    }
+    return hits & laneMask;
+}
+
+template <typename V>
+inline uint32_t RayPacketBoxWide(const RayPacket& packet, const hmm_vec3& min, const hmm_vec3& max, uint32_t laneMask) {
+    uint32_t hits = 0;
+    for (int lane = 0; lane < kRayPacketWidth; lane += V::kWidth) {
+        if ((laneMask >> lane) & ((1u << V::kWidth) - 1)) {
+            hits |= RayLanesBox<V>(packet, lane, min, max);
+        }
+    }
+    return hits & laneMask;
+}
+
+#if defined(RAY_KERNELS_AVX2)
+using WideLane = Lane8;
+#elif defined(RAY_KERNELS_SSE2)
+using WideLane = Lane4;
+#else
+using WideLane = Lane1;
+#endif
+
+} // namespace
+
+uint32_t RayTrianglePacket(const TrianglePacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                           float maxDistance, uint32_t laneMask, float outDistance[kRayPacketWidth]) {
+    return TrianglePacketWide<WideLane>(packet, origin, direction, maxDistance, laneMask, outDistance);
+}
+
+uint32_t RayBoxPacket(const BoxPacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                      uint32_t laneMask, float outDistance[kRayPacketWidth]) {
+    return BoxPacketWide<WideLane>(packet, origin, direction, laneMask, outDistance);
+}
+
+uint32_t RayPacketBox(const RayPacket& packet, const hmm_vec3& min, const hmm_vec3& max, uint32_t laneMask) {
+    return RayPacketBoxWide<WideLane>(packet, min, max, laneMask);
+}
+
+uint32_t RayTrianglePacketScalar(const TrianglePacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                                 float maxDistance, uint32_t laneMask, float outDistance[kRayPacketWidth]) {
+    return TrianglePacketWide<Lane1>(packet, origin, direction, maxDistance, laneMask, outDistance);
+}
+
+uint32_t RayBoxPacketScalar(const BoxPacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                            uint32_t laneMask, float outDistance[kRayPacketWidth]) {
+    return BoxPacketWide<Lane1>(packet, origin, direction, laneMask, outDistance);
+}
+
+uint32_t RayPacketBoxScalar(const RayPacket& packet, const hmm_vec3& min, const hmm_vec3& max, uint32_t laneMask) {
+    return RayPacketBoxWide<Lane1>(packet, min, max, laneMask);
+}
+
+const char* RayKernelName() {
+#if defined(RAY_KERNELS_AVX2)
+    return "AVX2";
+#elif defined(RAY_KERNELS_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Components.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// RAY KERNELS - One ray against packets of eight triangles or boxes, and
+// eight rays against one box
+// ============================================================================
+// Packets are structure-of-arrays so a packet is a handful of vector loads:
+// one AVX2 pass over 8 lanes, two SSE2 passes over 4, or eight scalar ones
+// on other targets. Every width runs the same template with the operations
+// of ECS::RayTriangleIntersect() / ECS::RayBoxIntersect() in the same
+// order, so hits, misses and distances match the scalar functions exactly.
+// Fused multiply-adds would break that, so RayKernels.cpp is compiled
+// without them; ECS.cpp may still fuse (GCC/Clang with -mfma), in which
+// case the ECS functions can differ in the last bit.
+//
+// The instruction set is picked at compile time, as for TransformBatch.
+// Results come back as a lane bit mask plus one distance per lane.
+
+// TrianglePacket and kRayPacketWidth live in Components.h (colliders keep
+// their triangles packed)
+
+struct BoxPacket {
+    float minX[kRayPacketWidth], minY[kRayPacketWidth], minZ[kRayPacketWidth];
+    float maxX[kRayPacketWidth], maxY[kRayPacketWidth], maxZ[kRayPacketWidth];
+
+    void Set(int lane, const hmm_vec3& min, const hmm_vec3& max);
+};
+
+// Eight rays walked through a tree together (DynamicAABBTree::RayCastPacket()):
+// lane i is origin + t * direction, 0 <= t <= maxDistance[i]
+struct RayPacket {
+    float originX[kRayPacketWidth] = {}, originY[kRayPacketWidth] = {}, originZ[kRayPacketWidth] = {};
+    float inverseX[kRayPacketWidth] = {}, inverseY[kRayPacketWidth] = {}, inverseZ[kRayPacketWidth] = {};
+    float maxDistance[kRayPacketWidth] = {};
+    uint32_t laneMask = 0;  // Lanes in use
+
+    void Set(int lane, const hmm_vec3& origin, const hmm_vec3& direction, float distance);
+};
+
+// Replaces `outPackets` with the triangles packed eight at a time
+void PackTriangles(const CollisionTriangle* triangles, size_t count, std::vector<TrianglePacket>& outPackets);
+
+// Lanes of `laneMask` whose triangle origin + t * direction hits with
+// epsilon < t < maxDistance; outDistance[lane] is t for those lanes
+uint32_t RayTrianglePacket(const TrianglePacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                           float maxDistance, uint32_t laneMask, float outDistance[kRayPacketWidth]);
+
+// Lanes of `laneMask` whose box the ray line touches in front of the origin,
+// with ECS::RayBoxIntersect()'s distance (the exit point if the origin is
+// inside)
+uint32_t RayBoxPacket(const BoxPacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                      uint32_t laneMask, float outDistance[kRayPacketWidth]);
+
+// Lanes of `laneMask` whose ray passes through the box, with the operations
+// of DynamicAABBTree::RayOverlapsBox() in the same order
+uint32_t RayPacketBox(const RayPacket& packet, const hmm_vec3& min, const hmm_vec3& max, uint32_t laneMask);
+
+// Same results one lane at a time, without SIMD
+uint32_t RayTrianglePacketScalar(const TrianglePacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                                 float maxDistance, uint32_t laneMask, float outDistance[kRayPacketWidth]);
+uint32_t RayBoxPacketScalar(const BoxPacket& packet, const hmm_vec3& origin, const hmm_vec3& direction,
+                            uint32_t laneMask, float outDistance[kRayPacketWidth]);
+uint32_t RayPacketBoxScalar(const RayPacket& packet, const hmm_vec3& min, const hmm_vec3& max, uint32_t laneMask);
+
+// Name of the instruction set the packet kernels were built with
+const char* RayKernelName();
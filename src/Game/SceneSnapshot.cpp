@@ -0,0 +1,755 @@
+#include "SceneSnapshot.h"
+#include "MeshBVH.h"
+#include "Narrowphase.h"
+#include "../Utilities/MappedFile.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+float SceneSnapshot::lastLoadMs_ = 0.0f;
+
+// -- File layout -------------------------------------------------------------
+
+namespace {
+
+constexpr uint64_t kBlockAlignment = 16;
+constexpr uint32_t kNoIndex = 0xFFFFFFFFu;
+
+// Every snapshot has one section per tag, in this order (empty ones too)
+enum SectionTag : uint32_t {
+    kSectionTransform = 0,
+    kSectionRigidbody,
+    kSectionCollider,
+    kSectionTriangles,       // CollisionTriangle blob for collision meshes, no entities
+    kSectionMeshBVH,         // MeshBVHNode blob for collision meshes, no entities
+    kSectionCollisionMesh,   // CollisionMeshRecord per shared mesh, no entities
+    kSectionHeightSamples,   // uint16_t blob for heightfields, no entities
+    kSectionHeightfield,     // HeightfieldRecord per shared heightfield, no entities
+    kSectionSelectable,
+    kSectionSelectableName,  // uint32_t name index per Selectable record, no entities
+    kSectionNames,           // Nul-terminated names, back to back, no entities
+    kSectionLight,
+    kSectionAI,
+    kSectionAnimator,
+    kSectionCharacter,
+    kSectionRenderable,      // int32_t mesh id
+    kSectionParent,          // uint32_t snapshot index of the parent
+    kSectionCount
+};
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entityCount;
+    uint32_t sectionCount;
+};
+
+struct SnapshotSection {
+    uint32_t tag;
+    uint32_t count;         // Records (and entity indices, if any)
+    uint32_t recordSize;    // sizeof one record, checked on load
+    uint32_t reserved;
+    uint64_t entityOffset;  // uint32_t[count] snapshot entity indices, 0 = none
+    uint64_t dataOffset;    // Records
+};
+
+// One shared collision mesh: ranges in the triangle and BVH blocks
+struct CollisionMeshRecord {
+    uint32_t firstTriangle;
+    uint32_t triangleCount;
+    uint32_t firstBVHNode;
+    uint32_t bvhNodeCount;
+};
+
+// One shared heightfield: its grid and a range in the sample block
+struct HeightfieldRecord {
+    int32_t columns;
+    int32_t rows;
+    float cellSize;
+    float originX;
+    float originZ;
+    float minHeight;
+    float heightStep;
+    uint32_t firstSample;
+};
+
+// Collider with its mesh and heightfield handles swapped for
+// kSectionCollisionMesh and kSectionHeightfield indices
+struct ColliderRecord {
+    ColliderType type;
+    float radius;
+    hmm_vec3 boxHalfExtents;
+    float capsuleHeight;
+    float capsuleRadius;
+    hmm_vec3 meshBoundsMin;
+    hmm_vec3 meshBoundsMax;
+    hmm_vec3 planeNormal;
+    float planeDistance;
+    uint8_t isTrigger;
+    uint8_t isStatic;
+    uint8_t useBroadPhase;
+    uint32_t collisionMask;
+    uint32_t collisionLayer;
+    uint32_t meshIndex;         // kNoIndex for non-mesh colliders
+    uint32_t heightfieldIndex;  // kNoIndex for non-heightfield colliders
+};
+
+// Bytes of raw records that must hold a bool or an enum value below
+// `limit`; anything else would be undefined behaviour or an index past a
+// table once loaded
+struct CheckedByte {
+    size_t offset;
+    uint8_t limit;
+};
+
+constexpr uint8_t kBoolLimit = 2;
+
+constexpr CheckedByte kTransformBytes[] = {
+    { offsetof(Transform, useCustomMatrix), kBoolLimit },
+    { offsetof(Transform, dirty), kBoolLimit },
+};
+constexpr CheckedByte kRigidbodyBytes[] = {
+    { offsetof(Rigidbody, affectedByGravity), kBoolLimit },
+    { offsetof(Rigidbody, isKinematic), kBoolLimit },
+    { offsetof(Rigidbody, canSleep), kBoolLimit },
+    { offsetof(Rigidbody, sleeping), kBoolLimit },
+    { offsetof(Rigidbody, continuousCollision), kBoolLimit },
+};
+constexpr CheckedByte kColliderBytes[] = {
+    { offsetof(ColliderRecord, type), (uint8_t)kColliderTypeCount },
+    { offsetof(ColliderRecord, isTrigger), kBoolLimit },
+    { offsetof(ColliderRecord, isStatic), kBoolLimit },
+    { offsetof(ColliderRecord, useBroadPhase), kBoolLimit },
+};
+constexpr CheckedByte kSelectableBytes[] = {
+    { offsetof(Selectable, isSelected), kBoolLimit },
+    { offsetof(Selectable, volumeType), (uint8_t)SelectionVolumeType::Icon + 1 },
+    { offsetof(Selectable, useMeshColliderForPicking), kBoolLimit },
+    { offsetof(Selectable, showWireframe), kBoolLimit },
+    { offsetof(Selectable, canBeSelected), kBoolLimit },
+};
+constexpr CheckedByte kLightBytes[] = {
+    { offsetof(Light, enabled), kBoolLimit },
+};
+constexpr CheckedByte kAIBytes[] = {
+    { offsetof(AIController, state), (uint8_t)AIState::Chase + 1 },
+};
+constexpr CheckedByte kCharacterBytes[] = {
+    { offsetof(CharacterController, grounded), kBoolLimit },
+};
+
+struct CheckedSection {
+    SectionTag tag;
+    const CheckedByte* bytes;
+    size_t count;
+};
+
+constexpr CheckedSection kCheckedSections[] = {
+    { kSectionTransform, kTransformBytes, std::size(kTransformBytes) },
+    { kSectionRigidbody, kRigidbodyBytes, std::size(kRigidbodyBytes) },
+    { kSectionCollider, kColliderBytes, std::size(kColliderBytes) },
+    { kSectionSelectable, kSelectableBytes, std::size(kSelectableBytes) },
+    { kSectionLight, kLightBytes, std::size(kLightBytes) },
+    { kSectionAI, kAIBytes, std::size(kAIBytes) },
+    { kSectionCharacter, kCharacterBytes, std::size(kCharacterBytes) },
+};
+
+static_assert(kColliderTypeCount == (int)ColliderType::Heightfield + 1, "Collider types are checked against the count");
+static_assert(sizeof(ColliderType) == 1 && sizeof(SelectionVolumeType) == 1 && sizeof(AIState) == 1 && sizeof(bool) == 1,
+              "Checked fields are single bytes");
+static_assert(std::is_trivially_copyable_v<Transform>, "Transform is stored raw");
+static_assert(std::is_trivially_copyable_v<Rigidbody>, "Rigidbody is stored raw");
+static_assert(std::is_trivially_copyable_v<Selectable>, "Selectable is stored raw");
+static_assert(std::is_trivially_copyable_v<Light>, "Light is stored raw");
+static_assert(std::is_trivially_copyable_v<AIController>, "AIController is stored raw");
+static_assert(std::is_trivially_copyable_v<Animator>, "Animator is stored raw");
+static_assert(std::is_trivially_copyable_v<CharacterController>, "CharacterController is stored raw");
+static_assert(std::is_trivially_copyable_v<CollisionTriangle>, "CollisionTriangle is stored raw");
+static_assert(std::is_trivially_copyable_v<MeshBVHNode>, "MeshBVHNode is stored raw");
+
+// Record size each tag must have; entity-less sections are marked false
+struct SectionInfo {
+    uint32_t recordSize;
+    bool hasEntities;
+};
+
+constexpr SectionInfo kSectionInfo[kSectionCount] = {
+    { sizeof(Transform), true },
+    { sizeof(Rigidbody), true },
+    { sizeof(ColliderRecord), true },
+    { sizeof(CollisionTriangle), false },
+    { sizeof(MeshBVHNode), false },
+    { sizeof(CollisionMeshRecord), false },
+    { sizeof(uint16_t), false },
+    { sizeof(HeightfieldRecord), false },
+    { sizeof(Selectable), true },
+    { sizeof(uint32_t), false },
+    { 1, false },
+    { sizeof(Light), true },
+    { sizeof(AIController), true },
+    { sizeof(Animator), true },
+    { sizeof(CharacterController), true },
+    { sizeof(int32_t), true },
+    { sizeof(uint32_t), true },
+};
+
+// Builds the whole file in memory: header, section table, then 16-byte
+// aligned blocks
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(uint32_t entityCount) {
+        SnapshotHeader header = { SceneSnapshot::kMagic, SceneSnapshot::kVersion, entityCount, kSectionCount };
+        Append(&header, sizeof(header));
+        sectionTable_ = Append(nullptr, sizeof(SnapshotSection) * kSectionCount);
+    }
+
+    void AddSection(SectionTag tag, size_t count, const uint32_t* entities, const void* records) {
+        SnapshotSection section = {};
+        section.tag = tag;
+        section.count = (uint32_t)count;
+        section.recordSize = kSectionInfo[tag].recordSize;
+        if (entities && count > 0) section.entityOffset = Append(entities, count * sizeof(uint32_t));
+        section.dataOffset = Append(records, count * section.recordSize);
+        memcpy(&bytes_[sectionTable_ + tag * sizeof(SnapshotSection)], &section, sizeof(section));
+    }
+
+    template <typename T>
+    void AddSection(SectionTag tag, const std::vector<uint32_t>& entities, const std::vector<T>& records) {
+        AddSection(tag, records.size(), kSectionInfo[tag].hasEntities ? entities.data() : nullptr, records.data());
+    }
+
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+    uint64_t Append(const void* data, size_t size) {
+        size_t offset = (bytes_.size() + kBlockAlignment - 1) & ~(size_t)(kBlockAlignment - 1);
+        bytes_.resize(offset + size, 0);
+        if (data && size > 0) memcpy(&bytes_[offset], data, size);
+        return offset;
+    }
+
+    std::vector<uint8_t> bytes_;
+    uint64_t sectionTable_ = 0;
+};
+
+// Snapshot index of every entity being saved, by entity slot
+class LocalIndexMap {
+public:
+    // Numbers entities in the order they are added; false if already added
+    bool Add(EntityId id) {
+        uint32_t slot = EntityIndex(id);
+        if (slot >= local_.size()) local_.resize(slot + 1, kNoIndex);
+        if (local_[slot] != kNoIndex) return false;
+        local_[slot] = count_++;
+        return true;
+    }
+
+    // Pools only hold live entities, so the slot alone identifies them
+    uint32_t operator()(EntityId id) const {
+        uint32_t slot = EntityIndex(id);
+        return slot < local_.size() ? local_[slot] : kNoIndex;
+    }
+
+private:
+    std::vector<uint32_t> local_;
+    uint32_t count_ = 0;
+};
+
+template <typename T>
+void WriteRawPool(SnapshotWriter& writer, SectionTag tag, const ComponentPool<T>& pool, const LocalIndexMap& local) {
+    std::vector<uint32_t> entities;
+    std::vector<T> records;
+    entities.reserve(pool.size());
+    records.reserve(pool.size());
+    for (const auto& [id, component] : pool) {
+        uint32_t index = local(id);
+        if (index == kNoIndex) continue;
+        entities.push_back(index);
+        records.push_back(component);
+    }
+    writer.AddSection(tag, entities, records);
+}
+
+// Names are interned for the lifetime of the program: Selectable keeps a
+// plain const char*, and loaded names must outlive the mapped file
+const char* InternName(const char* name) {
+    static std::unordered_set<std::string> names;
+    return names.insert(name).first->c_str();
+}
+
+bool BlockInFile(uint64_t offset, uint64_t count, uint64_t recordSize, size_t fileSize) {
+    if (offset % kBlockAlignment != 0 || offset > fileSize) return false;
+    return count <= (fileSize - offset) / recordSize;
+}
+
+} // namespace
+
+// -- Save ----------------------------------------------------------------------
+
+bool SceneSnapshot::Save(ECS& ecs, const char* path, const std::vector<EntityId>& entities) {
+    LocalIndexMap local;
+    uint32_t entityCount = 0;
+    for (EntityId id : entities) {
+        if (ecs.IsAlive(id) && local.Add(id)) ++entityCount;
+    }
+
+    SnapshotWriter writer(entityCount);
+    WriteRawPool(writer, kSectionTransform, ecs.Storage<Transform>(), local);
+    WriteRawPool(writer, kSectionRigidbody, ecs.Storage<Rigidbody>(), local);
+    WriteRawPool(writer, kSectionLight, ecs.Storage<Light>(), local);
+    WriteRawPool(writer, kSectionAI, ecs.Storage<AIController>(), local);
+    WriteRawPool(writer, kSectionAnimator, ecs.Storage<Animator>(), local);
+    WriteRawPool(writer, kSectionCharacter, ecs.Storage<CharacterController>(), local);
+
+    // Colliders: fixed fields plus an index into the meshes or heightfields
+    // they use, each written once however many colliders share it
+    {
+        std::vector<uint32_t> colliderEntities;
+        std::vector<ColliderRecord> records;
+        std::vector<CollisionMeshRecord> meshes;
+        std::vector<CollisionTriangle> triangles;
+        std::vector<MeshBVHNode> bvhNodes;
+        std::unordered_map<int, uint32_t> meshIndices;  // Registry handle -> meshes index
+        std::vector<HeightfieldRecord> heightfields;
+        std::vector<uint16_t> heightSamples;
+        std::unordered_map<int, uint32_t> heightfieldIndices;  // Registry handle -> heightfields index
+        for (const auto& [id, collider] : ecs.Storage<Collider>()) {
+            uint32_t index = local(id);
+            if (index == kNoIndex) continue;
+            ColliderRecord record = {};
+            record.type = collider.type;
+            record.radius = collider.radius;
+            record.boxHalfExtents = collider.boxHalfExtents;
+            record.capsuleHeight = collider.capsuleHeight;
+            record.capsuleRadius = collider.capsuleRadius;
+            record.meshBoundsMin = collider.meshBoundsMin;
+            record.meshBoundsMax = collider.meshBoundsMax;
+            record.planeNormal = collider.planeNormal;
+            record.planeDistance = collider.planeDistance;
+            record.isTrigger = collider.isTrigger;
+            record.isStatic = collider.isStatic;
+            record.useBroadPhase = collider.useBroadPhase;
+            record.collisionMask = collider.collisionMask;
+            record.collisionLayer = collider.collisionLayer;
+            record.meshIndex = kNoIndex;
+            if (const CollisionMesh* mesh = ecs.collisionMeshes_.Get(collider.meshHandle)) {
+                auto [it, inserted] = meshIndices.emplace(collider.meshHandle, (uint32_t)meshes.size());
+                if (inserted) {
+                    CollisionMeshRecord meshRecord;
+                    meshRecord.firstTriangle = (uint32_t)triangles.size();
+                    meshRecord.triangleCount = (uint32_t)mesh->triangles.size();
+                    meshRecord.firstBVHNode = (uint32_t)bvhNodes.size();
+                    meshRecord.bvhNodeCount = (uint32_t)mesh->bvhNodes.size();
+                    triangles.insert(triangles.end(), mesh->triangles.begin(), mesh->triangles.end());
+                    bvhNodes.insert(bvhNodes.end(), mesh->bvhNodes.begin(), mesh->bvhNodes.end());
+                    meshes.push_back(meshRecord);
+                }
+                record.meshIndex = it->second;
+            }
+            record.heightfieldIndex = kNoIndex;
+            if (const Heightfield* heightfield = ecs.heightfields_.Get(collider.heightfieldHandle)) {
+                auto [it, inserted] = heightfieldIndices.emplace(collider.heightfieldHandle,
+                                                                 (uint32_t)heightfields.size());
+                if (inserted) {
+                    HeightfieldRecord fieldRecord;
+                    fieldRecord.columns = heightfield->columns;
+                    fieldRecord.rows = heightfield->rows;
+                    fieldRecord.cellSize = heightfield->cellSize;
+                    fieldRecord.originX = heightfield->originX;
+                    fieldRecord.originZ = heightfield->originZ;
+                    fieldRecord.minHeight = heightfield->minHeight;
+                    fieldRecord.heightStep = heightfield->heightStep;
+                    fieldRecord.firstSample = (uint32_t)heightSamples.size();
+                    heightSamples.insert(heightSamples.end(), heightfield->samples.begin(), heightfield->samples.end());
+                    heightfields.push_back(fieldRecord);
+                }
+                record.heightfieldIndex = it->second;
+            }
+            colliderEntities.push_back(index);
+            records.push_back(record);
+        }
+        writer.AddSection(kSectionCollider, colliderEntities, records);
+        writer.AddSection(kSectionTriangles, {}, triangles);
+        writer.AddSection(kSectionMeshBVH, {}, bvhNodes);
+        writer.AddSection(kSectionCollisionMesh, {}, meshes);
+        writer.AddSection(kSectionHeightSamples, {}, heightSamples);
+        writer.AddSection(kSectionHeightfield, {}, heightfields);
+    }
+
+    // Selectables: raw records with the name swapped for a name table index
+    {
+        std::vector<uint32_t> selectableEntities;
+        std::vector<Selectable> records;
+        std::vector<uint32_t> nameIndices;
+        std::vector<char> names;
+        std::unordered_map<std::string, uint32_t> nameLookup;
+        for (const auto& [id, selectable] : ecs.Storage<Selectable>()) {
+            uint32_t index = local(id);
+            if (index == kNoIndex) continue;
+            const char* name = selectable.name ? selectable.name : "Entity";
+            auto [it, inserted] = nameLookup.emplace(name, (uint32_t)nameLookup.size());
+            if (inserted) names.insert(names.end(), name, name + strlen(name) + 1);
+
+            Selectable record = selectable;
+            record.name = nullptr;
+            selectableEntities.push_back(index);
+            records.push_back(record);
+            nameIndices.push_back(it->second);
+        }
+        writer.AddSection(kSectionSelectable, selectableEntities, records);
+        writer.AddSection(kSectionSelectableName, {}, nameIndices);
+        writer.AddSection(kSectionNames, {}, names);
+    }
+
+    // Renderables: mesh ids only, instances are recreated on load
+    {
+        std::vector<uint32_t> renderableEntities;
+        std::vector<int32_t> meshIds;
+        for (const auto& [id, renderable] : ecs.Storage<Renderable>()) {
+            uint32_t index = local(id);
+            if (index == kNoIndex) continue;
+            renderableEntities.push_back(index);
+            meshIds.push_back(renderable.meshId);
+        }
+        writer.AddSection(kSectionRenderable, renderableEntities, meshIds);
+    }
+
+    // Parents, as snapshot indices (links leaving the set are dropped)
+    {
+        std::vector<uint32_t> children;
+        std::vector<uint32_t> parents;
+        for (const auto& [id, parent] : ecs.Storage<Parent>()) {
+            if (!ecs.IsAlive(parent.parent)) continue;  // Detached lazily, see ECS::DestroyEntity
+            uint32_t index = local(id);
+            uint32_t parentIndex = local(parent.parent);
+            if (index == kNoIndex || parentIndex == kNoIndex) continue;
+            children.push_back(index);
+            parents.push_back(parentIndex);
+        }
+        writer.AddSection(kSectionParent, children, parents);
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("ERROR: Could not open %s for writing\n", path);
+        return false;
+    }
+    const std::vector<uint8_t>& bytes = writer.bytes();
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        printf("ERROR: Failed to write scene snapshot %s\n", path);
+        return false;
+    }
+
+    printf("Saved scene snapshot %s: %u entities, %zu bytes\n", path, entityCount, bytes.size());
+    return true;
+}
+
+// -- Load ----------------------------------------------------------------------
+
+int SceneSnapshot::Load(ECS& ecs, Renderer& renderer, const char* path, std::vector<EntityId>* outEntities) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MappedFile file;
+    if (!file.Open(path)) return -1;
+    const uint8_t* base = file.data();
+    const size_t size = file.size();
+
+    // Header and section table
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        printf("ERROR: %s is not a scene snapshot\n", path);
+        return -1;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != kMagic) {
+        printf("ERROR: %s is not a scene snapshot\n", path);
+        return -1;
+    }
+    if (header.version != kVersion || header.sectionCount != kSectionCount) {
+        printf("ERROR: Scene snapshot %s has version %u, expected %u\n", path, header.version, kVersion);
+        return -1;
+    }
+    if (header.entityCount > kEntityIndexMask + 1) {
+        printf("ERROR: Scene snapshot %s has too many entities (%u)\n", path, header.entityCount);
+        return -1;
+    }
+
+    uint64_t tableOffset = kBlockAlignment;
+    if (!BlockInFile(tableOffset, kSectionCount, sizeof(SnapshotSection), size)) {
+        printf("ERROR: Scene snapshot %s is truncated\n", path);
+        return -1;
+    }
+    SnapshotSection sections[kSectionCount];
+    memcpy(sections, base + tableOffset, sizeof(sections));
+
+    // Validate everything before creating any entity. sectionsOf[] has a
+    // bit per section the entity has a record in.
+    static_assert(kSectionCount <= 32, "sectionsOf is a 32-bit mask");
+    std::vector<uint32_t> sectionsOf(header.entityCount, 0);
+    for (uint32_t tag = 0; tag < kSectionCount; ++tag) {
+        const SnapshotSection& section = sections[tag];
+        const SectionInfo& info = kSectionInfo[tag];
+        if (section.tag != tag || section.recordSize != info.recordSize) {
+            printf("ERROR: Scene snapshot %s section %u does not match this build's component layout\n", path, tag);
+            return -1;
+        }
+        if (!BlockInFile(section.dataOffset, section.count, section.recordSize, size)) {
+            printf("ERROR: Scene snapshot %s section %u is out of bounds\n", path, tag);
+            return -1;
+        }
+        if (!info.hasEntities || section.count == 0) continue;
+
+        if (!BlockInFile(section.entityOffset, section.count, sizeof(uint32_t), size)) {
+            printf("ERROR: Scene snapshot %s section %u is out of bounds\n", path, tag);
+            return -1;
+        }
+        const uint32_t* indices = (const uint32_t*)(base + section.entityOffset);
+        for (uint32_t i = 0; i < section.count; ++i) {
+            if (indices[i] >= header.entityCount || (sectionsOf[indices[i]] & (1u << tag))) {
+                printf("ERROR: Scene snapshot %s section %u has a bad entity index\n", path, tag);
+                return -1;
+            }
+            sectionsOf[indices[i]] |= 1u << tag;
+        }
+    }
+    
+    for (const CheckedSection& checked : kCheckedSections) {
+        const SnapshotSection& section = sections[checked.tag];
+        const uint8_t* records = base + section.dataOffset;
+        for (uint32_t i = 0; i < section.count; ++i, records += section.recordSize) {
+            for (size_t k = 0; k < checked.count; ++k) {
+                if (records[checked.bytes[k].offset] >= checked.bytes[k].limit) {
+                    printf("ERROR: Scene snapshot %s section %u has a bad record\n", path, (uint32_t)checked.tag);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    const SnapshotSection& colliderSection = sections[kSectionCollider];
+    const ColliderRecord* colliders = (const ColliderRecord*)(base + colliderSection.dataOffset);
+    const CollisionTriangle* triangles = (const CollisionTriangle*)(base + sections[kSectionTriangles].dataOffset);
+    const MeshBVHNode* bvhNodes = (const MeshBVHNode*)(base + sections[kSectionMeshBVH].dataOffset);
+    const SnapshotSection& meshSection = sections[kSectionCollisionMesh];
+    const CollisionMeshRecord* meshes = (const CollisionMeshRecord*)(base + meshSection.dataOffset);
+    for (uint32_t i = 0; i < meshSection.count; ++i) {
+        uint64_t end = (uint64_t)meshes[i].firstTriangle + meshes[i].triangleCount;
+        uint64_t bvhEnd = (uint64_t)meshes[i].firstBVHNode + meshes[i].bvhNodeCount;
+        if (meshes[i].triangleCount == 0 ||
+            end > sections[kSectionTriangles].count || bvhEnd > sections[kSectionMeshBVH].count ||
+            !ValidateMeshBVH(bvhNodes + meshes[i].firstBVHNode, meshes[i].bvhNodeCount, meshes[i].triangleCount)) {
+            printf("ERROR: Scene snapshot %s has a bad collision mesh\n", path);
+            return -1;
+        }
+    }
+    const uint16_t* heightSamples = (const uint16_t*)(base + sections[kSectionHeightSamples].dataOffset);
+    const SnapshotSection& heightfieldSection = sections[kSectionHeightfield];
+    const HeightfieldRecord* heightfields = (const HeightfieldRecord*)(base + heightfieldSection.dataOffset);
+    for (uint32_t i = 0; i < heightfieldSection.count; ++i) {
+        const HeightfieldRecord& record = heightfields[i];
+        uint64_t end = (uint64_t)record.firstSample + (uint64_t)record.columns * (uint64_t)record.rows;
+        if (record.columns < 2 || record.rows < 2 || !(record.cellSize > 0.0f) || !(record.heightStep >= 0.0f) ||
+            end > sections[kSectionHeightSamples].count) {
+            printf("ERROR: Scene snapshot %s has a bad heightfield\n", path);
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < colliderSection.count; ++i) {
+        if (colliders[i].meshIndex != kNoIndex && colliders[i].meshIndex >= meshSection.count) {
+            printf("ERROR: Scene snapshot %s has a bad mesh collider\n", path);
+            return -1;
+        }
+        if (colliders[i].heightfieldIndex != kNoIndex && colliders[i].heightfieldIndex >= heightfieldSection.count) {
+            printf("ERROR: Scene snapshot %s has a bad heightfield collider\n", path);
+            return -1;
+        }
+    }
+
+    const SnapshotSection& selectableSection = sections[kSectionSelectable];
+    const uint32_t* nameIndices = (const uint32_t*)(base + sections[kSectionSelectableName].dataOffset);
+    if (sections[kSectionSelectableName].count != selectableSection.count) {
+        printf("ERROR: Scene snapshot %s has a bad name table\n", path);
+        return -1;
+    }
+    std::vector<const char*> names;
+    {
+        const char* blob = (const char*)(base + sections[kSectionNames].dataOffset);
+        uint32_t blobSize = sections[kSectionNames].count;
+        if (blobSize > 0 && blob[blobSize - 1] != '\0') {
+            printf("ERROR: Scene snapshot %s has a bad name table\n", path);
+            return -1;
+        }
+        for (uint32_t offset = 0; offset < blobSize; offset += (uint32_t)strlen(blob + offset) + 1) {
+            names.push_back(InternName(blob + offset));
+        }
+    }
+    for (uint32_t i = 0; i < selectableSection.count; ++i) {
+        if (nameIndices[i] >= names.size()) {
+            printf("ERROR: Scene snapshot %s has a bad name table\n", path);
+            return -1;
+        }
+    }
+
+    const SnapshotSection& parentSection = sections[kSectionParent];
+    const uint32_t* parentIndices = (const uint32_t*)(base + parentSection.dataOffset);
+    const uint32_t* childIndices = (const uint32_t*)(base + parentSection.entityOffset);
+    const uint32_t unparentable = (1u << kSectionCollider) | (1u << kSectionSelectable);
+    for (uint32_t i = 0; i < parentSection.count; ++i) {
+        if (parentIndices[i] >= header.entityCount) {
+            printf("ERROR: Scene snapshot %s has a bad parent index\n", path);
+            return -1;
+        }
+        if (sectionsOf[childIndices[i]] & unparentable) {
+            printf("ERROR: Scene snapshot %s parents an entity with a collider or selectable\n", path);
+            return -1;
+        }
+    }
+
+    // Entities
+    std::vector<EntityId> ids(header.entityCount);
+    ecs.ReserveEntities(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = ecs.CreateEntity();
+        if (ids[i] == -1) {
+            for (size_t k = 0; k < i; ++k) ecs.DestroyEntity(ids[k]);
+            return -1;
+        }
+    }
+
+    // Snapshot indices of a section -> the entities just created
+    std::vector<EntityId> mapped;
+    auto MapEntities = [&](const SnapshotSection& section) -> const EntityId* {
+        const uint32_t* indices = (const uint32_t*)(base + section.entityOffset);
+        mapped.resize(section.count);
+        for (uint32_t i = 0; i < section.count; ++i) {
+            mapped[i] = ids[indices[i]];
+        }
+        return mapped.data();
+    };
+    auto InsertRaw = [&](auto& pool, SectionTag tag) {
+        using T = typename std::decay_t<decltype(pool)>::value_type;
+        const SnapshotSection& section = sections[tag];
+        if (section.count == 0) return (T*)nullptr;
+        const EntityId* entities = MapEntities(section);
+        return pool.InsertBatch(entities, (const T*)(base + section.dataOffset), section.count);
+    };
+
+    // Raw pools: one bulk copy each
+    if (Transform* loaded = InsertRaw(ecs.Storage<Transform>(), kSectionTransform)) {
+        for (uint32_t i = 0; i < sections[kSectionTransform].count; ++i) {
+            loaded[i].dirty = false;
+            ecs.TouchTransform(mapped[i], loaded[i]);
+        }
+    }
+    InsertRaw(ecs.Storage<Rigidbody>(), kSectionRigidbody);
+    InsertRaw(ecs.Storage<Light>(), kSectionLight);
+    InsertRaw(ecs.Storage<AIController>(), kSectionAI);
+    InsertRaw(ecs.Storage<Animator>(), kSectionAnimator);
+    if (CharacterController* loaded = InsertRaw(ecs.Storage<CharacterController>(), kSectionCharacter)) {
+        for (uint32_t i = 0; i < sections[kSectionCharacter].count; ++i) {
+            loaded[i].groundEntity = -1;  // Refound by the next UpdateCharacters()
+        }
+    }
+
+    if (Selectable* loaded = InsertRaw(ecs.Storage<Selectable>(), kSectionSelectable)) {
+        for (uint32_t i = 0; i < selectableSection.count; ++i) {
+            loaded[i].name = names[nameIndices[i]];
+        }
+    }
+
+    // Meshes and heightfields go into the shared registries (one already
+    // there is reused), then colliders are built in place with the handles
+    std::vector<int> meshHandles(meshSection.count);
+    for (uint32_t i = 0; i < meshSection.count; ++i) {
+        const CollisionMeshRecord& record = meshes[i];
+        meshHandles[i] = ecs.collisionMeshes_.Adopt(triangles + record.firstTriangle, record.triangleCount,
+                                                    bvhNodes + record.firstBVHNode, record.bvhNodeCount);
+    }
+    std::vector<int> heightfieldHandles(heightfieldSection.count);
+    for (uint32_t i = 0; i < heightfieldSection.count; ++i) {
+        const HeightfieldRecord& record = heightfields[i];
+        Heightfield heightfield;
+        heightfield.columns = record.columns;
+        heightfield.rows = record.rows;
+        heightfield.cellSize = record.cellSize;
+        heightfield.originX = record.originX;
+        heightfield.originZ = record.originZ;
+        heightfield.minHeight = record.minHeight;
+        heightfield.heightStep = record.heightStep;
+        const uint16_t* first = heightSamples + record.firstSample;
+        heightfield.samples.assign(first, first + (size_t)record.columns * record.rows);
+        FinishHeightfield(heightfield);
+        heightfieldHandles[i] = ecs.heightfields_.Add(std::move(heightfield));
+    }
+    if (colliderSection.count > 0) {
+        ComponentPool<Collider>& pool = ecs.Storage<Collider>();
+        pool.ReserveAdditional(colliderSection.count);
+        const EntityId* entities = MapEntities(colliderSection);
+        for (uint32_t i = 0; i < colliderSection.count; ++i) {
+            const ColliderRecord& record = colliders[i];
+            Collider& collider = pool.Insert(entities[i], Collider());
+            collider.type = record.type;
+            collider.radius = record.radius;
+            collider.boxHalfExtents = record.boxHalfExtents;
+            collider.capsuleHeight = record.capsuleHeight;
+            collider.capsuleRadius = record.capsuleRadius;
+            collider.meshHandle = record.meshIndex != kNoIndex ? meshHandles[record.meshIndex] : -1;
+            collider.meshBoundsMin = record.meshBoundsMin;
+            collider.meshBoundsMax = record.meshBoundsMax;
+            collider.heightfieldHandle = record.heightfieldIndex != kNoIndex ? heightfieldHandles[record.heightfieldIndex] : -1;
+            collider.planeNormal = record.planeNormal;
+            collider.planeDistance = record.planeDistance;
+            collider.isTrigger = record.isTrigger != 0;
+            collider.isStatic = record.isStatic != 0;
+            collider.useBroadPhase = record.useBroadPhase != 0;
+            collider.collisionMask = record.collisionMask;
+            collider.collisionLayer = record.collisionLayer;
+        }
+    }
+
+    // Renderer instances start at identity; the queued transforms upload
+    // the real matrices at the next SyncToRenderer()
+    const SnapshotSection& renderableSection = sections[kSectionRenderable];
+    if (renderableSection.count > 0) {
+        ComponentPool<Renderable>& pool = ecs.Storage<Renderable>();
+        pool.ReserveAdditional(renderableSection.count);
+        const EntityId* entities = MapEntities(renderableSection);
+        const int32_t* meshIds = (const int32_t*)(base + renderableSection.dataOffset);
+        int missing = 0;
+        for (uint32_t i = 0; i < renderableSection.count; ++i) {
+            Renderable renderable;
+            renderable.meshId = meshIds[i];
+            renderable.instanceId = renderer.AddInstance(meshIds[i], HMM_Mat4d(1.0f));
+            if (renderable.instanceId < 0) {
+                ++missing;
+                continue;
+            }
+            pool.Insert(entities[i], renderable);
+        }
+        if (missing > 0) {
+            printf("WARNING: Scene snapshot %s: %d renderables reference unknown meshes\n", path, missing);
+        }
+    }
+
+    if (parentSection.count > 0) {
+        const EntityId* children = MapEntities(parentSection);
+        for (uint32_t i = 0; i < parentSection.count; ++i) {
+            ecs.SetParent(children[i], ids[parentIndices[i]]);
+        }
+    }
+
+    if (outEntities) outEntities->insert(outEntities->end(), ids.begin(), ids.end());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    lastLoadMs_ = std::chrono::duration<float, std::milli>(end - start).count();
+    printf("Loaded scene snapshot %s: %u entities in %.2f ms\n", path, header.entityCount, lastLoadMs_);
+    return (int)header.entityCount;
+}
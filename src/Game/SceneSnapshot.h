@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ECS.h"
+#include "../Renderer/Renderer.h"
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// SCENE SNAPSHOT - Versioned binary dump of ECS component pools
+// ============================================================================
+// A snapshot stores a set of entities, renumbered 0..N-1, as one section per
+// component type. Each section holds the snapshot indices of its entities
+// followed by their components in pool order:
+//
+//   SnapshotHeader
+//   SnapshotSection[sectionCount]
+//   section blocks, each 16-byte aligned
+//
+// Trivially copyable components (Transform, Rigidbody, Light, AIController,
+// Animator, CharacterController, Selectable minus its name) are written
+// exactly as they sit in memory, so Load() maps the file and copies each
+// one into its pool in a single batch. Only what points outside the
+// component - Selectable names, mesh and heightfield handles, renderer
+// instances, parent links and a character's ground entity - gets a
+// per-entity fix-up. Each shared collision mesh and heightfield is stored
+// once and handed back to its registry on load.
+//
+// Records are raw structs: a snapshot is only readable by a build with the
+// same component layouts. The header version and every section's record
+// size are checked, so anything else is rejected instead of misread, and
+// so is a record whose bool or enum fields hold values they can't have.
+// Mesh references are renderer mesh ids, which are stable as long as init()
+// adds meshes in the same order.
+
+class SceneSnapshot {
+public:
+    static constexpr uint32_t kMagic = 0x534E4353;  // "SCNS"
+    static constexpr uint32_t kVersion = 6;
+
+    // Writes `entities` (dead ones are skipped) and all their components.
+    // Parent links to entities outside the set are dropped.
+    static bool Save(ECS& ecs, const char* path, const std::vector<EntityId>& entities);
+
+    // Creates the snapshot's entities in `ecs` (in addition to the existing
+    // ones) and returns how many, or -1 if the file is missing or invalid.
+    // Nothing is created unless the whole file validates.
+    static int Load(ECS& ecs, Renderer& renderer, const char* path,
+                    std::vector<EntityId>* outEntities = nullptr);
+
+    // Timing of the last Load(), for the editor
+    static float LastLoadMs() { return lastLoadMs_; }
+
+private:
+    static float lastLoadMs_;
+};
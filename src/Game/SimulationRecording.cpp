@@ -0,0 +1,206 @@
+#include "SimulationRecording.h"
+#include "FixedTimestep.h"
+#include "SceneSnapshot.h"
+#include "../Utilities/MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static std::string ScenePath(const char* path) {
+    return std::string(path) + ".scene";
+}
+
+// -- Recording -----------------------------------------------------------------
+
+bool SimulationRecorder::Begin(ECS& ecs, const char* path, EntityId player, float stepRate, uint32_t seed) {
+    if (IsRecording()) End();
+
+    // Slot order, which the snapshot's renumbering keeps
+    std::vector<EntityId> entities = ecs.AllEntities();
+    std::sort(entities.begin(), entities.end(), [](EntityId a, EntityId b) { return EntityIndex(a) < EntityIndex(b); });
+
+    ecs.SetDeterministic(true);
+    ecs.ResetSimulationCaches();
+    if (!SceneSnapshot::Save(ecs, ScenePath(path).c_str(), entities)) {
+        ecs.SetDeterministic(false);
+        return false;
+    }
+    ecs.SeedRandom(seed);
+
+    header_ = RecordingHeader{};
+    header_.magic = kMagic;
+    header_.version = kVersion;
+    header_.seed = seed;
+    header_.stepRate = stepRate;
+    header_.playerIndex = -1;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        if (entities[i] == player) header_.playerIndex = (int32_t)i;
+    }
+    header_.hashGridLayers = ecs.GetHashGridLayers();
+    header_.hashGridCellSize = ecs.GetHashGridCellSize();
+    header_.solverIterations = ecs.GetSolverIterations();
+    header_.broadphaseMode = (uint8_t)ecs.GetBroadphaseMode();
+    header_.warmStarting = ecs.IsWarmStarting() ? 1 : 0;
+    header_.sleepingEnabled = ecs.IsSleepingEnabled() ? 1 : 0;
+
+    ecs_ = &ecs;
+    path_ = path;
+    player_ = header_.playerIndex >= 0 ? player : -1;
+    frames_.clear();
+    printf("Recording %s (%zu entities, seed %u)\n", path, entities.size(), seed);
+    return true;
+}
+
+// Goes through GetTransform() as replay does, so both log the same change
+void SimulationRecorder::CaptureInput() {
+    if (!ecs_) return;
+    RecordedFrame frame{};
+    if (Transform* t = ecs_->GetTransform(player_)) frame.playerYaw = t->yaw;
+    if (CharacterController* character = ecs_->GetCharacter(player_)) {
+        frame.playerVelocity = HMM_Vec3(character->moveVelocity.X, character->verticalVelocity, character->moveVelocity.Z);
+    } else if (Rigidbody* rb = ecs_->GetRigidbody(player_)) {
+        frame.playerVelocity = rb->velocity;
+    }
+    frames_.push_back(frame);
+}
+
+void SimulationRecorder::EndFrame() {
+    if (!ecs_ || frames_.empty()) return;
+    frames_.back().stateHash = ecs_->SimulationHash();
+}
+
+bool SimulationRecorder::End() {
+    if (!ecs_) return false;
+    ecs_->SetDeterministic(false);
+    ecs_ = nullptr;
+    header_.frameCount = (uint32_t)frames_.size();
+
+    FILE* file = fopen(path_.c_str(), "wb");
+    if (!file) {
+        printf("ERROR: Could not open %s for writing\n", path_.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header_, sizeof(header_), 1, file) == 1;
+    if (!frames_.empty()) ok = fwrite(frames_.data(), sizeof(RecordedFrame), frames_.size(), file) == frames_.size() && ok;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        printf("ERROR: Failed to write recording %s\n", path_.c_str());
+        return false;
+    }
+    printf("Saved recording %s: %u frames\n", path_.c_str(), header_.frameCount);
+    return true;
+}
+
+// -- Replay --------------------------------------------------------------------
+
+// One recorded frame in the game's order: input, per-frame systems, one
+// physics step, then the sync points at the end of frame()
+static uint64_t StepFrame(ECS& ecs, Renderer& renderer, EntityId player, const RecordedFrame& input, float dt) {
+    if (Transform* t = ecs.GetTransform(player)) t->yaw = input.playerYaw;
+    if (CharacterController* character = ecs.GetCharacter(player)) {
+        character->moveVelocity = HMM_Vec3(input.playerVelocity.X, 0.0f, input.playerVelocity.Z);
+        character->verticalVelocity = input.playerVelocity.Y;
+    } else if (Rigidbody* rb = ecs.GetRigidbody(player)) {
+        rb->velocity = input.playerVelocity;
+    }
+
+    ecs.UpdateAI(dt);
+    ecs.UpdateAnimation(dt);
+
+    ecs.BeginPhysicsStep();
+    ecs.UpdateCharacters(dt);
+    ecs.UpdatePhysics(dt);
+    ecs.UpdateCollisions(dt);
+    ecs.EndPhysicsStep();
+    uint64_t hash = ecs.SimulationHash();
+
+    ecs.PlaybackCommands(renderer);
+    ecs.SyncToRenderer(renderer);
+    ecs.EndFrame();
+    return hash;
+}
+
+SimulationReplay::Result SimulationReplay::Run(const char* path, JobSystem* jobs, bool runToEnd) {
+    Result result;
+
+    RecordingHeader header;
+    std::vector<RecordedFrame> frames;
+    {
+        MappedFile file;
+        if (!file.Open(path)) return result;
+        if (file.size() < sizeof(header)) {
+            printf("ERROR: %s is not a recording\n", path);
+            return result;
+        }
+        memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != SimulationRecorder::kMagic) {
+            printf("ERROR: %s is not a recording\n", path);
+            return result;
+        }
+        if (header.version != SimulationRecorder::kVersion) {
+            printf("ERROR: Recording %s has version %u, expected %u\n", path, header.version, SimulationRecorder::kVersion);
+            return result;
+        }
+        if ((file.size() - sizeof(header)) / sizeof(RecordedFrame) < header.frameCount) {
+            printf("ERROR: Recording %s is truncated\n", path);
+            return result;
+        }
+        frames.resize(header.frameCount);
+        if (header.frameCount > 0) {
+            memcpy(frames.data(), file.data() + sizeof(header), frames.size() * sizeof(RecordedFrame));
+        }
+    }
+
+    // Same settings as the recorded ECS, then the same reset Begin() did.
+    // Nothing is drawn: the renderer only collects instances.
+    ECS ecs;
+    Renderer renderer;
+    ecs.SetJobSystem(jobs);
+    ecs.SetHashGridLayers(header.hashGridLayers);
+    ecs.SetHashGridCellSize(header.hashGridCellSize);
+    ecs.SetSolverIterations(header.solverIterations);
+    ecs.SetBroadphaseMode((ECS::BroadphaseMode)header.broadphaseMode);
+    ecs.SetWarmStarting(header.warmStarting != 0);
+    ecs.SetSleepingEnabled(header.sleepingEnabled != 0);
+
+    std::vector<EntityId> entities;
+    if (SceneSnapshot::Load(ecs, renderer, ScenePath(path).c_str(), &entities) < 0) return result;
+    EntityId player = -1;
+    if (header.playerIndex >= 0 && (size_t)header.playerIndex < entities.size()) player = entities[header.playerIndex];
+
+    ecs.SetDeterministic(true);
+    ecs.ResetSimulationCaches();
+    ecs.SeedRandom(header.seed);
+    const float dt = FixedTimestep(header.stepRate).StepSize();
+
+    result.loaded = true;
+    result.frames = (int)frames.size();
+    for (const RecordedFrame& frame : frames) {
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t hash = StepFrame(ecs, renderer, player, frame, dt);
+        auto end = std::chrono::high_resolution_clock::now();
+        float ms = std::chrono::duration<float, std::milli>(end - start).count();
+        result.totalMs += ms;
+        result.maxFrameMs = std::max(result.maxFrameMs, ms);
+
+        if (hash != frame.stateHash && result.firstDivergence < 0) {
+            result.firstDivergence = result.simulated;
+            result.expectedHash = frame.stateHash;
+            result.actualHash = hash;
+        }
+        ++result.simulated;
+        if (result.firstDivergence >= 0 && !runToEnd) break;
+    }
+
+    if (result.firstDivergence >= 0) {
+        printf("Replay %s: diverged at frame %d of %d (hash %016llx, recorded %016llx)\n", path, result.firstDivergence,
+               result.frames, (unsigned long long)result.actualHash, (unsigned long long)result.expectedHash);
+    } else {
+        printf("Replay %s: %d frames match\n", path, result.frames);
+    }
+    if (result.simulated > 0) {
+        printf("Replay %s: %.3f ms/frame avg, %.3f ms max\n", path, result.totalMs / result.simulated, result.maxFrameMs);
+    }
+    return result;
+}
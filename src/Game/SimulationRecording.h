@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ECS.h"
+#include "../Utilities/JobSystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// SIMULATION RECORDING - Replayable runs of the deterministic simulation
+// ============================================================================
+// A recording starts from a scene snapshot, written next to it as
+// <path>.scene, and stores per frame the one input that comes from outside
+// the simulation - the player's velocity and facing once PlayerController
+// has applied the keys (for a character, its move velocity with the
+// vertical velocity in Y) - and a hash of the simulated state after the
+// frame's physics step:
+//
+//   RecordingHeader
+//   RecordedFrame[frameCount]
+//
+// Begin() switches the ECS to deterministic mode (see
+// ECS::SetDeterministic()), resets its simulation caches and seeds its
+// random numbers, so from there on the run depends only on the snapshot,
+// the settings in the header and the inputs. Each frame is exactly one
+// physics step of the header's rate.
+//
+// SimulationReplay::Run() loads the snapshot into a fresh ECS without a
+// window or GPU, re-simulates the frames and reports the first one whose
+// hash differs, along with how long the frames took, so a recording is
+// also a repeatable benchmark. Like snapshots, recordings are only valid
+// for the build that made them.
+
+struct RecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t seed;
+    float stepRate;
+    int32_t playerIndex;      // In the snapshot's entity order, -1 for none
+    uint32_t hashGridLayers;
+    float hashGridCellSize;
+    int32_t solverIterations;
+    uint8_t broadphaseMode;
+    uint8_t warmStarting;
+    uint8_t sleepingEnabled;
+    uint8_t reserved;
+};
+
+struct RecordedFrame {
+    hmm_vec3 playerVelocity;
+    float playerYaw;
+    uint64_t stateHash;       // ECS::SimulationHash() after the physics step
+};
+
+class SimulationRecorder {
+public:
+    static constexpr uint32_t kMagic = 0x43455253;  // "SREC"
+    static constexpr uint32_t kVersion = 2;
+
+    // Saves the scene and starts recording; player may be -1
+    bool Begin(ECS& ecs, const char* path, EntityId player, float stepRate, uint32_t seed);
+
+    // Once per frame: after the player's input and before the systems run,
+    // then after the physics step
+    void CaptureInput();
+    void EndFrame();
+
+    // Writes the recording and leaves deterministic mode
+    bool End();
+
+    bool IsRecording() const { return ecs_ != nullptr; }
+    int FrameCount() const { return (int)frames_.size(); }
+
+private:
+    ECS* ecs_ = nullptr;
+    std::string path_;
+    EntityId player_ = -1;
+    RecordingHeader header_{};
+    std::vector<RecordedFrame> frames_;
+};
+
+class SimulationReplay {
+public:
+    struct Result {
+        bool loaded = false;
+        int frames = 0;              // In the recording
+        int simulated = 0;           // Frames re-simulated
+        int firstDivergence = -1;    // First frame whose hash differs
+        uint64_t expectedHash = 0;   // At firstDivergence
+        uint64_t actualHash = 0;
+        float totalMs = 0.0f;        // Simulation only, loading excluded
+        float maxFrameMs = 0.0f;
+    };
+
+    // Re-simulates the recording at path, on `jobs` if given (which must
+    // not change the outcome). By default it stops at the first divergent
+    // frame; runToEnd keeps going, for timing.
+    static Result Run(const char* path, JobSystem* jobs = nullptr, bool runToEnd = false);
+};
@@ -0,0 +1,121 @@
+#include "SpatialHashGrid.h"
+#include <cfloat>
+
+// Buckets per proxy; keeps most buckets to one occupied cell
+static constexpr uint32_t kBucketsPerProxy = 2;
+static constexpr uint32_t kMinBuckets = 64;
+
+void SpatialHashGrid::SetCellSize(float cellSize) {
+    cellSize_ = cellSize > 0.01f ? cellSize : 0.01f;
+    invCellSize_ = 1.0f / cellSize_;
+}
+
+void SpatialHashGrid::Clear() {
+    entries_.clear();
+    bucketStart_.clear();
+    bucketMask_ = 0;
+    stats_ = Stats();
+    stats_.cellSize = cellSize_;
+}
+
+void SpatialHashGrid::Build(const std::vector<BroadphaseProxy>& proxies) {
+    const uint32_t count = (uint32_t)proxies.size();
+    uint32_t bucketCount = kMinBuckets;
+    while (bucketCount < count * kBucketsPerProxy) bucketCount *= 2;
+    bucketMask_ = bucketCount - 1;
+
+    // Count proxies per bucket (shifted by one so the prefix sum below
+    // turns the counts into start offsets)
+    bucketStart_.assign(bucketCount + 1, 0);
+    bucketOf_.resize(count);
+    boundsMin_ = HMM_Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    boundsMax_ = HMM_Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (uint32_t i = 0; i < count; ++i) {
+        const BroadphaseProxy& proxy = proxies[i];
+        int32_t cell[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            cell[axis] = CellCoord((proxy.min.Elements[axis] + proxy.max.Elements[axis]) * 0.5f);
+            if (proxy.min.Elements[axis] < boundsMin_.Elements[axis]) boundsMin_.Elements[axis] = proxy.min.Elements[axis];
+            if (proxy.max.Elements[axis] > boundsMax_.Elements[axis]) boundsMax_.Elements[axis] = proxy.max.Elements[axis];
+        }
+        bucketOf_[i] = Bucket(cell[0], cell[1], cell[2]);
+        ++bucketStart_[bucketOf_[i] + 1];
+    }
+
+    int largest = 0;
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        if ((int)bucketStart_[b + 1] > largest) largest = (int)bucketStart_[b + 1];
+        bucketStart_[b + 1] += bucketStart_[b];
+    }
+
+    // Scatter: each proxy goes to the next free slot of its bucket. The
+    // starts are advanced while filling and shifted back afterwards.
+    entries_.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Entry& entry = entries_[bucketStart_[bucketOf_[i]]++];
+        entry.proxy = proxies[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            entry.cell[axis] = CellCoord((proxies[i].min.Elements[axis] + proxies[i].max.Elements[axis]) * 0.5f);
+        }
+    }
+    for (uint32_t b = bucketCount; b > 0; --b) bucketStart_[b] = bucketStart_[b - 1];
+    bucketStart_[0] = 0;
+
+    // Cells sharing a bucket are rare and buckets short: an insertion sort
+    // makes each cell one run of entries
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        for (uint32_t i = bucketStart_[b] + 1; i < bucketStart_[b + 1]; ++i) {
+            for (uint32_t j = i; j > bucketStart_[b] && CellBefore(entries_[j], entries_[j - 1]); --j) {
+                Entry swap = entries_[j];
+                entries_[j] = entries_[j - 1];
+                entries_[j - 1] = swap;
+            }
+        }
+    }
+
+    stats_.proxies = (int)count;
+    stats_.buckets = (int)bucketCount;
+    stats_.largestBucket = largest;
+    stats_.cellSize = cellSize_;
+}
+
+void SpatialHashGrid::FindPairs(std::vector<BroadphasePair>& outPairs) {
+    // Half of the 26 neighbours: those after the cell in x, then y, then z order
+    static constexpr int32_t kForward[13][3] = {
+        { 1, -1, -1 }, { 1, -1, 0 }, { 1, -1, 1 }, { 1, 0, -1 }, { 1, 0, 0 }, { 1, 0, 1 },
+        { 1, 1, -1 }, { 1, 1, 0 }, { 1, 1, 1 }, { 0, 1, -1 }, { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 1 },
+    };
+
+    stats_.pairs = 0;
+    if (entries_.empty()) return;
+    const size_t before = outPairs.size();
+    auto consider = [&](const BroadphaseProxy& a, const BroadphaseProxy& b) {
+        if (!BoxesOverlap(a.min, a.max, b.min, b.max)) return;
+        if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, a.isStatic,
+                              b.collisionLayer, b.collisionMask, b.isStatic)) {
+            return;
+        }
+        outPairs.emplace_back(a.entity, b.entity);
+    };
+
+    // One cell (a run of entries) at a time: it is paired with itself and
+    // looked up in each neighbour's bucket once
+    const uint32_t count = (uint32_t)entries_.size();
+    for (uint32_t begin = 0, end; begin < count; begin = end) {
+        const int32_t* cell = entries_[begin].cell;
+        for (end = begin + 1; end < count && SameCell(entries_[end].cell, cell); ++end) {}
+
+        for (uint32_t i = begin; i < end; ++i) {
+            for (uint32_t j = i + 1; j < end; ++j) consider(entries_[i].proxy, entries_[j].proxy);
+        }
+        for (const int32_t* offset : kForward) {
+            uint32_t first, last;
+            if (!FindCell(cell[0] + offset[0], cell[1] + offset[1], cell[2] + offset[2], first, last)) continue;
+            for (uint32_t i = begin; i < end; ++i) {
+                for (uint32_t j = first; j < last; ++j) consider(entries_[i].proxy, entries_[j].proxy);
+            }
+        }
+    }
+
+    stats_.pairs = (int)(outPairs.size() - before);
+}
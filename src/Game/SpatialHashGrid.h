@@ -0,0 +1,272 @@
+#pragma once
+
+#include "SweepAndPrune.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// ============================================================================
+// SPATIAL HASH GRID - Broadphase for crowds of similar, small colliders
+// ============================================================================
+// A uniform grid over all of space, rebuilt from scratch every frame. Each
+// proxy goes into the one cell holding its centre; cells are hashed into a
+// power-of-two bucket table and the proxies are counting-sorted by bucket
+// into one flat array (bucket b covers [bucketStart[b], bucketStart[b+1])),
+// so a rebuild is two linear passes with no per-cell containers.
+//
+// Only proxies no larger than a cell fit (see Fits()). Two overlapping ones
+// then sit in the same or in adjacent cells, so FindPairs() compares each
+// proxy with the rest of its own cell and with 13 of its 26 neighbours (the
+// other half reaches it from theirs), each pair once. Cells that share a
+// bucket are told apart by the cell coordinates stored with each proxy and
+// sorted into separate runs within it.
+//
+// Queries look at the cells whose proxies could reach the query volume. A
+// ray walks the cells it crosses (3D DDA) and tests the proxies centred in
+// and around each, so candidates come roughly near to far and the walk
+// stops at the closest hit so far.
+
+class SpatialHashGrid {
+public:
+    struct Stats {
+        int proxies = 0;
+        int buckets = 0;
+        int largestBucket = 0;
+        int pairs = 0;       // Pairs reported by the last FindPairs()
+        float cellSize = 0.0f;
+    };
+
+    static constexpr float kDefaultCellSize = 1.0f;
+
+    explicit SpatialHashGrid(float cellSize = kDefaultCellSize) { SetCellSize(cellSize); }
+
+    // Takes effect at the next Build()
+    void SetCellSize(float cellSize);
+    float GetCellSize() const { return cellSize_; }
+
+    // Whether a proxy reaching at most `radius` from its centre may go into
+    // the grid. Deciding by shape size rather than by the box keeps the
+    // answer the same wherever (and however turned) the proxy is.
+    bool Fits(float radius) const { return radius * 2.0f <= cellSize_; }
+
+    // Replaces the contents with `proxies` (all of which must fit)
+    void Build(const std::vector<BroadphaseProxy>& proxies);
+    void Clear();
+    size_t Size() const { return entries_.size(); }
+
+    // Appends each pair of overlapping boxes that passes BroadphaseFilter() once
+    void FindPairs(std::vector<BroadphasePair>& outPairs);
+
+    // func(EntityId) for every proxy whose box overlaps the query
+    template <typename Func>
+    void QueryAABB(const hmm_vec3& min, const hmm_vec3& max, Func&& func) const {
+        ForEachNear(min, max, [&](const Entry& entry) {
+            if (BoxesOverlap(entry.proxy.min, entry.proxy.max, min, max)) func(entry.proxy.entity);
+        });
+    }
+
+    template <typename Func>
+    void QuerySphere(const hmm_vec3& center, float radius, Func&& func) const {
+        const hmm_vec3 reach = HMM_Vec3(radius, radius, radius);
+        ForEachNear(HMM_SubtractVec3(center, reach), HMM_AddVec3(center, reach), [&](const Entry& entry) {
+            // Squared distance from the centre to the box
+            float distSq = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) {
+                float c = center.Elements[axis];
+                float d = c < entry.proxy.min.Elements[axis] ? entry.proxy.min.Elements[axis] - c
+                        : (c > entry.proxy.max.Elements[axis] ? c - entry.proxy.max.Elements[axis] : 0.0f);
+                distSq += d * d;
+            }
+            if (distSq <= radius * radius) func(entry.proxy.entity);
+        });
+    }
+
+    // func(EntityId) for every proxy that is not static
+    template <typename Func>
+    void ForEachMoving(Func&& func) const {
+        for (const Entry& entry : entries_) {
+            if (!entry.proxy.isStatic) func(entry.proxy.entity);
+        }
+    }
+
+    // func(EntityId, float maxDistance) -> float for every proxy whose box
+    // the ray passes through before maxDistance; it returns the closest hit
+    // distance so far, which shortens the walk (see SpatialIndex::RayCast())
+    template <typename Func>
+    void RayCast(const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, Func&& func) const;
+
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    struct Entry {
+        BroadphaseProxy proxy;
+        int32_t cell[3];
+    };
+
+    static bool BoxesOverlap(const hmm_vec3& minA, const hmm_vec3& maxA, const hmm_vec3& minB, const hmm_vec3& maxB) {
+        return minA.X <= maxB.X && maxA.X >= minB.X &&
+               minA.Y <= maxB.Y && maxA.Y >= minB.Y &&
+               minA.Z <= maxB.Z && maxA.Z >= minB.Z;
+    }
+
+    int32_t CellCoord(float x) const { return (int32_t)floorf(x * invCellSize_); }
+
+    uint32_t Bucket(int32_t x, int32_t y, int32_t z) const {
+        return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) & bucketMask_;
+    }
+
+    static bool SameCell(const int32_t* a, const int32_t* b) { return a[0] == b[0] && a[1] == b[1] && a[2] == b[2]; }
+
+    static bool CellBefore(const Entry& a, const Entry& b) {
+        if (a.cell[0] != b.cell[0]) return a.cell[0] < b.cell[0];
+        if (a.cell[1] != b.cell[1]) return a.cell[1] < b.cell[1];
+        return a.cell[2] < b.cell[2];
+    }
+
+    // The run of entries [outBegin, outEnd) centred in cell (x, y, z)
+    bool FindCell(int32_t x, int32_t y, int32_t z, uint32_t& outBegin, uint32_t& outEnd) const {
+        const int32_t cell[3] = { x, y, z };
+        uint32_t bucket = Bucket(x, y, z);
+        uint32_t i = bucketStart_[bucket];
+        const uint32_t end = bucketStart_[bucket + 1];
+        while (i < end && !SameCell(entries_[i].cell, cell)) ++i;
+        if (i == end) return false;
+        outBegin = i;
+        while (i < end && SameCell(entries_[i].cell, cell)) ++i;
+        outEnd = i;
+        return true;
+    }
+
+    // func(const Entry&) for each entry centred in cell (x, y, z)
+    template <typename Func>
+    void ForEachInCell(int32_t x, int32_t y, int32_t z, Func&& func) const {
+        uint32_t begin, end;
+        if (!FindCell(x, y, z, begin, end)) return;
+        for (uint32_t i = begin; i < end; ++i) func(entries_[i]);
+    }
+
+    // func(const Entry&) for each entry whose box could overlap [min, max]:
+    // those centred within half a cell of it. Visits every entry instead
+    // when the box spans more cells than there are entries.
+    template <typename Func>
+    void ForEachNear(const hmm_vec3& min, const hmm_vec3& max, Func&& func) const {
+        if (entries_.empty()) return;
+        const float half = cellSize_ * 0.5f;
+        int32_t lo[3], hi[3];
+        double cells = 1.0;
+        for (int axis = 0; axis < 3; ++axis) {
+            lo[axis] = CellCoord(min.Elements[axis] - half);
+            hi[axis] = CellCoord(max.Elements[axis] + half);
+            cells *= (double)hi[axis] - lo[axis] + 1.0;
+        }
+        if (cells > (double)entries_.size()) {
+            for (const Entry& entry : entries_) {
+                if (entry.cell[0] >= lo[0] && entry.cell[0] <= hi[0] && entry.cell[1] >= lo[1] &&
+                    entry.cell[1] <= hi[1] && entry.cell[2] >= lo[2] && entry.cell[2] <= hi[2]) {
+                    func(entry);
+                }
+            }
+            return;
+        }
+        for (int32_t x = lo[0]; x <= hi[0]; ++x) {
+            for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+                for (int32_t z = lo[2]; z <= hi[2]; ++z) ForEachInCell(x, y, z, func);
+            }
+        }
+    }
+
+    float cellSize_ = kDefaultCellSize;
+    float invCellSize_ = 1.0f / kDefaultCellSize;
+    uint32_t bucketMask_ = 0;
+    std::vector<Entry> entries_;          // Sorted by bucket
+    std::vector<uint32_t> bucketStart_;   // Per bucket, plus the end
+    std::vector<uint32_t> bucketOf_;      // Build() scratch: bucket of each input proxy
+    hmm_vec3 boundsMin_{0.0f, 0.0f, 0.0f};  // Around every entry's box
+    hmm_vec3 boundsMax_{0.0f, 0.0f, 0.0f};
+    Stats stats_;
+};
+
+template <typename Func>
+void SpatialHashGrid::RayCast(const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, Func&& func) const {
+    if (entries_.empty()) return;
+
+    // Clip the ray to the box around every entry
+    float tEnter = 0.0f, tExit = maxDistance;
+    hmm_vec3 invDir;
+    for (int axis = 0; axis < 3; ++axis) {
+        float d = direction.Elements[axis];
+        invDir.Elements[axis] = d != 0.0f ? 1.0f / d : INFINITY;
+        if (d == 0.0f) {
+            float o = origin.Elements[axis];
+            if (o < boundsMin_.Elements[axis] || o > boundsMax_.Elements[axis]) return;
+            continue;
+        }
+        float t0 = (boundsMin_.Elements[axis] - origin.Elements[axis]) * invDir.Elements[axis];
+        float t1 = (boundsMax_.Elements[axis] - origin.Elements[axis]) * invDir.Elements[axis];
+        if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+        if (t0 > tEnter) tEnter = t0;
+        if (t1 < tExit) tExit = t1;
+    }
+    if (tEnter > tExit) return;
+
+    // DDA from the cell where the clipped ray starts
+    int32_t cell[3], step[3], last[3];
+    float tNext[3], tDelta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        float start = origin.Elements[axis] + direction.Elements[axis] * tEnter;
+        cell[axis] = CellCoord(start);
+        last[axis] = cell[axis] + 3;  // No neighbour shared: nothing skipped on the first cell
+        float d = direction.Elements[axis];
+        if (d > 0.0f) {
+            step[axis] = 1;
+            tNext[axis] = ((cell[axis] + 1) * cellSize_ - origin.Elements[axis]) * invDir.Elements[axis];
+            tDelta[axis] = cellSize_ * invDir.Elements[axis];
+        } else if (d < 0.0f) {
+            step[axis] = -1;
+            tNext[axis] = (cell[axis] * cellSize_ - origin.Elements[axis]) * invDir.Elements[axis];
+            tDelta[axis] = -cellSize_ * invDir.Elements[axis];
+        } else {
+            step[axis] = 0;
+            tNext[axis] = INFINITY;
+            tDelta[axis] = INFINITY;
+        }
+    }
+
+    float tCell = tEnter;
+    while (tCell <= tExit && tCell <= maxDistance) {
+        // A box hit in this cell may be centred in any neighbour of it;
+        // neighbours of the previous cell were already looked at
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+            for (int32_t dy = -1; dy <= 1; ++dy) {
+                for (int32_t dz = -1; dz <= 1; ++dz) {
+                    int32_t x = cell[0] + dx, y = cell[1] + dy, z = cell[2] + dz;
+                    if (abs(x - last[0]) <= 1 && abs(y - last[1]) <= 1 && abs(z - last[2]) <= 1) continue;
+                    ForEachInCell(x, y, z, [&](const Entry& entry) {
+                        // Slab test against the entry's box
+                        float t0 = 0.0f, t1 = maxDistance;
+                        for (int axis = 0; axis < 3 && t0 <= t1; ++axis) {
+                            float o = origin.Elements[axis];
+                            if (direction.Elements[axis] == 0.0f) {
+                                if (o < entry.proxy.min.Elements[axis] || o > entry.proxy.max.Elements[axis]) t0 = INFINITY;
+                                continue;
+                            }
+                            float a = (entry.proxy.min.Elements[axis] - o) * invDir.Elements[axis];
+                            float b = (entry.proxy.max.Elements[axis] - o) * invDir.Elements[axis];
+                            if (a > b) { float t = a; a = b; b = t; }
+                            if (a > t0) t0 = a;
+                            if (b < t1) t1 = b;
+                        }
+                        if (t0 <= t1) maxDistance = func(entry.proxy.entity, maxDistance);
+                    });
+                }
+            }
+        }
+        last[0] = cell[0]; last[1] = cell[1]; last[2] = cell[2];
+
+        int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        tCell = tNext[axis];
+        cell[axis] += step[axis];
+        tNext[axis] += tDelta[axis];
+    }
+}
@@ -0,0 +1,121 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+
+// Entry for the entity's slot; an entry left behind by an earlier
+// generation of the slot is dropped first
+SpatialIndex::Entry& SpatialIndex::EntryFor(EntityId entity) {
+    uint32_t slot = EntityIndex(entity);
+    if (slot >= entries_.size()) entries_.resize(slot + 1);
+    Entry& entry = entries_[slot];
+    if (entry.entity != entity) {
+        Unlink(entry);
+        entry = Entry();
+        entry.entity = entity;
+    }
+    return entry;
+}
+
+// Takes the entry out of whichever tree or list holds it
+void SpatialIndex::Unlink(Entry& entry) {
+    if (entry.proxy != DynamicAABBTree::kNullNode) {
+        (entry.isStatic ? static_ : dynamic_).DestroyProxy(entry.proxy);
+        entry.proxy = DynamicAABBTree::kNullNode;
+    }
+    if (entry.unbounded) {
+        unbounded_.erase(std::find(unbounded_.begin(), unbounded_.end(), entry.entity));
+        entry.unbounded = false;
+    }
+}
+
+void SpatialIndex::Update(const BroadphaseProxy& proxy, bool findPairs) {
+    if (proxy.entity < 0) return;
+    Entry& entry = EntryFor(proxy.entity);
+
+    if (entry.proxy != DynamicAABBTree::kNullNode && entry.isStatic == proxy.isStatic) {
+        DynamicAABBTree& tree = entry.isStatic ? static_ : dynamic_;
+        if (tree.MoveProxy(entry.proxy, proxy.min, proxy.max)) ++reinserts_;
+    } else {
+        Unlink(entry);
+        entry.isStatic = proxy.isStatic;
+        entry.proxy = (entry.isStatic ? static_ : dynamic_).CreateProxy(proxy.entity, proxy.min, proxy.max);
+        ++reinserts_;
+    }
+
+    entry.findPairs = findPairs;
+    entry.collisionLayer = proxy.collisionLayer;
+    entry.collisionMask = proxy.collisionMask;
+    entry.min = proxy.min;
+    entry.max = proxy.max;
+}
+
+void SpatialIndex::UpdateUnbounded(EntityId entity) {
+    if (entity < 0) return;
+    Entry& entry = EntryFor(entity);
+    if (entry.unbounded) return;
+    Unlink(entry);
+    entry.unbounded = true;
+    unbounded_.push_back(entity);
+}
+
+void SpatialIndex::Remove(EntityId entity) {
+    if (!Contains(entity)) return;
+    Entry& entry = entries_[EntityIndex(entity)];
+    Unlink(entry);
+    entry = Entry();
+}
+
+bool SpatialIndex::Contains(EntityId entity) const {
+    uint32_t slot = EntityIndex(entity);
+    return entity >= 0 && slot < entries_.size() && entries_[slot].entity == entity;
+}
+
+void SpatialIndex::Clear() {
+    entries_.clear();
+    unbounded_.clear();
+    dynamic_.Clear();
+    static_.Clear();
+    reinserts_ = 0;
+    lastReinserts_ = 0;
+    lastPairs_ = 0;
+}
+
+void SpatialIndex::FindPairs(std::vector<BroadphasePair>& outPairs) {
+    const size_t firstPair = outPairs.size();
+
+    // The trees are searched with fat boxes; tight boxes and the filter
+    // decide. Moving vs moving and moving vs static only: static pairs
+    // never need a response.
+    auto report = [&](const DynamicAABBTree& treeA, int proxyA, const DynamicAABBTree& treeB, int proxyB) {
+        const Entry& a = entries_[EntityIndex(treeA.GetEntity(proxyA))];
+        const Entry& b = entries_[EntityIndex(treeB.GetEntity(proxyB))];
+        if (!a.findPairs || !b.findPairs) return;
+        if (!DynamicAABBTree::BoxesOverlap(a.min, a.max, b.min, b.max)) return;
+        if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, a.isStatic,
+                              b.collisionLayer, b.collisionMask, b.isStatic)) {
+            return;
+        }
+        outPairs.emplace_back(a.entity, b.entity);
+    };
+    dynamic_.QueryPairs([&](int proxyA, int proxyB) {
+        report(dynamic_, proxyA, dynamic_, proxyB);
+    });
+    dynamic_.QueryPairs(static_, [&](int proxyA, int proxyB) {
+        report(dynamic_, proxyA, static_, proxyB);
+    });
+
+    lastPairs_ = (int)(outPairs.size() - firstPair);
+    lastReinserts_ = reinserts_;
+    reinserts_ = 0;
+}
+
+SpatialIndex::Stats SpatialIndex::GetStats() const {
+    Stats stats;
+    stats.dynamicProxies = dynamic_.ProxyCount();
+    stats.staticProxies = static_.ProxyCount();
+    stats.unbounded = (int)unbounded_.size();
+    stats.dynamicHeight = dynamic_.Height();
+    stats.staticHeight = static_.Height();
+    stats.reinserts = lastReinserts_;
+    stats.pairs = lastPairs_;
+    return stats;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "AABBTree.h"
+#include "SweepAndPrune.h"
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// SPATIAL INDEX - Entity bounds for pair finding, ray and overlap queries
+// ============================================================================
+// Bounded entities go into one of two dynamic AABB trees. Moving ones use
+// fattened boxes so most frames leave their tree untouched. Static ones
+// (trees, ground meshes) get a tree of their own with exact boxes, which is
+// only modified when a static entity is added, edited or moved, and so stays
+// tight no matter how much the rest of the scene churns.
+//
+// Unbounded entities (planes) are in neither tree: every query reports them
+// and the caller's exact test decides. The index keeps the tight box and the
+// collision filter of each entity, so pairs and overlap queries are
+// reported on tight boxes even though the trees are searched with fat ones.
+//
+// ECS keeps one index for colliders and one for selection volumes and feeds
+// both from the component change logs.
+
+class SpatialIndex {
+public:
+    struct Stats {
+        int dynamicProxies = 0;
+        int staticProxies = 0;
+        int unbounded = 0;
+        int dynamicHeight = 0;
+        int staticHeight = 0;
+        int reinserts = 0;   // Leaves (re)inserted between the last two FindPairs()
+        int pairs = 0;       // Pairs reported by the last FindPairs()
+    };
+
+    explicit SpatialIndex(float dynamicMargin) : dynamic_(dynamicMargin), static_(0.0f) {}
+
+    // Inserts or moves the entity's proxy. proxy.isStatic picks the tree;
+    // findPairs = false keeps it out of FindPairs() but not out of queries.
+    void Update(const BroadphaseProxy& proxy, bool findPairs = true);
+    void UpdateUnbounded(EntityId entity);
+    void Remove(EntityId entity);
+    bool Contains(EntityId entity) const;
+    void Clear();
+
+    // Appends each pair of overlapping (tight) boxes that passes
+    // BroadphaseFilter() once. Unbounded entities are left out.
+    void FindPairs(std::vector<BroadphasePair>& outPairs);
+
+    // func(EntityId) for every unbounded entity and every entity whose box
+    // overlaps the query
+    template <typename Func>
+    void QueryAABB(const hmm_vec3& min, const hmm_vec3& max, Func&& func) const {
+        for (EntityId entity : unbounded_) func(entity);
+        auto visit = [&](const DynamicAABBTree& tree) {
+            tree.QueryAABB(min, max, [&](int proxy) {
+                const Entry& entry = entries_[EntityIndex(tree.GetEntity(proxy))];
+                if (DynamicAABBTree::BoxesOverlap(entry.min, entry.max, min, max)) func(entry.entity);
+                return true;
+            });
+        };
+        visit(static_);
+        visit(dynamic_);
+    }
+
+    // func(EntityId) for every entity in the moving tree (findPairs or not)
+    template <typename Func>
+    void ForEachMoving(Func&& func) const {
+        const hmm_vec3 lo = HMM_Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        const hmm_vec3 hi = HMM_Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+        dynamic_.QueryAABB(lo, hi, [&](int proxy) {
+            func(dynamic_.GetEntity(proxy));
+            return true;
+        });
+    }
+
+    template <typename Func>
+    void QuerySphere(const hmm_vec3& center, float radius, Func&& func) const {
+        for (EntityId entity : unbounded_) func(entity);
+        auto visit = [&](const DynamicAABBTree& tree) {
+            tree.QuerySphere(center, radius, [&](int proxy) {
+                const Entry& entry = entries_[EntityIndex(tree.GetEntity(proxy))];
+                if (DynamicAABBTree::SphereOverlapsBox(center, radius, entry.min, entry.max)) func(entry.entity);
+                return true;
+            });
+        };
+        visit(static_);
+        visit(dynamic_);
+    }
+
+    // func(EntityId, float maxDistance) -> float for every candidate along
+    // the ray; it returns the closest hit distance so far, which shortens
+    // the ray for the remaining candidates. Static entities are visited
+    // first so the ground clips the search early.
+    template <typename Func>
+    void RayCast(const hmm_vec3& origin, const hmm_vec3& direction, float maxDistance, Func&& func) const {
+        for (EntityId entity : unbounded_) maxDistance = func(entity, maxDistance);
+        auto visit = [&](const DynamicAABBTree& tree) {
+            tree.RayCast(origin, direction, maxDistance, [&](int proxy, float) {
+                maxDistance = func(tree.GetEntity(proxy), maxDistance);
+                return maxDistance;
+            });
+        };
+        visit(static_);
+        visit(dynamic_);
+    }
+
+    // RayCast() for a packet of rays, each tree walked once for all of them:
+    // func(EntityId, uint32_t lanes) for every candidate with the lanes that
+    // reach it. It shortens those lanes' packet.maxDistance as it finds hits.
+    template <typename Func>
+    void RayCastPacket(RayPacket& packet, Func&& func) const {
+        for (EntityId entity : unbounded_) func(entity, packet.laneMask);
+        auto visit = [&](const DynamicAABBTree& tree) {
+            tree.RayCastPacket(packet, [&](int proxy, uint32_t lanes) { func(tree.GetEntity(proxy), lanes); });
+        };
+        visit(static_);
+        visit(dynamic_);
+    }
+
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        EntityId entity = -1;
+        int proxy = DynamicAABBTree::kNullNode;
+        bool isStatic = false;
+        bool unbounded = false;
+        bool findPairs = true;
+        uint32_t collisionLayer = 0x00000001;
+        uint32_t collisionMask = 0xFFFFFFFF;
+        hmm_vec3 min{0.0f, 0.0f, 0.0f};   // Tight box
+        hmm_vec3 max{0.0f, 0.0f, 0.0f};
+    };
+
+    Entry& EntryFor(EntityId entity);
+    void Unlink(Entry& entry);
+
+    std::vector<Entry> entries_;          // Per entity slot
+    std::vector<EntityId> unbounded_;
+    DynamicAABBTree dynamic_;
+    DynamicAABBTree static_;
+    int reinserts_ = 0;
+    int lastReinserts_ = 0;
+    int lastPairs_ = 0;
+};
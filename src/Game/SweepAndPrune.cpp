@@ -0,0 +1,134 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+// A frame's worth of small moves needs a few swaps per proxy; past this many
+// the order was scrambled (teleports, a new axis) and a full sort is cheaper
+static constexpr size_t kMaxSwapsPerProxy = 8;
+
+void SweepAndPrune::Add(EntityId entity) {
+    if (entity < 0 || Contains(entity)) return;
+    uint32_t slot = EntityIndex(entity);
+    if (slot >= members_.size()) members_.resize(slot + 1, -1);
+    members_[slot] = entity;
+
+    // Bounds are filled in by the caller before the next FindPairs()
+    BroadphaseProxy proxy;
+    proxy.entity = entity;
+    proxies_.push_back(proxy);
+}
+
+void SweepAndPrune::Remove(EntityId entity) {
+    if (Contains(entity)) members_[EntityIndex(entity)] = -1;
+}
+
+void SweepAndPrune::Clear() {
+    proxies_.clear();
+    members_.clear();
+    stats_ = Stats();
+}
+
+int SweepAndPrune::ChooseAxis() const {
+    // Axis with the largest variance of proxy centers
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    float sumSq[3] = { 0.0f, 0.0f, 0.0f };
+    for (const BroadphaseProxy& proxy : proxies_) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float center = (proxy.min.Elements[axis] + proxy.max.Elements[axis]) * 0.5f;
+            sum[axis] += center;
+            sumSq[axis] += center * center;
+        }
+    }
+
+    int best = 0;
+    float bestVariance = -1.0f;
+    float n = (float)(proxies_.size() > 0 ? proxies_.size() : 1);
+    for (int axis = 0; axis < 3; ++axis) {
+        float variance = sumSq[axis] / n - (sum[axis] / n) * (sum[axis] / n);
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            best = axis;
+        }
+    }
+    return best;
+}
+
+void SweepAndPrune::Sort(int axis) {
+    auto byMin = [axis](const BroadphaseProxy& a, const BroadphaseProxy& b) {
+        return a.min.Elements[axis] < b.min.Elements[axis];
+    };
+
+    if (axis != stats_.axis) {
+        std::sort(proxies_.begin(), proxies_.end(), byMin);
+        stats_.swaps = 0;
+        return;
+    }
+
+    // Insertion sort: cheap on the nearly sorted order left by last frame
+    const size_t maxSwaps = kMaxSwapsPerProxy * proxies_.size();
+    size_t swaps = 0;
+    for (size_t i = 1; i < proxies_.size(); ++i) {
+        BroadphaseProxy key = proxies_[i];
+        float keyMin = key.min.Elements[axis];
+        size_t j = i;
+        while (j > 0 && proxies_[j - 1].min.Elements[axis] > keyMin) {
+            proxies_[j] = proxies_[j - 1];
+            --j;
+            ++swaps;
+        }
+        proxies_[j] = key;
+
+        if (swaps > maxSwaps) {
+            std::sort(proxies_.begin(), proxies_.end(), byMin);
+            break;
+        }
+    }
+    stats_.swaps = (int)swaps;
+}
+
+void SweepAndPrune::FindPairs(std::vector<BroadphasePair>& outPairs) {
+    // Drop removed proxies (and duplicates left by Remove() + Add() of the
+    // same entity) without disturbing the order
+    size_t kept = 0;
+    for (size_t i = 0; i < proxies_.size(); ++i) {
+        EntityId entity = proxies_[i].entity;
+        if (!Contains(entity)) continue;
+        members_[EntityIndex(entity)] = ~entity;  // Claimed by this proxy
+        proxies_[kept++] = proxies_[i];
+    }
+    proxies_.resize(kept);
+    for (const BroadphaseProxy& proxy : proxies_) {
+        members_[EntityIndex(proxy.entity)] = proxy.entity;
+    }
+
+    int axis = ChooseAxis();
+    Sort(axis);
+    stats_.axis = axis;
+
+    const int axis1 = (axis + 1) % 3;
+    const int axis2 = (axis + 2) % 3;
+    const size_t count = proxies_.size();
+    const size_t firstPair = outPairs.size();
+
+    for (size_t i = 0; i < count; ++i) {
+        const BroadphaseProxy& a = proxies_[i];
+        const float maxA = a.max.Elements[axis];
+
+        for (size_t j = i + 1; j < count; ++j) {
+            const BroadphaseProxy& b = proxies_[j];
+            if (b.min.Elements[axis] > maxA) break;  // Sorted: nothing further can overlap
+
+            if (a.max.Elements[axis1] < b.min.Elements[axis1] || b.max.Elements[axis1] < a.min.Elements[axis1] ||
+                a.max.Elements[axis2] < b.min.Elements[axis2] || b.max.Elements[axis2] < a.min.Elements[axis2]) {
+                continue;
+            }
+            if (!BroadphaseFilter(a.collisionLayer, a.collisionMask, a.isStatic,
+                                  b.collisionLayer, b.collisionMask, b.isStatic)) {
+                continue;
+            }
+            outPairs.emplace_back(a.entity, b.entity);
+        }
+    }
+
+    stats_.proxies = (int)count;
+    stats_.pairs = (int)(outPairs.size() - firstPair);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "EntityId.h"
+#include "../../External/HandmadeMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// SWEEP AND PRUNE - Broadphase over axis-aligned bounding boxes
+// ============================================================================
+// Proxies are kept sorted by their minimum on one axis. FindPairs() re-sorts
+// them with an insertion sort, which is close to O(n) when things only moved
+// a little since the last frame, then sweeps: each proxy is only compared
+// with the proxies whose interval starts before its own ends. Overlap on the
+// other two axes and the collision filter (layers/masks, static vs static)
+// decide which pairs are reported.
+//
+// The sweep axis is the one along which the proxies are most spread out; it
+// is re-chosen every frame, and a change of axis falls back to a full sort.
+
+struct BroadphaseProxy {
+    EntityId entity = -1;
+    hmm_vec3 min{0.0f, 0.0f, 0.0f};
+    hmm_vec3 max{0.0f, 0.0f, 0.0f};
+    uint32_t collisionLayer = 0x00000001;
+    uint32_t collisionMask = 0xFFFFFFFF;
+    bool isStatic = false;
+};
+
+using BroadphasePair = std::pair<EntityId, EntityId>;
+
+// Same rules as the brute-force loop: layers must match both ways and two
+// static colliders never need a response
+inline bool BroadphaseFilter(uint32_t layerA, uint32_t maskA, bool staticA,
+                             uint32_t layerB, uint32_t maskB, bool staticB) {
+    if (staticA && staticB) return false;
+    return (maskA & layerB) != 0 && (maskB & layerA) != 0;
+}
+
+class SweepAndPrune {
+public:
+    struct Stats {
+        int proxies = 0;
+        int pairs = 0;       // Pairs reported by the last FindPairs()
+        int swaps = 0;       // Insertion sort moves (0 when nothing crossed)
+        int axis = 0;
+    };
+
+    // No-op if the entity already has a proxy
+    void Add(EntityId entity);
+
+    // Lazy: the proxy is dropped at the next FindPairs()
+    void Remove(EntityId entity);
+
+    bool Contains(EntityId entity) const {
+        uint32_t slot = EntityIndex(entity);
+        return slot < members_.size() && members_[slot] == entity;
+    }
+
+    void Clear();
+
+    // Proxies in sweep order. The caller refreshes bounds and filter data
+    // before each FindPairs(); proxies of removed entities may still be
+    // listed until then.
+    std::vector<BroadphaseProxy>& Proxies() { return proxies_; }
+
+    // Appends every overlapping pair that passes the filter, once each
+    void FindPairs(std::vector<BroadphasePair>& outPairs);
+
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    int ChooseAxis() const;
+    void Sort(int axis);
+
+    std::vector<BroadphaseProxy> proxies_;
+    std::vector<EntityId> members_;  // Entity that owns a proxy, per entity slot
+    Stats stats_;
+};
@@ -0,0 +1,90 @@
+#include "SystemScheduler.h"
+#include <chrono>
+
+static bool SystemsConflict(ComponentMask readsA, ComponentMask writesA,
+                            ComponentMask readsB, ComponentMask writesB) {
+    return (writesA & (readsB | writesB)) != 0 || (writesB & readsA) != 0;
+}
+
+void SystemScheduler::AddSystem(const char* name, ComponentMask reads, ComponentMask writes, std::function<void()> run) {
+    SystemEntry entry;
+    entry.name = name;
+    entry.reads = reads;
+    entry.writes = writes;
+    entry.run = std::move(run);
+    systems_.push_back(std::move(entry));
+    phasesDirty_ = true;
+}
+
+void SystemScheduler::Clear() {
+    systems_.clear();
+    phases_.clear();
+    phasesDirty_ = true;
+}
+
+void SystemScheduler::BuildPhases() {
+    phases_.clear();
+
+    for (size_t i = 0; i < systems_.size(); ++i) {
+        SystemEntry& system = systems_[i];
+        int phase = 0;
+        for (size_t j = 0; j < i; ++j) {
+            const SystemEntry& earlier = systems_[j];
+            if (SystemsConflict(system.reads, system.writes, earlier.reads, earlier.writes) &&
+                earlier.phase + 1 > phase) {
+                phase = earlier.phase + 1;
+            }
+        }
+        system.phase = phase;
+
+        if ((int)phases_.size() <= phase) phases_.resize(phase + 1);
+        phases_[phase].push_back(i);
+    }
+
+    phasesDirty_ = false;
+}
+
+int SystemScheduler::PhaseCount() {
+    if (phasesDirty_) BuildPhases();
+    return (int)phases_.size();
+}
+
+void SystemScheduler::RunTimed(SystemEntry& system) {
+    auto start = std::chrono::high_resolution_clock::now();
+    system.run();
+    auto end = std::chrono::high_resolution_clock::now();
+    system.lastMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void SystemScheduler::Run(JobSystem& jobs) {
+    if (phasesDirty_) BuildPhases();
+
+    // Debug mode: deterministic registration order on the calling thread
+    if (jobs.IsSingleThreaded()) {
+        for (SystemEntry& system : systems_) {
+            RunTimed(system);
+        }
+        return;
+    }
+
+    for (const std::vector<size_t>& phase : phases_) {
+        JobCounter counter;
+        for (size_t i = 1; i < phase.size(); ++i) {
+            SystemEntry* system = &systems_[phase[i]];
+            jobs.Submit([system]() { RunTimed(*system); }, counter);
+        }
+
+        // The calling thread runs the first system of the phase itself
+        RunTimed(systems_[phase[0]]);
+        jobs.Wait(counter);
+    }
+}
+
+std::vector<SystemScheduler::SystemStats> SystemScheduler::GetStats() const {
+    std::vector<SystemStats> stats;
+    stats.reserve(systems_.size());
+    for (const SystemEntry& system : systems_) {
+        stats.push_back({ system.name, system.phase, system.lastMs });
+    }
+    return stats;
+}
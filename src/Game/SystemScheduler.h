@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ECS.h"
+#include "../Utilities/JobSystem.h"
+#include <functional>
+#include <vector>
+
+// ============================================================================
+// SYSTEM SCHEDULER - Runs non-conflicting ECS systems in parallel
+// ============================================================================
+// Each system declares the components it reads and writes. Two systems
+// conflict when one writes something the other reads or writes. Systems are
+// grouped into phases: a system lands in the first phase after every earlier
+// system it conflicts with, so registration order is preserved wherever it
+// matters. Systems within a phase run concurrently on the job system; phases
+// run one after another.
+//
+// In single-threaded mode systems simply run in registration order.
+
+class SystemScheduler {
+public:
+    struct SystemStats {
+        const char* name;
+        int phase;
+        float lastMs;
+    };
+
+    void AddSystem(const char* name, ComponentMask reads, ComponentMask writes, std::function<void()> run);
+    void Clear();
+
+    void Run(JobSystem& jobs);
+
+    int PhaseCount();
+    std::vector<SystemStats> GetStats() const;
+
+private:
+    struct SystemEntry {
+        const char* name;
+        ComponentMask reads;
+        ComponentMask writes;
+        std::function<void()> run;
+        int phase = 0;
+        float lastMs = 0.0f;
+    };
+
+    void BuildPhases();
+    static void RunTimed(SystemEntry& system);
+
+    std::vector<SystemEntry> systems_;
+    std::vector<std::vector<size_t>> phases_;
+    bool phasesDirty_ = true;
+};
@@ -0,0 +1,259 @@
+#include "TransformBatch.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+    #define TRANSFORM_BATCH_AVX2 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TRANSFORM_BATCH_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+void TransformBatch::Clear() {
+    posX.clear(); posY.clear(); posZ.clear();
+    pitch.clear(); yaw.clear(); roll.clear();
+    scaleX.clear(); scaleY.clear(); scaleZ.clear();
+    originX.clear(); originY.clear(); originZ.clear();
+}
+
+void TransformBatch::Reserve(size_t count) {
+    posX.reserve(count); posY.reserve(count); posZ.reserve(count);
+    pitch.reserve(count); yaw.reserve(count); roll.reserve(count);
+    scaleX.reserve(count); scaleY.reserve(count); scaleZ.reserve(count);
+    originX.reserve(count); originY.reserve(count); originZ.reserve(count);
+}
+
+void TransformBatch::Push(const Transform& t) {
+    posX.push_back(t.position.X); posY.push_back(t.position.Y); posZ.push_back(t.position.Z);
+    pitch.push_back(t.pitch); yaw.push_back(t.yaw); roll.push_back(t.roll);
+    scaleX.push_back(t.scale.X); scaleY.push_back(t.scale.Y); scaleZ.push_back(t.scale.Z);
+    originX.push_back(t.originOffset.X); originY.push_back(t.originOffset.Y); originZ.push_back(t.originOffset.Z);
+}
+
+// ============================================================================
+// Lane types: the kernel below is written once against these
+// ============================================================================
+// Each provides splat construction, Load, + - *, Abs, and RoundQuadrant(),
+// which rounds to the nearest integer q and also returns q mod 4.
+
+namespace {
+
+struct Lane1 {
+    static constexpr size_t kWidth = 1;
+    float v;
+
+    Lane1() = default;
+    Lane1(float f) : v(f) {}
+
+    static Lane1 Load(const float* p) { return Lane1(*p); }
+    friend Lane1 operator+(Lane1 a, Lane1 b) { return Lane1(a.v + b.v); }
+    friend Lane1 operator-(Lane1 a, Lane1 b) { return Lane1(a.v - b.v); }
+    friend Lane1 operator*(Lane1 a, Lane1 b) { return Lane1(a.v * b.v); }
+    friend Lane1 Abs(Lane1 a) { return Lane1(fabsf(a.v)); }
+
+    friend void RoundQuadrant(Lane1 x, Lane1& q, Lane1& mod4) {
+        int qi = (int)nearbyintf(x.v);
+        q = Lane1((float)qi);
+        mod4 = Lane1((float)(qi & 3));
+    }
+
+    // m[col][row] -> out[0].Elements[col][row]
+    static void StoreMatrices(const Lane1 m[4][4], hmm_mat4* out) {
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                out->Elements[c][r] = m[c][r].v;
+            }
+        }
+    }
+};
+
+#if defined(TRANSFORM_BATCH_SSE2) || defined(TRANSFORM_BATCH_AVX2)
+struct Lane4 {
+    static constexpr size_t kWidth = 4;
+    __m128 v;
+
+    Lane4() = default;
+    Lane4(float f) : v(_mm_set1_ps(f)) {}
+    Lane4(__m128 x) : v(x) {}
+
+    static Lane4 Load(const float* p) { return Lane4(_mm_loadu_ps(p)); }
+    friend Lane4 operator+(Lane4 a, Lane4 b) { return Lane4(_mm_add_ps(a.v, b.v)); }
+    friend Lane4 operator-(Lane4 a, Lane4 b) { return Lane4(_mm_sub_ps(a.v, b.v)); }
+    friend Lane4 operator*(Lane4 a, Lane4 b) { return Lane4(_mm_mul_ps(a.v, b.v)); }
+    friend Lane4 Abs(Lane4 a) { return Lane4(_mm_and_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)))); }
+
+    friend void RoundQuadrant(Lane4 x, Lane4& q, Lane4& mod4) {
+        __m128i qi = _mm_cvtps_epi32(x.v);  // Round to nearest (default MXCSR mode)
+        q = Lane4(_mm_cvtepi32_ps(qi));
+        mod4 = Lane4(_mm_cvtepi32_ps(_mm_and_si128(qi, _mm_set1_epi32(3))));
+    }
+
+    // Each column is transposed from lane-per-entity to one vector per entity
+    static void StoreColumns(__m128 r0, __m128 r1, __m128 r2, __m128 r3, int col, hmm_mat4* out) {
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out[0].Elements[col], r0);
+        _mm_storeu_ps(out[1].Elements[col], r1);
+        _mm_storeu_ps(out[2].Elements[col], r2);
+        _mm_storeu_ps(out[3].Elements[col], r3);
+    }
+
+    static void StoreMatrices(const Lane4 m[4][4], hmm_mat4* out) {
+        for (int c = 0; c < 4; ++c) {
+            StoreColumns(m[c][0].v, m[c][1].v, m[c][2].v, m[c][3].v, c, out);
+        }
+    }
+};
+#endif
+
+#if defined(TRANSFORM_BATCH_AVX2)
+struct Lane8 {
+    static constexpr size_t kWidth = 8;
+    __m256 v;
+
+    Lane8() = default;
+    Lane8(float f) : v(_mm256_set1_ps(f)) {}
+    Lane8(__m256 x) : v(x) {}
+
+    static Lane8 Load(const float* p) { return Lane8(_mm256_loadu_ps(p)); }
+    friend Lane8 operator+(Lane8 a, Lane8 b) { return Lane8(_mm256_add_ps(a.v, b.v)); }
+    friend Lane8 operator-(Lane8 a, Lane8 b) { return Lane8(_mm256_sub_ps(a.v, b.v)); }
+    friend Lane8 operator*(Lane8 a, Lane8 b) { return Lane8(_mm256_mul_ps(a.v, b.v)); }
+    friend Lane8 Abs(Lane8 a) { return Lane8(_mm256_and_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)))); }
+
+    friend void RoundQuadrant(Lane8 x, Lane8& q, Lane8& mod4) {
+        __m256i qi = _mm256_cvtps_epi32(x.v);
+        q = Lane8(_mm256_cvtepi32_ps(qi));
+        mod4 = Lane8(_mm256_cvtepi32_ps(_mm256_and_si256(qi, _mm256_set1_epi32(3))));
+    }
+
+    // Low and high halves are four entities each; reuse the SSE transpose
+    static void StoreMatrices(const Lane8 m[4][4], hmm_mat4* out) {
+        for (int c = 0; c < 4; ++c) {
+            Lane4::StoreColumns(_mm256_castps256_ps128(m[c][0].v), _mm256_castps256_ps128(m[c][1].v),
+                                _mm256_castps256_ps128(m[c][2].v), _mm256_castps256_ps128(m[c][3].v), c, out);
+            Lane4::StoreColumns(_mm256_extractf128_ps(m[c][0].v, 1), _mm256_extractf128_ps(m[c][1].v, 1),
+                                _mm256_extractf128_ps(m[c][2].v, 1), _mm256_extractf128_ps(m[c][3].v, 1), c, out + 4);
+        }
+    }
+};
+#endif
+
+// ============================================================================
+// Vectorized sincos
+// ============================================================================
+// x = q * pi/2 + r with |r| <= pi/4, then minimax polynomials for sin(r) and cos(r) (Cephes sinf/cosf
+// coefficients). The quadrant k = q mod 4 rotates the result without
+// branches: sin(r + k*pi/2) = s*cos(k*pi/2) + c*sin(k*pi/2), where for
+// k in 0..3 cos(k*pi/2) = |k - 2| - 1 and sin(k*pi/2) = 1 - |k - 1|.
+//
+// pi/2 is split in three parts (Cephes DP1..DP3) whose leading ones have
+// few enough mantissa bits that q * part is exact for |x| up to ~8000
+// radians, so r stays accurate with or without fused multiply-adds.
+template <typename V>
+inline void SinCos(V x, V& outSin, V& outCos) {
+    V q, k;
+    RoundQuadrant(x * V(0.63661977236758134f), q, k);  // 2/pi
+
+    V r = x - q * V(1.5703125f);
+    r = r - q * V(4.837512969970703125e-4f);
+    r = r - q * V(7.54978995489188216e-8f);
+
+    V r2 = r * r;
+    V s = r + r * r2 * (V(-1.6666654611e-1f) + r2 * (V(8.3321608736e-3f) + r2 * V(-1.9515295891e-4f)));
+    V c = V(1.0f) - r2 * V(0.5f) +
+          r2 * r2 * (V(4.166664568298827e-2f) + r2 * (V(-1.388731625493765e-3f) + r2 * V(2.443315711809948e-5f)));
+
+    V cosK = Abs(k - V(2.0f)) - V(1.0f);
+    V sinK = V(1.0f) - Abs(k - V(1.0f));
+    outSin = s * cosK + c * sinK;
+    outCos = c * cosK - s * sinK;
+}
+
+// ============================================================================
+// Kernel: V::kWidth transforms starting at index i
+// ============================================================================
+// R = Rx(pitch) * Ry(yaw) * Rz(roll). Column j of the 3x3 part is R's
+// column j times scale j; the translation is position + R * (scale * origin).
+template <typename V>
+inline void ComputeLanes(const TransformBatch& b, size_t i, hmm_mat4* out) {
+    const V degToRad(0.017453292519943295f);
+
+    V sa, ca, sb, cb, sc, cc;
+    SinCos(V::Load(&b.pitch[i]) * degToRad, sa, ca);
+    SinCos(V::Load(&b.yaw[i]) * degToRad, sb, cb);
+    SinCos(V::Load(&b.roll[i]) * degToRad, sc, cc);
+
+    V sx = V::Load(&b.scaleX[i]);
+    V sy = V::Load(&b.scaleY[i]);
+    V sz = V::Load(&b.scaleZ[i]);
+
+    V sasb = sa * sb;
+    V casb = ca * sb;
+
+    V m[4][4];  // [col][row]
+    m[0][0] = (cb * cc) * sx;
+    m[0][1] = (ca * sc + sasb * cc) * sx;
+    m[0][2] = (sa * sc - casb * cc) * sx;
+    m[0][3] = V(0.0f);
+
+    m[1][0] = (V(0.0f) - cb * sc) * sy;
+    m[1][1] = (ca * cc - sasb * sc) * sy;
+    m[1][2] = (sa * cc + casb * sc) * sy;
+    m[1][3] = V(0.0f);
+
+    m[2][0] = sb * sz;
+    m[2][1] = (V(0.0f) - sa * cb) * sz;
+    m[2][2] = (ca * cb) * sz;
+    m[2][3] = V(0.0f);
+
+    V ox = V::Load(&b.originX[i]);
+    V oy = V::Load(&b.originY[i]);
+    V oz = V::Load(&b.originZ[i]);
+    m[3][0] = V::Load(&b.posX[i]) + m[0][0] * ox + m[1][0] * oy + m[2][0] * oz;
+    m[3][1] = V::Load(&b.posY[i]) + m[0][1] * ox + m[1][1] * oy + m[2][1] * oz;
+    m[3][2] = V::Load(&b.posZ[i]) + m[0][2] * ox + m[1][2] * oy + m[2][2] * oz;
+    m[3][3] = V(1.0f);
+
+    V::StoreMatrices(m, out + i);
+}
+
+template <typename V>
+inline size_t ComputeWide(const TransformBatch& b, size_t begin, size_t end, hmm_mat4* out) {
+    size_t i = begin;
+    for (; i + V::kWidth <= end; i += V::kWidth) {
+        ComputeLanes<V>(b, i, out);
+    }
+    return i;
+}
+
+} // namespace
+
+void ComputeModelMatrices(const TransformBatch& batch, size_t begin, size_t end, hmm_mat4* out) {
+    if (end > batch.size()) end = batch.size();
+    size_t i = begin;
+
+#if defined(TRANSFORM_BATCH_AVX2)
+    i = ComputeWide<Lane8>(batch, i, end, out);
+#endif
+#if defined(TRANSFORM_BATCH_SSE2) || defined(TRANSFORM_BATCH_AVX2)
+    i = ComputeWide<Lane4>(batch, i, end, out);
+#endif
+
+    // Remainder
+    ComputeWide<Lane1>(batch, i, end, out);
+}
+
+void ComputeModelMatricesScalar(const TransformBatch& batch, size_t begin, size_t end, hmm_mat4* out) {
+    if (end > batch.size()) end = batch.size();
+    ComputeWide<Lane1>(batch, begin, end, out);
+}
+
+const char* TransformBatchKernelName() {
+#if defined(TRANSFORM_BATCH_AVX2)
+    return "AVX2";
+#elif defined(TRANSFORM_BATCH_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
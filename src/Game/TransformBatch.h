@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Components.h"
+#include <cstddef>
+#include <vector>
+
+// ============================================================================
+// TRANSFORM BATCH - SoA transforms and a SIMD ModelMatrix kernel
+// ============================================================================
+// Transforms are gathered into structure-of-arrays form and turned into
+// instance matrices several at a time: 8 lanes with AVX2, 4 with SSE2, or
+// one at a time on other targets. The kernel evaluates the closed form of
+// Transform::ModelMatrix() (T * Rx * Ry * Rz * S * T(origin)) with a
+// vectorized sincos, so each transform costs one polynomial pass instead of
+// six trig calls and five 4x4 multiplies. Results match ModelMatrix()
+// within float tolerance.
+//
+// The instruction set is picked at compile time (__AVX2__ needs /arch:AVX2
+// or -mavx2). Custom matrices (useCustomMatrix) are not handled here.
+
+struct TransformBatch {
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> pitch, yaw, roll;  // Degrees, as HMM_Rotate expects
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<float> originX, originY, originZ;
+
+    void Clear();
+    void Reserve(size_t count);
+    void Push(const Transform& t);
+    size_t size() const { return posX.size(); }
+};
+
+// Writes the model matrix of batch entries [begin, end) to out[begin, end)
+void ComputeModelMatrices(const TransformBatch& batch, size_t begin, size_t end, hmm_mat4* out);
+
+// Same results one transform at a time, without SIMD
+void ComputeModelMatricesScalar(const TransformBatch& batch, size_t begin, size_t end, hmm_mat4* out);
+
+// Name of the instruction set ComputeModelMatrices() was built with
+const char* TransformBatchKernelName();
@@ -0,0 +1,169 @@
+#include "JobSystem.h"
+#include <cstdio>
+
+// Queue owned by the current thread. 0 is the main thread (and any thread
+// that is not a worker of the pool).
+static thread_local const JobSystem* t_owner = nullptr;
+static thread_local unsigned t_queueIndex = 0;
+
+// Executes a job and signals its counter
+static void RunJob(JobSystem::Job& job, JobCounter* counter) {
+    job();
+    counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+JobSystem::JobSystem() = default;
+
+JobSystem::~JobSystem() {
+    Shutdown();
+}
+
+void JobSystem::Init(unsigned workerCount) {
+    Shutdown();
+
+    if (workerCount == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        workerCount = (hw > 1) ? hw - 1 : 0;
+    }
+
+    queues_.clear();
+    for (unsigned i = 0; i < workerCount + 1; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+
+    running_ = true;
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+
+    printf("JobSystem: %u worker threads (+ main thread)\n", workerCount);
+}
+
+void JobSystem::Shutdown() {
+    if (!running_) return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    queues_.clear();
+    queuedJobs_ = 0;
+}
+
+unsigned JobSystem::CurrentQueueIndex() const {
+    return (t_owner == this) ? t_queueIndex : 0;
+}
+
+void JobSystem::Submit(Job job, JobCounter& counter) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (IsSingleThreaded()) {
+        RunJob(job, &counter);
+        return;
+    }
+
+    // Wrap the counter into the job so thieves can signal it
+    WorkQueue& queue = *queues_[CurrentQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back([job = std::move(job), c = &counter]() mutable { RunJob(job, c); });
+    }
+    queuedJobs_.fetch_add(1, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    wake_.notify_one();
+}
+
+bool JobSystem::TryRunJob(unsigned queueIndex) {
+    Job job;
+
+    // Own queue: newest first (LIFO keeps nested work cache-hot)
+    {
+        WorkQueue& own = *queues_[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    // Steal: oldest first from the other queues
+    if (!job) {
+        size_t queueCount = queues_.size();
+        for (size_t i = 1; i < queueCount && !job; ++i) {
+            WorkQueue& victim = *queues_[(queueIndex + i) % queueCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+            }
+        }
+    }
+
+    if (!job) return false;
+
+    queuedJobs_.fetch_sub(1, std::memory_order_acq_rel);
+    job();
+    return true;
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    if (IsSingleThreaded()) return;  // Everything already ran inline
+
+    unsigned queueIndex = CurrentQueueIndex();
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        if (!TryRunJob(queueIndex)) {
+            // Remaining jobs are running on other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned queueIndex) {
+    t_owner = this;
+    t_queueIndex = queueIndex;
+
+    while (running_) {
+        if (TryRunJob(queueIndex)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this]() {
+            return !running_ || queuedJobs_.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t minChunkSize, const RangeFunc& func) {
+    if (count == 0) return;
+    if (minChunkSize == 0) minChunkSize = 1;
+
+    // Small ranges and debug mode run as a single in-order range
+    if (IsSingleThreaded() || count <= minChunkSize) {
+        func(0, count);
+        return;
+    }
+
+    // A few chunks per thread so stealing can even out uneven work
+    size_t maxChunks = (size_t)ThreadCount() * 4;
+    size_t chunkCount = (count + minChunkSize - 1) / minChunkSize;
+    if (chunkCount > maxChunks) chunkCount = maxChunks;
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    JobCounter counter;
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+        size_t end = (begin + chunkSize < count) ? begin + chunkSize : count;
+        Submit([&func, begin, end]() { func(begin, end); }, counter);
+    }
+
+    // The calling thread takes the first chunk itself
+    func(0, chunkSize < count ? chunkSize : count);
+    Wait(counter);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// JOB SYSTEM - Work-stealing thread pool
+// ============================================================================
+// Every thread (the main thread plus each worker) owns a job queue. A thread
+// pops its own newest job first and steals the oldest job from other queues
+// when it runs dry. Wait() never blocks idle: the waiting thread keeps
+// executing jobs until its counter reaches zero, so jobs may submit and wait
+// on nested jobs (e.g. a system that splits its entity range).
+//
+// In single-threaded mode every job runs inline at Submit() in submission
+// order, which gives fully deterministic execution for debugging.
+
+// Tracks outstanding jobs from one batch
+struct JobCounter {
+    std::atomic<int> pending{0};
+};
+
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+    using RangeFunc = std::function<void(size_t begin, size_t end)>;
+
+    JobSystem();
+    ~JobSystem();
+
+    // workerCount = 0 picks hardware_concurrency - 1 (the main thread also works)
+    void Init(unsigned workerCount = 0);
+    void Shutdown();
+
+    void SetSingleThreaded(bool singleThreaded) { singleThreaded_ = singleThreaded; }
+    bool IsSingleThreaded() const { return singleThreaded_ || workers_.empty(); }
+
+    // Threads that execute jobs, including the calling thread
+    unsigned ThreadCount() const { return IsSingleThreaded() ? 1u : (unsigned)workers_.size() + 1u; }
+
+    // 0 for the main thread, 1..WorkerCount() for workers. Stable per thread,
+    // so it can index per-thread data (e.g. ECS command buffers).
+    unsigned CurrentThreadIndex() const { return CurrentQueueIndex(); }
+    unsigned WorkerCount() const { return (unsigned)workers_.size(); }
+
+    void Submit(Job job, JobCounter& counter);
+    void Wait(JobCounter& counter);
+
+    // Splits [0, count) into chunks of at least minChunkSize and runs them
+    // across all threads. Returns once every chunk has finished.
+    void ParallelFor(size_t count, size_t minChunkSize, const RangeFunc& func);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void WorkerLoop(unsigned queueIndex);
+    bool TryRunJob(unsigned queueIndex);
+    unsigned CurrentQueueIndex() const;
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;  // [0] = main thread
+
+    std::atomic<bool> running_{false};
+    std::atomic<int> queuedJobs_{0};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+
+    bool singleThreaded_ = false;
+};
@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path) {
+    Close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("ERROR: Could not open %s\n", path);
+        return false;
+    }
+    file_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        printf("ERROR: %s is empty or unreadable\n", path);
+        Close();
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        printf("ERROR: CreateFileMapping failed for %s (%lu)\n", path, GetLastError());
+        Close();
+        return false;
+    }
+    mapping_ = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        printf("ERROR: MapViewOfFile failed for %s (%lu)\n", path, GetLastError());
+        Close();
+        return false;
+    }
+
+    data_ = (const uint8_t*)view;
+    size_ = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle((HANDLE)mapping_);
+    if (file_) CloseHandle((HANDLE)file_);
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    file_ = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path) {
+    Close();
+
+    fd_ = open(path, O_RDONLY);
+    if (fd_ < 0) {
+        printf("ERROR: Could not open %s\n", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || info.st_size == 0) {
+        printf("ERROR: %s is empty or unreadable\n", path);
+        Close();
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (view == MAP_FAILED) {
+        printf("ERROR: mmap failed for %s\n", path);
+        Close();
+        return false;
+    }
+
+    data_ = (const uint8_t*)view;
+    size_ = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) munmap((void*)data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+}
+
+#endif